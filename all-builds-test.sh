@@ -41,8 +41,10 @@ build --enable-compatible
 build --disable-server
 build --disable-argp
 build --disable-verbose-lexer
+build --log-level-floor=error
 build --enable-hash-statistics
 build --disable-hash-warnings
+build --sorted-set-backend=btree
 build --no-defer-pkg-config
 build --ldflags="-Wl,--as-needed"
 
@@ -57,8 +59,10 @@ build --enable-compatible --O3 --build=release
 build --disable-server --build=release
 build --disable-argp --build=release
 build --disable-verbose-lexer --build=release
+build --log-level-floor=error --build=release
 build --enable-hash-statistics --build=release
 build --disable-hash-warnings --build=release
+build --sorted-set-backend=btree --build=release
 build --no-defer-pkg-config --build=release
 build --ldflags="-Wl,--as-needed" --build=release
 
@@ -73,6 +77,7 @@ build --disable-server --build=w64
 build --disable-verbose-lexer --build=w64
 build --enable-hash-statistics --build=w64
 build --disable-hash-warnings --build=w64
+build --sorted-set-backend=btree --build=w64
 build --no-defer-pkg-config --build=w64
 build --ldflags="-Wl,--as-needed" --build=w64
 
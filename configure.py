@@ -77,13 +77,16 @@ parser.add_argument('--O3', '--o3', action='store_true',
 parser.add_argument('--disable-test-tool', action='append', default=[],
                     choices=[
                         'gperf_test', 'lex_test', 'hash_test',
-                        'sorted_set_test', 'hash_test2', 'lex_test2'
+                        'sorted_set_test', 'hash_test2', 'lex_test2',
+                        'parse_bench', 'parse_test', 'bench', 'server_bench',
+                        'game_state_test', 'name_set_test',
+                        'ngram_index_test', 'string_pool_test'
                     ],
                     help='don\'t build a specific test tool')
 parser.add_argument('--disable-tool', action='append', default=[],
                     choices=[
                         'cards_compile', 'cards_inspect',
-                        'save_create', 'save_inspect'
+                        'save_create', 'save_inspect', 'log_decode'
                     ],
                     help='don\'t build a specific tool')
 parser.add_argument('--disable-client', action='append', default=[],
@@ -100,9 +103,19 @@ parser.add_argument('--lua-backend',
 parser.add_argument('--disable-argp', action='store_true',
                     help='fall back to getopt for argument parsing')
 
+parser.add_argument('--sorted-set-backend',
+                    choices=['skiplist', 'btree'], default='skiplist',
+                    help='set the sorted set implementation ' +
+                         '(default: skiplist)')
+
 parser.add_argument('--disable-verbose-lexer', action='store_true',
                     help='don\'t enable the verbose lexer')
 
+parser.add_argument('--log-level-floor',
+                    choices=['verbose', 'info', 'error'], default='verbose',
+                    help='compile out logging below this level ' +
+                         '(default: verbose)')
+
 parser.add_argument('--force-version', metavar='STRING',
                     help='override the version string')
 parser.add_argument('--add-version-suffix', metavar='SUFFIX',
@@ -196,7 +209,8 @@ def build(source,
           output_prefix = '$builddir/',
           packages = [],
           cflags = '$cflags',
-          includes = '$includes'):
+          includes = '$includes',
+          output = None):
 
     variables = []
     cflags = ' '.join([cflags] + ['$' + name + '_cflags' for name in packages])
@@ -206,11 +220,21 @@ def build(source,
     if includes != '$includes':
         variables += [('includes', includes)]
 
+    # anything might include command/keyword.h, so nothing is compiled before
+    # the headers generated from the keyword list exist
+    order_only = []
+    if rule == 'cc':
+        order_only = ['$builddir/include/command/keywords.h']
+
+    if output is None:
+        output = transformer(source, rule)
+
     w.build(
-            output_prefix + transformer(source, rule),
+            output_prefix + output,
             rule,
             input_prefix + source,
-            variables = variables
+            variables = variables,
+            order_only = order_only
         )
 
 def exesuffix(root, enabled):
@@ -444,7 +468,8 @@ else:
 # INCLUDES
 #
 
-w.variable(key = 'includes', value = '-Iinclude -Ilibs/hash/include')
+w.variable(key = 'includes',
+           value = '-Iinclude -I$builddir/include -Ilibs/hash/include')
 w.newline()
 
 #
@@ -482,6 +507,15 @@ else:
     w.variable(key = 'defines', value = '$defines -DVERBOSE_LEXER=1')
 w.newline()
 
+#
+# --log-level-floor
+#
+if args.log_level_floor != 'verbose':
+    w.comment('-DLOG_LEVEL_FLOOR because we were generated with --log-level-floor=' + args.log_level_floor)
+    w.variable('defines', '$defines -DLOG_LEVEL_FLOOR=LOG_' +
+               args.log_level_floor.upper())
+    w.newline()
+
 #
 # --enable-hash-statistics
 #
@@ -547,6 +581,8 @@ w.newline()
 package('sqlite3')
 package('libevent', libs = {"w64": "-lws2_32 -liphlpapi"})
 package('jansson')
+package('threads', pkg_config = False, libs = { 'all': '-pthread' })
+package('math', pkg_config = False, libs = { 'all': '-lm' })
 package('unistring', pkg_config = False, libs = {
     'debug': '-lunistring',
     'release': '-lunistring',
@@ -598,6 +634,13 @@ w.rule(
     )
 w.newline()
 
+w.rule(
+        name = 'keywords',
+        command = 'python3 misc/generate_keywords.py $in ' +
+                  '--header $header --gperf $gperf_out'
+    )
+w.newline()
+
 #
 # SOURCES
 #
@@ -607,7 +650,9 @@ w.comment('source files')
 build('bundle.c', packages = ['sqlite3'])
 build('card.c', packages = ['lua'])
 build('config_loader.c', packages = ['lua'])
-build('game.c')
+build('game.c', packages = ['unistring'])
+build('look_cache.c', packages = ['unistring'])
+build('game_state.c')
 build('name_set.c', packages = ['unistring'])
 build('main.c', packages = ['unistring', 'libevent'])
 build('networker.c', packages = ['unistring'])
@@ -615,8 +660,19 @@ build('server.c')
 w.newline()
 
 build('util/log.c', packages = ['unistring'])
+build('util/log_format.c')
 build('util/refstring.c', packages = ['unistring'])
-build('util/sorted_set.c')
+if args.sorted_set_backend == 'btree':
+    w.comment('the sorted set is a B+tree because we were generated with ' +
+              '--sorted-set-backend=btree')
+    build('util/sorted_set_btree.c', output = 'util/sorted_set.o')
+else:
+    build('util/sorted_set.c')
+build('util/arena.c')
+build('util/metrics.c')
+build('util/ngram_index.c')
+build('util/string_pool.c')
+build('util/timer_wheel.c')
 build('util/strdup.c')
 build('util/checksum.c')
 w.newline()
@@ -633,6 +689,14 @@ build('test/lex_test.c', packages = ['unistring'])
 build('test/sorted_set_test.c')
 build('test/hash_test2.c')
 build('test/lex_test2.c', packages = ['unistring'])
+build('test/parse_bench.c')
+build('test/parse_test.c')
+build('test/bench.c', packages = ['unistring'])
+build('test/server_bench.c', packages = ['libevent'])
+build('test/game_state_test.c')
+build('test/name_set_test.c')
+build('test/ngram_index_test.c')
+build('test/string_pool_test.c')
 w.newline()
 
 build('tools/cards_compile/cards_compile.c', packages = ['sqlite3'])
@@ -647,6 +711,12 @@ build('tools/cards_inspect/args_argp.c',
       cflags = '$cflags -Wno-missing-field-initializers')
 w.newline()
 
+build('tools/log_decode/log_decode.c', packages = ['unistring', 'jansson'])
+build('tools/log_decode/args_getopt.c')
+build('tools/log_decode/args_argp.c',
+      cflags = '$cflags -Wno-missing-field-initializers')
+w.newline()
+
 build('tools/save_create/save_create.c', packages = ['sqlite3', 'jansson'])
 build('tools/save_create/args_getopt.c')
 build('tools/save_create/args_argp.c',
@@ -672,7 +742,20 @@ build('client/rlcli/args_argp.c',
       cflags = '$cflags -Wno-missing-field-initializers')
 w.newline()
 
-build('command/keyword.gperf', rule = 'gperf')
+w.build(
+        [
+            '$builddir/include/command/keywords.h',
+            '$builddir/command/keyword.gperf'
+        ],
+        'keywords',
+        'src/command/keywords.txt',
+        implicit = ['misc/generate_keywords.py'],
+        variables = [
+            ('header', '$builddir/include/command/keywords.h'),
+            ('gperf_out', '$builddir/command/keyword.gperf')
+        ]
+    )
+build('command/keyword.gperf', rule = 'gperf', input_prefix = '$builddir/')
 w.newline()
 
 build('hash.c',
@@ -743,15 +826,24 @@ bin_target(
             '$builddir/networker.o',
             '$builddir/card.o',
             '$builddir/game.o',
+            '$builddir/look_cache.o',
+            '$builddir/game_state.o',
             '$builddir/server.o',
+            '$builddir/util/arena.o',
             '$builddir/util/log.o',
+            '$builddir/util/log_format.o',
+            '$builddir/util/metrics.o',
+            '$builddir/util/ngram_index.o',
+            '$builddir/util/string_pool.o',
             '$builddir/util/refstring.o',
             '$builddir/util/sorted_set.o',
             '$builddir/util/strdup.o',
+            '$builddir/util/timer_wheel.o',
             '$builddir/libs/hash/hash.o'
         ],
         variables = [
-            ('libs', '$libevent_libs $lua_libs $unistring_libs $sqlite3_libs')
+            ('libs', '$libevent_libs $lua_libs $unistring_libs $sqlite3_libs ' +
+             '$threads_libs')
         ],
         is_disabled = [
             args.disable_server,
@@ -784,15 +876,24 @@ bin_target(
             '$builddir/name_set.o',
             '$builddir/bundle.o',
             '$builddir/game.o',
+            '$builddir/look_cache.o',
+            '$builddir/game_state.o',
             '$builddir/card.o',
             '$builddir/test/lex_test.o',
+            '$builddir/util/arena.o',
+            '$builddir/util/ngram_index.o',
+            '$builddir/util/string_pool.o',
             '$builddir/util/refstring.o',
             '$builddir/util/strdup.o',
             '$builddir/util/sorted_set.o',
             '$builddir/util/log.o',
+            '$builddir/util/log_format.o',
+            '$builddir/util/metrics.o',
             '$builddir/libs/hash/hash.o'
         ],
-        variables = [('libs', '$sqlite3_libs $lua_libs $unistring_libs')],
+        variables = [
+            ('libs', '$sqlite3_libs $lua_libs $unistring_libs $threads_libs')
+        ],
         is_disabled = [
             args.lua_backend == 'none',
             'lex_test' in args.disable_test_tool
@@ -804,6 +905,149 @@ bin_target(
         targets = [all_targets, tools_targets]
     )
 
+bin_target(
+        name = 'test/parse_bench',
+        inputs = [
+            '$builddir/test/parse_bench.o',
+            '$builddir/command/lex.o',
+            '$builddir/command/keyword.o',
+            '$builddir/command/parse.o',
+            '$builddir/name_set.o',
+            '$builddir/card.o',
+            '$builddir/libs/hash/hash.o',
+            '$builddir/util/arena.o',
+            '$builddir/util/ngram_index.o',
+            '$builddir/util/string_pool.o',
+            '$builddir/util/sorted_set.o',
+            '$builddir/util/refstring.o',
+            '$builddir/util/log.o',
+            '$builddir/util/log_format.o',
+            '$builddir/util/metrics.o'
+        ],
+        variables = [('libs', '$unistring_libs $lua_libs $threads_libs')],
+        is_disabled = [
+            'parse_bench' in args.disable_test_tool,
+            args.lua_backend == 'none'
+        ],
+        why_disabled = [
+            'we were generated with --disable-test-tool=parse_bench',
+            'we were generated with --lua-backend=none'
+        ],
+        targets = [all_targets, tools_targets]
+    )
+
+bin_target(
+        name = 'test/parse_test',
+        inputs = [
+            '$builddir/test/parse_test.o',
+            '$builddir/command/lex.o',
+            '$builddir/command/keyword.o',
+            '$builddir/command/parse.o',
+            '$builddir/name_set.o',
+            '$builddir/bundle.o',
+            '$builddir/game.o',
+            '$builddir/look_cache.o',
+            '$builddir/game_state.o',
+            '$builddir/card.o',
+            '$builddir/libs/hash/hash.o',
+            '$builddir/util/arena.o',
+            '$builddir/util/ngram_index.o',
+            '$builddir/util/string_pool.o',
+            '$builddir/util/sorted_set.o',
+            '$builddir/util/refstring.o',
+            '$builddir/util/strdup.o',
+            '$builddir/util/log.o',
+            '$builddir/util/log_format.o',
+            '$builddir/util/metrics.o'
+        ],
+        variables = [
+            ('libs', '$sqlite3_libs $lua_libs $unistring_libs $threads_libs')
+        ],
+        is_disabled = [
+            'parse_test' in args.disable_test_tool,
+            args.lua_backend == 'none'
+        ],
+        why_disabled = [
+            'we were generated with --disable-test-tool=parse_test',
+            'we were generated with --lua-backend=none'
+        ],
+        targets = [all_targets, tools_targets]
+    )
+
+bin_target(
+        name = 'test/bench',
+        inputs = [
+            '$builddir/test/bench.o',
+            '$builddir/command/lex.o',
+            '$builddir/command/keyword.o',
+            '$builddir/game_state.o',
+            '$builddir/name_set.o',
+            '$builddir/card.o',
+            '$builddir/libs/hash/hash.o',
+            '$builddir/util/arena.o',
+            '$builddir/util/ngram_index.o',
+            '$builddir/util/string_pool.o',
+            '$builddir/util/sorted_set.o',
+            '$builddir/util/refstring.o',
+            '$builddir/util/log.o',
+            '$builddir/util/log_format.o',
+            '$builddir/util/metrics.o'
+        ],
+        variables = [
+            ('libs', '$unistring_libs $lua_libs $threads_libs $math_libs')
+        ],
+        is_disabled = [
+            'bench' in args.disable_test_tool,
+            args.lua_backend == 'none'
+        ],
+        why_disabled = [
+            'we were generated with --disable-test-tool=bench',
+            'we were generated with --lua-backend=none'
+        ],
+        targets = [all_targets, tools_targets]
+    )
+
+bin_target(
+        name = 'test/server_bench',
+        inputs = [
+            '$builddir/test/server_bench.o',
+            '$builddir/bundle.o',
+            '$builddir/command/keyword.o',
+            '$builddir/command/lex.o',
+            '$builddir/command/parse.o',
+            '$builddir/name_set.o',
+            '$builddir/networker.o',
+            '$builddir/card.o',
+            '$builddir/game.o',
+            '$builddir/look_cache.o',
+            '$builddir/game_state.o',
+            '$builddir/util/arena.o',
+            '$builddir/util/log.o',
+            '$builddir/util/log_format.o',
+            '$builddir/util/metrics.o',
+            '$builddir/util/ngram_index.o',
+            '$builddir/util/string_pool.o',
+            '$builddir/util/refstring.o',
+            '$builddir/util/sorted_set.o',
+            '$builddir/util/strdup.o',
+            '$builddir/util/timer_wheel.o',
+            '$builddir/libs/hash/hash.o'
+        ],
+        variables = [
+            ('libs', '$libevent_libs $lua_libs $unistring_libs $sqlite3_libs ' +
+             '$threads_libs')
+        ],
+        is_disabled = [
+            'server_bench' in args.disable_test_tool,
+            args.lua_backend == 'none'
+        ],
+        why_disabled = [
+            'we were generated with --disable-test-tool=server_bench',
+            'we were generated with --lua-backend=none'
+        ],
+        targets = [all_targets, tools_targets]
+    )
+
 bin_target(
         name = 'clients/cli',
         inputs = [
@@ -870,6 +1114,71 @@ bin_target(
         targets = [all_targets, tools_targets]
     )
 
+bin_target(
+        name = 'test/game_state_test',
+        inputs = [
+            '$builddir/test/game_state_test.o',
+            '$builddir/game_state.o'
+        ],
+        is_disabled = 'game_state_test' in args.disable_test_tool,
+        why_disabled =
+            'we were generated with --disable-test-tool=game_state_test',
+        targets = [all_targets, tools_targets]
+    )
+
+bin_target(
+        name = 'test/name_set_test',
+        inputs = [
+            '$builddir/test/name_set_test.o',
+            '$builddir/name_set.o',
+            '$builddir/card.o',
+            '$builddir/libs/hash/hash.o',
+            '$builddir/util/arena.o',
+            '$builddir/util/ngram_index.o',
+            '$builddir/util/string_pool.o',
+            '$builddir/util/sorted_set.o',
+            '$builddir/util/refstring.o',
+            '$builddir/util/log.o',
+            '$builddir/util/log_format.o',
+            '$builddir/util/metrics.o'
+        ],
+        variables = [('libs', '$unistring_libs $lua_libs $threads_libs')],
+        is_disabled = [
+            'name_set_test' in args.disable_test_tool,
+            args.lua_backend == 'none'
+        ],
+        why_disabled = [
+            'we were generated with --disable-test-tool=name_set_test',
+            'we were generated with --lua-backend=none'
+        ],
+        targets = [all_targets, tools_targets]
+    )
+
+bin_target(
+        name = 'test/ngram_index_test',
+        inputs = [
+            '$builddir/test/ngram_index_test.o',
+            '$builddir/util/ngram_index.o'
+        ],
+        is_disabled = 'ngram_index_test' in args.disable_test_tool,
+        why_disabled =
+            'we were generated with --disable-test-tool=ngram_index_test',
+        targets = [all_targets, tools_targets]
+    )
+
+bin_target(
+        name = 'test/string_pool_test',
+        inputs = [
+            '$builddir/test/string_pool_test.o',
+            '$builddir/util/string_pool.o',
+            '$builddir/util/arena.o'
+        ],
+        is_disabled = 'string_pool_test' in args.disable_test_tool,
+        why_disabled =
+            'we were generated with --disable-test-tool=string_pool_test',
+        targets = [all_targets, tools_targets]
+    )
+
 bin_target(
         name = 'test/lex_test2',
         inputs = [
@@ -879,11 +1188,16 @@ bin_target(
             '$builddir/name_set.o',
             '$builddir/card.o',
             '$builddir/libs/hash/hash.o',
+            '$builddir/util/arena.o',
+            '$builddir/util/ngram_index.o',
+            '$builddir/util/string_pool.o',
             '$builddir/util/sorted_set.o',
             '$builddir/util/refstring.o',
-            '$builddir/util/log.o'
+            '$builddir/util/log.o',
+            '$builddir/util/log_format.o',
+            '$builddir/util/metrics.o'
         ],
-        variables = [('libs', '$unistring_libs $lua_libs')],
+        variables = [('libs', '$unistring_libs $lua_libs $threads_libs')],
         is_disabled = [
             'lex_test2' in args.disable_test_tool,
             args.lua_backend == 'none'
@@ -931,6 +1245,7 @@ bin_target(
         name = 'tools/cards_inspect',
         inputs = [
             '$builddir/tools/cards_inspect/cards_inspect.o',
+            '$builddir/util/sorted_set.o',
             '$builddir/util/strdup.o'
         ],
         argp_inputs = [
@@ -951,6 +1266,25 @@ bin_target(
         targets = [all_targets, tools_targets]
     )
 
+bin_target(
+        name = 'tools/log_decode',
+        inputs = [
+            '$builddir/tools/log_decode/log_decode.o',
+            '$builddir/util/log_format.o',
+            '$builddir/util/strdup.o'
+        ],
+        argp_inputs = [
+            '$builddir/tools/log_decode/args_argp.o'
+        ],
+        getopt_inputs = [
+            '$builddir/tools/log_decode/args_getopt.o'
+        ],
+        variables = [('libs', '$unistring_libs $jansson_libs')],
+        is_disabled = 'log_decode' in args.disable_tool,
+        why_disabled = 'we were generated with --disable-tool=log_decode',
+        targets = [all_targets, tools_targets]
+    )
+
 bin_target(
         name = 'tools/save_create',
         inputs = [
@@ -15,3 +15,59 @@
 -- along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 -- config.port = 10101
+
+-- per-connection flow control, in bytes (0 disables each one)
+--
+-- config.read_low_watermark = 0
+-- config.read_high_watermark = 64 * 1024
+-- config.write_low_watermark = 16 * 1024
+-- config.write_high_watermark = 256 * 1024
+-- config.output_limit = 4 * 1024 * 1024
+-- config.input_limit = 64 * 1024
+
+-- connection timeouts, in seconds (0 disables each one)
+--
+-- config.handshake_timeout = 30
+-- config.lobby_timeout = 10 * 60
+
+-- rate limits (a rate of 0 disables it, a burst of 0 or less than the rate
+-- means the same as the rate)
+--
+-- input over the limits waits until there are enough tokens for it, it is
+-- never dropped. the server_ limits are shared by every connection.
+--
+-- config.commands_per_second = 20
+-- config.command_burst = 40
+-- config.bytes_per_second = 16 * 1024
+-- config.byte_burst = 64 * 1024
+-- config.server_bytes_per_second = 0
+-- config.server_byte_burst = 0
+
+-- the most commands processed from one connection before the other
+-- connections get a turn (0 means no limit)
+--
+-- config.commands_per_turn = 8
+
+-- admin commands (stats, connections, reload, shutdown) are only accepted on
+-- this unix domain socket, e.g. with: echo stats | nc -U cards-admin.sock
+-- ("" disables it)
+--
+-- config.admin_socket = "cards-admin.sock"
+
+-- log messages wait in a ring of log_ring_size messages to be written by a
+-- background thread. when it is full, log_overflow decides whether new
+-- messages are dropped (and counted) or wait for room.
+--
+-- config.log_ring_size = 1024
+-- config.log_overflow = "drop" -- or "block"
+
+-- the lowest level of messages written: "verbose", "info", or "error"
+--
+-- config.log_level = "verbose"
+
+-- "text" logs are written to stdout and stderr. "binary" logs record each
+-- message's call site, timestamp and arguments in log_file without formatting
+-- them (decode them with tools/log_decode)
+--
+-- config.log_format = "text"
+-- config.log_file = "cards.log"
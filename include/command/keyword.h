@@ -22,38 +22,10 @@
 
 #include <stddef.h>
 
-enum keyword {
-    KEYWORD_NO_MATCH,
-
-    KEYWORD_SAY,
-    KEYWORD_EXIT,
-    KEYWORD_SHUTDOWN,
-
-    KEYWORD_LOAD,
-
-    KEYWORD_LIFE,
-
-    KEYWORD_ENERGY,
-    KEYWORD_SOURCES,
-
-    KEYWORD_MY,
-    KEYWORD_PLAYER,
-
-    KEYWORD_HAND,
-    KEYWORD_DECK,
-    KEYWORD_DISCARD,
-    KEYWORD_GRAVE,
-    KEYWORD_ZONE,
-    KEYWORD_ID,
-    KEYWORD_SPECIAL,
-
-    KEYWORD_POSITION,
-
-    KEYWORD_CARD,
-    KEYWORD_IN,
-
-    KEYWORD_LOOK
-};
+/* enum keyword (and enum command_type) are generated from
+ * src/command/keywords.txt, along with the gperf input for keyword_lookup()
+ */
+#include "command/keywords.h"
 
 struct keyword_lookup_result {
     int offset;
@@ -20,42 +20,153 @@
 #ifndef COMMAND_PARSE_H
 #define COMMAND_PARSE_H
 
+#include "command/keyword.h"
+
+#include <stddef.h>
+
 /* forward declare */
+struct particle;
 struct particle_buffer;
 struct game;
+struct arena;
+struct parser_frame;
+struct parser_symbol;
 
+/* a parser, which turns the particles of lexed commands into commands (see
+ * planning/grammar)
+ *
+ * the fields other than game are private to src/command/parse.c
+ */
 struct parser {
     struct game * game;
+
+    /* the commands, arguments and values are allocated from this, and it is
+     * reset at the start of every parser_parse()
+     */
+    struct arena * arena;
+
+    /* the parse stack (of positions in the productions of the grammar) and
+     * the stack of the arguments being built, which are kept between calls so
+     * that parsing doesn't allocate once they are big enough
+     */
+    const struct parser_symbol ** stack;
+    size_t stack_capacity;
+    struct parser_frame * frames;
+    size_t frames_capacity;
+};
+
+/* the type of a value */
+enum value_type {
+    VALUE_NONE,
+    VALUE_NUMBER, /* .particle is the PARTICLE_NUMBER and .number its value */
+    VALUE_NAME, /* .particle is the PARTICLE_NAME (see particle->name) */
+    VALUE_SUBCOMMAND, /* .subcommand is a nested command, i.e. ( ... ) */
+    VALUE_PARTICLES /* .particles is a run of .n_particles particles */
+};
+
+/* a value, i.e. what an argument refers to by number, name, or the result of
+ * a subcommand
+ */
+struct value {
+    enum value_type type;
+    struct particle * particle;
+    long number;
+    struct command * subcommand;
+    struct particle ** particles;
+    size_t n_particles;
+};
+
+/* the type of an argument */
+enum argument_type {
+    ARGUMENT_PLAYER, /* .keyword is MY, or PLAYER with a .value */
+    ARGUMENT_STACK, /* .keyword is HAND, DECK, DISCARD, GRAVE, SPECIAL (for
+                     * ZONE SPECIAL), or ZONE with a .value
+                     */
+    ARGUMENT_POSITION, /* .value is the position */
+    ARGUMENT_LOCATION, /* .children are [PLAYER] STACK [POSITION] */
+    ARGUMENT_CARD, /* .value is the id or name of the card (if given), and
+                    * .children is its [LOCATION]
+                    */
+    ARGUMENT_MOVE, /* .children is the CARD, and .value the id or name of the
+                    * ability
+                    */
+    ARGUMENT_LIFE, /* .children is the [PLAYER] */
+    ARGUMENT_ENERGY, /* .children is the [PLAYER], .keyword is SOURCES if the
+                      * sources were asked for
+                      */
+    ARGUMENT_FACE, /* .keyword is UP or DOWN */
+    ARGUMENT_MODE, /* .keyword is ATTACK or DEFENSE */
+    ARGUMENT_LIST, /* .keyword is PLAYERS, STACKS, or ZONES, .children is the
+                    * [PLAYER]
+                    */
+    ARGUMENT_PREFIX, /* .value is the name to complete (of a COMPLETE) */
+    ARGUMENT_COUNT, /* .value is how many results are wanted */
+    ARGUMENT_TEXT /* .value is the particles (of a SAY) */
 };
 
-/*
-enum command_type {
-    COMMAND_SUBCOMMAND,
-    COMMAND_SAY,
-    COMMAND_EXIT,
-    COMMAND_SHUTDOWN
+/* an argument of a command, which may have arguments of its own */
+struct argument {
+    enum argument_type type;
+    enum keyword keyword;
+    struct value value;
+    struct argument * children;
+    struct argument * next;
 };
 
+/* a command
+ *
+ * particles is where the command came from (not including its PARTICLE_END
+ * or, for a subcommand, its parentheses), which is only valid until the
+ * particle buffer is changed
+ */
 struct command {
     enum command_type type;
     struct argument * arguments;
-    struct command * subcommands;
-    size_t n_subcommands;
+
+    struct particle ** particles;
+    size_t n_particles;
+
+    /* for COMMAND_ERROR, a message and the index (into particles) of the
+     * particle it is about
+     */
+    const char * error;
+    size_t error_index;
+
+    struct command * next;
 };
-*/
 
+/* create a parser for this game */
 [[nodiscard]] struct parser * parser_create(struct game * game);
+
+/* destroy this parser */
 void parser_destroy(struct parser * parser) [[gnu::nonnull(1)]];
 
 enum parse_result_type {
-    PARSE_OKAY,
-    PARSE_ERROR
+    PARSE_OKAY, /* every command parsed */
+    PARSE_ERROR /* at least one command is a COMMAND_ERROR */
 };
 
+/* the result of parser_parse()
+ *
+ * commands is a list (see command->next) of every complete command in the
+ * particles, in order. empty commands (i.e. blank lines) are left out.
+ */
 struct parse_result {
     enum parse_result_type type;
+    struct command * commands;
+    size_t n_commands;
+    size_t n_errors;
 };
 
+/* parse every complete command in these particles into result
+ *
+ * the commands are allocated from the parser and are only valid until the
+ * next call to parser_parse() (or parser_destroy()) on it, and until the
+ * particle buffer is changed
+ *
+ * parsing does not allocate memory (except to grow the parser when it sees
+ * a batch bigger or more deeply nested than any before it)
+ */
 void parser_parse(
         struct parser * parser,
         struct particle_buffer * particles,
@@ -36,6 +36,85 @@ struct config {
     long port;
     char * default_card_db;
     bool dummy;
+
+    /* the logger's ring holds log_ring_size messages (rounded up to a power
+     * of two) waiting to be written. log_overflow is what happens to messages
+     * logged while it is full: "drop" (they are dropped and counted) or
+     * "block" (the caller waits for room.)
+     */
+    long log_ring_size;
+    char * log_overflow;
+
+    /* the lowest level of messages the logger writes: "verbose", "info", or
+     * "error"
+     */
+    char * log_level;
+
+    /* log_format is "text" (messages are formatted and written to stdout
+     * and stderr) or "binary" (messages are recorded unformatted in
+     * log_file, see util/log_format.h and tools/log_decode)
+     */
+    char * log_format;
+    char * log_file;
+
+    /* per-connection flow control, in bytes (0 disables each one)
+     *
+     * read_low_watermark and read_high_watermark are passed to
+     * bufferevent_setwatermark() for EV_READ, so libevent stops reading
+     * from a connection whose input reaches read_high_watermark
+     *
+     * reads are also paused while a connection's output is above
+     * write_high_watermark, and resumed once it drains down to
+     * write_low_watermark
+     *
+     * a connection whose output exceeds output_limit, or whose unprocessed
+     * input reaches input_limit, is disconnected
+     */
+    long read_low_watermark;
+    long read_high_watermark;
+    long write_low_watermark;
+    long write_high_watermark;
+    long output_limit;
+    long input_limit;
+
+    /* connection timeouts, in seconds (0 disables each one)
+     *
+     * handshake_timeout is how long a new connection has to send its first
+     * complete command. after that, a connection is disconnected when it
+     * sends nothing for lobby_timeout seconds while in the lobby.
+     */
+    long handshake_timeout;
+    long lobby_timeout;
+
+    /* rate limits (a rate of 0 disables it, a burst of 0 or less than the
+     * rate means the same as the rate)
+     *
+     * each connection has a token bucket of command_burst commands that
+     * refills at commands_per_second, and one of byte_burst bytes that
+     * refills at bytes_per_second. server_bytes_per_second (with a burst of
+     * server_byte_burst) is shared by every connection.
+     *
+     * input over the limits is not dropped: it waits in the connection's
+     * input (and then the socket) until there are enough tokens for it.
+     */
+    long commands_per_second;
+    long command_burst;
+    long bytes_per_second;
+    long byte_burst;
+    long server_bytes_per_second;
+    long server_byte_burst;
+
+    /* the most commands processed from one connection before the other
+     * connections get a turn (0 means no limit)
+     */
+    long commands_per_turn;
+
+    /* the path of the unix domain socket the server accepts admin commands
+     * (stats, connections, reload, shutdown) on, or "" for none
+     *
+     * the socket is only accessible to the user the server runs as
+     */
+    char * admin_socket;
 };
 
 /* free resources used by this config */
@@ -20,15 +20,36 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 /* forward declare */
+struct command;
 struct config;
+struct game_state;
 struct logger;
+struct look_cache;
 struct name_set;
+struct refstring;
 
 /* a game */
 struct game {
     struct logger * logger;
     struct name_set * name_set;
+
+    /* the bundle the name_set was loaded from (config.default_card_db), or
+     * NULL
+     */
+    char * bundle_name;
+
+    /* bumped (by game_changed()) whenever anything a LOOK could see changes,
+     * which invalidates every response in look_cache
+     */
+    uint64_t version;
+    struct look_cache * look_cache;
+
+    /* the card instances in play (and in decks, hands, graves, ...) */
+    struct game_state * state;
 };
 
 /* create a game with this config */
@@ -38,4 +59,45 @@ struct game {
 /* destroy this game */
 void game_destroy(struct game * game) [[gnu::nonnull(1)]];
 
+/* reload this game's bundle into a new name_set, replacing the old one only
+ * if every card loaded
+ *
+ * returns true on success, false if there is no bundle or it could not be
+ * loaded (in which case the old name_set is kept)
+ *
+ * nothing may hold on to names from the old name_set across this call
+ */
+bool game_reload(struct game * game) [[gnu::nonnull(1)]];
+
+/* note that this game's state has changed, invalidating any cached LOOK
+ * responses
+ */
+void game_changed(struct game * game) [[gnu::nonnull(1)]];
+
+/* do this game's housekeeping (see name_set_maintain()), which should be
+ * done now and then, e.g. once a second
+ */
+void game_maintain(struct game * game) [[gnu::nonnull(1)]];
+
+/* render the response to this LOOK command
+ *
+ * returns the null refstring on memory error (see refstring.h). the caller
+ * must refstring_destroy() the result.
+ */
+[[nodiscard]] struct refstring * game_look(
+        struct game * game,
+        const struct command * command
+    ) [[gnu::nonnull(1, 2)]];
+
+/* render the response to this COMPLETE command, which is the display names
+ * of the first (in order) few names that begin with its prefix
+ *
+ * returns the null refstring on memory error (see refstring.h). the caller
+ * must refstring_destroy() the result.
+ */
+[[nodiscard]] struct refstring * game_complete(
+        struct game * game,
+        const struct command * command
+    ) [[gnu::nonnull(1, 2)]];
+
 #endif /* GAME_H */
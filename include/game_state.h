@@ -0,0 +1,323 @@
+/* File: include/game_state.h
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GAME_STATE_H
+#define GAME_STATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* forward declare */
+struct card;
+
+/* the state of a game's cards: every card instance (a copy of a card in some
+ * player's deck, hand, field, ...) and what has happened to it
+ *
+ * instances are stored as a struct of arrays, indexed by instance id, rather
+ * than as an object per instance, so that resolving an attack touches a few
+ * bytes in each of a few arrays and a sweep over every instance (e.g. an
+ * effect that damages all of a player's characters) walks contiguous memory.
+ *
+ * each player's stacks (their deck, hand, each of their character zones,
+ * and so on) are kept both as bitsets over instance ids, so that a question
+ * like "how many face down characters does player 1 have in zone 2" is a few
+ * ANDs and popcounts (see game_state_count()), and as arrays of ids in order,
+ * for positions (see game_state_at().)
+ *
+ * the arrays may be read directly, but only change them through the
+ * game_state_*() functions, which keep them consistent with each other
+ * (stacks and equipment links in particular.) adding an instance can move
+ * the arrays.
+ */
+
+/* an instance id that isn't one, e.g. in equipped_to for an instance that
+ * isn't attached to anything
+ */
+#define GAME_STATE_NO_INSTANCE UINT32_MAX
+
+/* the most players a game_state has stacks for (owners are less than this) */
+#ifndef GAME_STATE_PLAYERS_MAX
+#define GAME_STATE_PLAYERS_MAX 8
+#endif /* GAME_STATE_PLAYERS_MAX */
+
+/* what kind of card an instance is (see planning/rules.md) */
+enum game_card_kind {
+    GAME_CARD_CHARACTER,
+    GAME_CARD_EQUIPMENT,
+    GAME_CARD_EFFECT,
+    GAME_CARD_TRIGGER
+};
+
+/* the zones an instance can be in */
+enum game_zone {
+    GAME_ZONE_DECK,
+    GAME_ZONE_HAND,
+    GAME_ZONE_FIELD, /* a character zone, see zone_number */
+    GAME_ZONE_SPECIAL, /* triggers, effects, and unattached equipment */
+    GAME_ZONE_DISCARD,
+    GAME_ZONE_GRAVE
+};
+
+/* the number of zones */
+#define GAME_ZONES (GAME_ZONE_GRAVE + 1)
+
+/* the bits of flags */
+#define GAME_INSTANCE_FACE_UP 0x01
+#define GAME_INSTANCE_DEFENSE_MODE 0x02 /* otherwise, it's in attack mode */
+
+/* an instance's stats
+ *
+ * for a character, these are its A/AD/DD, HP and range. for equipment, they
+ * are what it adds to the character it is attached to.
+ */
+struct game_stats {
+    int16_t attack;
+    int16_t attack_defense;
+    int16_t defense_defense;
+    int16_t hp;
+    uint8_t range;
+};
+
+/* one of a player's stacks
+ *
+ * members has a bit for each instance id (see game_state_count()), and
+ * order holds the same ids, first position first, with room for every
+ * instance the player owns (so that moving into it never allocates)
+ */
+struct game_stack {
+    uint64_t * members;
+    uint32_t * order;
+    size_t n_order;
+    size_t order_capacity;
+};
+
+/* a player's stacks */
+struct game_player {
+    size_t n_instances; /* owned by this player */
+
+    /* by zone, except that stacks[GAME_ZONE_FIELD] is every character zone
+     * together (and has no order), while character zone n is field[n - 1]
+     */
+    struct game_stack stacks[GAME_ZONES];
+    struct game_stack * field;
+    size_t n_field;
+};
+
+/* the card instances of a game */
+struct game_state {
+    size_t n_instances;
+    size_t capacity;
+    size_t n_words; /* in each bitset, which is capacity / 64 */
+
+    /* the stats, including those added by any equipment attached */
+    int16_t * attack;
+    int16_t * attack_defense;
+    int16_t * defense_defense;
+    int16_t * hp;
+    uint8_t * range;
+
+    uint8_t * kind; /* an enum game_card_kind */
+    uint8_t * owner; /* the player */
+    uint8_t * zone; /* an enum game_zone */
+    uint16_t * zone_number; /* for GAME_ZONE_FIELD, 1 is closest to owner */
+    uint8_t * flags; /* GAME_INSTANCE_* */
+
+    /* for equipment, the character it is attached to, which has it in a
+     * list that begins at equipment and continues through next_equipment
+     */
+    uint32_t * equipped_to;
+    uint32_t * equipment;
+    uint32_t * next_equipment;
+
+    /* the card each instance is of, which may be NULL */
+    struct card ** card;
+
+    /* bitsets of the instances that are characters, face up, and in
+     * defense mode
+     */
+    uint64_t * characters;
+    uint64_t * face_up;
+    uint64_t * defense_mode;
+
+    struct game_player players[GAME_STATE_PLAYERS_MAX];
+};
+
+/* which instances game_state_count() and game_state_select() want */
+struct game_query {
+    uint8_t owner;
+    enum game_zone zone;
+    uint16_t zone_number; /* for GAME_ZONE_FIELD, or 0 for every zone */
+    bool characters; /* only characters */
+    uint8_t flags_mask; /* only instances with (flags & flags_mask) == flags */
+    uint8_t flags;
+};
+
+/* the result of game_state_attack() */
+enum game_attack_result {
+    GAME_ATTACK_INVALID, /* nothing happened, because the attacker isn't a
+                          * face up character on the field in attack mode,
+                          * the defender isn't a character on the field, or
+                          * they have the same owner
+                          */
+    GAME_ATTACK_DEFENDER_DESTROYED,
+    GAME_ATTACK_ATTACKER_DESTROYED
+};
+
+/* create a game_state with no instances */
+[[nodiscard]] struct game_state * game_state_create();
+
+/* destroy this game_state (but not the cards its instances are of) */
+void game_state_destroy(struct game_state * state) [[gnu::nonnull(1)]];
+
+/* add an instance of this card (which may be NULL) of this kind with these
+ * stats, owned by this player and in this zone (face down, in attack mode,
+ * and unattached) and return its id
+ *
+ * ids count up from zero in the order instances were added. the instance
+ * goes at the end of its stack.
+ *
+ * returns GAME_STATE_NO_INSTANCE on memory error or if owner isn't less than
+ * GAME_STATE_PLAYERS_MAX
+ */
+uint32_t game_state_add(
+        struct game_state * state,
+        struct card * card,
+        enum game_card_kind kind,
+        const struct game_stats * stats,
+        uint8_t owner,
+        enum game_zone zone,
+        uint16_t zone_number
+    ) [[gnu::nonnull(1, 4)]];
+
+/* move this instance to the end of this zone (and zone_number, for
+ * GAME_ZONE_FIELD) of its owner's
+ *
+ * equipment that is moved is detached first. a character that leaves the
+ * field takes any equipment attached to it to the grave.
+ *
+ * returns false (and does nothing) if zone_number is 0 for GAME_ZONE_FIELD,
+ * or on memory error, which can only happen when moving to a character zone
+ * that the player hasn't used before
+ */
+bool game_state_move(
+        struct game_state * state,
+        uint32_t id,
+        enum game_zone zone,
+        uint16_t zone_number
+    ) [[gnu::nonnull(1)]];
+
+/* send this instance (and any equipment attached to it) to the grave */
+void game_state_bury(
+        struct game_state * state, uint32_t id) [[gnu::nonnull(1)]];
+
+/* set (or clear, if set is false) these GAME_INSTANCE_* flags on this
+ * instance
+ */
+void game_state_set_flags(
+        struct game_state * state,
+        uint32_t id,
+        uint8_t flags,
+        bool set
+    ) [[gnu::nonnull(1)]];
+
+/* attach this equipment to this character, detaching it from any other
+ * first, and add its stats to the character's
+ *
+ * returns false (and does nothing) if equipment isn't equipment or character
+ * isn't a character on the field of the same player's
+ */
+bool game_state_attach(
+        struct game_state * state,
+        uint32_t equipment,
+        uint32_t character
+    ) [[gnu::nonnull(1)]];
+
+/* detach this equipment from whatever it is attached to, if anything, and
+ * take its stats back off of that character
+ */
+void game_state_detach(
+        struct game_state * state, uint32_t equipment) [[gnu::nonnull(1)]];
+
+/* resolve an attack by this attacker on this defender
+ *
+ * the attacker's attack is compared against the defender's AD (if it is in
+ * attack mode) or DD (in defense mode.) if it is greater, the defender is
+ * destroyed, otherwise (ties go to the defender) the attacker is. either
+ * way, a face down defender is turned face up.
+ *
+ * this doesn't check the attacker's range or whether other defenders are in
+ * the way, which depend on the zones in front of them.
+ */
+enum game_attack_result game_state_attack(
+        struct game_state * state,
+        uint32_t attacker,
+        uint32_t defender
+    ) [[gnu::nonnull(1)]];
+
+/* return the number of instances matching this query */
+size_t game_state_count(
+        const struct game_state * state,
+        const struct game_query * query
+    ) [[gnu::nonnull(1, 2)]];
+
+/* write the ids (in increasing order) of up to max instances matching this
+ * query to ids, and return the number written
+ */
+size_t game_state_select(
+        const struct game_state * state,
+        const struct game_query * query,
+        uint32_t * ids,
+        size_t max
+    ) [[gnu::nonnull(1, 2)]];
+
+/* return the number of instances in this stack of this player's */
+size_t game_state_stack_size(
+        const struct game_state * state,
+        uint8_t owner,
+        enum game_zone zone,
+        uint16_t zone_number
+    ) [[gnu::nonnull(1)]];
+
+/* return the instance at this position (counting from 1) of this stack of
+ * this player's, or GAME_STATE_NO_INSTANCE if there isn't one
+ *
+ * GAME_ZONE_FIELD needs a zone_number, since the character zones together
+ * have no order
+ */
+uint32_t game_state_at(
+        const struct game_state * state,
+        uint8_t owner,
+        enum game_zone zone,
+        uint16_t zone_number,
+        size_t position
+    ) [[gnu::nonnull(1)]];
+
+/* lower the HP of every character this player has on the field by amount,
+ * destroying those left with none
+ *
+ * returns the number of characters destroyed
+ */
+size_t game_state_damage_all(
+        struct game_state * state,
+        uint8_t owner,
+        int16_t amount
+    ) [[gnu::nonnull(1)]];
+
+#endif /* GAME_STATE_H */
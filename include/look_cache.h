@@ -0,0 +1,88 @@
+/* File: include/look_cache.h
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LOOK_CACHE_H
+#define LOOK_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* forward declare */
+struct command;
+struct refstring;
+
+/* a cache of rendered responses to read-only commands (LOOK)
+ *
+ * entries are keyed by the normalized particles of the command (see
+ * look_cache_key()) and tagged with the game version they were rendered at.
+ * an entry from any other version is stale and is never returned, so bumping
+ * the version (see game_changed()) invalidates the whole cache at once.
+ *
+ * the cache is a fixed number of slots with a short probe sequence; when
+ * every slot a key can go in is live, the key's home slot is evicted.
+ */
+struct look_cache;
+
+/* the largest key look_cache_key() will produce for a cacheable command */
+#ifndef LOOK_CACHE_KEY_MAX
+#define LOOK_CACHE_KEY_MAX 256
+#endif /* LOOK_CACHE_KEY_MAX */
+
+/* create a cache with (at least) this many slots */
+[[nodiscard]] struct look_cache * look_cache_create(size_t size);
+
+/* destroy this cache, releasing its references to any responses */
+void look_cache_destroy(struct look_cache * cache) [[gnu::nonnull(1)]];
+
+/* write the key for this command, as seen by this viewer, to key
+ *
+ * returns the length of the key, or 0 if the command can't be cached
+ * (because its key would be longer than LOOK_CACHE_KEY_MAX)
+ */
+size_t look_cache_key(
+        const struct command * command,
+        uint64_t viewer,
+        uint8_t key[static LOOK_CACHE_KEY_MAX]
+    ) [[gnu::nonnull(1, 3)]];
+
+/* returns the response cached for this key at this version, or NULL
+ *
+ * the response is borrowed: use refstring_dup() to keep it
+ */
+struct refstring * look_cache_lookup(
+        const struct look_cache * cache,
+        uint64_t version,
+        const uint8_t * key,
+        size_t length
+    ) [[gnu::nonnull(1, 3)]];
+
+/* cache this response for this key at this version
+ *
+ * the cache takes its own reference to the response (with refstring_dup()),
+ * and silently caches nothing if it can't copy the key
+ */
+void look_cache_store(
+        struct look_cache * cache,
+        uint64_t version,
+        const uint8_t * key,
+        size_t length,
+        struct refstring * response
+    ) [[gnu::nonnull(1, 3, 5)]];
+
+#endif /* LOOK_CACHE_H */
@@ -35,9 +35,20 @@ enum name_type {
     NAME_TYPE_PLAYER
 };
 
+/* the bit for this type in a mask of types, for name_set_lookup_types() */
+#define NAME_TYPE_BIT(type) (1u << (type))
+
+/* a mask of every type */
+#define NAME_TYPE_BITS_ALL ( \
+        NAME_TYPE_BIT(NAME_TYPE_CARD) | \
+        NAME_TYPE_BIT(NAME_TYPE_ABILITY) | \
+        NAME_TYPE_BIT(NAME_TYPE_SUBTYPE) | \
+        NAME_TYPE_BIT(NAME_TYPE_PLAYER) \
+    )
+
 /* the result of a name lookup */
 struct name {
-    uint8_t * display_name;
+    uint8_t * display_name; /* belongs to the name set: don't change it */
     size_t display_name_length;
     enum name_type type;
     void * data;
@@ -53,6 +64,10 @@ void name_set_destroy(struct name_set * name_set) [[gnu::nonnull(1)]];
  *
  * returns true if the key is added, false otherwise (because it was a
  * duplicate)
+ *
+ * sets oom to true on memory error, which returns false unless the name was
+ * added and only its entries in the indexes for name_set_complete() and
+ * name_set_suggest() couldn't be
  */
 bool name_set_add(
         struct name_set * name_set,
@@ -76,6 +91,10 @@ struct name_data * name_set_remove(
 */
 
 /* compile a name set (transforming its internal sorted_set into a hash)
+ *
+ * if it's already compiled, this instead merges everything added since into
+ * a new hash right away (see name_set_maintain() for doing that without
+ * waiting)
  *
  * 1. create an empty hash_inputs and make sure it has space to store the
  *    whole sorted_set
@@ -92,6 +111,24 @@ struct name_data * name_set_remove(
  */
 void name_set_compile(struct name_set * name_set) [[gnu::nonnull(1)]];
 
+/* keep a compiled name set's hash up to date with the names added since
+ *
+ * names added to a compiled set go into a small overflow tier that lookups
+ * check after missing the hash. once it holds
+ * NAME_SET_MERGE_THRESHOLD_DEFAULT names, this moves it aside (where lookups
+ * still check it) and starts a thread that merges it and the hash into a new
+ * hash, so adding names never waits on rebuilding the hash. a later call
+ * swaps the new hash in once that thread is done.
+ *
+ * this is called by name_set_add(), and should also be called now and then
+ * (e.g. once a second) so that a finished merge doesn't wait for the next
+ * add. it never blocks.
+ *
+ * the set must only be used from one thread, as usual: the merge thread
+ * only reads the parts of it that nothing else changes while it runs.
+ */
+void name_set_maintain(struct name_set * name_set) [[gnu::nonnull(1)]];
+
 /* look up a name in this set
  *
  * returns the name if present, NULL otherwise
@@ -107,6 +144,60 @@ struct name * name_set_lookup(
         bool * oom
     ) [[gnu::nonnull(1, 2)]];
 
+/* look up a name in this set, like name_set_lookup(), but only find it if
+ * its type is one of these types (a mask of NAME_TYPE_BIT()s)
+ *
+ * the type is checked from the slot the name was found in, without loading
+ * the name, so callers that only want (e.g.) abilities should use this
+ * rather than checking the type of whatever name_set_lookup() returns
+ */
+struct name * name_set_lookup_types(
+        const struct name_set * name_set,
+        const uint8_t * name,
+        size_t length,
+        unsigned int types,
+        bool * oom
+    ) [[gnu::nonnull(1, 2)]];
+
+/* find the names in this set that begin with this prefix (ignoring case)
+ *
+ * writes up to max of them to names, in order of their display names, and
+ * returns how many it wrote. this takes O(log n + max) time, whether or not
+ * the set is compiled, and includes names added after compiling it.
+ *
+ * sets oom to true and returns 0 on memory error (which can only occur if
+ * the prefix needs more than the default buffer space for unicode tolower)
+ */
+size_t name_set_complete(
+        const struct name_set * name_set,
+        const uint8_t * prefix,
+        size_t length,
+        struct name ** names,
+        size_t max,
+        bool * oom
+    ) [[gnu::nonnull(1, 2)]];
+
+/* find the names in this set that are at most max_distance edits (ignoring
+ * case) from this one, for suggesting what a name that wasn't found might
+ * have been meant to be
+ *
+ * writes up to max of them to names, closest first, and returns how many it
+ * wrote. like name_set_complete(), this includes names added after compiling
+ * the set. it only looks at names that share some of the name's trigrams
+ * (see util/ngram_index.h), so it stays fast however many names there are.
+ *
+ * sets oom to true and returns 0 on memory error
+ */
+size_t name_set_suggest(
+        const struct name_set * name_set,
+        const uint8_t * name,
+        size_t length,
+        size_t max_distance,
+        struct name ** names,
+        size_t max,
+        bool * oom
+    ) [[gnu::nonnull(1, 2)]];
+
 /* call this function on every name in this set, passing it ptr */
 void name_set_apply(
         struct name_set * name_set,
@@ -22,6 +22,13 @@
 
 #include "config.h"
 
+#include <stddef.h>
+
+/* forward declare */
+struct bufferevent;
+struct event_base;
+struct refstring;
+
 /* a networker */
 struct networker;
 
@@ -37,9 +44,62 @@ void networker_destroy(struct networker * networker) [[gnu::nonnull(1)]];
  */
 int networker_run(struct networker * networker) [[gnu::nonnull(1)]];
 
+/* returns this networker's event base, for running it some other way than
+ * networker_run() (e.g. to drive in-process clients on the same loop)
+ */
+struct event_base * networker_base(
+        struct networker * networker) [[gnu::nonnull(1)]];
+
+/* connect a new in-process client to this networker over a bufferevent pair,
+ * which the networker treats exactly like a connection it accepted
+ *
+ * returns the client's end of the pair (which the caller frees with
+ * bufferevent_free()) or NULL on error
+ */
+[[nodiscard]] struct bufferevent * networker_connect_pair(
+        struct networker * networker) [[gnu::nonnull(1)]];
+
+/* attach this message to the output of every connection
+ *
+ * the message is not copied: each connection's output holds a reference to
+ * it (see refstring_dup()) which is released once that output has been
+ * written, so broadcasting to N connections costs N pointer appends rather
+ * than N copies. the caller keeps its own reference and must still call
+ * refstring_destroy() on it.
+ */
+void networker_broadcast(
+        struct networker * networker,
+        struct refstring * message
+    ) [[gnu::nonnull(1, 2)]];
+
+/* format a message once and broadcast it (see networker_broadcast())
+ *
+ * the format is the same as for refstring_createf()
+ */
+void networker_broadcastf(
+        struct networker * networker,
+        const char * format,
+        ...
+    ) [[gnu::nonnull(1, 2)]];
+
 /* a connection */
 struct connection;
 
+/* returns the id of this connection */
+size_t connection_id(struct connection * connection) [[gnu::nonnull(1)]];
+
+/* returns the number of bytes received from this connection that have not
+ * been processed yet
+ */
+size_t connection_input_depth(
+        struct connection * connection) [[gnu::nonnull(1)]];
+
+/* returns the number of bytes queued for this connection that have not been
+ * written yet
+ */
+size_t connection_output_depth(
+        struct connection * connection) [[gnu::nonnull(1)]];
+
 /* an iterator over a networker's connections */
 struct networker_connection_iter;
 
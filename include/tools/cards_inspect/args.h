@@ -28,6 +28,9 @@ struct arguments
 {
     bool validate;
     char * database_name;
+    char * prefix; /* only list cards whose filenames begin with this */
+    char * after; /* only list cards whose filenames sort after this */
+    size_t limit; /* list at most this many cards (or all of them if 0) */
 };
 
 /* parse this argv and argc, storing the result in args
@@ -0,0 +1,55 @@
+/* File: include/util/arena.h
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef UTIL_ARENA_H
+#define UTIL_ARENA_H
+
+#include <stddef.h>
+
+/* an arena
+ *
+ * an arena hands out memory from large blocks by bumping a pointer, and
+ * everything allocated from it is released at once by arena_reset() (or
+ * arena_destroy()) rather than one allocation at a time.
+ *
+ * the blocks are kept when the arena is reset, so an arena that is reset
+ * and refilled with about the same amount each time stops calling malloc()
+ * at all.
+ */
+struct arena;
+
+/* create an arena that allocates blocks of (at least) block_size bytes */
+[[nodiscard]] struct arena * arena_create(size_t block_size);
+
+/* destroy this arena and everything allocated from it */
+void arena_destroy(struct arena * arena) [[gnu::nonnull(1)]];
+
+/* allocate size bytes from this arena, aligned for any type
+ *
+ * returns NULL on memory error. the memory is not zeroed.
+ */
+[[nodiscard]] void * arena_alloc(
+        struct arena * arena, size_t size) [[gnu::nonnull(1)]];
+
+/* release everything allocated from this arena, keeping its blocks to be
+ * reused
+ */
+void arena_reset(struct arena * arena) [[gnu::nonnull(1)]];
+
+#endif /* UTIL_ARENA_H */
@@ -21,6 +21,7 @@
 #define LOG_H
 
 #include <unitypes.h>
+#include <stdbool.h>
 
 /* forward declare */
 struct config;
@@ -45,10 +46,24 @@ enum log_level {
 [[nodiscard]] struct logger * logger_create(
         struct config * config) [[gnu::nonnull(1)]];
 
-/* destroy this logger */
+/* destroy this logger, after writing every message logged before this call
+ */
 void logger_destroy(struct logger * logger) [[gnu::nonnull(1)]];
 
-/* log using this logger at this level with this format and args */
+/* returns true if this logger writes messages at this level (i.e. if level
+ * is at least the logger's minimum level), or true if logger is NULL
+ */
+bool logger_wants(const struct logger * logger, enum log_level level);
+
+/* log using this logger at this level with this format and args
+ *
+ * the message is formatted on the calling thread and written by the
+ * logger's writer thread. if logger is NULL, the message is written
+ * synchronously.
+ *
+ * messages below the logger's minimum level are ignored, but prefer the
+ * LOGF_* macros, which check that before evaluating or formatting anything
+ */
 void logger_logf(
         struct logger * logger,
         enum log_level level,
@@ -56,17 +71,57 @@ void logger_logf(
         ...
     ) [[gnu::nonnull(3)]];
 
-/* predefined macros that call logger_logf() with their corresponding
- * log level.
- * 
- * these are here to allow for future compile-time disabling of logging at
- * certain levels.
+/* a call site of one of the LOGF_* macros
+ *
+ * the binary backend (see util/log_format.h) writes each site to the log
+ * once, and then only refers to it by id
+ */
+struct log_site {
+    enum log_level level;
+    const char * file;
+    int line;
+    const char * format;
+};
+
+/* log using this logger at the level of this site with its format and these
+ * args (this is what the LOGF_* macros call)
+ */
+void logger_logf_site(
+        struct logger * logger,
+        const struct log_site * site,
+        ...
+    ) [[gnu::nonnull(2)]];
+
+/* the lowest level that is compiled in at all
+ *
+ * LOGF_* calls below this level are compiled out (their arguments are never
+ * evaluated.) this is set with the configure.py --log-level-floor option.
+ */
+#ifndef LOG_LEVEL_FLOOR
+#define LOG_LEVEL_FLOOR LOG_VERBOSE
+#endif /* LOG_LEVEL_FLOOR */
+
+/* log at this level if it is above both LOG_LEVEL_FLOOR and the logger's
+ * minimum level, without formatting (or evaluating the arguments) otherwise
+ */
+#define LOGF_LEVEL(logger, level, format, ...) \
+    do { \
+        if ((level) >= LOG_LEVEL_FLOOR && logger_wants((logger), (level))) { \
+            static const struct log_site log_site_ = { \
+                (level), __FILE__, __LINE__, (format) \
+            }; \
+            logger_logf_site((logger), &log_site_ __VA_OPT__(,) __VA_ARGS__); \
+        } \
+    } while (0)
+
+/* predefined macros that call logger_logf_site() with their corresponding
+ * log level (see LOGF_LEVEL())
  */
 #define LOGF_VERBOSE(logger, format, ...) \
-    logger_logf(logger, LOG_VERBOSE, format __VA_OPT__(,) __VA_ARGS__)
+    LOGF_LEVEL(logger, LOG_VERBOSE, format __VA_OPT__(,) __VA_ARGS__)
 #define LOGF_INFO(logger, format, ...) \
-    logger_logf(logger, LOG_INFO, format __VA_OPT__(,) __VA_ARGS__)
+    LOGF_LEVEL(logger, LOG_INFO, format __VA_OPT__(,) __VA_ARGS__)
 #define LOGF_ERROR(logger, format, ...) \
-    logger_logf(logger, LOG_ERROR, format __VA_OPT__(,)  __VA_ARGS__)
+    LOGF_LEVEL(logger, LOG_ERROR, format __VA_OPT__(,) __VA_ARGS__)
 
 #endif /* LOG_H */
@@ -0,0 +1,109 @@
+/* File: include/util/log_format.h
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef UTIL_LOG_FORMAT_H
+#define UTIL_LOG_FORMAT_H
+
+#include "util/log.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* the binary log format
+ *
+ * this is shared by the binary logging backend in src/util/log.c and the
+ * decoder in src/tools/log_decode. a binary log is a sequence of records, in
+ * the byte order of the machine that wrote it, each starting with one of
+ * the enum log_record_kind bytes:
+ *
+ *  LOG_RECORD_HEADER:  "CARDSLOG" u32 version, u32 LOG_BYTE_ORDER_MARK
+ *  LOG_RECORD_SITE:    u32 id, u8 level, u32 line, u32 length, file,
+ *                      u32 length, format
+ *  LOG_RECORD_EVENT:   u32 site id, u64 timestamp, u32 length, arguments
+ *  LOG_RECORD_TEXT:    u8 level, u64 timestamp, u32 length, text
+ *
+ * a header starts each run of the logger (a log file may be appended to
+ * many times), and site ids are only unique until the next header. a site is
+ * defined before the first event that uses it.
+ *
+ * timestamps are nanoseconds since the epoch. the arguments of an event are
+ * the arguments of the call, in order, encoded as described for
+ * log_format_next(). text records hold messages that could not be encoded
+ * (see LOG_ARG_UNSUPPORTED.)
+ */
+enum log_record_kind {
+    LOG_RECORD_HEADER = 'H',
+    LOG_RECORD_SITE = 'S',
+    LOG_RECORD_EVENT = 'E',
+    LOG_RECORD_TEXT = 'T'
+};
+
+#define LOG_MAGIC "CARDSLOG"
+#define LOG_VERSION 1
+#define LOG_BYTE_ORDER_MARK 0x01020304
+
+/* the type of the argument a conversion consumes, which is also how it is
+ * encoded
+ */
+enum log_arg_type {
+    LOG_ARG_NONE, /* %% */
+    LOG_ARG_INT, /* int (and char, short), as an int32_t */
+    LOG_ARG_LONG, /* long, as an int64_t */
+    LOG_ARG_LONG_LONG, /* long long, as an int64_t */
+    LOG_ARG_SIZE, /* size_t, as a uint64_t */
+    LOG_ARG_INTMAX, /* intmax_t, as an int64_t */
+    LOG_ARG_PTRDIFF, /* ptrdiff_t, as an int64_t */
+    LOG_ARG_DOUBLE, /* double, as a double */
+    LOG_ARG_LONG_DOUBLE, /* long double, as a long double */
+    LOG_ARG_POINTER, /* void *, as a uint64_t */
+    LOG_ARG_STRING, /* char *, as a u32 length and that many bytes, or a
+                     * length of UINT32_MAX if it was NULL
+                     */
+    LOG_ARG_U8_STRING, /* uint8_t * (%U), like LOG_ARG_STRING */
+    LOG_ARG_UNSUPPORTED /* anything else (%n, %lU, wide strings, ...) */
+};
+
+/* one conversion specification in a format string */
+struct log_conversion {
+    size_t start; /* the offset of the % in the format */
+    size_t length; /* the length of the whole specification */
+    bool star_width; /* the width is an int argument (encoded as an int32_t
+                      * before the value)
+                      */
+    bool star_precision; /* likewise for the precision */
+    long precision; /* the precision, if it is given as digits, or -1 */
+    enum log_arg_type type;
+};
+
+/* find the next conversion in format at or after *offset, storing it in
+ * conversion and advancing *offset past it
+ *
+ * returns false if there are no more conversions
+ */
+bool log_format_next(
+        const char * format,
+        size_t * offset,
+        struct log_conversion * conversion
+    ) [[gnu::nonnull(1, 2, 3)]];
+
+/* returns the name of this log level ("verbose", "info", or "error") */
+const char * log_level_name(enum log_level level);
+
+#endif /* UTIL_LOG_FORMAT_H */
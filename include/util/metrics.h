@@ -0,0 +1,101 @@
+/* File: include/util/metrics.h
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef UTIL_METRICS_H
+#define UTIL_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* the metrics registry
+ *
+ * there is one registry per process. counters and histograms are recorded
+ * into a shard owned by the calling thread (so recording never contends with
+ * another thread, and costs a thread-local load and a couple of adds), and
+ * the shards are summed whenever the metrics are reported.
+ *
+ * gauges go up and down (rather than only up), so they are kept as single
+ * atomics instead.
+ */
+
+/* counters, which only ever go up */
+enum metric_counter {
+    METRIC_ACCEPTS,
+    METRIC_DISCONNECTS,
+    METRIC_BYTES_IN,
+    METRIC_BYTES_OUT,
+    METRIC_COMMANDS_LEXED,
+    METRIC_COMMANDS_PARSED,
+    METRIC_LEX_ERRORS,
+    METRIC_NAME_LOOKUPS,
+    METRIC_NAME_LOOKUP_MISSES,
+    METRIC_NAME_COMPLETIONS,
+    METRIC_NAME_SUGGESTIONS,
+    METRIC_NAME_SET_MERGES,
+    METRIC_LOOK_CACHE_HITS,
+    METRIC_LOOK_CACHE_MISSES,
+    METRIC_COUNTERS /* the number of counters */
+};
+
+/* gauges */
+enum metric_gauge {
+    METRIC_CONNECTIONS,
+    METRIC_GAUGES /* the number of gauges */
+};
+
+/* histograms, all of which are of durations in nanoseconds */
+enum metric_histogram {
+    METRIC_BUNDLE_LOAD_TIME,
+    METRIC_NAME_SET_MERGE_TIME,
+    METRIC_COMMAND_LATENCY,
+    METRIC_TURN_LATENCY,
+    METRIC_HISTOGRAMS /* the number of histograms */
+};
+
+/* add n to this counter */
+void metrics_count(enum metric_counter counter, uint64_t n);
+
+/* add delta (which may be negative) to this gauge */
+void metrics_gauge_add(enum metric_gauge gauge, int64_t delta);
+
+/* record this value in this histogram
+ *
+ * histograms are log-linear (like HdrHistogram): values are bucketed by
+ * their highest set bit, and each power of two is split into
+ * METRICS_SUB_BUCKETS linear sub-buckets, so every recorded value is
+ * reported to within 1/METRICS_SUB_BUCKETS of itself
+ */
+void metrics_record(enum metric_histogram histogram, uint64_t value);
+
+/* returns a monotonic timestamp in nanoseconds, for timing things that go
+ * into histograms
+ */
+uint64_t metrics_now();
+
+/* call fn once per line of a human-readable report of every metric
+ *
+ * each line is terminated with a newline. histograms are reported as their
+ * count, mean, max and p50/p90/p99/p999.
+ */
+void metrics_report(
+        void (*fn)(const char * line, void * ptr),
+        void * ptr
+    ) [[gnu::nonnull(1)]];
+
+#endif /* UTIL_METRICS_H */
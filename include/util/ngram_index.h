@@ -0,0 +1,98 @@
+/* File: include/util/ngram_index.h
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef UTIL_NGRAM_INDEX_H
+#define UTIL_NGRAM_INDEX_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* an n-gram index, for finding the keys that are a few edits away from some
+ * string without computing the edit distance to every key
+ *
+ * each key is broken into trigrams, padded at both ends (so "cat" has the
+ * five trigrams "__c", "_ca", "cat", "at_", and "t__") and the index maps
+ * each trigram to the keys that contain it. an edit changes at most three
+ * of a string's trigrams, so a key within d edits of a string shares all but
+ * at most 3d of its distinct trigrams, and a search only computes the edit
+ * distance to the keys that share that many.
+ *
+ * keys (and edits) are bytes: a character that is more than one byte in
+ * UTF-8 counts as more than one edit.
+ */
+struct ngram_index;
+
+/* a key found by ngram_index_search() */
+struct ngram_index_result {
+    const char * key;
+    size_t length;
+    void * data;
+    size_t distance; /* the edit distance from what was searched for */
+};
+
+/* create an empty n-gram index */
+[[nodiscard]] struct ngram_index * ngram_index_create();
+
+/* destroy this n-gram index (but not its keys, which it doesn't own) */
+void ngram_index_destroy(struct ngram_index * index) [[gnu::nonnull(1)]];
+
+/* return the number of keys added to this index */
+size_t ngram_index_size(
+        const struct ngram_index * index) [[gnu::nonnull(1)]];
+
+/* add this key of length to the index, associating it with data
+ *
+ * the key is not copied and must outlive the index. duplicate keys are not
+ * detected, and are found (and returned) once each.
+ *
+ * returns false on memory error, after which the key may be in the index
+ * under only some of its trigrams (and so not be found by every search that
+ * should find it)
+ */
+bool ngram_index_add(
+        struct ngram_index * index,
+        const char * key,
+        size_t length,
+        void * data
+    ) [[gnu::nonnull(1, 2)]];
+
+/* find the keys within max_distance edits (insertions, deletions, and
+ * substitutions) of this key of length
+ *
+ * writes up to max of them to results, closest first (and in bytewise order
+ * when they are equally close), and returns how many it wrote. only keys that
+ * share at least one trigram with key are found, even if max_distance is
+ * large enough that keys sharing none would be close enough.
+ *
+ * the index keeps the scratch space it searches with, so searches of the same
+ * index must not run at the same time
+ *
+ * sets oom to true and returns 0 on memory error
+ */
+size_t ngram_index_search(
+        struct ngram_index * index,
+        const char * key,
+        size_t length,
+        size_t max_distance,
+        struct ngram_index_result * results,
+        size_t max,
+        bool * oom
+    ) [[gnu::nonnull(1, 2, 7)]];
+
+#endif /* UTIL_NGRAM_INDEX_H */
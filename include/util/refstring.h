@@ -21,6 +21,7 @@
 #define REFSTRING_H
 
 #include <stddef.h>
+#include <stdarg.h>
 #include <unitypes.h>
 
 /* a refstring */
@@ -33,6 +34,10 @@ struct refstring;
 [[nodiscard]] struct refstring * refstring_createf(
         const char * string, ...);
 
+/* like refstring_createf() but with a va_list */
+[[nodiscard]] struct refstring * refstring_createv(
+        const char * format, va_list args);
+
 /* create a refstring using exactly n bytes of this string
  *
  * adds a null terminator
@@ -52,6 +57,11 @@ void refstring_destroy(struct refstring * refstring) [[gnu::nonnull(1)]];
 const uint8_t * refstring_string(
         struct refstring * refstring) [[gnu::nonnull(1)]];
 
+/* get the length of the string in this refstring, not including the null
+ * terminator
+ */
+size_t refstring_length(struct refstring * refstring) [[gnu::nonnull(1)]];
+
 /* "duplicate" a refstring (this returns its argument, but with its reference
  * count increased by one
  */
@@ -129,6 +129,75 @@ const struct sorted_set_lookup_result * sorted_set_lookup(
         size_t length
     ) [[gnu::nonnull(1, 2)]];
 
+/* a position in a sorted set, for walking its keys in order without a
+ * callback (and stopping whenever)
+ *
+ * keys are in bytewise order (as unsigned chars, like memcmp()), with each
+ * key coming before every longer key that begins with it, so the keys that
+ * begin with some prefix are all together.
+ *
+ * the fields are private to the sorted set implementation. adding keys to
+ * the set invalidates its cursors.
+ */
+struct sorted_set_cursor {
+    void * node;
+    size_t index;
+    const char * prefix; /* not copied: must outlive the cursor */
+    size_t prefix_length;
+};
+
+/* returns a cursor at the first key in the set */
+struct sorted_set_cursor sorted_set_first(
+        struct sorted_set * sorted_set) [[gnu::nonnull(1)]];
+
+/* returns a cursor at the first key in the set that is not less than this
+ * key of length
+ *
+ * this function does not take ownership of key
+ */
+struct sorted_set_cursor sorted_set_lower_bound(
+        struct sorted_set * sorted_set,
+        const char * key,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]];
+
+/* returns a cursor at the first key in the set that is greater than this
+ * key of length
+ *
+ * this function does not take ownership of key
+ */
+struct sorted_set_cursor sorted_set_upper_bound(
+        struct sorted_set * sorted_set,
+        const char * key,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]];
+
+/* returns a cursor over just the keys that begin with this prefix of length
+ *
+ * this is sorted_set_lower_bound() followed by
+ * sorted_set_cursor_limit_prefix(), so prefix must outlive the cursor
+ */
+struct sorted_set_cursor sorted_set_prefix(
+        struct sorted_set * sorted_set,
+        const char * prefix,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]];
+
+/* make this cursor stop at the first key that doesn't begin with this prefix
+ * of length, which is not copied and must outlive the cursor
+ */
+void sorted_set_cursor_limit_prefix(
+        struct sorted_set_cursor * cursor,
+        const char * prefix,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]];
+
+/* return the key this cursor is at and advance it to the next one, or return
+ * NULL if there are no more keys
+ */
+const struct sorted_set_lookup_result * sorted_set_cursor_next(
+        struct sorted_set_cursor * cursor) [[gnu::nonnull(1)]];
+
 /* a sorted_set_maker
  *
  * this allows insertion of pre-sorted keys into a sorted_set in O(1) time
@@ -0,0 +1,86 @@
+/* File: include/util/string_pool.h
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef UTIL_STRING_POOL_H
+#define UTIL_STRING_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* a string pool
+ *
+ * a string pool interns strings: each distinct string is copied into it once
+ * and given an id, and interning an equal string again returns the same id,
+ * so two interned strings are equal exactly when their ids are.
+ *
+ * it is append-only. strings are packed one after another into large blocks
+ * (with a null terminator after each) instead of being allocated one at a
+ * time, and are never moved or freed until the pool is destroyed, so the
+ * pointers in a string_view stay valid for as long as the pool does.
+ */
+struct string_pool;
+
+/* the id returned when there is no such string (or on memory error) */
+#define STRING_POOL_NO_ID UINT32_MAX
+
+/* a view of an interned string, which is owned by the pool */
+struct string_view {
+    const uint8_t * string; /* null-terminated */
+    size_t length; /* not including the null terminator */
+};
+
+/* create an empty string pool */
+[[nodiscard]] struct string_pool * string_pool_create();
+
+/* destroy this string pool and every string in it */
+void string_pool_destroy(struct string_pool * pool) [[gnu::nonnull(1)]];
+
+/* return the number of distinct strings in this pool */
+size_t string_pool_size(
+        const struct string_pool * pool) [[gnu::nonnull(1)]];
+
+/* intern this string of length, copying it into the pool if an equal string
+ * isn't already there, and return its id
+ *
+ * ids count up from zero in the order strings were first interned
+ *
+ * returns STRING_POOL_NO_ID on memory error
+ */
+uint32_t string_pool_intern(
+        struct string_pool * pool,
+        const uint8_t * string,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]];
+
+/* return the id of this string of length if it has been interned, or
+ * STRING_POOL_NO_ID if it hasn't, without adding it
+ */
+uint32_t string_pool_find(
+        const struct string_pool * pool,
+        const uint8_t * string,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]];
+
+/* return a view of the string with this id, which must have been returned by
+ * string_pool_intern() on this pool
+ */
+struct string_view string_pool_view(
+        const struct string_pool * pool, uint32_t id) [[gnu::nonnull(1)]];
+
+#endif /* UTIL_STRING_POOL_H */
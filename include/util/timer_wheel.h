@@ -0,0 +1,104 @@
+/* File: include/util/timer_wheel.h
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef UTIL_TIMER_WHEEL_H
+#define UTIL_TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* a timer wheel
+ *
+ * this is a hashed timing wheel: timers are kept in one of a fixed number of
+ * slots according to the tick they expire on, and each call to
+ * timer_wheel_tick() only looks at the timers in one slot. scheduling and
+ * cancelling a timer are O(1), and a tick costs O(1) per timer in its slot
+ * rather than per timer on the wheel.
+ *
+ * the wheel does not know how long a tick is: it is driven by whoever calls
+ * timer_wheel_tick() (e.g. the networker's libevent timer.)
+ */
+struct timer_wheel;
+
+/* a timer on a timer wheel
+ *
+ * timers are intrusive: embed one of these in whatever needs a timeout, and
+ * recover it in the callback from the ptr given to timer_wheel_schedule().
+ *
+ * the fields are private to src/util/timer_wheel.c, a timer only needs to be
+ * initialized with timer_wheel_timer_init() before it is first used.
+ */
+struct timer_wheel_timer {
+    struct timer_wheel_timer * prev;
+    struct timer_wheel_timer * next;
+    uint64_t expires;
+    void (*fn)(struct timer_wheel_timer * timer, void * ptr);
+    void * ptr;
+};
+
+/* create a timer wheel with this many slots (which must not be 0)
+ *
+ * more slots means fewer timers looked at (but not fired) per tick when
+ * timeouts are long
+ */
+[[nodiscard]] struct timer_wheel * timer_wheel_create(size_t n_slots);
+
+/* destroy this timer wheel
+ *
+ * any timers still scheduled on it are left unscheduled, not fired
+ */
+void timer_wheel_destroy(struct timer_wheel * wheel) [[gnu::nonnull(1)]];
+
+/* returns the number of times this wheel has ticked */
+uint64_t timer_wheel_now(const struct timer_wheel * wheel) [[gnu::nonnull(1)]];
+
+/* initialize this timer, which is not scheduled */
+void timer_wheel_timer_init(
+        struct timer_wheel_timer * timer) [[gnu::nonnull(1)]];
+
+/* returns true if this timer is scheduled on a wheel */
+bool timer_wheel_timer_pending(
+        const struct timer_wheel_timer * timer) [[gnu::nonnull(1)]];
+
+/* schedule this timer to call fn(timer, ptr) after this many ticks
+ *
+ * a timer that is already scheduled is rescheduled. a timer scheduled for
+ * 0 ticks fires on the next tick.
+ */
+void timer_wheel_schedule(
+        struct timer_wheel * wheel,
+        struct timer_wheel_timer * timer,
+        uint64_t ticks,
+        void (*fn)(struct timer_wheel_timer * timer, void * ptr),
+        void * ptr
+    ) [[gnu::nonnull(1, 2, 4)]];
+
+/* unschedule this timer, if it is scheduled */
+void timer_wheel_cancel(struct timer_wheel_timer * timer) [[gnu::nonnull(1)]];
+
+/* advance this wheel by one tick, firing the timers that expire on it
+ *
+ * fired timers are unscheduled before their callback is called, so the
+ * callback may reschedule them. callbacks may also schedule or cancel any
+ * other timer.
+ */
+void timer_wheel_tick(struct timer_wheel * wheel) [[gnu::nonnull(1)]];
+
+#endif /* UTIL_TIMER_WHEEL_H */
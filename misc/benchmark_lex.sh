@@ -18,11 +18,33 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+# usage: benchmark_lex.sh [BASELINE]
+#
+# runs test/bench over each corpus made by make_lex_test.sh and saves the
+# results in test.gen/results/<commit>-<corpus>.json. if BASELINE (another
+# commit) is given, each result is compared against that commit's with
+# compare_benchmarks.py, and the script fails if any regressed
+
+mkdir -p test.gen/results
+
+commit=$(git describe --always --dirty)
+status=0
+
 function benchmark() {
     echo "$1"
-    time ../test/lex_test --silent < test.gen/"$1"
+    ../test/bench --corpus test.gen/"$1" \
+        --json test.gen/results/"$commit"-"$1".json || status=1
+    if [ -n "$BASELINE" ] ; then
+        ./compare_benchmarks.py \
+            test.gen/results/"$BASELINE"-"$1".json \
+            test.gen/results/"$commit"-"$1".json || status=1
+    fi
 }
 
+BASELINE="$1"
+
 benchmark 1000000-16x16
 benchmark 1000000-64x16
 benchmark 1000000-64x128
+
+exit $status
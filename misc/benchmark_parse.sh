@@ -0,0 +1,33 @@
+#!/bin/bash
+# File: misc/benchmark_parse.sh
+# Part of cards <github.com/rmkrupp/cards>
+#
+# Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+# Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+mkdir -p test.gen
+
+function benchmark() {
+    if [ ! -f test.gen/"$1" ] ; then
+        echo "generating $1..."
+        ./generate_parse_input.py -s 0 $2 > test.gen/"$1"
+    fi
+    echo "$1"
+    ../test/parse_bench --iterations 10 < test.gen/"$1"
+}
+
+benchmark parse-100000 "-n 100000"
+benchmark parse-100000-nested "-n 100000 --depth 4 --nest-percent 40"
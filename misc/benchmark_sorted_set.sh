@@ -0,0 +1,58 @@
+#!/bin/bash
+# File: misc/benchmark_sorted_set.sh
+# Part of cards <github.com/rmkrupp/cards>
+#
+# Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+# Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: benchmark_sorted_set.sh [CONFIGURE ARGS...]
+#
+# builds test/bench with each --sorted-set-backend and runs it with 1k, 100k
+# and 1M keys, saving the results in
+# test.gen/results/<commit>-sorted_set-<backend>-<keys>.json and comparing
+# the btree's against the skip list's with compare_benchmarks.py
+#
+# n.b. this reconfigures the build (with any arguments given), and leaves it
+# configured with the default backend
+
+mkdir -p test.gen/results
+
+commit=$(git describe --always --dirty)
+status=0
+
+function configure() {
+    (cd .. && ./configure.py "$@" && ninja test/bench) || exit 1
+}
+
+for backend in skiplist btree ; do
+    configure --sorted-set-backend="$backend" "$@"
+    for keys in 1000 100000 1000000 ; do
+        echo "$backend, $keys keys"
+        json=test.gen/results/"$commit"-sorted_set-"$backend"-"$keys".json
+        ../test/bench --keys "$keys" --json "$json" || status=1
+    done
+done
+
+configure "$@"
+
+for keys in 1000 100000 1000000 ; do
+    echo "btree against skiplist, $keys keys"
+    ./compare_benchmarks.py \
+        test.gen/results/"$commit"-sorted_set-skiplist-"$keys".json \
+        test.gen/results/"$commit"-sorted_set-btree-"$keys".json
+done
+
+exit $status
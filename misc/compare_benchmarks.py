@@ -0,0 +1,72 @@
+#!/usr/bin/python3
+# File: misc/compare_benchmarks.py
+# Part of cards <github.com/rmkrupp/cards>
+#
+# Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+# Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+
+# compare two sets of results written by test/bench --json, and exit with
+# status 1 if any benchmark got slower by more than the threshold
+
+import argparse
+import json
+import sys
+
+parser = argparse.ArgumentParser(
+        prog="compare_benchmarks",
+        description="compare the results of two runs of test/bench"
+    )
+
+parser.add_argument("baseline", help="the results to compare against")
+parser.add_argument("current", help="the new results")
+parser.add_argument(
+        "-t", "--threshold",
+        type=float,
+        default=10,
+        help="the slowdown (in percent of the mean) that counts as a "
+             "regression"
+    )
+
+args = parser.parse_args()
+
+with open(args.baseline) as f:
+    baseline = json.load(f)
+with open(args.current) as f:
+    current = json.load(f)
+
+for key in ["seed", "keys", "attacks"]:
+    if baseline.get(key) != current.get(key):
+        print("warning: the runs used different --" + key, file=sys.stderr)
+
+regressions = 0
+
+print("%-20s %12s %12s %9s" % ("benchmark", "baseline", "current", "change"))
+for name, result in current["results"].items():
+    if name not in baseline["results"]:
+        print("%-20s %12s %12.2f %9s" % (name, "-", result["mean_ns"], "new"))
+        continue
+
+    old = baseline["results"][name]["mean_ns"]
+    new = result["mean_ns"]
+    change = 100 * (new - old) / old if old > 0 else 0
+    mark = ""
+    if change > args.threshold:
+        mark = " REGRESSION"
+        regressions += 1
+    print("%-20s %12.2f %12.2f %+8.1f%%%s" % (name, old, new, change, mark))
+
+if regressions:
+    print(str(regressions) + " regression(s) over " +
+          str(args.threshold) + "%")
+    sys.exit(1)
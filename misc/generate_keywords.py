@@ -0,0 +1,151 @@
+#!/usr/bin/python3
+# File: misc/generate_keywords.py
+# Part of cards <github.com/rmkrupp/cards>
+#
+# Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+# Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# generate command/keywords.h and command/keyword.gperf from the keyword list
+# in src/command/keywords.txt (see that file for its format)
+
+import argparse
+import re
+import sys
+
+parser = argparse.ArgumentParser(
+        prog="generate_keywords",
+        description="generate the keyword enum, gperf input, and command "
+                    "dispatch list from a keyword list"
+    )
+
+parser.add_argument("input", help="the keyword list")
+parser.add_argument("--header", required=True,
+                    help="where to write command/keywords.h")
+parser.add_argument("--gperf", required=True,
+                    help="where to write command/keyword.gperf")
+
+args = parser.parse_args()
+
+license = """\
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * generated by misc/generate_keywords.py from """ + args.input + """, do not
+ * edit
+ */
+"""
+
+keywords = []
+commands = []
+
+with open(args.input) as f:
+    for number, line in enumerate(f, 1):
+        fields = line.split("#", 1)[0].split()
+        if not fields:
+            continue
+
+        def fail(why):
+            print(args.input + ":" + str(number) + ": " + why,
+                  file=sys.stderr)
+            sys.exit(1)
+
+        keyword = fields[0]
+        if not re.fullmatch("[A-Z][A-Z0-9_]*", keyword):
+            fail("bad keyword " + keyword)
+        if keyword in keywords:
+            fail("duplicate keyword " + keyword)
+        keywords += [keyword]
+
+        if len(fields) == 1:
+            continue
+        if len(fields) != 3 or fields[1] != "command":
+            fail("expected KEYWORD [command HANDLER]")
+        if not re.fullmatch("[a-z_][a-z0-9_]*", fields[2]):
+            fail("bad handler " + fields[2])
+        commands += [(keyword, fields[2])]
+
+with open(args.header, "w") as f:
+    f.write("/* File: command/keywords.h\n" + license)
+    f.write("#ifndef COMMAND_KEYWORDS_H\n#define COMMAND_KEYWORDS_H\n\n")
+
+    f.write("enum keyword {\n    KEYWORD_NO_MATCH,\n")
+    for keyword in keywords:
+        f.write("    KEYWORD_" + keyword + ",\n")
+    f.write("    KEYWORD_COUNT /* the number of keywords "
+            "(this is not a keyword) */\n};\n\n")
+
+    f.write("/* the type of a command */\nenum command_type {\n")
+    f.write("    COMMAND_ERROR, /* the command could not be parsed, "
+            "see .error */\n")
+    for keyword, _ in commands:
+        f.write("    COMMAND_" + keyword + ",\n")
+    f.write("    COMMAND_COUNT /* the number of command types "
+            "(this is not a command) */\n};\n\n")
+
+    f.write("/* X(COMMAND, handler) for every command type, in order */\n")
+    f.write("#define COMMAND_HANDLERS(X) \\\n    X(ERROR, error)")
+    for keyword, handler in commands:
+        f.write(" \\\n    X(" + keyword + ", " + handler + ")")
+    f.write("\n\n#endif /* COMMAND_KEYWORDS_H */\n")
+
+with open(args.gperf, "w") as f:
+    f.write("%{\n/* File: command/keyword.gperf (or the .c file generated "
+            "from it by gperf)\n" + license)
+    f.write("""\
+#include "command/keyword.h"
+%}
+
+%compare-strncmp
+%readonly-tables
+%enum
+%define slot-name offset
+%define lookup-function-name keyword_lookup
+%define string-pool-name keyword_pool
+%includes
+%omit-struct-type
+%struct-type
+%pic
+
+struct keyword_lookup_result;
+
+%%
+""")
+    for keyword in keywords:
+        f.write(keyword + ", KEYWORD_" + keyword + "\n")
+    f.write("""\
+%%
+
+/* offset->string function because we are using %pic */
+const char * __attribute__ ((const)) keyword_string(int offset)
+{
+    return &keyword_pool[offset];
+}
+""")
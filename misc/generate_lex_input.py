@@ -18,7 +18,7 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-from random import randint, choice
+from random import randint, choice, seed
 import string
 import argparse
 import sys
@@ -88,6 +88,11 @@ parser.add_argument(
         default=1,
         help="set the relative frequency of end-nest particles"
     )
+parser.add_argument(
+        "-s", "--seed",
+        type=int,
+        help="set the random seed (the same seed gives the same output)"
+    )
 parser.add_argument(
         "--percent",
         action="store_true",
@@ -96,6 +101,9 @@ parser.add_argument(
 
 args = parser.parse_args()
 
+if args.seed is not None:
+    seed(args.seed)
+
 name_forbidden = "\n\"\r\x0b\x0c"
 particle_name_letters = [c for c in string.printable if c not in name_forbidden]
 particle_num_letters = [c for c in string.digits]
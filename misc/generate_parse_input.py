@@ -0,0 +1,131 @@
+#!/usr/bin/python3
+# File: misc/generate_parse_input.py
+# Part of cards <github.com/rmkrupp/cards>
+#
+# Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+# Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+from random import Random
+import argparse
+import sys
+
+parser = argparse.ArgumentParser(
+        prog="generate_parse_input",
+        description="generate (valid) commands for the parser to parse"
+    )
+
+parser.add_argument(
+        "-n", "--number",
+        type=int,
+        default=1000,
+        help="set the number of commands to generate"
+    )
+parser.add_argument(
+        "-s", "--seed",
+        type=int,
+        default=0,
+        help="set the random seed (the same seed gives the same commands)"
+    )
+parser.add_argument(
+        "-d", "--depth",
+        type=int,
+        default=2,
+        help="set the maximum depth of nested subcommands"
+    )
+parser.add_argument(
+        "--nest-percent",
+        type=int,
+        default=10,
+        help="set how often a value is a subcommand rather than a number or "
+             "name"
+    )
+
+args = parser.parse_args()
+
+random = Random(args.seed)
+
+def maybe(s):
+    return s if random.randint(0, 1) else ""
+
+def name():
+    return "\"" + "".join(
+            random.choice("abcdefghijklmnopqrstuvwxyz ")
+            for _ in range(random.randint(1, 16))
+        ) + "\""
+
+def number():
+    return str(random.randint(0, 99))
+
+def value(depth):
+    if depth < args.depth and random.randint(1, 100) <= args.nest_percent:
+        return "( " + command(depth + 1) + " )"
+    return random.choice([name, number])()
+
+def player(depth):
+    return random.choice(["my", "player " + value(depth)])
+
+def stack(depth):
+    return random.choice([
+        "hand", "deck", "discard", "grave",
+        "zone " + value(depth), "zone id " + value(depth), "zone special"
+    ])
+
+def location(depth):
+    s = maybe(player(depth) + " ") + stack(depth)
+    if random.randint(0, 1):
+        s += " position " + value(depth)
+    return s
+
+def card(depth):
+    return "card " + random.choice([
+        "id " + value(depth),
+        value(depth) + maybe(" in " + location(depth)),
+        "in " + location(depth)
+    ])
+
+def face_mode():
+    return maybe(random.choice([" face up", " face down", " up", " down"])) + \
+        maybe(random.choice([" attack", " defense", " attack mode"]))
+
+def command(depth=0):
+    return random.choice([
+        lambda: "say " + " ".join(name() for _ in range(random.randint(1, 4))),
+        lambda: random.choice(["version", "rules", "ready"]),
+        lambda: "look " + random.choice([
+            player(depth) + maybe(" " + random.choice([
+                stack(depth), "life", "energy", "energy sources"])),
+            location(depth),
+            card(depth),
+            "life",
+            "energy" + maybe(" sources")
+        ]),
+        lambda: "activate " + card(depth) + " ability " + value(depth),
+        lambda: "list " + random.choice([
+            "players", "stacks", "zones",
+            player(depth) + random.choice([" stacks", " zones"])
+        ]),
+        lambda: "find " + card(depth),
+        lambda: "lookup " + card(depth) + maybe(" ability " + value(depth)),
+        lambda: "move " + location(depth) + maybe(" to") + " " + \
+            location(depth) + face_mode(),
+        lambda: "play " + random.choice([number(), location(depth)]) + \
+            maybe(random.choice([" in ", " on "]) + location(depth)) + \
+            face_mode()
+    ])()
+
+for i in range(args.number):
+    print(command())
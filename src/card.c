@@ -219,8 +219,14 @@ struct card * card_load(
         }
         size_t length;
         const char * key = lua_tolstring(L, -1, &length);
-        const struct name * ability_name =
-            name_set_lookup(name_set, (const uint8_t *)key, length, &oom);
+        const struct name * ability_name = name_set_lookup_types(
+                name_set,
+                (const uint8_t *)key,
+                length,
+                NAME_TYPE_BIT(NAME_TYPE_CARD) |
+                    NAME_TYPE_BIT(NAME_TYPE_ABILITY),
+                &oom
+            );
 
         if (oom) {
             LOGF_ERROR(logger, "card_load() failed to allocate memory\n");
@@ -291,7 +291,6 @@ void particle_buffer_grow(
         );
 
     if (new_ptr) {
-        free(buffer->particles);
         buffer->particles = new_ptr;
         buffer->capacity += amount;
     }
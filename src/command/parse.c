@@ -19,55 +19,843 @@
  */
 #include "command/parse.h"
 #include "command/lex.h"
-#include "util/refstring.h"
+#include "util/arena.h"
+#include "util/safe_realloc.h"
 
-#include <unistdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include <limits.h>
 
+/* the size of the blocks of the parser's arena */
+#ifndef PARSER_ARENA_BLOCK_SIZE_DEFAULT
+#define PARSER_ARENA_BLOCK_SIZE_DEFAULT (16 * 1024)
+#endif /* PARSER_ARENA_BLOCK_SIZE_DEFAULT */
+
+/* the initial depth of the parse and frame stacks */
+#ifndef PARSER_STACK_SIZE_DEFAULT
+#define PARSER_STACK_SIZE_DEFAULT 32
+#endif /* PARSER_STACK_SIZE_DEFAULT */
+
+/* the terminals of the grammar, which are particle types, except that each
+ * keyword is a terminal of its own
+ */
+enum terminal {
+    T_END,
+    T_NUMBER,
+    T_NAME,
+    T_BEGIN_NEST,
+    T_END_NEST,
+    T_ERROR,
+    T_KEYWORD, /* T_KEYWORD + the keyword, see KW() */
+    N_TERMINALS = T_KEYWORD + KEYWORD_COUNT
+};
+
+#define KW(keyword) (T_KEYWORD + KEYWORD_##keyword)
+
+/* the nonterminals of the grammar (see planning/grammar, this is that
+ * grammar rewritten to be LL(1), with optional parts as nonterminals of their
+ * own)
+ */
+enum nonterminal {
+    NT_COMMAND,
+    NT_PLAYERSPEC,
+    NT_PLAYER_OPT,
+    NT_STACKSPEC,
+    NT_ZONE_TAIL,
+    NT_POSITION_OPT,
+    NT_LOCATION,
+    NT_LOCATION_OPT,
+    NT_CARDSPEC,
+    NT_CARD_TAIL,
+    NT_MOVESPEC,
+    NT_ABILITY,
+    NT_ABILITY_OPT,
+    NT_FACE_OPT,
+    NT_FACE_DIRECTION,
+    NT_MODE_OPT,
+    NT_MODE_KEYWORD_OPT,
+    NT_TO_OPT,
+    NT_IN_ON_OPT,
+    NT_HAND_DEFAULT,
+    NT_SPECIAL_DEFAULT,
+    NT_LOOK_ARGS,
+    NT_LOOK_PLAYER_TAIL,
+    NT_SOURCES_OPT,
+    NT_LIST_ARGS,
+    NT_LIST_WHAT,
+    NT_NAME,
+    NT_COUNT_OPT,
+    N_NONTERMINALS
+};
+
+/* what a symbol of a production does when the parser gets to it */
+enum op {
+    OP_DONE, /* the end of the production */
+    OP_NT, /* expand nonterminal arg */
+    OP_SKIP, /* consume the (already predicted) particle */
+    OP_STORE, /* consume the (already predicted) keyword, storing it in the
+               * argument being built
+               */
+    OP_VALUE, /* consume a number, name, or subcommand as the value of the
+               * argument being built
+               */
+    OP_REST, /* consume the rest of the command as an ARGUMENT_TEXT */
+    OP_COMMAND, /* set the type of the command to arg */
+    OP_OPEN, /* start building a new argument of type arg */
+    OP_ADOPT, /* start building a new argument of type arg, taking the last
+               * argument that was built as its first child
+               */
+    OP_CLOSE, /* finish the argument being built */
+    OP_END_NEST /* consume the ) that ends a subcommand */
+};
+
+/* one symbol of a production */
+struct parser_symbol {
+    uint8_t op;
+    uint8_t arg;
+};
+
+#define NT(x) { OP_NT, NT_##x }
+#define SKIP { OP_SKIP, 0 }
+#define STORE { OP_STORE, 0 }
+#define VALUE { OP_VALUE, 0 }
+#define REST { OP_REST, 0 }
+#define COMMAND(x) { OP_COMMAND, COMMAND_##x }
+#define OPEN(x) { OP_OPEN, ARGUMENT_##x }
+#define ADOPT(x) { OP_ADOPT, ARGUMENT_##x }
+#define CLOSE { OP_CLOSE, 0 }
+#define DONE { OP_DONE, 0 }
+
+#define PRODUCTION(name, ...) \
+    static const struct parser_symbol name[] = { __VA_ARGS__, DONE }
+
+/* commands */
+PRODUCTION(p_say, COMMAND(SAY), SKIP, REST);
+PRODUCTION(p_exit, COMMAND(EXIT), SKIP);
+PRODUCTION(p_shutdown, COMMAND(SHUTDOWN), SKIP);
+PRODUCTION(p_version, COMMAND(VERSION), SKIP);
+PRODUCTION(p_rules, COMMAND(RULES), SKIP);
+PRODUCTION(p_ready, COMMAND(READY), SKIP);
+PRODUCTION(p_look, COMMAND(LOOK), SKIP, NT(LOOK_ARGS));
+PRODUCTION(p_activate, COMMAND(ACTIVATE), SKIP, NT(MOVESPEC));
+PRODUCTION(p_list, COMMAND(LIST), SKIP, NT(LIST_ARGS));
+PRODUCTION(p_find, COMMAND(FIND), SKIP, NT(CARDSPEC));
+PRODUCTION(p_lookup, COMMAND(LOOKUP), SKIP, NT(CARDSPEC), NT(ABILITY_OPT));
+PRODUCTION(p_move,
+        COMMAND(MOVE), SKIP, NT(LOCATION), NT(TO_OPT), NT(LOCATION),
+        NT(FACE_OPT), NT(MODE_OPT));
+PRODUCTION(p_play,
+        COMMAND(PLAY), SKIP, NT(HAND_DEFAULT), NT(IN_ON_OPT),
+        NT(SPECIAL_DEFAULT), NT(FACE_OPT), NT(MODE_OPT));
+PRODUCTION(p_complete,
+        COMMAND(COMPLETE), SKIP, OPEN(PREFIX), NT(NAME), CLOSE,
+        NT(COUNT_OPT));
+
+/* specs */
+PRODUCTION(p_player_my, OPEN(PLAYER), STORE, CLOSE);
+PRODUCTION(p_player, OPEN(PLAYER), STORE, VALUE, CLOSE);
+PRODUCTION(p_stack, OPEN(STACK), STORE, CLOSE);
+PRODUCTION(p_zone, OPEN(STACK), STORE, NT(ZONE_TAIL), CLOSE);
+PRODUCTION(p_position_keyword, OPEN(POSITION), SKIP, VALUE, CLOSE);
+PRODUCTION(p_position, OPEN(POSITION), VALUE, CLOSE);
+PRODUCTION(p_location,
+        OPEN(LOCATION), NT(PLAYER_OPT), NT(STACKSPEC), NT(POSITION_OPT),
+        CLOSE);
+PRODUCTION(p_in_location, SKIP, NT(LOCATION));
+PRODUCTION(p_card, OPEN(CARD), SKIP, NT(CARD_TAIL), CLOSE);
+PRODUCTION(p_card_value, VALUE, NT(LOCATION_OPT));
+PRODUCTION(p_movespec, NT(CARDSPEC), ADOPT(MOVE), NT(ABILITY), CLOSE);
+PRODUCTION(p_adopt_move, ADOPT(MOVE), NT(ABILITY), CLOSE);
+PRODUCTION(p_face_keyword, OPEN(FACE), SKIP, NT(FACE_DIRECTION), CLOSE);
+PRODUCTION(p_face, OPEN(FACE), STORE, CLOSE);
+PRODUCTION(p_mode, OPEN(MODE), STORE, NT(MODE_KEYWORD_OPT), CLOSE);
+PRODUCTION(p_look_player, NT(PLAYERSPEC), NT(LOOK_PLAYER_TAIL));
+PRODUCTION(p_life, OPEN(LIFE), SKIP, CLOSE);
+PRODUCTION(p_energy, OPEN(ENERGY), SKIP, NT(SOURCES_OPT), CLOSE);
+PRODUCTION(p_adopt_location,
+        ADOPT(LOCATION), NT(STACKSPEC), NT(POSITION_OPT), CLOSE);
+PRODUCTION(p_adopt_life, ADOPT(LIFE), SKIP, CLOSE);
+PRODUCTION(p_adopt_energy, ADOPT(ENERGY), SKIP, NT(SOURCES_OPT), CLOSE);
+PRODUCTION(p_list_what, OPEN(LIST), STORE, CLOSE);
+PRODUCTION(p_count, OPEN(COUNT), VALUE, CLOSE);
+PRODUCTION(p_list_player,
+        NT(PLAYERSPEC), ADOPT(LIST), NT(LIST_WHAT), CLOSE);
+
+/* shared by several nonterminals */
+PRODUCTION(p_skip, SKIP);
+PRODUCTION(p_store, STORE);
+PRODUCTION(p_value, VALUE);
+PRODUCTION(p_skip_value, SKIP, VALUE);
+PRODUCTION(p_playerspec, NT(PLAYERSPEC));
+PRODUCTION(p_locationspec, NT(LOCATION));
+PRODUCTION(p_cardspec, NT(CARDSPEC));
+
+/* what a top-level command and a subcommand expand to */
+PRODUCTION(p_top, NT(COMMAND));
+PRODUCTION(p_nested, NT(COMMAND), { OP_END_NEST, 0 });
+
+/* the entries of the prediction table for sets of terminals */
+#define VALUE_FIRST(p) \
+    [T_NUMBER] = (p), [T_NAME] = (p), [T_BEGIN_NEST] = (p)
+#define PLAYER_FIRST(p) \
+    [KW(MY)] = (p), [KW(PLAYER)] = (p)
+#define STACK_FIRST(p) \
+    [KW(HAND)] = (p), [KW(DECK)] = (p), [KW(DISCARD)] = (p), \
+    [KW(GRAVE)] = (p), [KW(ZONE)] = (p)
+#define LOCATION_FIRST(p) PLAYER_FIRST(p), STACK_FIRST(p)
+
+/* the prediction table: which production a nonterminal expands to given the
+ * next terminal, or NULL if there isn't one (in which case the nonterminal
+ * expands to nothing if it is nullable, and is an error otherwise)
+ */
+static const struct parser_symbol * const
+predict[N_NONTERMINALS][N_TERMINALS] = {
+    [NT_COMMAND] = {
+        [KW(SAY)] = p_say,
+        [KW(EXIT)] = p_exit,
+        [KW(SHUTDOWN)] = p_shutdown,
+        [KW(VERSION)] = p_version,
+        [KW(RULES)] = p_rules,
+        [KW(READY)] = p_ready,
+        [KW(LOOK)] = p_look,
+        [KW(ACTIVATE)] = p_activate,
+        [KW(LIST)] = p_list,
+        [KW(FIND)] = p_find,
+        [KW(LOOKUP)] = p_lookup,
+        [KW(MOVE)] = p_move,
+        [KW(PLAY)] = p_play,
+        [KW(COMPLETE)] = p_complete
+    },
+    [NT_PLAYERSPEC] = {
+        [KW(MY)] = p_player_my,
+        [KW(PLAYER)] = p_player
+    },
+    [NT_PLAYER_OPT] = { PLAYER_FIRST(p_playerspec) },
+    [NT_STACKSPEC] = {
+        [KW(HAND)] = p_stack,
+        [KW(DECK)] = p_stack,
+        [KW(DISCARD)] = p_stack,
+        [KW(GRAVE)] = p_stack,
+        [KW(ZONE)] = p_zone
+    },
+    [NT_ZONE_TAIL] = {
+        [KW(ID)] = p_skip_value,
+        [KW(SPECIAL)] = p_store,
+        VALUE_FIRST(p_value)
+    },
+    [NT_POSITION_OPT] = {
+        [KW(POSITION)] = p_position_keyword,
+        [T_NUMBER] = p_position,
+        [T_BEGIN_NEST] = p_position
+    },
+    [NT_LOCATION] = { LOCATION_FIRST(p_location) },
+    [NT_LOCATION_OPT] = {
+        [KW(IN)] = p_in_location,
+        LOCATION_FIRST(p_locationspec)
+    },
+    [NT_CARDSPEC] = { [KW(CARD)] = p_card },
+    [NT_CARD_TAIL] = {
+        [KW(ID)] = p_skip_value,
+        [KW(IN)] = p_in_location,
+        VALUE_FIRST(p_card_value),
+        LOCATION_FIRST(p_locationspec)
+    },
+    [NT_MOVESPEC] = { [KW(CARD)] = p_movespec },
+    [NT_ABILITY] = {
+        [KW(ABILITY)] = p_skip_value,
+        VALUE_FIRST(p_value)
+    },
+    [NT_ABILITY_OPT] = {
+        [KW(ABILITY)] = p_adopt_move,
+        VALUE_FIRST(p_adopt_move)
+    },
+    [NT_FACE_OPT] = {
+        [KW(FACE)] = p_face_keyword,
+        [KW(UP)] = p_face,
+        [KW(DOWN)] = p_face
+    },
+    [NT_FACE_DIRECTION] = {
+        [KW(UP)] = p_store,
+        [KW(DOWN)] = p_store
+    },
+    [NT_MODE_OPT] = {
+        [KW(ATTACK)] = p_mode,
+        [KW(DEFENSE)] = p_mode
+    },
+    [NT_MODE_KEYWORD_OPT] = { [KW(MODE)] = p_skip },
+    [NT_TO_OPT] = { [KW(TO)] = p_skip },
+    [NT_IN_ON_OPT] = {
+        [KW(IN)] = p_skip,
+        [KW(ON)] = p_skip
+    },
+    [NT_HAND_DEFAULT] = {
+        [T_NUMBER] = p_position,
+        [T_BEGIN_NEST] = p_position,
+        LOCATION_FIRST(p_locationspec)
+    },
+    [NT_SPECIAL_DEFAULT] = { LOCATION_FIRST(p_locationspec) },
+    [NT_LOOK_ARGS] = {
+        PLAYER_FIRST(p_look_player),
+        STACK_FIRST(p_locationspec),
+        [KW(CARD)] = p_cardspec,
+        [KW(LIFE)] = p_life,
+        [KW(ENERGY)] = p_energy
+    },
+    [NT_LOOK_PLAYER_TAIL] = {
+        STACK_FIRST(p_adopt_location),
+        [KW(LIFE)] = p_adopt_life,
+        [KW(ENERGY)] = p_adopt_energy
+    },
+    [NT_SOURCES_OPT] = { [KW(SOURCES)] = p_store },
+    [NT_LIST_ARGS] = {
+        [KW(PLAYERS)] = p_list_what,
+        [KW(STACKS)] = p_list_what,
+        [KW(ZONES)] = p_list_what,
+        PLAYER_FIRST(p_list_player)
+    },
+    [NT_LIST_WHAT] = {
+        [KW(STACKS)] = p_store,
+        [KW(ZONES)] = p_store
+    },
+    [NT_NAME] = { [T_NAME] = p_value },
+    [NT_COUNT_OPT] = { [T_NUMBER] = p_count }
+};
+
+/* the nonterminals that may expand to nothing */
+static const bool nullable[N_NONTERMINALS] = {
+    [NT_PLAYER_OPT] = true,
+    [NT_POSITION_OPT] = true,
+    [NT_LOCATION_OPT] = true,
+    [NT_ABILITY_OPT] = true,
+    [NT_FACE_OPT] = true,
+    [NT_MODE_OPT] = true,
+    [NT_MODE_KEYWORD_OPT] = true,
+    [NT_TO_OPT] = true,
+    [NT_IN_ON_OPT] = true,
+    [NT_SPECIAL_DEFAULT] = true,
+    [NT_LOOK_PLAYER_TAIL] = true,
+    [NT_SOURCES_OPT] = true,
+    [NT_COUNT_OPT] = true
+};
+
+/* the error for when a (non-nullable) nonterminal has no production for the
+ * next terminal
+ */
+static const char * expected[N_NONTERMINALS] = {
+    [NT_COMMAND] = "expected a command",
+    [NT_PLAYERSPEC] = "expected MY or PLAYER",
+    [NT_STACKSPEC] = "expected HAND, DECK, DISCARD, GRAVE, or ZONE",
+    [NT_ZONE_TAIL] = "expected a zone",
+    [NT_LOCATION] = "expected a location",
+    [NT_CARDSPEC] = "expected CARD",
+    [NT_CARD_TAIL] = "expected a card",
+    [NT_MOVESPEC] = "expected CARD",
+    [NT_ABILITY] = "expected an ability",
+    [NT_FACE_DIRECTION] = "expected UP or DOWN",
+    [NT_HAND_DEFAULT] = "expected a position in the hand or a location",
+    [NT_LOOK_ARGS] = "expected something to look at",
+    [NT_LIST_ARGS] = "expected PLAYERS, STACKS, ZONES, or a player",
+    [NT_LIST_WHAT] = "expected STACKS or ZONES",
+    [NT_NAME] = "expected a name"
+};
+
+/* an argument (or command) being built
+ *
+ * tail is where the next child goes, and last is what points to the last
+ * child (for OP_ADOPT), or NULL if there isn't one yet
+ */
+struct parser_frame {
+    struct command * command;
+    struct argument * argument;
+    struct argument ** tail;
+    struct argument ** last;
+};
+
+/* the state of parsing one top-level command */
+struct parse_state {
+    struct parser * parser;
+    struct command * command;
+
+    /* the particles of the command, not including its PARTICLE_END */
+    struct particle ** particles;
+    size_t n_particles;
+    size_t index;
+
+    size_t depth;
+    size_t n_frames;
+
+    const char * error;
+};
+
+/* create a parser for this game */
 [[nodiscard]] struct parser * parser_create(struct game * game)
 {
     struct parser * parser = malloc(sizeof(*parser));
-    if (!parser) return NULL;
+    if (!parser) {
+        return NULL;
+    }
+
     *parser = (struct parser) {
-        .game = game
+        .game = game,
+        .arena = arena_create(PARSER_ARENA_BLOCK_SIZE_DEFAULT),
+        .stack = malloc(sizeof(*parser->stack) * PARSER_STACK_SIZE_DEFAULT),
+        .stack_capacity = PARSER_STACK_SIZE_DEFAULT,
+        .frames = malloc(
+                sizeof(*parser->frames) * PARSER_STACK_SIZE_DEFAULT),
+        .frames_capacity = PARSER_STACK_SIZE_DEFAULT
     };
+
+    if (!parser->arena || !parser->stack || !parser->frames) {
+        if (parser->arena) {
+            arena_destroy(parser->arena);
+        }
+        free(parser->stack);
+        free(parser->frames);
+        free(parser);
+        return NULL;
+    }
+
     return parser;
 }
 
+/* destroy this parser */
 void parser_destroy(struct parser * parser) [[gnu::nonnull(1)]]
 {
+    arena_destroy(parser->arena);
+    free(parser->stack);
+    free(parser->frames);
     free(parser);
 }
 
+/* returns the terminal of the next particle */
+static enum terminal lookahead(
+        const struct parse_state * state) [[gnu::nonnull(1)]]
+{
+    if (state->index >= state->n_particles) {
+        return T_END;
+    }
+
+    const struct particle * particle = state->particles[state->index];
+    switch (particle->type) {
+        case PARTICLE_END:
+            return T_END;
+        case PARTICLE_KEYWORD:
+            if ((size_t)particle->keyword >= KEYWORD_COUNT) {
+                return T_ERROR;
+            }
+            return T_KEYWORD + particle->keyword;
+        case PARTICLE_NUMBER:
+            return T_NUMBER;
+        case PARTICLE_NAME:
+            return T_NAME;
+        case PARTICLE_BEGIN_NEST:
+            return T_BEGIN_NEST;
+        case PARTICLE_END_NEST:
+            return T_END_NEST;
+        case PARTICLE_ERROR:
+            return T_ERROR;
+    }
+    return T_ERROR;
+}
+
+/* push this position in a production onto the parse stack */
+static bool push_symbol(
+        struct parse_state * state,
+        const struct parser_symbol * symbol
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct parser * parser = state->parser;
+    if (state->depth == parser->stack_capacity) {
+        parser->stack = safe_realloc(
+                parser->stack,
+                sizeof(*parser->stack) * parser->stack_capacity * 2
+            );
+        if (!parser->stack) {
+            parser->stack_capacity = 0;
+            return false;
+        }
+        parser->stack_capacity *= 2;
+    }
+    parser->stack[state->depth++] = symbol;
+    return true;
+}
+
+/* push a frame onto the frame stack */
+static bool push_frame(
+        struct parse_state * state,
+        struct parser_frame frame
+    ) [[gnu::nonnull(1)]]
+{
+    struct parser * parser = state->parser;
+    if (state->n_frames == parser->frames_capacity) {
+        parser->frames = safe_realloc(
+                parser->frames,
+                sizeof(*parser->frames) * parser->frames_capacity * 2
+            );
+        if (!parser->frames) {
+            parser->frames_capacity = 0;
+            return false;
+        }
+        parser->frames_capacity *= 2;
+    }
+    parser->frames[state->n_frames++] = frame;
+    return true;
+}
+
+/* returns a new command (of type COMMAND_ERROR) starting at particles */
+[[nodiscard]] static struct command * command_create(
+        struct parser * parser,
+        struct particle ** particles,
+        size_t n_particles
+    ) [[gnu::nonnull(1)]]
+{
+    struct command * command = arena_alloc(parser->arena, sizeof(*command));
+    if (!command) {
+        return NULL;
+    }
+    *command = (struct command) {
+        .type = COMMAND_ERROR,
+        .particles = particles,
+        .n_particles = n_particles
+    };
+    return command;
+}
+
+/* returns a new argument of this type, added as the last child of whatever
+ * the top frame is building
+ */
+[[nodiscard]] static struct argument * argument_create(
+        struct parse_state * state,
+        enum argument_type type
+    ) [[gnu::nonnull(1)]]
+{
+    struct argument * argument =
+        arena_alloc(state->parser->arena, sizeof(*argument));
+    if (!argument) {
+        return NULL;
+    }
+
+    *argument = (struct argument) {
+        .type = type,
+        .keyword = KEYWORD_NO_MATCH
+    };
+
+    struct parser_frame * frame = &state->parser->frames[state->n_frames - 1];
+    *frame->tail = argument;
+    frame->last = frame->tail;
+    frame->tail = &argument->next;
+
+    return argument;
+}
+
+/* the value of a number particle, returning false if it doesn't fit in a
+ * long
+ */
+static bool number_value(
+        const struct particle * particle,
+        long * number
+    ) [[gnu::nonnull(1, 2)]]
+{
+    long value = 0;
+    for (size_t i = 0; i < particle->length; i++) {
+        int digit = particle->value[i] - '0';
+        if (value > (LONG_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    *number = value;
+    return true;
+}
+
+/* run one symbol, returning false (with state->error set) on error */
+static bool parse_symbol(
+        struct parse_state * state,
+        const struct parser_symbol * symbol
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct parser * parser = state->parser;
+    struct parser_frame * frame = &parser->frames[state->n_frames - 1];
+    enum terminal terminal = lookahead(state);
+
+    switch ((enum op)symbol->op) {
+        case OP_DONE:
+            break;
+
+        case OP_NT: {
+            const struct parser_symbol * production =
+                predict[symbol->arg][terminal];
+            if (!production) {
+                if (nullable[symbol->arg]) {
+                    return true;
+                }
+                state->error = terminal == T_ERROR ?
+                    "invalid input" : expected[symbol->arg];
+                return false;
+            }
+            if (!push_symbol(state, production)) {
+                state->error = "out of memory";
+                return false;
+            }
+            return true;
+        }
+
+        case OP_SKIP:
+            state->index++;
+            return true;
+
+        case OP_STORE:
+            frame->argument->keyword =
+                state->particles[state->index]->keyword;
+            state->index++;
+            return true;
+
+        case OP_VALUE: {
+            struct value * value = &frame->argument->value;
+            struct particle * particle = state->index < state->n_particles ?
+                state->particles[state->index] : NULL;
+
+            if (terminal == T_NUMBER) {
+                *value = (struct value) {
+                    .type = VALUE_NUMBER,
+                    .particle = particle
+                };
+                if (!number_value(particle, &value->number)) {
+                    state->error = "number out of range";
+                    return false;
+                }
+                state->index++;
+                return true;
+            }
+
+            if (terminal == T_NAME) {
+                *value = (struct value) {
+                    .type = VALUE_NAME,
+                    .particle = particle
+                };
+                state->index++;
+                return true;
+            }
+
+            if (terminal != T_BEGIN_NEST) {
+                state->error = terminal == T_ERROR ? "invalid input" :
+                    "expected a number, a name, or a subcommand";
+                return false;
+            }
+
+            state->index++;
+            struct command * subcommand = command_create(
+                    parser, &state->particles[state->index], 0);
+            if (!subcommand || !push_frame(state, (struct parser_frame) {
+                        .command = subcommand,
+                        .tail = &subcommand->arguments
+                    }) || !push_symbol(state, p_nested)) {
+                state->error = "out of memory";
+                return false;
+            }
+            *value = (struct value) {
+                .type = VALUE_SUBCOMMAND,
+                .subcommand = subcommand
+            };
+            return true;
+        }
+
+        case OP_END_NEST:
+            if (terminal != T_END_NEST) {
+                state->error = "expected )";
+                return false;
+            }
+            frame->command->n_particles =
+                &state->particles[state->index] - frame->command->particles;
+            state->index++;
+            state->n_frames--;
+            return true;
+
+        case OP_REST: {
+            /* a subcommand's text ends at its ), a command's at its end */
+            bool nested = frame->command != state->command;
+            size_t start = state->index;
+            size_t depth = 0;
+            for (; state->index < state->n_particles; state->index++) {
+                enum particle_type type =
+                    state->particles[state->index]->type;
+                if (type == PARTICLE_BEGIN_NEST) {
+                    depth++;
+                } else if (type == PARTICLE_END_NEST) {
+                    if (depth == 0 && nested) {
+                        break;
+                    }
+                    if (depth > 0) {
+                        depth--;
+                    }
+                }
+            }
+
+            struct argument * argument =
+                argument_create(state, ARGUMENT_TEXT);
+            if (!argument) {
+                state->error = "out of memory";
+                return false;
+            }
+            argument->value = (struct value) {
+                .type = VALUE_PARTICLES,
+                .particles = &state->particles[start],
+                .n_particles = state->index - start
+            };
+            return true;
+        }
+
+        case OP_COMMAND:
+            frame->command->type = symbol->arg;
+            return true;
+
+        case OP_OPEN: {
+            struct argument * argument = argument_create(state, symbol->arg);
+            if (!argument || !push_frame(state, (struct parser_frame) {
+                        .command = frame->command,
+                        .argument = argument,
+                        .tail = &argument->children
+                    })) {
+                state->error = "out of memory";
+                return false;
+            }
+            return true;
+        }
+
+        case OP_ADOPT: {
+            /* the grammar only adopts right after an argument was built */
+            struct argument ** slot = frame->last;
+            struct argument * child = *slot;
+            struct argument * argument =
+                arena_alloc(parser->arena, sizeof(*argument));
+            if (!argument) {
+                state->error = "out of memory";
+                return false;
+            }
+            *argument = (struct argument) {
+                .type = symbol->arg,
+                .keyword = KEYWORD_NO_MATCH,
+                .children = child
+            };
+            *slot = argument;
+            frame->tail = &argument->next;
+
+            struct command * command = frame->command;
+            if (!push_frame(state, (struct parser_frame) {
+                        .command = command,
+                        .argument = argument,
+                        .tail = &child->next,
+                        .last = &argument->children
+                    })) {
+                state->error = "out of memory";
+                return false;
+            }
+            return true;
+        }
+
+        case OP_CLOSE:
+            state->n_frames--;
+            return true;
+    }
+
+    return true;
+}
+
+/* parse these particles (a complete command, without its PARTICLE_END) into
+ * a new command, which is a COMMAND_ERROR if it doesn't parse
+ */
+[[nodiscard]] static struct command * parse_command(
+        struct parser * parser,
+        struct particle ** particles,
+        size_t n_particles
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct command * command =
+        command_create(parser, particles, n_particles);
+    if (!command) {
+        return NULL;
+    }
+
+    struct parse_state state = (struct parse_state) {
+        .parser = parser,
+        .command = command,
+        .particles = particles,
+        .n_particles = n_particles
+    };
+
+    if (!push_frame(&state, (struct parser_frame) {
+                .command = command,
+                .tail = &command->arguments
+            }) || !push_symbol(&state, p_top)) {
+        command->error = "out of memory";
+        return command;
+    }
+
+    while (state.depth > 0) {
+        const struct parser_symbol * symbol = parser->stack[state.depth - 1];
+        if (symbol->op == OP_DONE) {
+            state.depth--;
+            continue;
+        }
+        /* advance past this symbol before running it, since running it may
+         * push a production on top
+         */
+        parser->stack[state.depth - 1] = symbol + 1;
+        if (!parse_symbol(&state, symbol)) {
+            break;
+        }
+    }
+
+    if (!state.error && state.index < n_particles) {
+        state.error = lookahead(&state) == T_ERROR ?
+            "invalid input" : "unexpected input after the end of the command";
+    }
+
+    if (state.error) {
+        command->type = COMMAND_ERROR;
+        command->arguments = NULL;
+        command->error = state.error;
+        command->error_index = state.index;
+    }
+
+    return command;
+}
+
+/* parse every complete command in these particles into result */
 void parser_parse(
         struct parser * parser,
         struct particle_buffer * particles,
         struct parse_result * result
     ) [[gnu::nonnull(1, 2, 3)]]
 {
-    /* TODO */
-    (void)parser;
-
-    bool zero = true;
-    for (size_t j = 0; j < particles->n_particles; j++) {
-        for (size_t i = 0; i < particles->n_particles; i++) {
-            struct particle * particle = particles->particles[i];
-            struct refstring * s = particle_string(particle);
-            ulc_fprintf(stdout, "%s%U", zero ? "" : " ", refstring_string(s));
-            refstring_destroy(s);
-            if (particle->type == PARTICLE_END) {
-                ulc_fprintf(stdout, "\n");
-                zero = true;
-            } else {
-                zero = false;
-            }
+    arena_reset(parser->arena);
+
+    *result = (struct parse_result) {
+        .type = PARSE_OKAY
+    };
+    struct command ** tail = &result->commands;
+
+    size_t start = 0;
+    for (size_t i = 0; i < particles->n_particles; i++) {
+        if (particles->particles[i]->type != PARTICLE_END) {
+            continue;
         }
-        if (!zero) {
-            ulc_fprintf(stdout, "\n");
+
+        if (i > start) {
+            struct command * command = parse_command(
+                    parser, &particles->particles[start], i - start);
+            if (!command || command->type == COMMAND_ERROR) {
+                result->type = PARSE_ERROR;
+                result->n_errors++;
+            }
+            if (command) {
+                *tail = command;
+                tail = &command->next;
+                result->n_commands++;
+            }
         }
-        break;
-    }
 
-    result->type = PARSE_OKAY;
+        start = i + 1;
+    }
 }
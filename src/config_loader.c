@@ -45,6 +45,90 @@
 #define CONFIG_DEFAULT_CARD_DB_DEFAULT "data/cards.bundle"
 #endif /* CONFIG_DEFAULT_CARD_DB_DEFAULT */
 
+#ifndef CONFIG_LOG_RING_SIZE_DEFAULT
+#define CONFIG_LOG_RING_SIZE_DEFAULT 1024
+#endif /* CONFIG_LOG_RING_SIZE_DEFAULT */
+
+#ifndef CONFIG_LOG_OVERFLOW_DEFAULT
+#define CONFIG_LOG_OVERFLOW_DEFAULT "drop"
+#endif /* CONFIG_LOG_OVERFLOW_DEFAULT */
+
+#ifndef CONFIG_LOG_LEVEL_DEFAULT
+#define CONFIG_LOG_LEVEL_DEFAULT "verbose"
+#endif /* CONFIG_LOG_LEVEL_DEFAULT */
+
+#ifndef CONFIG_LOG_FORMAT_DEFAULT
+#define CONFIG_LOG_FORMAT_DEFAULT "text"
+#endif /* CONFIG_LOG_FORMAT_DEFAULT */
+
+#ifndef CONFIG_LOG_FILE_DEFAULT
+#define CONFIG_LOG_FILE_DEFAULT "cards.log"
+#endif /* CONFIG_LOG_FILE_DEFAULT */
+
+#ifndef CONFIG_READ_LOW_WATERMARK_DEFAULT
+#define CONFIG_READ_LOW_WATERMARK_DEFAULT 0
+#endif /* CONFIG_READ_LOW_WATERMARK_DEFAULT */
+
+#ifndef CONFIG_READ_HIGH_WATERMARK_DEFAULT
+#define CONFIG_READ_HIGH_WATERMARK_DEFAULT (64 * 1024)
+#endif /* CONFIG_READ_HIGH_WATERMARK_DEFAULT */
+
+#ifndef CONFIG_WRITE_LOW_WATERMARK_DEFAULT
+#define CONFIG_WRITE_LOW_WATERMARK_DEFAULT (16 * 1024)
+#endif /* CONFIG_WRITE_LOW_WATERMARK_DEFAULT */
+
+#ifndef CONFIG_WRITE_HIGH_WATERMARK_DEFAULT
+#define CONFIG_WRITE_HIGH_WATERMARK_DEFAULT (256 * 1024)
+#endif /* CONFIG_WRITE_HIGH_WATERMARK_DEFAULT */
+
+#ifndef CONFIG_OUTPUT_LIMIT_DEFAULT
+#define CONFIG_OUTPUT_LIMIT_DEFAULT (4 * 1024 * 1024)
+#endif /* CONFIG_OUTPUT_LIMIT_DEFAULT */
+
+#ifndef CONFIG_INPUT_LIMIT_DEFAULT
+#define CONFIG_INPUT_LIMIT_DEFAULT (64 * 1024)
+#endif /* CONFIG_INPUT_LIMIT_DEFAULT */
+
+#ifndef CONFIG_HANDSHAKE_TIMEOUT_DEFAULT
+#define CONFIG_HANDSHAKE_TIMEOUT_DEFAULT 30
+#endif /* CONFIG_HANDSHAKE_TIMEOUT_DEFAULT */
+
+#ifndef CONFIG_LOBBY_TIMEOUT_DEFAULT
+#define CONFIG_LOBBY_TIMEOUT_DEFAULT (10 * 60)
+#endif /* CONFIG_LOBBY_TIMEOUT_DEFAULT */
+
+#ifndef CONFIG_COMMANDS_PER_SECOND_DEFAULT
+#define CONFIG_COMMANDS_PER_SECOND_DEFAULT 20
+#endif /* CONFIG_COMMANDS_PER_SECOND_DEFAULT */
+
+#ifndef CONFIG_COMMAND_BURST_DEFAULT
+#define CONFIG_COMMAND_BURST_DEFAULT 40
+#endif /* CONFIG_COMMAND_BURST_DEFAULT */
+
+#ifndef CONFIG_BYTES_PER_SECOND_DEFAULT
+#define CONFIG_BYTES_PER_SECOND_DEFAULT (16 * 1024)
+#endif /* CONFIG_BYTES_PER_SECOND_DEFAULT */
+
+#ifndef CONFIG_BYTE_BURST_DEFAULT
+#define CONFIG_BYTE_BURST_DEFAULT (64 * 1024)
+#endif /* CONFIG_BYTE_BURST_DEFAULT */
+
+#ifndef CONFIG_SERVER_BYTES_PER_SECOND_DEFAULT
+#define CONFIG_SERVER_BYTES_PER_SECOND_DEFAULT 0
+#endif /* CONFIG_SERVER_BYTES_PER_SECOND_DEFAULT */
+
+#ifndef CONFIG_SERVER_BYTE_BURST_DEFAULT
+#define CONFIG_SERVER_BYTE_BURST_DEFAULT 0
+#endif /* CONFIG_SERVER_BYTE_BURST_DEFAULT */
+
+#ifndef CONFIG_COMMANDS_PER_TURN_DEFAULT
+#define CONFIG_COMMANDS_PER_TURN_DEFAULT 8
+#endif /* CONFIG_COMMANDS_PER_TURN_DEFAULT */
+
+#ifndef CONFIG_ADMIN_SOCKET_DEFAULT
+#define CONFIG_ADMIN_SOCKET_DEFAULT "cards-admin.sock"
+#endif /* CONFIG_ADMIN_SOCKET_DEFAULT */
+
 /* the type of config option */
 enum config_option_type {
     CONFIG_BOOLEAN, /* a bool option */
@@ -380,6 +464,174 @@ int config_load(
         );
     config_loader_add_option_boolean(
             loader, "dummy", CONFIG_DUMMY_DEFAULT, NULL, &config->dummy, &oom);
+    config_loader_add_option_integer(
+            loader,
+            "log_ring_size",
+            CONFIG_LOG_RING_SIZE_DEFAULT,
+            NULL,
+            &config->log_ring_size,
+            &oom
+        );
+    config_loader_add_option_string(
+            loader,
+            "log_overflow",
+            CONFIG_LOG_OVERFLOW_DEFAULT,
+            NULL,
+            &config->log_overflow,
+            &oom
+        );
+    config_loader_add_option_string(
+            loader,
+            "log_level",
+            CONFIG_LOG_LEVEL_DEFAULT,
+            NULL,
+            &config->log_level,
+            &oom
+        );
+    config_loader_add_option_string(
+            loader,
+            "log_format",
+            CONFIG_LOG_FORMAT_DEFAULT,
+            NULL,
+            &config->log_format,
+            &oom
+        );
+    config_loader_add_option_string(
+            loader,
+            "log_file",
+            CONFIG_LOG_FILE_DEFAULT,
+            NULL,
+            &config->log_file,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "read_low_watermark",
+            CONFIG_READ_LOW_WATERMARK_DEFAULT,
+            NULL,
+            &config->read_low_watermark,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "read_high_watermark",
+            CONFIG_READ_HIGH_WATERMARK_DEFAULT,
+            NULL,
+            &config->read_high_watermark,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "write_low_watermark",
+            CONFIG_WRITE_LOW_WATERMARK_DEFAULT,
+            NULL,
+            &config->write_low_watermark,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "write_high_watermark",
+            CONFIG_WRITE_HIGH_WATERMARK_DEFAULT,
+            NULL,
+            &config->write_high_watermark,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "output_limit",
+            CONFIG_OUTPUT_LIMIT_DEFAULT,
+            NULL,
+            &config->output_limit,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "input_limit",
+            CONFIG_INPUT_LIMIT_DEFAULT,
+            NULL,
+            &config->input_limit,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "handshake_timeout",
+            CONFIG_HANDSHAKE_TIMEOUT_DEFAULT,
+            NULL,
+            &config->handshake_timeout,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "lobby_timeout",
+            CONFIG_LOBBY_TIMEOUT_DEFAULT,
+            NULL,
+            &config->lobby_timeout,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "commands_per_second",
+            CONFIG_COMMANDS_PER_SECOND_DEFAULT,
+            NULL,
+            &config->commands_per_second,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "command_burst",
+            CONFIG_COMMAND_BURST_DEFAULT,
+            NULL,
+            &config->command_burst,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "bytes_per_second",
+            CONFIG_BYTES_PER_SECOND_DEFAULT,
+            NULL,
+            &config->bytes_per_second,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "byte_burst",
+            CONFIG_BYTE_BURST_DEFAULT,
+            NULL,
+            &config->byte_burst,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "server_bytes_per_second",
+            CONFIG_SERVER_BYTES_PER_SECOND_DEFAULT,
+            NULL,
+            &config->server_bytes_per_second,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "server_byte_burst",
+            CONFIG_SERVER_BYTE_BURST_DEFAULT,
+            NULL,
+            &config->server_byte_burst,
+            &oom
+        );
+    config_loader_add_option_integer(
+            loader,
+            "commands_per_turn",
+            CONFIG_COMMANDS_PER_TURN_DEFAULT,
+            NULL,
+            &config->commands_per_turn,
+            &oom
+        );
+    config_loader_add_option_string(
+            loader,
+            "admin_socket",
+            CONFIG_ADMIN_SOCKET_DEFAULT,
+            NULL,
+            &config->admin_socket,
+            &oom
+        );
 
     if (oom) {
         fprintf(stderr, "[config] error initializing loader\n");
@@ -486,4 +738,9 @@ int config_load(
 void config_free(struct config * config) [[gnu::nonnull(1)]]
 {
     free(config->default_card_db);
+    free(config->log_overflow);
+    free(config->log_level);
+    free(config->log_format);
+    free(config->log_file);
+    free(config->admin_socket);
 }
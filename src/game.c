@@ -19,11 +19,151 @@
  */
 #include "game.h"
 #include "bundle.h"
+#include "game_state.h"
+#include "look_cache.h"
 #include "name_set.h"
 #include "config.h"
+#include "command/lex.h"
+#include "command/parse.h"
 #include "util/log.h"
+#include "util/metrics.h"
+#include "util/refstring.h"
+
+#include "util/safe_realloc.h"
+#include "util/strdup.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+/* the number of responses a game's look_cache holds */
+#ifndef GAME_LOOK_CACHE_SIZE_DEFAULT
+#define GAME_LOOK_CACHE_SIZE_DEFAULT 256
+#endif /* GAME_LOOK_CACHE_SIZE_DEFAULT */
+
+/* how many names a COMPLETE without a count returns */
+#ifndef GAME_COMPLETIONS_DEFAULT
+#define GAME_COMPLETIONS_DEFAULT 10
+#endif /* GAME_COMPLETIONS_DEFAULT */
+
+/* the most names a COMPLETE returns, whatever count it asks for */
+#ifndef GAME_COMPLETIONS_MAX_DEFAULT
+#define GAME_COMPLETIONS_MAX_DEFAULT 100
+#endif /* GAME_COMPLETIONS_MAX_DEFAULT */
+
+/* how many names LOOK suggests when it doesn't find the one it was given */
+#ifndef GAME_SUGGESTIONS_DEFAULT
+#define GAME_SUGGESTIONS_DEFAULT 3
+#endif /* GAME_SUGGESTIONS_DEFAULT */
+
+/* how many edits away from the name that wasn't found a suggestion can be
+ * (names shorter than three times this can be fewer, see game_look())
+ */
+#ifndef GAME_SUGGESTION_DISTANCE_DEFAULT
+#define GAME_SUGGESTION_DISTANCE_DEFAULT 2
+#endif /* GAME_SUGGESTION_DISTANCE_DEFAULT */
+
+/* a response that's built up a piece at a time, when there are too many
+ * pieces for refstring_createf()
+ */
+struct response {
+    uint8_t * buffer;
+    size_t length;
+    size_t capacity;
+    bool oom;
+};
+
+/* append these bytes of length to this response */
+static void response_append(
+        struct response * response,
+        const void * bytes,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    if (response->oom) {
+        return;
+    }
+    if (response->length + length > response->capacity) {
+        size_t capacity = response->capacity ? response->capacity : 128;
+        while (capacity < response->length + length) {
+            capacity *= 2;
+        }
+        response->buffer = safe_realloc(response->buffer, capacity);
+        if (!response->buffer) {
+            response->oom = true;
+            return;
+        }
+        response->capacity = capacity;
+    }
+    memcpy(&response->buffer[response->length], bytes, length);
+    response->length += length;
+}
+
+/* append this string to this response */
+static void response_append_string(
+        struct response * response,
+        const char * string
+    ) [[gnu::nonnull(1, 2)]]
+{
+    response_append(response, string, strlen(string));
+}
+
+/* append these names to this response, each quoted and separated by
+ * separator
+ */
+static void response_append_names(
+        struct response * response,
+        struct name ** names,
+        size_t n_names,
+        const char * separator
+    ) [[gnu::nonnull(1, 2, 4)]]
+{
+    for (size_t i = 0; i < n_names; i++) {
+        if (i > 0) {
+            response_append_string(response, separator);
+        }
+        response_append_string(response, "\"");
+        response_append(
+                response,
+                names[i]->display_name,
+                names[i]->display_name_length
+            );
+        response_append_string(response, "\"");
+    }
+}
+
+/* turn this response into a refstring, freeing its buffer */
+static struct refstring * response_finish(
+        struct response * response) [[gnu::nonnull(1)]]
+{
+    if (response->oom) {
+        return refstring_createf("[server] error: out of memory\n");
+    }
+    struct refstring * refstring = refstring_create_from_stringn(
+            response->buffer, response->length);
+    free(response->buffer);
+    return refstring;
+}
+
+/* load the game's bundle into this name_set, adding the number of cards
+ * that could not be loaded to errors (see bundle_load())
+ */
+static enum bundle_load_result game_load_bundle(
+        struct game * game,
+        struct name_set * name_set,
+        size_t * errors
+    ) [[gnu::nonnull(1, 2, 3)]]
+{
+    LOGF_INFO(game->logger, "loading bundle %s\n", game->bundle_name);
+    uint64_t started = metrics_now();
+    enum bundle_load_result result = bundle_load(
+            game->bundle_name,
+            name_set,
+            errors,
+            game->logger
+        );
+    metrics_record(METRIC_BUNDLE_LOAD_TIME, metrics_now() - started);
+    return result;
+}
 
 /* create a game with this config */
 [[nodiscard]] struct game * game_create(
@@ -35,24 +175,37 @@
     }
     *game = (struct game) {
         .name_set = name_set_create(),
-        .logger = config->logger
+        .logger = config->logger,
+        .look_cache = look_cache_create(GAME_LOOK_CACHE_SIZE_DEFAULT),
+        .state = game_state_create()
     };
 
-    if (!game->name_set) {
+    if (!game->name_set || !game->look_cache || !game->state) {
+        if (game->name_set) {
+            name_set_destroy(game->name_set);
+        }
+        if (game->look_cache) {
+            look_cache_destroy(game->look_cache);
+        }
+        if (game->state) {
+            game_state_destroy(game->state);
+        }
         free(game);
         return NULL;
     }
 
     if (config->default_card_db) {
-        LOGF_INFO(
-                game->logger, "loading bundle %s\n", config->default_card_db);
-        size_t errors;
-        enum bundle_load_result result = bundle_load(
-                config->default_card_db,
-                game->name_set,
-                &errors,
-                config->logger
-            );
+        game->bundle_name = util_strdup(config->default_card_db);
+        if (!game->bundle_name) {
+            name_set_destroy(game->name_set);
+            look_cache_destroy(game->look_cache);
+            game_state_destroy(game->state);
+            free(game);
+            return NULL;
+        }
+        size_t errors = 0;
+        enum bundle_load_result result =
+            game_load_bundle(game, game->name_set, &errors);
         /* TODO */
         (void)result;
     }
@@ -63,5 +216,175 @@
 void game_destroy(struct game * game) [[gnu::nonnull(1)]]
 {
     name_set_destroy(game->name_set);
+    look_cache_destroy(game->look_cache);
+    game_state_destroy(game->state);
+    free(game->bundle_name);
     free(game);
 }
+
+/* reload this game's bundle, replacing its name_set on success */
+bool game_reload(struct game * game) [[gnu::nonnull(1)]]
+{
+    if (!game->bundle_name) {
+        return false;
+    }
+
+    struct name_set * name_set = name_set_create();
+    if (!name_set) {
+        return false;
+    }
+
+    size_t errors = 0;
+    if (game_load_bundle(game, name_set, &errors) != BUNDLE_LOAD_RESULT_OKAY
+            || errors > 0) {
+        LOGF_ERROR(
+                game->logger,
+                "reloading bundle %s failed, keeping the old one\n",
+                game->bundle_name
+            );
+        name_set_destroy(name_set);
+        return false;
+    }
+
+    name_set_destroy(game->name_set);
+    game->name_set = name_set;
+    game_changed(game);
+    return true;
+}
+
+/* note that this game's state has changed */
+void game_changed(struct game * game) [[gnu::nonnull(1)]]
+{
+    game->version++;
+}
+
+/* do this game's housekeeping */
+void game_maintain(struct game * game) [[gnu::nonnull(1)]]
+{
+    name_set_maintain(game->name_set);
+}
+
+/* render the response to this LOOK command */
+[[nodiscard]] struct refstring * game_look(
+        struct game * game,
+        const struct command * command
+    ) [[gnu::nonnull(1, 2)]]
+{
+    static const char * types[] = {
+        [NAME_TYPE_CARD] = "card",
+        [NAME_TYPE_ABILITY] = "ability",
+        [NAME_TYPE_SUBTYPE] = "subtype",
+        [NAME_TYPE_PLAYER] = "player"
+    };
+
+    /* there are no players or stacks yet, so the only thing there is to
+     * look at is a card (or anything else) by name
+     */
+    const struct argument * argument = command->arguments;
+    if (!argument || argument->type != ARGUMENT_CARD ||
+            argument->value.type != VALUE_NAME) {
+        return refstring_createf(
+                "[server] there is nothing there to see yet\n");
+    }
+
+    const struct particle * particle = argument->value.particle;
+    if (!particle->name) {
+        /* one edit per three characters, so that short names aren't
+         * "close" to everything
+         */
+        size_t distance = particle->length / 3;
+        if (distance > GAME_SUGGESTION_DISTANCE_DEFAULT) {
+            distance = GAME_SUGGESTION_DISTANCE_DEFAULT;
+        }
+
+        struct name * names[GAME_SUGGESTIONS_DEFAULT];
+        bool oom = false;
+        size_t n_names = name_set_suggest(
+                game->name_set,
+                particle->value,
+                particle->length,
+                distance,
+                names,
+                GAME_SUGGESTIONS_DEFAULT,
+                &oom
+            );
+
+        if (n_names == 0) {
+            return refstring_createf(
+                    "[server] there is nothing named \"%.*U\"\n",
+                    (int)particle->length,
+                    particle->value
+                );
+        }
+
+        struct response response = { };
+        response_append_string(&response, "[server] there is nothing named \"");
+        response_append(&response, particle->value, particle->length);
+        response_append_string(&response, "\", did you mean ");
+        response_append_names(&response, names, n_names, " or ");
+        response_append_string(&response, "?\n");
+        return response_finish(&response);
+    }
+
+    return refstring_createf(
+            "[server] \"%.*U\" is a %s\n",
+            (int)particle->name->display_name_length,
+            particle->name->display_name,
+            types[particle->name->type]
+        );
+}
+
+/* render the response to this COMPLETE command */
+[[nodiscard]] struct refstring * game_complete(
+        struct game * game,
+        const struct command * command
+    ) [[gnu::nonnull(1, 2)]]
+{
+    const struct particle * prefix = NULL;
+    long count = GAME_COMPLETIONS_DEFAULT;
+    for (const struct argument * argument = command->arguments; argument;
+            argument = argument->next) {
+        if (argument->type == ARGUMENT_PREFIX &&
+                argument->value.type == VALUE_NAME) {
+            prefix = argument->value.particle;
+        } else if (argument->type == ARGUMENT_COUNT &&
+                argument->value.type == VALUE_NUMBER) {
+            count = argument->value.number;
+        }
+    }
+
+    if (!prefix) {
+        return refstring_createf(
+                "[server] error: expected a name to complete\n");
+    }
+
+    if (count < 1) {
+        count = 1;
+    } else if (count > GAME_COMPLETIONS_MAX_DEFAULT) {
+        count = GAME_COMPLETIONS_MAX_DEFAULT;
+    }
+
+    struct name * names[GAME_COMPLETIONS_MAX_DEFAULT];
+    bool oom = false;
+    size_t n_names = name_set_complete(
+            game->name_set, prefix->value, prefix->length, names, count, &oom);
+    if (oom) {
+        return refstring_createf("[server] error: out of memory\n");
+    }
+
+    if (n_names == 0) {
+        return refstring_createf(
+                "[server] nothing begins with \"%.*U\"\n",
+                (int)prefix->length,
+                prefix->value
+            );
+    }
+
+    struct response response = { };
+    response_append_string(&response, "[server] \"");
+    response_append(&response, prefix->value, prefix->length);
+    response_append_string(&response, "\" completes to ");
+    response_append_names(&response, names, n_names, " ");
+    response_append_string(&response, "\n");
+    return response_finish(&response);
+}
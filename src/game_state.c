@@ -0,0 +1,692 @@
+/* File: src/game_state.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "game_state.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* the number of instances a new game_state has room for before it first
+ * grows, which must be a multiple of 64
+ */
+#ifndef GAME_STATE_CAPACITY_DEFAULT
+#define GAME_STATE_CAPACITY_DEFAULT 256
+#endif /* GAME_STATE_CAPACITY_DEFAULT */
+
+/* the least room a stack's order is made with */
+#ifndef GAME_STATE_ORDER_DEFAULT
+#define GAME_STATE_ORDER_DEFAULT 16
+#endif /* GAME_STATE_ORDER_DEFAULT */
+
+/* set this id's bit in this bitset */
+static void bit_set(uint64_t * bits, uint32_t id) [[gnu::nonnull(1)]]
+{
+    bits[id / 64] |= (uint64_t)1 << (id % 64);
+}
+
+/* clear this id's bit in this bitset */
+static void bit_clear(uint64_t * bits, uint32_t id) [[gnu::nonnull(1)]]
+{
+    bits[id / 64] &= ~((uint64_t)1 << (id % 64));
+}
+
+/* grow this bitset from n_words to capacity words, zeroing the new ones */
+static bool bitset_grow(
+        uint64_t ** bits, size_t n_words, size_t capacity) [[gnu::nonnull(1)]]
+{
+    uint64_t * grown = realloc(*bits, sizeof(*grown) * capacity);
+    if (!grown) {
+        return false;
+    }
+    memset(&grown[n_words], 0, sizeof(*grown) * (capacity - n_words));
+    *bits = grown;
+    return true;
+}
+
+/* make sure this stack's order has room for capacity ids */
+static bool stack_reserve(
+        struct game_stack * stack, size_t capacity) [[gnu::nonnull(1)]]
+{
+    if (stack->order_capacity >= capacity) {
+        return true;
+    }
+    if (capacity < stack->order_capacity * 2) {
+        capacity = stack->order_capacity * 2;
+    }
+    if (capacity < GAME_STATE_ORDER_DEFAULT) {
+        capacity = GAME_STATE_ORDER_DEFAULT;
+    }
+    uint32_t * order = realloc(stack->order, sizeof(*order) * capacity);
+    if (!order) {
+        return false;
+    }
+    stack->order = order;
+    stack->order_capacity = capacity;
+    return true;
+}
+
+/* free the memory of this stack */
+static void stack_free(struct game_stack * stack) [[gnu::nonnull(1)]]
+{
+    free(stack->members);
+    free(stack->order);
+}
+
+/* make room for at least one more instance, returning false on memory error
+ *
+ * if only some of the arrays grow, they stay that way (which is harmless)
+ * and capacity is left as it was
+ */
+static bool game_state_reserve(
+        struct game_state * state) [[gnu::nonnull(1)]]
+{
+    if (state->n_instances < state->capacity) {
+        return true;
+    }
+    if (state->capacity >= GAME_STATE_NO_INSTANCE / 2) {
+        return false;
+    }
+
+    size_t capacity = state->capacity ?
+        state->capacity * 2 : GAME_STATE_CAPACITY_DEFAULT;
+    size_t n_words = capacity / 64;
+
+    void * grown;
+#define GROW(field) \
+    ((grown = realloc(state->field, sizeof(*state->field) * capacity)) && \
+        (state->field = grown))
+    if (!GROW(attack) || !GROW(attack_defense) || !GROW(defense_defense) ||
+            !GROW(hp) || !GROW(range) || !GROW(kind) || !GROW(owner) ||
+            !GROW(zone) || !GROW(zone_number) || !GROW(flags) ||
+            !GROW(equipped_to) || !GROW(equipment) ||
+            !GROW(next_equipment) || !GROW(card)) {
+        return false;
+    }
+#undef GROW
+
+    if (!bitset_grow(&state->characters, state->n_words, n_words) ||
+            !bitset_grow(&state->face_up, state->n_words, n_words) ||
+            !bitset_grow(&state->defense_mode, state->n_words, n_words)) {
+        return false;
+    }
+    for (size_t i = 0; i < GAME_STATE_PLAYERS_MAX; i++) {
+        struct game_player * player = &state->players[i];
+        for (size_t j = 0; j < GAME_ZONES; j++) {
+            if (!bitset_grow(&player->stacks[j].members,
+                        state->n_words, n_words)) {
+                return false;
+            }
+        }
+        for (size_t j = 0; j < player->n_field; j++) {
+            if (!bitset_grow(&player->field[j].members,
+                        state->n_words, n_words)) {
+                return false;
+            }
+        }
+    }
+
+    state->capacity = capacity;
+    state->n_words = n_words;
+    return true;
+}
+
+/* create a game_state with no instances */
+[[nodiscard]] struct game_state * game_state_create()
+{
+    struct game_state * state = malloc(sizeof(*state));
+    if (!state) {
+        return NULL;
+    }
+    *state = (struct game_state) { };
+    if (!game_state_reserve(state)) {
+        game_state_destroy(state);
+        return NULL;
+    }
+    return state;
+}
+
+/* destroy this game_state */
+void game_state_destroy(struct game_state * state) [[gnu::nonnull(1)]]
+{
+    for (size_t i = 0; i < GAME_STATE_PLAYERS_MAX; i++) {
+        struct game_player * player = &state->players[i];
+        for (size_t j = 0; j < GAME_ZONES; j++) {
+            stack_free(&player->stacks[j]);
+        }
+        for (size_t j = 0; j < player->n_field; j++) {
+            stack_free(&player->field[j]);
+        }
+        free(player->field);
+    }
+    free(state->attack);
+    free(state->attack_defense);
+    free(state->defense_defense);
+    free(state->hp);
+    free(state->range);
+    free(state->kind);
+    free(state->owner);
+    free(state->zone);
+    free(state->zone_number);
+    free(state->flags);
+    free(state->equipped_to);
+    free(state->equipment);
+    free(state->next_equipment);
+    free(state->card);
+    free(state->characters);
+    free(state->face_up);
+    free(state->defense_mode);
+    free(state);
+}
+
+/* return this player's stack for this zone (and zone_number), or NULL if
+ * there isn't one
+ */
+static struct game_stack * stack_find(
+        const struct game_state * state,
+        uint8_t owner,
+        enum game_zone zone,
+        uint16_t zone_number
+    ) [[gnu::nonnull(1)]]
+{
+    if (owner >= GAME_STATE_PLAYERS_MAX || zone >= GAME_ZONES) {
+        return NULL;
+    }
+    struct game_player * player =
+        (struct game_player *)&state->players[owner];
+    if (zone != GAME_ZONE_FIELD || zone_number == 0) {
+        return &player->stacks[zone];
+    }
+    if (zone_number > player->n_field) {
+        return NULL;
+    }
+    return &player->field[zone_number - 1];
+}
+
+/* make sure this player has character zones up to zone_number, with room
+ * in each for capacity ids
+ */
+static bool field_reserve(
+        struct game_state * state,
+        struct game_player * player,
+        uint16_t zone_number,
+        size_t capacity
+    ) [[gnu::nonnull(1, 2)]]
+{
+    if (zone_number <= player->n_field) {
+        return true;
+    }
+
+    struct game_stack * field = realloc(
+            player->field, sizeof(*field) * zone_number);
+    if (!field) {
+        return false;
+    }
+    player->field = field;
+
+    while (player->n_field < zone_number) {
+        struct game_stack * stack = &player->field[player->n_field];
+        *stack = (struct game_stack) {
+            .members = calloc(state->n_words, sizeof(*stack->members))
+        };
+        if (!stack->members || !stack_reserve(stack, capacity)) {
+            stack_free(stack);
+            return false;
+        }
+        player->n_field++;
+    }
+    return true;
+}
+
+/* take this instance out of its stack */
+static void stack_remove(
+        struct game_state * state, uint32_t id) [[gnu::nonnull(1)]]
+{
+    struct game_stack * stack = stack_find(
+            state, state->owner[id], state->zone[id], state->zone_number[id]);
+    bit_clear(stack->members, id);
+
+    /* from the end, since what was just put somewhere is the likeliest to
+     * be moved again (e.g. out of the grave)
+     */
+    size_t i = stack->n_order - 1;
+    while (stack->order[i] != id) {
+        i--;
+    }
+    memmove(&stack->order[i], &stack->order[i + 1],
+            sizeof(*stack->order) * (stack->n_order - i - 1));
+    stack->n_order--;
+
+    if (state->zone[id] == GAME_ZONE_FIELD) {
+        bit_clear(state->players[state->owner[id]]
+                .stacks[GAME_ZONE_FIELD].members, id);
+    }
+}
+
+/* put this instance (which isn't in a stack) at the end of this stack, which
+ * must exist
+ */
+static void stack_append(
+        struct game_state * state,
+        uint32_t id,
+        enum game_zone zone,
+        uint16_t zone_number
+    ) [[gnu::nonnull(1)]]
+{
+    state->zone[id] = zone;
+    state->zone_number[id] = zone_number;
+
+    struct game_stack * stack =
+        stack_find(state, state->owner[id], zone, zone_number);
+    bit_set(stack->members, id);
+    stack->order[stack->n_order++] = id;
+
+    if (zone == GAME_ZONE_FIELD) {
+        bit_set(state->players[state->owner[id]]
+                .stacks[GAME_ZONE_FIELD].members, id);
+    }
+}
+
+/* set this instance's flags to exactly these */
+static void flags_write(
+        struct game_state * state, uint32_t id, uint8_t flags)
+        [[gnu::nonnull(1)]]
+{
+    state->flags[id] = flags;
+    if (flags & GAME_INSTANCE_FACE_UP) {
+        bit_set(state->face_up, id);
+    } else {
+        bit_clear(state->face_up, id);
+    }
+    if (flags & GAME_INSTANCE_DEFENSE_MODE) {
+        bit_set(state->defense_mode, id);
+    } else {
+        bit_clear(state->defense_mode, id);
+    }
+}
+
+/* add an instance of this card and return its id */
+uint32_t game_state_add(
+        struct game_state * state,
+        struct card * card,
+        enum game_card_kind kind,
+        const struct game_stats * stats,
+        uint8_t owner,
+        enum game_zone zone,
+        uint16_t zone_number
+    ) [[gnu::nonnull(1, 4)]]
+{
+    if (owner >= GAME_STATE_PLAYERS_MAX || zone >= GAME_ZONES ||
+            (zone == GAME_ZONE_FIELD && zone_number == 0)) {
+        return GAME_STATE_NO_INSTANCE;
+    }
+    if (zone != GAME_ZONE_FIELD) {
+        zone_number = 0;
+    }
+
+    /* every stack of the owner's gets room for one more */
+    struct game_player * player = &state->players[owner];
+    size_t n_owned = player->n_instances + 1;
+    if (!game_state_reserve(state) ||
+            !field_reserve(state, player, zone_number, n_owned)) {
+        return GAME_STATE_NO_INSTANCE;
+    }
+    for (size_t i = 0; i < GAME_ZONES; i++) {
+        if (i != GAME_ZONE_FIELD &&
+                !stack_reserve(&player->stacks[i], n_owned)) {
+            return GAME_STATE_NO_INSTANCE;
+        }
+    }
+    for (size_t i = 0; i < player->n_field; i++) {
+        if (!stack_reserve(&player->field[i], n_owned)) {
+            return GAME_STATE_NO_INSTANCE;
+        }
+    }
+    player->n_instances = n_owned;
+
+    uint32_t id = state->n_instances++;
+    state->attack[id] = stats->attack;
+    state->attack_defense[id] = stats->attack_defense;
+    state->defense_defense[id] = stats->defense_defense;
+    state->hp[id] = stats->hp;
+    state->range[id] = stats->range;
+    state->kind[id] = kind;
+    state->owner[id] = owner;
+    state->equipped_to[id] = GAME_STATE_NO_INSTANCE;
+    state->equipment[id] = GAME_STATE_NO_INSTANCE;
+    state->next_equipment[id] = GAME_STATE_NO_INSTANCE;
+    state->card[id] = card;
+    flags_write(state, id, 0);
+    if (kind == GAME_CARD_CHARACTER) {
+        bit_set(state->characters, id);
+    }
+    stack_append(state, id, zone, zone_number);
+    return id;
+}
+
+/* add (or, if sign is -1, take away) this equipment's stats to the
+ * character's
+ */
+static void apply_equipment(
+        struct game_state * state,
+        uint32_t equipment,
+        uint32_t character,
+        int sign
+    ) [[gnu::nonnull(1)]]
+{
+    state->attack[character] += sign * state->attack[equipment];
+    state->attack_defense[character] +=
+        sign * state->attack_defense[equipment];
+    state->defense_defense[character] +=
+        sign * state->defense_defense[equipment];
+    state->hp[character] += sign * state->hp[equipment];
+    state->range[character] += sign * state->range[equipment];
+}
+
+/* detach this equipment from whatever it is attached to */
+void game_state_detach(
+        struct game_state * state, uint32_t equipment) [[gnu::nonnull(1)]]
+{
+    uint32_t character = state->equipped_to[equipment];
+    if (character == GAME_STATE_NO_INSTANCE) {
+        return;
+    }
+
+    uint32_t * link = &state->equipment[character];
+    while (*link != equipment) {
+        link = &state->next_equipment[*link];
+    }
+    *link = state->next_equipment[equipment];
+
+    apply_equipment(state, equipment, character, -1);
+    state->equipped_to[equipment] = GAME_STATE_NO_INSTANCE;
+    state->next_equipment[equipment] = GAME_STATE_NO_INSTANCE;
+    stack_remove(state, equipment);
+    stack_append(state, equipment, GAME_ZONE_SPECIAL, 0);
+}
+
+/* attach this equipment to this character */
+bool game_state_attach(
+        struct game_state * state,
+        uint32_t equipment,
+        uint32_t character
+    ) [[gnu::nonnull(1)]]
+{
+    if (state->kind[equipment] != GAME_CARD_EQUIPMENT ||
+            state->kind[character] != GAME_CARD_CHARACTER ||
+            state->zone[character] != GAME_ZONE_FIELD ||
+            state->owner[equipment] != state->owner[character]) {
+        return false;
+    }
+
+    game_state_detach(state, equipment);
+
+    /* equipment is always face up, and goes where its character is (whose
+     * character zone already exists)
+     */
+    state->equipped_to[equipment] = character;
+    state->next_equipment[equipment] = state->equipment[character];
+    state->equipment[character] = equipment;
+    stack_remove(state, equipment);
+    stack_append(state, equipment, GAME_ZONE_FIELD,
+            state->zone_number[character]);
+    flags_write(state, equipment,
+            state->flags[equipment] | GAME_INSTANCE_FACE_UP);
+    apply_equipment(state, equipment, character, 1);
+    return true;
+}
+
+/* move this instance to this zone */
+bool game_state_move(
+        struct game_state * state,
+        uint32_t id,
+        enum game_zone zone,
+        uint16_t zone_number
+    ) [[gnu::nonnull(1)]]
+{
+    if (zone >= GAME_ZONES || (zone == GAME_ZONE_FIELD && zone_number == 0)) {
+        return false;
+    }
+    if (zone != GAME_ZONE_FIELD) {
+        zone_number = 0;
+    }
+
+    struct game_player * player = &state->players[state->owner[id]];
+    if (!field_reserve(state, player, zone_number, player->n_instances)) {
+        return false;
+    }
+
+    if (state->kind[id] == GAME_CARD_EQUIPMENT) {
+        game_state_detach(state, id);
+    } else if (zone == GAME_ZONE_FIELD) {
+        /* moving between character zones, so its equipment comes along */
+        for (uint32_t equipment = state->equipment[id];
+                equipment != GAME_STATE_NO_INSTANCE;
+                equipment = state->next_equipment[equipment]) {
+            stack_remove(state, equipment);
+            stack_append(state, equipment, GAME_ZONE_FIELD, zone_number);
+        }
+    } else {
+        while (state->equipment[id] != GAME_STATE_NO_INSTANCE) {
+            game_state_bury(state, state->equipment[id]);
+        }
+    }
+
+    stack_remove(state, id);
+    stack_append(state, id, zone, zone_number);
+    return true;
+}
+
+/* send this instance to the grave, which can't fail because every stack has
+ * room for every instance its player owns
+ */
+void game_state_bury(
+        struct game_state * state, uint32_t id) [[gnu::nonnull(1)]]
+{
+    (void)game_state_move(state, id, GAME_ZONE_GRAVE, 0);
+}
+
+/* set or clear these flags on this instance */
+void game_state_set_flags(
+        struct game_state * state,
+        uint32_t id,
+        uint8_t flags,
+        bool set
+    ) [[gnu::nonnull(1)]]
+{
+    flags_write(state, id,
+            set ? state->flags[id] | flags : state->flags[id] & ~flags);
+}
+
+/* resolve an attack by this attacker on this defender */
+enum game_attack_result game_state_attack(
+        struct game_state * state,
+        uint32_t attacker,
+        uint32_t defender
+    ) [[gnu::nonnull(1)]]
+{
+    if (state->kind[attacker] != GAME_CARD_CHARACTER ||
+            state->kind[defender] != GAME_CARD_CHARACTER ||
+            state->zone[attacker] != GAME_ZONE_FIELD ||
+            state->zone[defender] != GAME_ZONE_FIELD ||
+            state->owner[attacker] == state->owner[defender] ||
+            (state->flags[attacker] &
+                (GAME_INSTANCE_FACE_UP | GAME_INSTANCE_DEFENSE_MODE)) !=
+                GAME_INSTANCE_FACE_UP) {
+        return GAME_ATTACK_INVALID;
+    }
+
+    flags_write(state, defender,
+            state->flags[defender] | GAME_INSTANCE_FACE_UP);
+
+    int16_t defense = state->flags[defender] & GAME_INSTANCE_DEFENSE_MODE ?
+        state->defense_defense[defender] : state->attack_defense[defender];
+
+    if (state->attack[attacker] > defense) {
+        game_state_bury(state, defender);
+        return GAME_ATTACK_DEFENDER_DESTROYED;
+    }
+    game_state_bury(state, attacker);
+    return GAME_ATTACK_ATTACKER_DESTROYED;
+}
+
+/* the instances in this word of the bitsets that match this query, given
+ * the members of the stack it's for
+ */
+static uint64_t query_word(
+        const struct game_state * state,
+        const struct game_query * query,
+        const uint64_t * members,
+        size_t i
+    ) [[gnu::nonnull(1, 2, 3)]]
+{
+    uint64_t word = members[i];
+    if (query->characters) {
+        word &= state->characters[i];
+    }
+    if (query->flags_mask & GAME_INSTANCE_FACE_UP) {
+        word &= query->flags & GAME_INSTANCE_FACE_UP ?
+            state->face_up[i] : ~state->face_up[i];
+    }
+    if (query->flags_mask & GAME_INSTANCE_DEFENSE_MODE) {
+        word &= query->flags & GAME_INSTANCE_DEFENSE_MODE ?
+            state->defense_mode[i] : ~state->defense_mode[i];
+    }
+    return word;
+}
+
+/* return the number of instances matching this query */
+size_t game_state_count(
+        const struct game_state * state,
+        const struct game_query * query
+    ) [[gnu::nonnull(1, 2)]]
+{
+    const struct game_stack * stack = stack_find(
+            state, query->owner, query->zone, query->zone_number);
+    if (!stack) {
+        return 0;
+    }
+
+    size_t count = 0;
+    size_t n_words = (state->n_instances + 63) / 64;
+    for (size_t i = 0; i < n_words; i++) {
+        count += __builtin_popcountll(
+                query_word(state, query, stack->members, i));
+    }
+    return count;
+}
+
+/* write the ids of up to max instances matching this query to ids */
+size_t game_state_select(
+        const struct game_state * state,
+        const struct game_query * query,
+        uint32_t * ids,
+        size_t max
+    ) [[gnu::nonnull(1, 2)]]
+{
+    const struct game_stack * stack = stack_find(
+            state, query->owner, query->zone, query->zone_number);
+    if (!stack) {
+        return 0;
+    }
+
+    size_t n = 0;
+    size_t n_words = (state->n_instances + 63) / 64;
+    for (size_t i = 0; i < n_words && n < max; i++) {
+        uint64_t word = query_word(state, query, stack->members, i);
+        while (word && n < max) {
+            ids[n++] = i * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+        }
+    }
+    return n;
+}
+
+/* return the number of instances in this stack of this player's */
+size_t game_state_stack_size(
+        const struct game_state * state,
+        uint8_t owner,
+        enum game_zone zone,
+        uint16_t zone_number
+    ) [[gnu::nonnull(1)]]
+{
+    if (zone == GAME_ZONE_FIELD && zone_number == 0) {
+        return game_state_count(state, &(struct game_query) {
+                    .owner = owner,
+                    .zone = zone
+                });
+    }
+    const struct game_stack * stack =
+        stack_find(state, owner, zone, zone_number);
+    return stack ? stack->n_order : 0;
+}
+
+/* return the instance at this position of this stack of this player's */
+uint32_t game_state_at(
+        const struct game_state * state,
+        uint8_t owner,
+        enum game_zone zone,
+        uint16_t zone_number,
+        size_t position
+    ) [[gnu::nonnull(1)]]
+{
+    if (zone == GAME_ZONE_FIELD && zone_number == 0) {
+        return GAME_STATE_NO_INSTANCE;
+    }
+    const struct game_stack * stack =
+        stack_find(state, owner, zone, zone_number);
+    if (!stack || position == 0 || position > stack->n_order) {
+        return GAME_STATE_NO_INSTANCE;
+    }
+    return stack->order[position - 1];
+}
+
+/* lower the HP of every character this player has on the field, which only
+ * visits the characters in the player's character zones
+ */
+size_t game_state_damage_all(
+        struct game_state * state,
+        uint8_t owner,
+        int16_t amount
+    ) [[gnu::nonnull(1)]]
+{
+    if (owner >= GAME_STATE_PLAYERS_MAX) {
+        return 0;
+    }
+    const uint64_t * field =
+        state->players[owner].stacks[GAME_ZONE_FIELD].members;
+
+    size_t destroyed = 0;
+    size_t n_words = (state->n_instances + 63) / 64;
+    for (size_t i = 0; i < n_words; i++) {
+        uint64_t word = field[i] & state->characters[i];
+        while (word) {
+            uint32_t id = i * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+
+            int hp = state->hp[id] - amount;
+            state->hp[id] = hp < INT16_MIN ? INT16_MIN :
+                hp > INT16_MAX ? INT16_MAX : hp;
+            if (hp <= 0) {
+                game_state_bury(state, id);
+                destroyed++;
+            }
+        }
+    }
+    return destroyed;
+}
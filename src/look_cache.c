@@ -0,0 +1,243 @@
+/* File: src/look_cache.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "look_cache.h"
+#include "command/lex.h"
+#include "command/parse.h"
+#include "util/refstring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* how many slots past its home slot a key may be stored in */
+#ifndef LOOK_CACHE_PROBE_DEFAULT
+#define LOOK_CACHE_PROBE_DEFAULT 4
+#endif /* LOOK_CACHE_PROBE_DEFAULT */
+
+/* a slot of the cache, which is empty if response is NULL */
+struct look_cache_entry {
+    uint64_t hash;
+    uint64_t version;
+    uint8_t * key;
+    size_t length;
+    struct refstring * response;
+};
+
+/* a look_cache */
+struct look_cache {
+    struct look_cache_entry * entries;
+    size_t mask; /* the number of slots (a power of two) minus one */
+};
+
+/* FNV-1a */
+static uint64_t look_cache_hash(
+        const uint8_t * key, size_t length) [[gnu::nonnull(1)]]
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= key[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+/* empty this slot */
+static void look_cache_entry_clear(
+        struct look_cache_entry * entry) [[gnu::nonnull(1)]]
+{
+    if (entry->response) {
+        refstring_destroy(entry->response);
+    }
+    free(entry->key);
+    *entry = (struct look_cache_entry) { };
+}
+
+/* create a cache with (at least) this many slots */
+[[nodiscard]] struct look_cache * look_cache_create(size_t size)
+{
+    size_t slots = 1;
+    while (slots < size) {
+        slots *= 2;
+    }
+
+    struct look_cache * cache = malloc(sizeof(*cache));
+    if (!cache) {
+        return NULL;
+    }
+
+    *cache = (struct look_cache) {
+        .entries = calloc(slots, sizeof(*cache->entries)),
+        .mask = slots - 1
+    };
+
+    if (!cache->entries) {
+        free(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+/* destroy this cache */
+void look_cache_destroy(struct look_cache * cache) [[gnu::nonnull(1)]]
+{
+    for (size_t i = 0; i <= cache->mask; i++) {
+        look_cache_entry_clear(&cache->entries[i]);
+    }
+    free(cache->entries);
+    free(cache);
+}
+
+/* write the key for this command as seen by this viewer
+ *
+ * the key is the viewer followed by one tag byte per particle and, for
+ * keywords the keyword, for numbers their digits without leading zeroes, and
+ * for names either the name they matched or (if they didn't match one) their
+ * text. the viewer is part of the key because MY (and, eventually, what is
+ * hidden from whom) depends on it.
+ */
+size_t look_cache_key(
+        const struct command * command,
+        uint64_t viewer,
+        uint8_t key[static LOOK_CACHE_KEY_MAX]
+    ) [[gnu::nonnull(1, 3)]]
+{
+    size_t length = 0;
+
+#define LOOK_CACHE_KEY_PUT(data, size) \
+    do { \
+        if (length + (size) > LOOK_CACHE_KEY_MAX) { \
+            return 0; \
+        } \
+        memcpy(&key[length], (data), (size)); \
+        length += (size); \
+    } while (0)
+
+    LOOK_CACHE_KEY_PUT(&viewer, sizeof(viewer));
+
+    for (size_t i = 0; i < command->n_particles; i++) {
+        const struct particle * particle = command->particles[i];
+        uint8_t tag = particle->type;
+        LOOK_CACHE_KEY_PUT(&tag, 1);
+
+        switch (particle->type) {
+            case PARTICLE_KEYWORD: {
+                uint8_t keyword = particle->keyword;
+                LOOK_CACHE_KEY_PUT(&keyword, 1);
+                break;
+            }
+            case PARTICLE_NUMBER: {
+                size_t start = 0;
+                while (start + 1 < particle->length &&
+                        particle->value[start] == '0') {
+                    start++;
+                }
+                if (particle->length - start > UINT8_MAX) {
+                    return 0;
+                }
+                uint8_t digits = particle->length - start;
+                LOOK_CACHE_KEY_PUT(&digits, 1);
+                LOOK_CACHE_KEY_PUT(&particle->value[start], digits);
+                break;
+            }
+            case PARTICLE_NAME:
+                if (particle->name) {
+                    LOOK_CACHE_KEY_PUT(
+                            &particle->name, sizeof(particle->name));
+                } else {
+                    if (particle->length > UINT8_MAX) {
+                        return 0;
+                    }
+                    uint8_t size = particle->length;
+                    LOOK_CACHE_KEY_PUT(&size, 1);
+                    LOOK_CACHE_KEY_PUT(particle->value, size);
+                }
+                break;
+            case PARTICLE_END:
+            case PARTICLE_BEGIN_NEST:
+            case PARTICLE_END_NEST:
+            case PARTICLE_ERROR:
+                break;
+        }
+    }
+
+#undef LOOK_CACHE_KEY_PUT
+
+    return length;
+}
+
+/* returns the response cached for this key at this version, or NULL */
+struct refstring * look_cache_lookup(
+        const struct look_cache * cache,
+        uint64_t version,
+        const uint8_t * key,
+        size_t length
+    ) [[gnu::nonnull(1, 3)]]
+{
+    uint64_t hash = look_cache_hash(key, length);
+    for (size_t i = 0; i < LOOK_CACHE_PROBE_DEFAULT; i++) {
+        const struct look_cache_entry * entry =
+            &cache->entries[(hash + i) & cache->mask];
+        if (entry->response && entry->hash == hash &&
+                entry->version == version && entry->length == length &&
+                !memcmp(entry->key, key, length)) {
+            return entry->response;
+        }
+    }
+    return NULL;
+}
+
+/* cache this response for this key at this version */
+void look_cache_store(
+        struct look_cache * cache,
+        uint64_t version,
+        const uint8_t * key,
+        size_t length,
+        struct refstring * response
+    ) [[gnu::nonnull(1, 3, 5)]]
+{
+    uint64_t hash = look_cache_hash(key, length);
+
+    /* the first empty or stale slot, or else the home slot */
+    struct look_cache_entry * entry = &cache->entries[hash & cache->mask];
+    for (size_t i = 0; i < LOOK_CACHE_PROBE_DEFAULT; i++) {
+        struct look_cache_entry * candidate =
+            &cache->entries[(hash + i) & cache->mask];
+        if (!candidate->response || candidate->version != version) {
+            entry = candidate;
+            break;
+        }
+    }
+
+    look_cache_entry_clear(entry);
+
+    uint8_t * copy = malloc(length ? length : 1);
+    if (!copy) {
+        return;
+    }
+    memcpy(copy, key, length);
+
+    *entry = (struct look_cache_entry) {
+        .hash = hash,
+        .version = version,
+        .key = copy,
+        .length = length,
+        .response = refstring_dup(response)
+    };
+}
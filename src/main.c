@@ -99,6 +99,11 @@ int main(int argc, char ** argv) {
     }
 
     config.logger = logger_create(&config);
+    if (!config.logger) {
+        fprintf(stderr, "logger_create() failed\n");
+        config_free(&config);
+        return 1;
+    }
 
     LOGF_VERBOSE(config.logger, "version = %s\n", VERSION);
     LOGF_VERBOSE(config.logger, "port = %ld\n", config.port);
@@ -20,21 +20,113 @@
 #include "name_set.h"
 
 #include <stdlib.h>
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #include "util/sorted_set.h"
+#include "util/ngram_index.h"
+#include "util/string_pool.h"
 #include "util/log.h"
+#include "util/metrics.h"
 #include "hash.h"
 #include "card.h"
 
 
 #include <unicase.h>
 
-/* a set for looking up name tokens */
+/* how many names can be added to a compiled name set before they're merged
+ * (in the background) into a new hash
+ */
+#ifndef NAME_SET_MERGE_THRESHOLD_DEFAULT
+#define NAME_SET_MERGE_THRESHOLD_DEFAULT 64
+#endif /* NAME_SET_MERGE_THRESHOLD_DEFAULT */
+
+/* a merge of the hash and merging tiers of a name set into a new hash, on a
+ * thread of its own
+ *
+ * the thread only reads hash and merging, which nothing changes until the
+ * merge is finished (see merge_finish())
+ */
+struct name_set_merge {
+    pthread_t thread;
+    struct hash * hash;
+    struct sorted_set * merging;
+    struct hash * result; /* or NULL if the hash couldn't be made */
+    atomic_bool done;
+};
+
+/* a set for looking up name tokens
+ *
+ * once compiled, the names are in up to three tiers, which are checked in
+ * order by name_set_lookup():
+ *
+ * - hash, the frozen perfect hash of the names that were compiled
+ *
+ * - merging, the names being merged with the hash into a new one in the
+ *   background (see name_set_maintain()), or NULL
+ *
+ * - uncompiled, the names added since, which is the only tier name_set_add()
+ *   changes
+ */
 struct name_set {
     struct hash * hash;
+    struct sorted_set * merging;
     struct sorted_set * uncompiled;
+    struct name_set_merge * merge;
+
+    /* every name, keyed by its display_name (which is lowercased but, unlike
+     * the keys of hash and uncompiled, not normxfrm'd, so names that begin
+     * with the same text are next to each other.) the keys belong to
+     * display_names.
+     */
+    struct sorted_set * completions;
+
+    /* the same names, by the trigrams of their display names, for
+     * name_set_suggest()
+     */
+    struct ngram_index * suggestions;
+
+    /* the display names of every name, which are only ever added to (and
+     * live until the set is destroyed), packed together rather than
+     * malloc'd one by one
+     */
+    struct string_pool * display_names;
 };
 
+/* the names in the hash, merging, and uncompiled tiers are tagged with
+ * their type in the low bits of their pointers, which are always zero
+ * because the names come from malloc()
+ *
+ * this lets name_set_lookup_types() reject a name of the wrong type straight
+ * from the hash slot (or sorted set node) it found, without loading the name
+ */
+#define NAME_TAG_MASK ((uintptr_t)3)
+
+static_assert(NAME_TYPE_PLAYER <= NAME_TAG_MASK);
+static_assert(alignof(max_align_t) > NAME_TAG_MASK);
+
+/* return this name tagged with its type */
+static void * name_tag(struct name * name) [[gnu::nonnull(1)]]
+{
+    return (void *)((uintptr_t)name | name->type);
+}
+
+/* return the name that this tagged name points to */
+static struct name * name_untag(void * data)
+{
+    return (struct name *)((uintptr_t)data & ~NAME_TAG_MASK);
+}
+
+/* return the type that this tagged name is tagged with */
+static enum name_type name_tag_type(const void * data)
+{
+    return (enum name_type)((uintptr_t)data & NAME_TAG_MASK);
+}
+
 /* create an empty name set */
 [[nodiscard]] struct name_set * name_set_create()
 {
@@ -43,8 +135,28 @@ struct name_set {
         return NULL;
     }
     *name_set = (struct name_set) {
-        .uncompiled = sorted_set_create()
+        .uncompiled = sorted_set_create(),
+        .completions = sorted_set_create(),
+        .suggestions = ngram_index_create(),
+        .display_names = string_pool_create()
     };
+    if (!name_set->uncompiled || !name_set->completions ||
+            !name_set->suggestions || !name_set->display_names) {
+        if (name_set->uncompiled) {
+            sorted_set_destroy(name_set->uncompiled);
+        }
+        if (name_set->completions) {
+            sorted_set_destroy(name_set->completions);
+        }
+        if (name_set->suggestions) {
+            ngram_index_destroy(name_set->suggestions);
+        }
+        if (name_set->display_names) {
+            string_pool_destroy(name_set->display_names);
+        }
+        free(name_set);
+        return NULL;
+    }
     return name_set;
 }
 
@@ -53,7 +165,7 @@ void destroyer(const char * key, size_t length, void * data, void * ptr)
     (void)key;
     (void)length;
     (void)ptr;
-    struct name * name = data;
+    struct name * name = name_untag(data);
     switch (name->type) {
         case NAME_TYPE_CARD:
             card_destroy(name->data);
@@ -67,19 +179,184 @@ void destroyer(const char * key, size_t length, void * data, void * ptr)
         case NAME_TYPE_PLAYER:
             break;
     }
-    free(name->display_name);
     free(name);
 }
 
+/* callback for copying keys into a hash_inputs */
+static void copy_to_hash_inputs(
+        const char * key, size_t length, void * data, void * ptr)
+{
+    struct hash_inputs * hash_inputs = ptr;
+    hash_inputs_add(hash_inputs, key, length, data);
+}
+
+/* make a new hash of the names in this hash and these sorted sets (any of
+ * which may be NULL), with copies of their keys
+ *
+ * returns NULL on failure
+ */
+static struct hash * merge_tiers(
+        struct hash * hash,
+        struct sorted_set * a,
+        struct sorted_set * b
+    )
+{
+    struct hash_inputs * hash_inputs = hash_inputs_create();
+    if (!hash_inputs) {
+        return NULL;
+    }
+
+    if (hash) {
+        hash_apply(hash, &copy_to_hash_inputs, hash_inputs);
+    }
+    if (a) {
+        sorted_set_apply(a, &copy_to_hash_inputs, hash_inputs);
+    }
+    if (b) {
+        sorted_set_apply(b, &copy_to_hash_inputs, hash_inputs);
+    }
+
+#if defined(HASH_SIMULATE_FAILURE)
+    struct hash * result = NULL;
+#else
+    struct hash * result = hash_create(hash_inputs);
+#endif /* HASH_SIMULATE_FAILURE */
+
+    /* this frees the copies if making the hash failed */
+    hash_inputs_destroy(hash_inputs);
+    return result;
+}
+
+/* the thread of a name_set_merge */
+static void * merge_thread(void * ptr)
+{
+    struct name_set_merge * merge = ptr;
+    uint64_t started = metrics_now();
+    merge->result = merge_tiers(merge->hash, merge->merging, NULL);
+    metrics_record(METRIC_NAME_SET_MERGE_TIME, metrics_now() - started);
+    atomic_store(&merge->done, true);
+    return NULL;
+}
+
+/* start merging the uncompiled tier of this name set into its hash in the
+ * background, by moving it to the merging tier (or, if a merge of it failed,
+ * start merging the merging tier again)
+ *
+ * does nothing if the thread can't be started
+ */
+static void merge_start(struct name_set * name_set) [[gnu::nonnull(1)]]
+{
+    struct name_set_merge * merge = malloc(sizeof(*merge));
+    if (!merge) {
+        return;
+    }
+
+    struct sorted_set * uncompiled = NULL;
+    if (!name_set->merging) {
+        uncompiled = sorted_set_create();
+        if (!uncompiled) {
+            free(merge);
+            return;
+        }
+    }
+
+    *merge = (struct name_set_merge) {
+        .hash = name_set->hash,
+        .merging = name_set->merging ?
+            name_set->merging : name_set->uncompiled
+    };
+    atomic_init(&merge->done, false);
+
+    if (pthread_create(&merge->thread, NULL, &merge_thread, merge)) {
+        if (uncompiled) {
+            sorted_set_destroy(uncompiled);
+        }
+        free(merge);
+        return;
+    }
+
+    if (uncompiled) {
+        name_set->merging = name_set->uncompiled;
+        name_set->uncompiled = uncompiled;
+    }
+    name_set->merge = merge;
+}
+
+/* finish this name set's merge (if it has one) by swapping in the new hash
+ * in place of the old hash and the merging tier
+ *
+ * if the merge failed, the merging tier is kept (and merged again by the
+ * next name_set_maintain())
+ *
+ * if wait is false, returns false instead of waiting if the merge is still
+ * running. returns true otherwise.
+ */
+static bool merge_finish(
+        struct name_set * name_set, bool wait) [[gnu::nonnull(1)]]
+{
+    struct name_set_merge * merge = name_set->merge;
+    if (!merge) {
+        return true;
+    }
+    if (!wait && !atomic_load(&merge->done)) {
+        return false;
+    }
+
+    pthread_join(merge->thread, NULL);
+
+    if (merge->result) {
+        /* the names belong to the new hash now, only the keys are freed */
+        if (name_set->hash) {
+            hash_destroy(name_set->hash);
+        }
+        sorted_set_destroy(name_set->merging);
+        name_set->hash = merge->result;
+        name_set->merging = NULL;
+        metrics_count(METRIC_NAME_SET_MERGES, 1);
+    }
+
+    free(merge);
+    name_set->merge = NULL;
+    return true;
+}
+
+/* finish a background merge that's done, and start one if it's needed */
+void name_set_maintain(struct name_set * name_set) [[gnu::nonnull(1)]]
+{
+    if (!merge_finish(name_set, false)) {
+        return;
+    }
+
+    /* names added before the set is compiled go in the first hash */
+    if (!name_set->hash) {
+        return;
+    }
+
+    if (name_set->merging || sorted_set_size(name_set->uncompiled) >=
+            NAME_SET_MERGE_THRESHOLD_DEFAULT) {
+        merge_start(name_set);
+    }
+}
+
 /* destroy a name set and free the names its holding */
 void name_set_destroy(struct name_set * name_set) [[gnu::nonnull(1)]]
 {
+    merge_finish(name_set, true);
+
+    /* before the names (and so the keys) are freed */
+    sorted_set_destroy_except_keys(name_set->completions);
+    ngram_index_destroy(name_set->suggestions);
     if (name_set->hash) {
         hash_apply(name_set->hash, &destroyer, NULL);
         hash_destroy(name_set->hash);
     }
+    if (name_set->merging) {
+        sorted_set_apply(name_set->merging, &destroyer, NULL);
+        sorted_set_destroy(name_set->merging);
+    }
     sorted_set_apply(name_set->uncompiled, &destroyer, NULL);
     sorted_set_destroy(name_set->uncompiled);
+    string_pool_destroy(name_set->display_names);
     free(name_set);
 }
 
@@ -87,7 +364,9 @@ void name_set_destroy(struct name_set * name_set) [[gnu::nonnull(1)]]
  *
  * returns true if the key is added, false otherwise
  *
- * if a memory allocation error occurred, sets oom to true (and returns false)
+ * if a memory allocation error occurred, sets oom to true (and returns false,
+ * unless the name was added and just couldn't be indexed for completions or
+ * suggestions)
  */
 bool name_set_add(
         struct name_set * name_set,
@@ -131,16 +410,42 @@ bool name_set_add(
         return false;
     }
 
+    /* only the uncompiled tier checks for duplicates itself */
+    if ((name_set->hash &&
+                hash_lookup(name_set->hash, buffer_out, size_out)) ||
+            (name_set->merging &&
+                sorted_set_lookup(name_set->merging, buffer_out, size_out))) {
+        free(buffer_out);
+        free(buffer_out_transform);
+        return false;
+    }
+
+    /* n.b. if adding the name fails after this, its display name just stays
+     * in the pool (where adding it again will find it)
+     */
+    uint32_t display_name = string_pool_intern(
+            name_set->display_names,
+            buffer_out_transform,
+            size_out_transform
+        );
+    free(buffer_out_transform);
+    if (display_name == STRING_POOL_NO_ID) {
+        free(buffer_out);
+        *oom = true;
+        return false;
+    }
+    struct string_view view =
+        string_pool_view(name_set->display_names, display_name);
+
     struct name * name = malloc(sizeof(*name));
     if (!name) {
         free(buffer_out);
-        free(buffer_out_transform);
         *oom = true;
         return false;
     }
     *name = (struct name) {
-        .display_name = buffer_out_transform,
-        .display_name_length = size_out_transform,
+        .display_name = (uint8_t *)view.string,
+        .display_name_length = view.length,
         .type = type,
         .data = data
     };
@@ -149,23 +454,48 @@ bool name_set_add(
             name_set->uncompiled,
             buffer_out,
             size_out,
-            name
+            name_tag(name)
         );
 
     if (result == SORTED_SET_ADD_KEY_ERROR) {
         *oom = true;
         free(buffer_out);
-        free(name->display_name);
         free(name);
         return false;
     }
 
     if (result != SORTED_SET_ADD_KEY_UNIQUE) {
         free(buffer_out);
-        free(name->display_name);
         free(name);
         return false;
     }
+
+    /* names that are different but lowercase the same (e.g. that differ only
+     * in normalization) complete (and are suggested) as whichever was added
+     * first
+     *
+     * on memory error, the name is still added, it just might not be
+     * completed or suggested
+     */
+    result = sorted_set_add_key(
+            name_set->completions,
+            (char *)name->display_name,
+            name->display_name_length,
+            name
+        );
+    if (result == SORTED_SET_ADD_KEY_ERROR) {
+        *oom = true;
+    }
+    if (result != SORTED_SET_ADD_KEY_DUPLICATE && !ngram_index_add(
+                name_set->suggestions,
+                (const char *)name->display_name,
+                name->display_name_length,
+                name
+            )) {
+        *oom = true;
+    }
+
+    name_set_maintain(name_set);
     return true;
 }
 
@@ -228,12 +558,38 @@ static void add_to_sorted_set_maker(
  *       distributed at exact multiples of 2.
  *
  *       update: this is now what we do, using a sorted_set_maker
+ *
+ * if the set was already compiled, the hash and the other tiers are merged
+ * into a new hash instead (see name_set_maintain() for doing that in the
+ * background)
  */
 void name_set_compile(struct name_set * name_set) [[gnu::nonnull(1)]]
 {
-    /* TODO: is this the desired behavior? */
+    merge_finish(name_set, true);
+
+    /* compiling again merges every tier into a new hash right away (leaving
+     * them as they are if that fails)
+     */
     if (name_set->hash) {
+        struct hash * hash = merge_tiers(
+                name_set->hash, name_set->merging, name_set->uncompiled);
+        if (!hash) {
+            return;
+        }
+        struct sorted_set * uncompiled = sorted_set_create();
+        if (!uncompiled) {
+            hash_destroy(hash);
+            return;
+        }
         hash_destroy(name_set->hash);
+        if (name_set->merging) {
+            sorted_set_destroy(name_set->merging);
+            name_set->merging = NULL;
+        }
+        sorted_set_destroy(name_set->uncompiled);
+        name_set->hash = hash;
+        name_set->uncompiled = uncompiled;
+        return;
     }
 
     struct hash_inputs * hash_inputs = hash_inputs_create();
@@ -280,6 +636,25 @@ struct name * name_set_lookup(
         size_t length,
         bool * oom
     ) [[gnu::nonnull(1, 2)]]
+{
+    return name_set_lookup_types(
+            name_set, key, length, NAME_TYPE_BITS_ALL, oom);
+}
+
+/* look up a name of one of these types (a mask of NAME_TYPE_BIT()s) in this
+ * set
+ *
+ * returns the name if present and one of those types, NULL otherwise
+ *
+ * sets oom to true and returns NULL on memory error
+ */
+struct name * name_set_lookup_types(
+        const struct name_set * name_set,
+        const uint8_t * key,
+        size_t length,
+        unsigned int types,
+        bool * oom
+    ) [[gnu::nonnull(1, 2)]]
 {
 #if ENABLE_COMPAT
 #ifdef size_buffer
@@ -290,6 +665,8 @@ struct name * name_set_lookup(
     constexpr size_t size_buffer = 1024;
 #endif /* ENABLE_COMPAT */
 
+    metrics_count(METRIC_NAME_LOOKUPS, 1);
+
     /* first, transform */
     size_t size_out_transform = size_buffer;
     static uint8_t transform_buffer[size_buffer];
@@ -330,31 +707,43 @@ struct name * name_set_lookup(
         return NULL;
     }
 
+    /* the (tagged) name, from whichever tier has it */
+    void * data = NULL;
+
     if (name_set->hash) {
         /* n.b. this cannot fail due to malloc-y reasons */
         const struct hash_lookup_result * hash_result =
             hash_lookup(name_set->hash, buffer_out, size_out);
 
         if (hash_result) {
-            if (buffer_out != normxfrm_buffer) {
-                free(buffer_out);
-            }
-            return hash_result->ptr;
+            data = hash_result->ptr;
         }
     }
 
     /* n.b. neither can this */
-    const struct sorted_set_lookup_result * sorted_set_result =
-        sorted_set_lookup(name_set->uncompiled, buffer_out, size_out);
+    const struct sorted_set_lookup_result * sorted_set_result = NULL;
+    if (!data && name_set->merging) {
+        sorted_set_result =
+            sorted_set_lookup(name_set->merging, buffer_out, size_out);
+    }
+    if (!data && !sorted_set_result) {
+        sorted_set_result =
+            sorted_set_lookup(name_set->uncompiled, buffer_out, size_out);
+    }
+    if (sorted_set_result) {
+        data = sorted_set_result->data;
+    }
 
     if (buffer_out != normxfrm_buffer) {
         free(buffer_out);
     }
 
-    if (sorted_set_result) {
-        return sorted_set_result->data;
+    /* a name of the wrong type is rejected by its tag, without loading it */
+    if (data && (types & NAME_TYPE_BIT(name_tag_type(data)))) {
+        return name_untag(data);
     }
 
+    metrics_count(METRIC_NAME_LOOKUP_MISSES, 1);
     return NULL;
 
 #if ENABLE_COMPAT
@@ -362,6 +751,130 @@ struct name * name_set_lookup(
 #endif /* ENABLE_COMPAT */
 }
 
+/* find the names that begin with this prefix
+ *
+ * writes up to max of them, in order, to names, and returns how many it
+ * wrote
+ *
+ * sets oom to true and returns 0 on memory error
+ */
+size_t name_set_complete(
+        const struct name_set * name_set,
+        const uint8_t * prefix,
+        size_t length,
+        struct name ** names,
+        size_t max,
+        bool * oom
+    ) [[gnu::nonnull(1, 2)]]
+{
+    metrics_count(METRIC_NAME_COMPLETIONS, 1);
+
+    /* the keys are display names, so transform the prefix the same way */
+    uint8_t transform_buffer[256];
+    size_t size_out_transform = sizeof(transform_buffer);
+    uint8_t * buffer_out_transform = u8_tolower(
+            prefix,
+            length,
+            uc_locale_language(),
+            NULL,
+            transform_buffer,
+            &size_out_transform
+        );
+
+    if (!buffer_out_transform) {
+        *oom = true;
+        return 0;
+    }
+
+    struct sorted_set_cursor cursor = sorted_set_prefix(
+            name_set->completions,
+            (const char *)buffer_out_transform,
+            size_out_transform
+        );
+
+    size_t n_names = 0;
+    const struct sorted_set_lookup_result * result;
+    while (n_names < max && (result = sorted_set_cursor_next(&cursor))) {
+        names[n_names++] = result->data;
+    }
+
+    if (buffer_out_transform != transform_buffer) {
+        free(buffer_out_transform);
+    }
+
+    return n_names;
+}
+
+/* find the names that are within max_distance edits of this one
+ *
+ * writes up to max of them, closest first, to names, and returns how many it
+ * wrote
+ *
+ * sets oom to true and returns 0 on memory error
+ */
+size_t name_set_suggest(
+        const struct name_set * name_set,
+        const uint8_t * key,
+        size_t length,
+        size_t max_distance,
+        struct name ** names,
+        size_t max,
+        bool * oom
+    ) [[gnu::nonnull(1, 2)]]
+{
+    metrics_count(METRIC_NAME_SUGGESTIONS, 1);
+
+    if (max == 0) {
+        return 0;
+    }
+
+    /* the keys are display names, so transform the name the same way */
+    uint8_t transform_buffer[256];
+    size_t size_out_transform = sizeof(transform_buffer);
+    uint8_t * buffer_out_transform = u8_tolower(
+            key,
+            length,
+            uc_locale_language(),
+            NULL,
+            transform_buffer,
+            &size_out_transform
+        );
+
+    if (!buffer_out_transform) {
+        *oom = true;
+        return 0;
+    }
+
+    struct ngram_index_result * results = malloc(sizeof(*results) * max);
+    if (!results) {
+        if (buffer_out_transform != transform_buffer) {
+            free(buffer_out_transform);
+        }
+        *oom = true;
+        return 0;
+    }
+
+    size_t n_results = ngram_index_search(
+            name_set->suggestions,
+            (const char *)buffer_out_transform,
+            size_out_transform,
+            max_distance,
+            results,
+            max,
+            oom
+        );
+    for (size_t i = 0; i < n_results; i++) {
+        names[i] = results[i].data;
+    }
+
+    free(results);
+    if (buffer_out_transform != transform_buffer) {
+        free(buffer_out_transform);
+    }
+
+    return n_results;
+}
+
 /* used internally by name_set_apply */
 struct name_set_apply_context {
     void (*fn)(struct name * name, void * ptr);
@@ -379,8 +892,7 @@ static void name_set_apply_helper(
     (void)key;
     (void)length;
     struct name_set_apply_context * context = ptr;
-    struct name * name = data;
-    context->fn(name, ptr);
+    context->fn(name_untag(data), context->ptr);
 }
 
 /* call this function every name */
@@ -397,6 +909,13 @@ void name_set_apply(
                 &(struct name_set_apply_context){ .fn = fn, .ptr = ptr, }
             );
     }
+    if (name_set->merging) {
+        sorted_set_apply(
+                name_set->merging,
+                &name_set_apply_helper,
+                &(struct name_set_apply_context){ .fn = fn, .ptr = ptr }
+            );
+    }
     sorted_set_apply(
             name_set->uncompiled,
             &name_set_apply_helper,
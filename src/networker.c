@@ -19,18 +19,70 @@
  */
 #include "networker.h"
 #include "util/log.h"
+#include "util/metrics.h"
+#include "util/refstring.h"
 #include "util/safe_realloc.h"
+#include "util/strdup.h"
+#include "util/timer_wheel.h"
 
 #include "command/lex.h"
 #include "command/parse.h"
 #include "game.h"
+#include "look_cache.h"
 
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 
 #include <event2/listener.h>
 #include <event2/bufferevent.h>
 #include <event2/buffer.h>
+#include <event2/event.h>
+#include <event2/util.h>
+
+#if !defined(__MINGW32__)
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif /* __MINGW32__ */
+
+/* VERSION is defined as a string by the build scripts and sent in reply to
+ * the VERSION command
+ */
+#ifndef VERSION
+#error no VERSION defined
+#endif /* VERSION */
+
+/* how much input is peeked and handed to the lexer at once when
+ * config.input_limit is 0
+ */
+#ifndef NETWORKER_PEEK_SIZE_DEFAULT
+#define NETWORKER_PEEK_SIZE_DEFAULT (16 * 1024)
+#endif /* NETWORKER_PEEK_SIZE_DEFAULT */
+
+/* the number of slots in the networker's timer wheel, which ticks once a
+ * second
+ */
+#ifndef NETWORKER_TIMER_WHEEL_SLOTS_DEFAULT
+#define NETWORKER_TIMER_WHEEL_SLOTS_DEFAULT 64
+#endif /* NETWORKER_TIMER_WHEEL_SLOTS_DEFAULT */
+
+/* the most input an admin command (i.e. one line) may be */
+#ifndef NETWORKER_ADMIN_LINE_LIMIT
+#define NETWORKER_ADMIN_LINE_LIMIT 1024
+#endif /* NETWORKER_ADMIN_LINE_LIMIT */
+
+/* the networker's events have NETWORKER_PRIORITIES priorities, and (unless
+ * they are given another one) get the middle one. the admin socket runs at
+ * the lowest priority, so its callbacks only run when no game callbacks are
+ * waiting to.
+ */
+#define NETWORKER_PRIORITIES 3
+#define NETWORKER_PRIORITY_ADMIN 2
+
+/* forward declare */
+struct admin_connection;
 
 /* a networker holds the state of networking apparatus */
 struct networker {
@@ -41,9 +93,42 @@ struct networker {
     size_t n_connections;
     int errors;
 
+    /* flow control, copied from the config (see config.h) */
+    size_t read_low_watermark;
+    size_t read_high_watermark;
+    size_t write_low_watermark;
+    size_t write_high_watermark;
+    size_t output_limit;
+    size_t input_limit;
+
+    /* connection timeouts in seconds (i.e. ticks of timers) */
+    struct timer_wheel * timers;
+    struct event * tick_event;
+    uint64_t handshake_timeout;
+    uint64_t lobby_timeout;
+
+    /* rate limits (see config.h) */
+    double commands_per_second;
+    double command_burst;
+    size_t commands_per_turn;
+    struct ev_token_bucket_cfg * connection_rate_limit;
+    struct ev_token_bucket_cfg * server_rate_limit;
+    struct bufferevent_rate_limit_group * rate_limit_group;
+
+    /* the admin socket (see config.h), and its connections */
+    struct evconnlistener * admin_listener;
+    char * admin_socket;
+    struct admin_connection * admins;
+
     struct game * game;
 };
 
+/* the state of a connection, which decides which timeout applies to it */
+enum connection_state {
+    CONNECTION_HANDSHAKE, /* has not yet sent a complete command */
+    CONNECTION_LOBBY /* not in a game (which, for now, is all of them) */
+};
+
 /* a connection is the context given to each connection created by the
  * networker
  * */
@@ -57,6 +142,38 @@ struct connection {
 
     struct particle_buffer * buffer;
     struct parser * parser;
+
+    /* reads are disabled until the output drains to write_low_watermark */
+    bool reads_paused;
+
+    /* connection_close() has been called, and close_event will destroy this
+     * connection once the eventloop gets to it
+     */
+    bool closing;
+    struct event * close_event;
+
+    /* the timeout is checked lazily: activity only updates last_activity, and
+     * when the timer fires it is rescheduled if there was activity since it
+     * was scheduled
+     */
+    enum connection_state state;
+    uint64_t last_activity;
+    struct timer_wheel_timer timeout;
+
+    /* the command token bucket, which is refilled lazily based on how long
+     * it has been since it was last updated. throttle_event fires when the
+     * bucket will have a token again, if there is input waiting on one.
+     */
+    double command_tokens;
+    struct timeval command_tokens_updated;
+    struct event * throttle_event;
+
+    /* process_event is made active (rather than the input being processed
+     * all at once) when a connection has more than commands_per_turn
+     * commands waiting, which puts it at the back of the eventloop's queue
+     */
+    bool process_queued;
+    struct event * process_event;
 };
 
 /* iterator over networker->connections */
@@ -65,6 +182,64 @@ struct networker_connection_iter {
     size_t index;
 };
 
+static void connection_timeout_cb(struct timer_wheel_timer * timer, void * ptr);
+static void connection_throttle_cb(
+        evutil_socket_t fd, short events, void * ptr);
+static void connection_process_cb(
+        evutil_socket_t fd, short events, void * ptr);
+
+/* returns how many seconds this connection may go without activity in its
+ * current state, or 0 if it has no timeout
+ */
+static uint64_t connection_timeout(
+        const struct connection * connection) [[gnu::nonnull(1)]]
+{
+    switch (connection->state) {
+        case CONNECTION_HANDSHAKE:
+            return connection->networker->handshake_timeout;
+        case CONNECTION_LOBBY:
+            return connection->networker->lobby_timeout;
+    }
+    return 0;
+}
+
+/* (re)schedule the timeout of this connection based on its state and
+ * last_activity
+ */
+static void connection_schedule_timeout(
+        struct connection * connection) [[gnu::nonnull(1)]]
+{
+    struct timer_wheel * timers = connection->networker->timers;
+    uint64_t timeout = connection_timeout(connection);
+
+    if (timeout == 0) {
+        timer_wheel_cancel(&connection->timeout);
+        return;
+    }
+
+    uint64_t deadline = connection->last_activity + timeout;
+    uint64_t now = timer_wheel_now(timers);
+
+    timer_wheel_schedule(
+            timers,
+            &connection->timeout,
+            deadline > now ? deadline - now : 0,
+            &connection_timeout_cb,
+            connection
+        );
+}
+
+/* move this connection into state, restarting its timeout */
+static void connection_set_state(
+        struct connection * connection,
+        enum connection_state state
+    ) [[gnu::nonnull(1)]]
+{
+    connection->state = state;
+    connection->last_activity = timer_wheel_now(connection->networker->timers);
+    connection_schedule_timeout(connection);
+}
+
 /* create a connection with the given networker and bufferevent */
 [[nodiscard]] static struct connection * connection_create(
         struct networker * networker,
@@ -81,12 +256,29 @@ struct networker_connection_iter {
         .networker = networker,
         .bev = bev,
         .buffer = particle_buffer_create(),
-        .parser = parser_create(networker->game)
+        .parser = parser_create(networker->game),
+        .state = CONNECTION_HANDSHAKE,
+        .last_activity = timer_wheel_now(networker->timers),
+        .command_tokens = networker->command_burst,
+        .throttle_event = evtimer_new(
+                networker->base, &connection_throttle_cb, connection),
+        .process_event = event_new(
+                networker->base, -1, 0, &connection_process_cb, connection)
     };
+    timer_wheel_timer_init(&connection->timeout);
+    event_base_gettimeofday_cached(
+            networker->base, &connection->command_tokens_updated);
 
-    if (!connection->buffer || !connection->parser) {
+    if (!connection->buffer || !connection->parser ||
+            !connection->throttle_event || !connection->process_event) {
         particle_buffer_destroy(connection->buffer);
         parser_destroy(connection->parser);
+        if (connection->throttle_event) {
+            event_free(connection->throttle_event);
+        }
+        if (connection->process_event) {
+            event_free(connection->process_event);
+        }
         free(connection);
         return NULL;
     }
@@ -99,12 +291,17 @@ struct networker_connection_iter {
     if (!networker->connections) {
         particle_buffer_destroy(connection->buffer);
         parser_destroy(connection->parser);
+        event_free(connection->throttle_event);
+        event_free(connection->process_event);
         free(connection);
         return NULL;
     }
 
     networker->connections[networker->n_connections] = connection;
     networker->n_connections++;
+    metrics_gauge_add(METRIC_CONNECTIONS, 1);
+
+    connection_schedule_timeout(connection);
 
     return connection;
 }
@@ -122,20 +319,557 @@ static void connection_destroy(
         }
     }
 
+    if (connection->close_event) {
+        event_free(connection->close_event);
+    }
+    timer_wheel_cancel(&connection->timeout);
+    event_free(connection->throttle_event);
+    event_free(connection->process_event);
     bufferevent_free(connection->bev);
     particle_buffer_destroy(connection->buffer);
     parser_destroy(connection->parser);
 
     free(connection->vecs);
     free(connection);
+
+    metrics_count(METRIC_DISCONNECTS, 1);
+    metrics_gauge_add(METRIC_CONNECTIONS, -1);
 }
 
-/* dummy read callback */
-static void example_read_cb(struct bufferevent * bev, void * ptr)
+/* close_event callback for connection_close() */
+static void connection_close_cb(evutil_socket_t fd, short events, void * ptr)
+{
+    (void)fd;
+    (void)events;
+    connection_destroy(ptr);
+}
+
+/* stop reading from and writing to this connection and destroy it once
+ * control returns to the eventloop
+ *
+ * unlike connection_destroy(), this is safe to call on any connection from
+ * inside any callback (including while iterating over the networker's
+ * connections, or while one of this connection's own callbacks is running)
+ */
+static void connection_close(
+        struct connection * connection) [[gnu::nonnull(1)]]
+{
+    if (connection->closing) {
+        return;
+    }
+
+    connection->closing = true;
+    bufferevent_disable(connection->bev, EV_READ | EV_WRITE);
+    timer_wheel_cancel(&connection->timeout);
+
+    connection->close_event = event_new(
+            connection->networker->base,
+            -1,
+            0,
+            &connection_close_cb,
+            connection
+        );
+
+    if (!connection->close_event) {
+        LOGF_ERROR(
+                connection->networker->logger,
+                "[networker] event_new() failed closing connection %lu, "
+                "it will be destroyed with the networker\n",
+                (unsigned long)connection->id
+            );
+        return;
+    }
+
+    event_active(connection->close_event, 0, 0);
+}
+
+/* timer callback that closes connections which have been inactive for longer
+ * than the timeout of their state
+ */
+static void connection_timeout_cb(struct timer_wheel_timer * timer, void * ptr)
 {
+    (void)timer;
     struct connection * connection = ptr;
+    uint64_t timeout = connection_timeout(connection);
+    uint64_t now = timer_wheel_now(connection->networker->timers);
+
+    if (timeout == 0) {
+        return;
+    }
+
+    if (connection->last_activity + timeout > now) {
+        /* there was activity since this was scheduled */
+        connection_schedule_timeout(connection);
+        return;
+    }
+
+    static const char * state_names[] = {
+        [CONNECTION_HANDSHAKE] = "handshake",
+        [CONNECTION_LOBBY] = "lobby"
+    };
+
+    LOGF_INFO(
+            connection->networker->logger,
+            "[networker] connection %lu exceeded the %s timeout, "
+            "disconnecting\n",
+            (unsigned long)connection->id,
+            state_names[connection->state]
+        );
+
+    struct evbuffer * output = bufferevent_get_output(connection->bev);
+    evbuffer_add_printf(output, "[server] timed out\n");
+    connection_close(connection);
+}
+
+/* refill this connection's command token bucket and return how many whole
+ * commands it may process right now (or SIZE_MAX if there is no limit)
+ */
+static size_t connection_command_tokens(
+        struct connection * connection) [[gnu::nonnull(1)]]
+{
+    struct networker * networker = connection->networker;
+
+    if (networker->commands_per_second <= 0) {
+        return SIZE_MAX;
+    }
+
+    struct timeval now, elapsed;
+    event_base_gettimeofday_cached(networker->base, &now);
+    evutil_timersub(&now, &connection->command_tokens_updated, &elapsed);
+    connection->command_tokens_updated = now;
+
+    /* the clock went backwards */
+    if (elapsed.tv_sec < 0) {
+        return (size_t)connection->command_tokens;
+    }
+
+    connection->command_tokens +=
+        ((double)elapsed.tv_sec + (double)elapsed.tv_usec / 1000000.0) *
+        networker->commands_per_second;
+
+    if (connection->command_tokens > networker->command_burst) {
+        connection->command_tokens = networker->command_burst;
+    }
+
+    return (size_t)connection->command_tokens;
+}
+
+/* spend this many command tokens (which may be more than were available, if
+ * the lexer found more commands than newlines)
+ */
+static void connection_spend_command_tokens(
+        struct connection * connection,
+        size_t n_commands
+    ) [[gnu::nonnull(1)]]
+{
+    if (connection->networker->commands_per_second <= 0) {
+        return;
+    }
+
+    connection->command_tokens -= (double)n_commands;
+    if (connection->command_tokens < 0) {
+        connection->command_tokens = 0;
+    }
+}
+
+/* arrange for this connection's input to be looked at again once its
+ * command token bucket has a whole token in it
+ */
+static void connection_throttle(
+        struct connection * connection) [[gnu::nonnull(1)]]
+{
+    double wait = (1.0 - connection->command_tokens) /
+        connection->networker->commands_per_second;
+
+    if (wait < 0) {
+        wait = 0;
+    }
+
+    struct timeval delay = (struct timeval) {
+        .tv_sec = (time_t)wait,
+        .tv_usec = (suseconds_t)((wait - (double)(time_t)wait) * 1000000.0)
+    };
+
+    if (!evtimer_pending(connection->throttle_event, NULL)) {
+        evtimer_add(connection->throttle_event, &delay);
+    }
+}
+
+/* truncate these vecs (as filled in by evbuffer_peek()) so that they end just
+ * after the max_commands-th newline, returning the new number of vecs
+ *
+ * if there are fewer than max_commands newlines, the vecs are not changed
+ */
+static size_t limit_commands(
+        struct evbuffer_iovec * vecs,
+        size_t n_vecs,
+        size_t max_commands
+    ) [[gnu::nonnull(1)]]
+{
+    size_t n_commands = 0;
+    for (size_t i = 0; i < n_vecs; i++) {
+        const char * start = vecs[i].iov_base;
+        const char * end = start + vecs[i].iov_len;
+        const char * c = start;
+        while ((c = memchr(c, '\n', end - c))) {
+            c++;
+            n_commands++;
+            if (n_commands == max_commands) {
+                vecs[i].iov_len = c - start;
+                return i + 1;
+            }
+        }
+    }
+    return n_vecs;
+}
+
+/* enforce the output limits on this connection, after something has been
+ * added to its output
+ *
+ * a connection whose output is above write_high_watermark stops being read
+ * from (so that it cannot issue more commands whose responses would queue up
+ * behind the ones it isn't reading), and one whose output is above
+ * output_limit is disconnected
+ */
+static void connection_check_output(
+        struct connection * connection) [[gnu::nonnull(1)]]
+{
+    if (connection->closing) {
+        return;
+    }
+
+    struct networker * networker = connection->networker;
+    size_t depth = connection_output_depth(connection);
+
+    if (networker->output_limit && depth > networker->output_limit) {
+        LOGF_INFO(
+                networker->logger,
+                "[networker] connection %lu exceeded the output limit "
+                "(%zu bytes queued), disconnecting\n",
+                (unsigned long)connection->id,
+                depth
+            );
+        connection_close(connection);
+        return;
+    }
+
+    if (networker->write_high_watermark && !connection->reads_paused
+            && depth > networker->write_high_watermark) {
+        bufferevent_disable(connection->bev, EV_READ);
+        connection->reads_paused = true;
+    }
+}
+
+/* cleanup callback for evbuffer_add_reference() that releases the reference
+ * a connection's output held on a refstring
+ */
+static void connection_reference_cleanup_cb(
+        const void * data, size_t length, void * ptr)
+{
+    (void)data;
+    (void)length;
+    refstring_destroy(ptr);
+}
+
+/* attach this refstring to the output of this connection without copying it
+ *
+ * the output holds its own reference, released once it has been written, so
+ * the caller still has to refstring_destroy() its own
+ */
+static void connection_send_reference(
+        struct connection * connection,
+        struct refstring * message
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct refstring * reference = refstring_dup(message);
+    if (evbuffer_add_reference(
+                bufferevent_get_output(connection->bev),
+                refstring_string(message),
+                refstring_length(message),
+                &connection_reference_cleanup_cb,
+                reference
+            )) {
+        /* the cleanup callback is not called on failure */
+        refstring_destroy(reference);
+        LOGF_ERROR(
+                connection->networker->logger,
+                "[networker] evbuffer_add_reference() failed for "
+                "connection %lu\n",
+                (unsigned long)connection->id
+            );
+        return;
+    }
+
+    connection_check_output(connection);
+}
+
+/* broadcast what a connection said (the particles following its SAY keyword)
+ * to every connection
+ *
+ * the message is assembled and formatted once, no matter how many
+ * connections it is sent to
+ */
+static void connection_say(
+        struct connection * connection,
+        struct particle ** particles,
+        size_t n_particles
+    ) [[gnu::nonnull(1)]]
+{
+    size_t length = 0;
+    for (size_t i = 0; i < n_particles; i++) {
+        struct particle * particle = particles[i];
+        switch (particle->type) {
+            case PARTICLE_KEYWORD:
+            case PARTICLE_NUMBER:
+                length += particle->length + 1;
+                break;
+            case PARTICLE_NAME:
+                length += particle->length + 3;
+                break;
+            case PARTICLE_BEGIN_NEST:
+            case PARTICLE_END_NEST:
+                length += 2;
+                break;
+            case PARTICLE_END:
+            case PARTICLE_ERROR:
+                break;
+        }
+    }
+
+    uint8_t * text = malloc(length + 1);
+    if (!text) {
+        LOGF_ERROR(
+                connection->networker->logger,
+                "[networker] connection_say() failed to allocate memory\n"
+            );
+        return;
+    }
+
+    size_t index = 0;
+    for (size_t i = 0; i < n_particles; i++) {
+        struct particle * particle = particles[i];
+        switch (particle->type) {
+            case PARTICLE_KEYWORD:
+            case PARTICLE_NUMBER:
+                memcpy(&text[index], particle->value, particle->length);
+                index += particle->length;
+                break;
+            case PARTICLE_NAME:
+                text[index++] = '"';
+                memcpy(&text[index], particle->value, particle->length);
+                index += particle->length;
+                text[index++] = '"';
+                break;
+            case PARTICLE_BEGIN_NEST:
+                text[index++] = '(';
+                break;
+            case PARTICLE_END_NEST:
+                text[index++] = ')';
+                break;
+            case PARTICLE_END:
+            case PARTICLE_ERROR:
+                continue;
+        }
+        text[index++] = ' ';
+    }
+
+    /* drop the trailing space */
+    if (index > 0) {
+        index--;
+    }
+
+    networker_broadcastf(
+            connection->networker,
+            "[%lu] %.*U\n",
+            (unsigned long)connection->id,
+            (int)index,
+            text
+        );
+
+    free(text);
+}
+
+/* the command handlers, one per command type (COMMAND_HANDLERS is generated
+ * from src/command/keywords.txt)
+ *
+ * each returns false if the connection should stop processing commands
+ * and close
+ */
+
+static bool connection_command_error(
+        struct connection * connection,
+        struct command * command
+    ) [[gnu::nonnull(1, 2)]]
+{
+    evbuffer_add_printf(
+            bufferevent_get_output(connection->bev),
+            "[server] error: %s\n",
+            command->error
+        );
+    return true;
+}
+
+static bool connection_command_say(
+        struct connection * connection,
+        struct command * command
+    ) [[gnu::nonnull(1, 2)]]
+{
+    connection_say(
+            connection,
+            command->arguments->value.particles,
+            command->arguments->value.n_particles
+        );
+    return true;
+}
 
-    struct evbuffer * input = bufferevent_get_input(bev);
+static bool connection_command_exit(
+        struct connection * connection,
+        struct command * command
+    ) [[gnu::nonnull(1, 2)]]
+{
+    (void)connection;
+    (void)command;
+    return false;
+}
+
+static bool connection_command_shutdown(
+        struct connection * connection,
+        struct command * command
+    ) [[gnu::nonnull(1, 2)]]
+{
+    (void)command;
+    evbuffer_add_printf(
+            bufferevent_get_output(connection->bev),
+            "[server] shutdown is only accepted on the admin socket\n"
+        );
+    return true;
+}
+
+static bool connection_command_version(
+        struct connection * connection,
+        struct command * command
+    ) [[gnu::nonnull(1, 2)]]
+{
+    (void)command;
+    evbuffer_add_printf(
+            bufferevent_get_output(connection->bev),
+            "[server] version %s\n",
+            VERSION
+        );
+    return true;
+}
+
+/* LOOK is read-only, so its response is rendered once per game version and
+ * then served from the game's look_cache
+ */
+static bool connection_command_look(
+        struct connection * connection,
+        struct command * command
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct game * game = connection->networker->game;
+
+    uint8_t key[LOOK_CACHE_KEY_MAX];
+    size_t length = look_cache_key(command, connection->id, key);
+
+    struct refstring * response = NULL;
+    if (length > 0) {
+        response = look_cache_lookup(
+                game->look_cache, game->version, key, length);
+    }
+
+    if (response) {
+        metrics_count(METRIC_LOOK_CACHE_HITS, 1);
+        connection_send_reference(connection, response);
+        return true;
+    }
+
+    metrics_count(METRIC_LOOK_CACHE_MISSES, 1);
+    response = game_look(game, command);
+    if (refstring_is_null_refstring(response)) {
+        LOGF_ERROR(
+                connection->networker->logger,
+                "[networker] game_look() failed to allocate memory\n"
+            );
+        refstring_destroy(response);
+        return true;
+    }
+
+    if (length > 0) {
+        look_cache_store(
+                game->look_cache, game->version, key, length, response);
+    }
+    connection_send_reference(connection, response);
+    refstring_destroy(response);
+    return true;
+}
+
+static bool connection_command_complete(
+        struct connection * connection,
+        struct command * command
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct refstring * response =
+        game_complete(connection->networker->game, command);
+    if (refstring_is_null_refstring(response)) {
+        LOGF_ERROR(
+                connection->networker->logger,
+                "[networker] game_complete() failed to allocate memory\n"
+            );
+        refstring_destroy(response);
+        return true;
+    }
+
+    connection_send_reference(connection, response);
+    refstring_destroy(response);
+    return true;
+}
+
+static bool connection_command_not_implemented(
+        struct connection * connection,
+        struct command * command
+    ) [[gnu::nonnull(1, 2)]]
+{
+    (void)command;
+    evbuffer_add_printf(
+            bufferevent_get_output(connection->bev),
+            "[server] error: that command is not implemented yet\n"
+        );
+    return true;
+}
+
+/* the handler for each command type, indexed by command->type */
+static bool (* const command_handlers[COMMAND_COUNT])(
+        struct connection *, struct command *) = {
+#define COMMAND_HANDLER(type, handler) \
+    [COMMAND_##type] = connection_command_##handler,
+    COMMAND_HANDLERS(COMMAND_HANDLER)
+#undef COMMAND_HANDLER
+};
+
+/* process one turn's worth of this connection's input: as many complete
+ * commands as it has tokens for, up to commands_per_turn
+ *
+ * if more commands are waiting, the connection is either throttled (if it
+ * ran out of tokens) or requeued (if it ran out of turn)
+ */
+static void connection_process(
+        struct connection * connection) [[gnu::nonnull(1)]]
+{
+    struct networker * networker = connection->networker;
+
+    if (connection->closing || connection->reads_paused ||
+            connection->process_queued) {
+        /* anything left in the input will be handled once reads resume or
+         * the queued turn runs
+         */
+        return;
+    }
+
+    struct evbuffer * input = bufferevent_get_input(connection->bev);
+
+    ev_ssize_t peek_size = networker->input_limit ?
+        (ev_ssize_t)networker->input_limit : NETWORKER_PEEK_SIZE_DEFAULT;
 
     size_t n_vecs_needed = 1;
     do {
@@ -149,115 +883,687 @@ static void example_read_cb(struct bufferevent * bev, void * ptr)
         }
         n_vecs_needed = evbuffer_peek(
                 input,
-                16 * 1024,
+                peek_size,
                 NULL,
                 connection->vecs,
                 connection->vecs_capacity
             );
     } while (n_vecs_needed > connection->vecs_capacity);
 
-    if (n_vecs_needed == 0) {
-        return;
+    if (n_vecs_needed == 0) {
+        return;
+    }
+
+    size_t tokens = connection_command_tokens(connection);
+    if (tokens == 0) {
+        connection_throttle(connection);
+        return;
+    }
+
+    uint64_t turn_started = metrics_now();
+
+    size_t max_commands = networker->commands_per_turn ?
+        networker->commands_per_turn : SIZE_MAX;
+    bool out_of_tokens = tokens <= max_commands;
+    if (out_of_tokens) {
+        max_commands = tokens;
+    }
+
+    size_t n_vecs = n_vecs_needed;
+    if (max_commands != SIZE_MAX) {
+        n_vecs = limit_commands(connection->vecs, n_vecs, max_commands);
+    }
+
+    const struct lexer_input * lexer_inputs =
+        (const struct lexer_input *)connection->vecs;
+
+    /* minimal lexing code for testing */
+    bool oom;
+    size_t index = lex(
+            lexer_inputs,
+            n_vecs,
+            connection->parser->game->name_set,
+            connection->buffer,
+            &oom
+        );
+
+    if (oom) {
+        LOGF_ERROR(NULL, "lex() signaled a memory failure\n");
+    }
+
+    struct parse_result parse_result;
+    parser_parse(
+            connection->parser,
+            connection->buffer,
+            &parse_result
+        );
+
+    size_t n_commands = 0;
+    size_t n_errors = 0;
+    for (size_t i = 0; i < connection->buffer->n_particles; i++) {
+        switch (connection->buffer->particles[i]->type) {
+            case PARTICLE_END:
+                n_commands++;
+                break;
+            case PARTICLE_ERROR:
+                n_errors++;
+                break;
+            default:
+                break;
+        }
+    }
+    connection_spend_command_tokens(connection, n_commands);
+
+    metrics_count(METRIC_COMMANDS_LEXED, n_commands);
+    metrics_count(METRIC_LEX_ERRORS, n_errors);
+    metrics_count(
+            METRIC_COMMANDS_PARSED,
+            parse_result.n_commands - parse_result.n_errors
+        );
+
+    /* sending anything counts as activity, except during the handshake,
+     * which only a complete command ends
+     */
+    if (connection->state == CONNECTION_HANDSHAKE) {
+        if (n_commands > 0) {
+            connection_set_state(connection, CONNECTION_LOBBY);
+        }
+    } else {
+        connection->last_activity = timer_wheel_now(networker->timers);
+    }
+
+    bool exit = false;
+    uint64_t command_started = metrics_now();
+    for (struct command * command = parse_result.commands; command;
+            command = command->next) {
+        exit = !command_handlers[command->type](connection, command);
+
+        uint64_t now = metrics_now();
+        metrics_record(METRIC_COMMAND_LATENCY, now - command_started);
+        command_started = now;
+
+        if (exit) {
+            break;
+        }
+    }
+
+    particle_buffer_free_all(connection->buffer);
+    /* ------------------------------- */
+
+    if (evbuffer_drain(input, index)) {
+        LOGF_ERROR(
+                connection->networker->logger,
+                "evbuffer_drain() error\n"
+            );
+    }
+
+    metrics_record(METRIC_TURN_LATENCY, metrics_now() - turn_started);
+
+    if (exit) {
+        connection_close(connection);
+        return;
+    }
+
+    /* the input stops growing at read_high_watermark (and we only ever look
+     * at the first input_limit bytes of it), so no progress past either means
+     * no complete token is ever going to arrive
+     */
+    size_t depth = evbuffer_get_length(input);
+    if (index == 0 && n_vecs == n_vecs_needed && (
+                (networker->input_limit && depth >= networker->input_limit) ||
+                (networker->read_high_watermark &&
+                 depth >= networker->read_high_watermark))) {
+        LOGF_INFO(
+                networker->logger,
+                "[networker] connection %lu exceeded the input limit "
+                "(%zu bytes unprocessed), disconnecting\n",
+                (unsigned long)connection->id,
+                depth
+            );
+        connection_close(connection);
+        return;
+    }
+
+    /* commands held back by the token bucket or the turn limit won't
+     * trigger another read callback on their own
+     */
+    if (n_vecs != n_vecs_needed || (max_commands != SIZE_MAX &&
+                n_commands >= max_commands && depth > 0)) {
+        if (out_of_tokens) {
+            connection_throttle(connection);
+        } else {
+            connection->process_queued = true;
+            event_active(connection->process_event, 0, 0);
+        }
+    }
+
+    connection_check_output(connection);
+}
+
+/* dummy read callback */
+static void example_read_cb(struct bufferevent * bev, void * ptr)
+{
+    (void)bev;
+    connection_process(ptr);
+}
+
+/* process_event callback, which gives a connection another turn */
+static void connection_process_cb(
+        evutil_socket_t fd, short events, void * ptr)
+{
+    (void)fd;
+    (void)events;
+    struct connection * connection = ptr;
+    connection->process_queued = false;
+    connection_process(connection);
+}
+
+/* throttle_event callback, which looks at a connection's input again once
+ * its token bucket has refilled
+ */
+static void connection_throttle_cb(
+        evutil_socket_t fd, short events, void * ptr)
+{
+    (void)fd;
+    (void)events;
+    connection_process(ptr);
+}
+
+/* write callback, called when a connection's output drains to
+ * write_low_watermark, resumes reading from connections that were paused by
+ * connection_check_output()
+ */
+static void example_write_cb(struct bufferevent * bev, void * ptr)
+{
+    struct connection * connection = ptr;
+
+    if (connection->closing || !connection->reads_paused) {
+        return;
+    }
+
+    if (connection_output_depth(connection) >
+            connection->networker->write_low_watermark) {
+        return;
+    }
+
+    connection->reads_paused = false;
+    bufferevent_enable(bev, EV_READ);
+
+    /* input that arrived before the pause won't trigger another read
+     * callback on its own
+     */
+    if (evbuffer_get_length(bufferevent_get_input(bev)) > 0) {
+        connection_process(connection);
+    }
+}
+
+/* dummy event callback */
+static void example_event_cb(
+        struct bufferevent * bev, short events, void * ptr)
+{
+    (void)bev;
+    struct connection * connection = ptr;
+
+    if (events & BEV_EVENT_ERROR) {
+        connection->networker->errors++;
+        LOGF_ERROR(
+                connection->networker->logger,
+                "echo_event_cb() called for error %s\n",
+                strerror(errno)
+            );
+    }
+
+    if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        connection_close(connection);
+    }
+}
+
+/* evbuffer callback that counts the bytes received from a connection */
+static void connection_input_cb(
+        struct evbuffer * buffer,
+        const struct evbuffer_cb_info * info,
+        void * ptr
+    )
+{
+    (void)buffer;
+    (void)ptr;
+    if (info->n_added) {
+        metrics_count(METRIC_BYTES_IN, info->n_added);
+    }
+}
+
+/* evbuffer callback that counts the bytes written to a connection */
+static void connection_output_cb(
+        struct evbuffer * buffer,
+        const struct evbuffer_cb_info * info,
+        void * ptr
+    )
+{
+    (void)buffer;
+    (void)ptr;
+    if (info->n_deleted) {
+        metrics_count(METRIC_BYTES_OUT, info->n_deleted);
+    }
+}
+
+/* make a connection out of this (just accepted or connected) bufferevent
+ *
+ * returns false on error, in which case the caller still owns bev
+ */
+static bool networker_add_connection(
+        struct networker * networker,
+        struct bufferevent * bev
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct connection * connection = connection_create(networker, bev);
+
+    if (!connection) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] connection_create() failed\n"
+            );
+        return false;
+    }
+
+    bufferevent_setcb(
+            bev,
+            &example_read_cb,
+            &example_write_cb,
+            &example_event_cb,
+            connection
+        );
+    bufferevent_setwatermark(
+            bev,
+            EV_READ,
+            networker->read_low_watermark,
+            networker->read_high_watermark
+        );
+    bufferevent_setwatermark(
+            bev,
+            EV_WRITE,
+            networker->write_low_watermark,
+            0
+        );
+
+    if (!evbuffer_add_cb(
+                bufferevent_get_input(bev), &connection_input_cb, NULL) ||
+            !evbuffer_add_cb(
+                bufferevent_get_output(bev), &connection_output_cb, NULL)) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] evbuffer_add_cb() failed, connection %lu will "
+                "not be counted in metrics\n",
+                (unsigned long)connection->id
+            );
+    }
+
+    if (networker->connection_rate_limit &&
+            bufferevent_set_rate_limit(
+                bev, networker->connection_rate_limit)) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] bufferevent_set_rate_limit() failed\n"
+            );
+    }
+
+    if (networker->rate_limit_group &&
+            bufferevent_add_to_rate_limit_group(
+                bev, networker->rate_limit_group)) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] bufferevent_add_to_rate_limit_group() failed\n"
+            );
+    }
+
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+
+    struct evbuffer * output = bufferevent_get_output(bev);
+    evbuffer_add_printf(
+            output,
+            "[server] welcome, you are %lu\n",
+            (unsigned long)connection->id
+        );
+
+    return true;
+}
+
+/* listener callback creates connection objects for each new connection */
+static void networker_listener_accept_cb(
+        struct evconnlistener * listener,
+        evutil_socket_t sock,
+        struct sockaddr * addr,
+        int len,
+        void * ptr
+    )
+{
+    (void)len;
+    (void)addr;
+
+    struct networker * networker = ptr;
+    struct event_base * base = evconnlistener_get_base(listener);
+
+    metrics_count(METRIC_ACCEPTS, 1);
+
+    struct bufferevent * bev = bufferevent_socket_new(
+            base,
+            sock,
+            BEV_OPT_CLOSE_ON_FREE
+        );
+
+    if (!bev) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] bufferevent_socket_new() failed\n"
+            );
+        evutil_closesocket(sock);
+        return;
+    }
+
+    if (!networker_add_connection(networker, bev)) {
+        bufferevent_free(bev);
+    }
+}
+
+
+/* a connection to the admin socket */
+struct admin_connection {
+    struct networker * networker;
+    struct bufferevent * bev;
+
+    /* the admin hung up (or asked to), so this is destroyed as soon as its
+     * output has been written
+     */
+    bool closing;
+
+    /* the admin asked for a shutdown, which happens once the reply has been
+     * written (admin connections are the lowest priority, so exiting the
+     * eventloop right away would lose it)
+     */
+    bool shutting_down;
+
+    struct admin_connection * prev;
+    struct admin_connection * next;
+};
+
+/* destroy this admin connection and remove it from its networker */
+static void admin_connection_destroy(
+        struct admin_connection * admin) [[gnu::nonnull(1)]]
+{
+    if (admin->prev) {
+        admin->prev->next = admin->next;
+    } else {
+        admin->networker->admins = admin->next;
+    }
+    if (admin->next) {
+        admin->next->prev = admin->prev;
+    }
+
+    bufferevent_free(admin->bev);
+    free(admin);
+}
+
+/* destroy this finished admin connection, first exiting the eventloop if
+ * it asked for a shutdown
+ */
+static void admin_connection_done(
+        struct admin_connection * admin) [[gnu::nonnull(1)]]
+{
+    if (admin->shutting_down) {
+        event_base_loopexit(admin->networker->base, NULL);
+    }
+    admin_connection_destroy(admin);
+}
+
+/* stop reading from this admin connection, and destroy it once its output
+ * has been written (which may be right away)
+ */
+static void admin_connection_finish(
+        struct admin_connection * admin) [[gnu::nonnull(1)]]
+{
+    admin->closing = true;
+    bufferevent_disable(admin->bev, EV_READ);
+    if (evbuffer_get_length(bufferevent_get_output(admin->bev)) == 0) {
+        admin_connection_done(admin);
+    }
+}
+
+/* metrics_report() callback that writes each line to an evbuffer */
+static void admin_stats_cb(const char * line, void * ptr)
+{
+    evbuffer_add(ptr, line, strlen(line));
+}
+
+/* the stats admin command */
+static void admin_stats(
+        struct admin_connection * admin,
+        struct evbuffer * output
+    ) [[gnu::nonnull(1, 2)]]
+{
+    (void)admin;
+    metrics_report(&admin_stats_cb, output);
+}
+
+/* the connections admin command */
+static void admin_connections(
+        struct admin_connection * admin,
+        struct evbuffer * output
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct networker_connection_iter * iter =
+        networker_connection_iter_create(admin->networker);
+    if (!iter) {
+        evbuffer_add_printf(output, "error: out of memory\n");
+        return;
+    }
+
+    size_t n_connections = 0;
+    struct connection * connection;
+    while ((connection = networker_connection_iter_iterate(iter))) {
+        evbuffer_add_printf(
+                output,
+                "connection %zu input=%zu output=%zu\n",
+                connection_id(connection),
+                connection_input_depth(connection),
+                connection_output_depth(connection)
+            );
+        n_connections++;
+    }
+    networker_connection_iter_destroy(iter);
+
+    evbuffer_add_printf(output, "%zu connections\n", n_connections);
+}
+
+/* the reload admin command */
+static void admin_reload(
+        struct admin_connection * admin,
+        struct evbuffer * output
+    ) [[gnu::nonnull(1, 2)]]
+{
+    if (!admin->networker->game || !game_reload(admin->networker->game)) {
+        evbuffer_add_printf(output, "error: reload failed\n");
+        return;
+    }
+    evbuffer_add_printf(output, "reloaded\n");
+}
+
+/* the shutdown admin command */
+static void admin_shutdown(
+        struct admin_connection * admin,
+        struct evbuffer * output
+    ) [[gnu::nonnull(1, 2)]]
+{
+    LOGF_INFO(
+            admin->networker->logger,
+            "[networker] shutdown requested on the admin socket\n"
+        );
+    evbuffer_add_printf(output, "shutting down\n");
+    admin->shutting_down = true;
+    admin->closing = true;
+}
+
+/* the quit admin command */
+static void admin_quit(
+        struct admin_connection * admin,
+        struct evbuffer * output
+    ) [[gnu::nonnull(1, 2)]]
+{
+    (void)output;
+    admin->closing = true;
+}
+
+static void admin_help(
+        struct admin_connection * admin, struct evbuffer * output);
+
+/* the commands accepted on the admin socket, one per line */
+static const struct admin_command {
+    const char * name;
+    const char * help;
+    void (*fn)(struct admin_connection * admin, struct evbuffer * output);
+} admin_commands[] = {
+    { "stats", "report the metrics", &admin_stats },
+    { "connections", "list the connections", &admin_connections },
+    { "reload", "reload the card bundle", &admin_reload },
+    { "shutdown", "shut the server down", &admin_shutdown },
+    { "quit", "close this admin connection", &admin_quit },
+    { "help", "list the admin commands", &admin_help }
+};
+
+/* the help admin command */
+static void admin_help(
+        struct admin_connection * admin,
+        struct evbuffer * output
+    ) [[gnu::nonnull(1, 2)]]
+{
+    (void)admin;
+    for (size_t i = 0; i < sizeof(admin_commands) / sizeof(*admin_commands);
+            i++) {
+        evbuffer_add_printf(
+                output,
+                "%s - %s\n",
+                admin_commands[i].name,
+                admin_commands[i].help
+            );
+    }
+}
+
+/* run this line (which is modified) as an admin command */
+static void admin_connection_run(
+        struct admin_connection * admin,
+        char * line,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct evbuffer * output = bufferevent_get_output(admin->bev);
+
+    /* trim surrounding whitespace */
+    char * command = line;
+    while (*command == ' ' || *command == '\t') {
+        command++;
     }
+    char * end = line + length;
+    while (end > command && (end[-1] == ' ' || end[-1] == '\t')) {
+        end--;
+    }
+    *end = '\0';
 
-    const struct lexer_input * lexer_inputs =
-        (const struct lexer_input *)connection->vecs;
+    if (*command == '\0') {
+        return;
+    }
 
-    /* TODO cleanup */
-    /*
-    if (strncmp(line, "say ", 4) == 0) {
-        size_t n_connections = connection->networker->n_connections;
-        for (size_t i = 0; i < n_connections; i++) {
-            if (connection->networker->connections[i]) {
-                struct evbuffer * output = bufferevent_get_output(
-                        connection->networker->connections[i]->bev);
-                evbuffer_add_printf(output, "%s\n", &line[4]);
-            }
+    for (size_t i = 0; i < sizeof(admin_commands) / sizeof(*admin_commands);
+            i++) {
+        if (!evutil_ascii_strcasecmp(command, admin_commands[i].name)) {
+            admin_commands[i].fn(admin, output);
+            return;
         }
-        free(line);
-        continue;
     }
-    */
 
-    /* minimal lexing code for testing */
-    bool oom;
-    size_t index = lex(
-            lexer_inputs,
-            n_vecs_needed,
-            connection->parser->game->name_set,
-            connection->buffer,
-            &oom
-        );
+    evbuffer_add_printf(
+            output, "error: unknown command %s (try help)\n", command);
+}
 
-    if (oom) {
-        LOGF_ERROR(NULL, "lex() signaled a memory failure\n");
+/* run each complete line of this admin connection's input as a command,
+ * stopping early if one of them closes the connection
+ *
+ * at_eof means no more input is coming, so whatever follows the last
+ * newline is a command too
+ */
+static void admin_connection_process(
+        struct admin_connection * admin,
+        bool at_eof
+    ) [[gnu::nonnull(1)]]
+{
+    struct evbuffer * input = bufferevent_get_input(admin->bev);
+
+    char * line;
+    size_t length;
+    while (!admin->closing &&
+            (line = evbuffer_readln(input, &length, EVBUFFER_EOL_CRLF))) {
+        admin_connection_run(admin, line, length);
+        free(line);
     }
 
-    struct parse_result parse_result;
-    parser_parse(
-            connection->parser,
-            connection->buffer,
-            &parse_result
-        );
+    length = evbuffer_get_length(input);
+    if (admin->closing || length == 0) {
+        return;
+    }
 
-    bool exit = false;
-    for (size_t i = 0; i < connection->buffer->n_particles; i++) {
-        struct particle * particle = connection->buffer->particles[i];
-        if (particle->type == PARTICLE_KEYWORD) {
-            switch (particle->keyword) {
-                default:
-                    break;
-                case KEYWORD_SHUTDOWN:
-                    event_base_loopexit(connection->networker->base, NULL);
-                    break;
-                case KEYWORD_EXIT:
-                    exit = true;
-                    break;
-            }
-        }
-        if (exit) {
-            break;
-        }
+    if (length >= NETWORKER_ADMIN_LINE_LIMIT) {
+        evbuffer_add_printf(
+                bufferevent_get_output(admin->bev), "error: line too long\n");
+        admin->closing = true;
+        return;
     }
 
-    particle_buffer_free_all(connection->buffer);
-    /* ------------------------------- */
+    if (at_eof) {
+        char rest[NETWORKER_ADMIN_LINE_LIMIT];
+        evbuffer_remove(input, rest, length);
+        rest[length] = '\0';
+        admin_connection_run(admin, rest, length);
+    }
+}
 
-    if (evbuffer_drain(input, index)) {
-        LOGF_ERROR(
-                connection->networker->logger,
-                "evbuffer_drain() error\n"
-            );
+/* admin read callback */
+static void admin_read_cb(struct bufferevent * bev, void * ptr)
+{
+    (void)bev;
+    struct admin_connection * admin = ptr;
+    admin_connection_process(admin, false);
+    if (admin->closing) {
+        admin_connection_finish(admin);
     }
+}
 
-    if (exit) {
-        connection_destroy(connection);
+/* admin write callback, called once an admin connection's output has been
+ * written, which destroys the connections that are finished
+ */
+static void admin_write_cb(struct bufferevent * bev, void * ptr)
+{
+    (void)bev;
+    struct admin_connection * admin = ptr;
+    if (admin->closing) {
+        admin_connection_done(admin);
     }
 }
 
-/* dummy event callback */
-static void example_event_cb(
-        struct bufferevent * bev, short events, void * ptr)
+/* admin event callback */
+static void admin_event_cb(struct bufferevent * bev, short events, void * ptr)
 {
     (void)bev;
-    struct connection * connection = ptr;
+    struct admin_connection * admin = ptr;
 
     if (events & BEV_EVENT_ERROR) {
-        connection->networker->errors++;
-        LOGF_ERROR(
-                connection->networker->logger,
-                "echo_event_cb() called for error %s\n",
-                strerror(errno)
-            );
-    }
-
-    if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
-        connection_destroy(connection);
+        admin_connection_done(admin);
+    } else if (events & BEV_EVENT_EOF) {
+        admin_connection_process(admin, true);
+        admin_connection_finish(admin);
     }
 }
 
-/* listener callback creates connection objects for each new connection */
-static void networker_listener_accept_cb(
+/* admin listener callback, which creates an admin_connection for each new
+ * connection to the admin socket
+ */
+static void networker_admin_accept_cb(
         struct evconnlistener * listener,
         evutil_socket_t sock,
         struct sockaddr * addr,
@@ -277,18 +1583,138 @@ static void networker_listener_accept_cb(
             BEV_OPT_CLOSE_ON_FREE
         );
 
-    struct connection * connection = connection_create(networker, bev);
+    if (!bev) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] bufferevent_socket_new() failed\n"
+            );
+        evutil_closesocket(sock);
+        return;
+    }
+
+    struct admin_connection * admin = malloc(sizeof(*admin));
+    if (!admin) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] failed to allocate an admin connection\n"
+            );
+        bufferevent_free(bev);
+        return;
+    }
 
+    *admin = (struct admin_connection) {
+        .networker = networker,
+        .bev = bev,
+        .next = networker->admins
+    };
+    if (networker->admins) {
+        networker->admins->prev = admin;
+    }
+    networker->admins = admin;
+
+    bufferevent_priority_set(bev, NETWORKER_PRIORITY_ADMIN);
     bufferevent_setcb(
-            bev, &example_read_cb, NULL, &example_event_cb, connection);
+            bev,
+            &admin_read_cb,
+            &admin_write_cb,
+            &admin_event_cb,
+            admin
+        );
+    bufferevent_setwatermark(bev, EV_READ, 0, NETWORKER_ADMIN_LINE_LIMIT);
     bufferevent_enable(bev, EV_READ | EV_WRITE);
+}
 
-    struct evbuffer * output = bufferevent_get_output(bev);
-    evbuffer_add_printf(
-            output,
-            "[server] welcome, you are %lu\n",
-            (unsigned long)connection->id
+#if !defined(__MINGW32__)
+/* start listening for admin connections on the unix domain socket at path,
+ * returning false on failure
+ */
+static bool networker_admin_listen(
+        struct networker * networker,
+        const char * path
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct sockaddr_un sun = (struct sockaddr_un) {
+        .sun_family = AF_UNIX
+    };
+
+    if (strlen(path) >= sizeof(sun.sun_path)) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] config.admin_socket is too long\n"
+            );
+        return false;
+    }
+    strcpy(sun.sun_path, path);
+
+    /* a socket left behind by a server that didn't exit cleanly would make
+     * the bind fail, but anything else at path is not ours to remove
+     */
+    struct stat st;
+    if (!lstat(path, &st)) {
+        if (!S_ISSOCK(st.st_mode)) {
+            LOGF_ERROR(
+                    networker->logger,
+                    "[networker] config.admin_socket %s exists and is not a "
+                    "socket\n",
+                    path
+                );
+            return false;
+        }
+        unlink(path);
+    }
+
+    networker->admin_socket = util_strdup(path);
+    if (!networker->admin_socket) {
+        return false;
+    }
+
+    /* create the socket without any permissions for group or other, so that
+     * only the user the server runs as can connect to it
+     */
+    mode_t mask = umask(0077);
+    networker->admin_listener = evconnlistener_new_bind(
+            networker->base,
+            &networker_admin_accept_cb,
+            networker,
+            LEV_OPT_CLOSE_ON_FREE | LEV_OPT_CLOSE_ON_EXEC,
+            -1,
+            (struct sockaddr *)&sun, sizeof(sun)
+        );
+    umask(mask);
+
+    if (!networker->admin_listener) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] evconnlistener_new_bind() failed for the admin "
+                "socket %s\n",
+                path
+            );
+        free(networker->admin_socket);
+        networker->admin_socket = NULL;
+        return false;
+    }
+
+    LOGF_INFO(
+            networker->logger,
+            "[networker] accepting admin commands on %s\n",
+            path
         );
+    return true;
+}
+#endif /* __MINGW32__ */
+
+/* timer callback that advances the networker's timer wheel (and does the
+ * game's housekeeping) once a second
+ */
+static void networker_tick_cb(evutil_socket_t fd, short events, void * ptr)
+{
+    (void)fd;
+    (void)events;
+    struct networker * networker = ptr;
+    timer_wheel_tick(networker->timers);
+    if (networker->game) {
+        game_maintain(networker->game);
+    }
 }
 
 /* listener error callback exits the eventloop on listener error */
@@ -309,6 +1735,20 @@ static void networker_listener_error_cb(
     event_base_loopexit(base, NULL);
 }
 
+/* returns a new token bucket config limiting reads to rate bytes per second
+ * with this burst (see config.h), or NULL on failure
+ */
+[[nodiscard]] static struct ev_token_bucket_cfg * read_rate_limit_create(
+        long rate, long burst)
+{
+    if (burst < rate) {
+        burst = rate;
+    }
+
+    return ev_token_bucket_cfg_new(
+            rate, burst, EV_RATE_LIMIT_MAX, EV_RATE_LIMIT_MAX, NULL);
+}
+
 /* reutrn a new networker based on config and holding game */
 [[nodiscard]] struct networker * networker_create(
         struct config * config) [[gnu::nonnull(1)]]
@@ -331,6 +1771,38 @@ static void networker_listener_error_cb(
         .sin_port = htons(port)
     };
 
+    if (config->handshake_timeout < 0 || config->lobby_timeout < 0) {
+        LOGF_ERROR(
+                config->logger,
+                "[networker] config timeouts must not be negative\n"
+            );
+        return NULL;
+    }
+
+    if (config->read_low_watermark < 0 || config->read_high_watermark < 0 ||
+            config->write_low_watermark < 0 ||
+            config->write_high_watermark < 0 ||
+            config->output_limit < 0 || config->input_limit < 0) {
+        LOGF_ERROR(
+                config->logger,
+                "[networker] config watermarks and limits must not be "
+                "negative\n"
+            );
+        return NULL;
+    }
+
+    if (config->commands_per_second < 0 || config->command_burst < 0 ||
+            config->commands_per_turn < 0 ||
+            config->bytes_per_second < 0 || config->byte_burst < 0 ||
+            config->server_bytes_per_second < 0 ||
+            config->server_byte_burst < 0) {
+        LOGF_ERROR(
+                config->logger,
+                "[networker] config rate limits must not be negative\n"
+            );
+        return NULL;
+    }
+
     struct networker * networker = malloc(sizeof(*networker));
     if (!networker) {
         return NULL;
@@ -338,15 +1810,59 @@ static void networker_listener_error_cb(
 
     *networker = (struct networker) {
         .logger = config->logger,
+        .read_low_watermark = config->read_low_watermark,
+        .read_high_watermark = config->read_high_watermark,
+        .write_low_watermark = config->write_low_watermark,
+        .write_high_watermark = config->write_high_watermark,
+        .output_limit = config->output_limit,
+        .input_limit = config->input_limit,
+        .handshake_timeout = config->handshake_timeout,
+        .lobby_timeout = config->lobby_timeout,
+        .commands_per_second = config->commands_per_second,
+        .commands_per_turn = config->commands_per_turn,
+        .command_burst = config->command_burst > config->commands_per_second ?
+            config->command_burst : config->commands_per_second,
         .game = game_create(config)
     };
 
     networker->base = event_base_new();
-    if (!networker->base) {
+    if (!networker->base ||
+            event_base_priority_init(networker->base, NETWORKER_PRIORITIES)) {
         LOGF_ERROR(
                 networker->logger,
                 "[networker] event_base_new() failed\n"
             );
+        if (networker->base) {
+            event_base_free(networker->base);
+        }
+        free(networker);
+        return NULL;
+    }
+
+    networker->timers = timer_wheel_create(
+            NETWORKER_TIMER_WHEEL_SLOTS_DEFAULT);
+    networker->tick_event = event_new(
+            networker->base,
+            -1,
+            EV_PERSIST,
+            &networker_tick_cb,
+            networker
+        );
+
+    struct timeval tick = (struct timeval) { .tv_sec = 1 };
+    if (!networker->timers || !networker->tick_event ||
+            event_add(networker->tick_event, &tick)) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] failed to set up the connection timer\n"
+            );
+        if (networker->tick_event) {
+            event_free(networker->tick_event);
+        }
+        if (networker->timers) {
+            timer_wheel_destroy(networker->timers);
+        }
+        event_base_free(networker->base);
         free(networker);
         return NULL;
     }
@@ -365,6 +1881,8 @@ static void networker_listener_error_cb(
                 networker->logger,
                 "[networker] evconnlistener_new_bind() failed\n"
             );
+        event_free(networker->tick_event);
+        timer_wheel_destroy(networker->timers);
         event_base_free(networker->base);
         free(networker);
         return NULL;
@@ -375,6 +1893,51 @@ static void networker_listener_error_cb(
             &networker_listener_error_cb
         );
 
+    if (config->bytes_per_second > 0) {
+        networker->connection_rate_limit = read_rate_limit_create(
+                config->bytes_per_second, config->byte_burst);
+        if (!networker->connection_rate_limit) {
+            LOGF_ERROR(
+                    networker->logger,
+                    "[networker] ev_token_bucket_cfg_new() failed\n"
+                );
+            networker_destroy(networker);
+            return NULL;
+        }
+    }
+
+    if (config->server_bytes_per_second > 0) {
+        networker->server_rate_limit = read_rate_limit_create(
+                config->server_bytes_per_second, config->server_byte_burst);
+        if (networker->server_rate_limit) {
+            networker->rate_limit_group = bufferevent_rate_limit_group_new(
+                    networker->base, networker->server_rate_limit);
+        }
+        if (!networker->rate_limit_group) {
+            LOGF_ERROR(
+                    networker->logger,
+                    "[networker] failed to create the server rate limit\n"
+                );
+            networker_destroy(networker);
+            return NULL;
+        }
+    }
+
+    if (config->admin_socket && config->admin_socket[0]) {
+#if defined(__MINGW32__)
+        LOGF_INFO(
+                networker->logger,
+                "[networker] admin sockets are not supported on this "
+                "platform, ignoring config.admin_socket\n"
+            );
+#else
+        if (!networker_admin_listen(networker, config->admin_socket)) {
+            networker_destroy(networker);
+            return NULL;
+        }
+#endif /* __MINGW32__ */
+    }
+
     return networker;
 }
 
@@ -382,24 +1945,160 @@ static void networker_listener_error_cb(
 void networker_destroy(struct networker * networker) [[gnu::nonnull(1)]]
 {
     evconnlistener_free(networker->listener);
+    event_free(networker->tick_event);
+    if (networker->admin_listener) {
+        evconnlistener_free(networker->admin_listener);
+    }
+    while (networker->admins) {
+        admin_connection_destroy(networker->admins);
+    }
+#if !defined(__MINGW32__)
+    if (networker->admin_socket) {
+        unlink(networker->admin_socket);
+    }
+#endif /* __MINGW32__ */
+    free(networker->admin_socket);
     for (size_t n = 0; n < networker->n_connections; n++) {
         if (networker->connections[n]) {
             connection_destroy(networker->connections[n]);
         }
     }
     free(networker->connections);
+    if (networker->rate_limit_group) {
+        bufferevent_rate_limit_group_free(networker->rate_limit_group);
+    }
+    if (networker->server_rate_limit) {
+        ev_token_bucket_cfg_free(networker->server_rate_limit);
+    }
+    if (networker->connection_rate_limit) {
+        ev_token_bucket_cfg_free(networker->connection_rate_limit);
+    }
+    timer_wheel_destroy(networker->timers);
     event_base_free(networker->base);
     game_destroy(networker->game);
     free(networker);
 }
 
-/* run the eventloop of this networker */
+/* attach this message to the output of every connection
+ *
+ * the message is not copied: each connection's output holds a reference to
+ * it (see refstring_dup()) which is released once that output has been
+ * written, so broadcasting to N connections costs N pointer appends rather
+ * than N copies. the caller keeps its own reference and must still call
+ * refstring_destroy() on it.
+ */
+void networker_broadcast(
+        struct networker * networker,
+        struct refstring * message
+    ) [[gnu::nonnull(1, 2)]]
+{
+    if (refstring_is_null_refstring(message)) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] refusing to broadcast the null refstring\n"
+            );
+        return;
+    }
+
+    for (size_t n = 0; n < networker->n_connections; n++) {
+        struct connection * connection = networker->connections[n];
+        if (!connection) {
+            continue;
+        }
+        connection_send_reference(connection, message);
+    }
+}
+
+/* format a message once and broadcast it (see networker_broadcast()) */
+void networker_broadcastf(
+        struct networker * networker,
+        const char * format,
+        ...
+    ) [[gnu::nonnull(1, 2)]]
+{
+    va_list args;
+    va_start(args, format);
+    struct refstring * message = refstring_createv(format, args);
+    va_end(args);
+
+    networker_broadcast(networker, message);
+    refstring_destroy(message);
+}
+
+/* metrics_report() callback that logs each line */
+static void networker_metrics_cb(const char * line, void * ptr)
+{
+    struct networker * networker = ptr;
+    LOGF_INFO(networker->logger, "[metrics] %s", line);
+}
+
+/* run the eventloop of this networker, logging the metrics once it exits */
 int networker_run(struct networker * networker) [[gnu::nonnull(1)]]
 {
     event_base_dispatch(networker->base);
+    metrics_report(&networker_metrics_cb, networker);
     return networker->errors;
 }
 
+/* returns this networker's event base */
+struct event_base * networker_base(
+        struct networker * networker) [[gnu::nonnull(1)]]
+{
+    return networker->base;
+}
+
+/* connect an in-process client to this networker over a bufferevent pair */
+[[nodiscard]] struct bufferevent * networker_connect_pair(
+        struct networker * networker) [[gnu::nonnull(1)]]
+{
+    struct bufferevent * pair[2];
+    if (bufferevent_pair_new(
+                networker->base,
+                BEV_OPT_CLOSE_ON_FREE | BEV_OPT_DEFER_CALLBACKS,
+                pair
+            )) {
+        LOGF_ERROR(
+                networker->logger,
+                "[networker] bufferevent_pair_new() failed\n"
+            );
+        return NULL;
+    }
+
+    metrics_count(METRIC_ACCEPTS, 1);
+
+    if (!networker_add_connection(networker, pair[0])) {
+        bufferevent_free(pair[0]);
+        bufferevent_free(pair[1]);
+        return NULL;
+    }
+
+    return pair[1];
+}
+
+/* returns the id of this connection */
+size_t connection_id(struct connection * connection) [[gnu::nonnull(1)]]
+{
+    return connection->id;
+}
+
+/* returns the number of bytes received from this connection that have not
+ * been processed yet
+ */
+size_t connection_input_depth(
+        struct connection * connection) [[gnu::nonnull(1)]]
+{
+    return evbuffer_get_length(bufferevent_get_input(connection->bev));
+}
+
+/* returns the number of bytes queued for this connection that have not been
+ * written yet
+ */
+size_t connection_output_depth(
+        struct connection * connection) [[gnu::nonnull(1)]]
+{
+    return evbuffer_get_length(bufferevent_get_output(connection->bev));
+}
+
 /* returns a new iterator over the networker's connections */
 [[nodiscard]] struct networker_connection_iter * networker_connection_iter_create(
         struct networker * networker) [[gnu::nonnull(1)]]
@@ -426,12 +2125,13 @@ void networker_connection_iter_destroy(
 struct connection * networker_connection_iter_iterate(
         struct networker_connection_iter * iter) [[gnu::nonnull(1)]]
 {
-    if (iter->index >= iter->networker->n_connections) {
-        return NULL;
+    while (iter->index < iter->networker->n_connections &&
+            !iter->networker->connections[iter->index]) {
+        iter->index++;
     }
 
-    while (!iter->networker->connections[iter->index]) {
-        iter->index++;
+    if (iter->index >= iter->networker->n_connections) {
+        return NULL;
     }
 
     struct connection * connection = iter->networker->connections[iter->index];
@@ -0,0 +1,730 @@
+/* File: src/test/bench.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "command/lex.h"
+#include "game_state.h"
+#include "name_set.h"
+#include "util/sorted_set.h"
+#include "hash.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* microbenchmarks for lex(), name_set_lookup() and name_set_suggest(), the
+ * sorted_set, the hash, and resolving attacks in a game_state
+ *
+ * every benchmark runs --warmup untimed iterations and then --iterations
+ * timed ones, and reports the mean, standard deviation, and minimum time per
+ * unit (byte, token, lookup, ...) over the timed ones. the keys are random
+ * but generated from --seed, and the lexer corpus is a file (see
+ * misc/make_lex_test.sh), so runs with the same arguments are comparable.
+ *
+ * --json writes the results where misc/compare_benchmarks.py can compare
+ * them against an earlier run.
+ */
+
+/* the most timed iterations a benchmark will run */
+#ifndef BENCH_ITERATIONS_MAX
+#define BENCH_ITERATIONS_MAX 1000
+#endif /* BENCH_ITERATIONS_MAX */
+
+/* the lengths of the random keys */
+#ifndef BENCH_KEY_LENGTH_MIN
+#define BENCH_KEY_LENGTH_MIN 4
+#endif /* BENCH_KEY_LENGTH_MIN */
+
+#ifndef BENCH_KEY_LENGTH_MAX
+#define BENCH_KEY_LENGTH_MAX 24
+#endif /* BENCH_KEY_LENGTH_MAX */
+
+/* the most keys name_set_suggest() is timed with (it's much slower than a
+ * lookup, so not every key)
+ */
+#ifndef BENCH_SUGGESTIONS_MAX
+#define BENCH_SUGGESTIONS_MAX 1000
+#endif /* BENCH_SUGGESTIONS_MAX */
+
+/* the number of characters each of the two players has on the field in the
+ * game_state benchmarks
+ */
+#ifndef BENCH_BOARD_DEFAULT
+#define BENCH_BOARD_DEFAULT 4096
+#endif /* BENCH_BOARD_DEFAULT */
+
+/* the results of one benchmark */
+struct result {
+    const char * name; /* e.g. "lex/byte", which is per byte */
+    size_t units; /* the number of units timed per iteration */
+    size_t n_samples;
+    double samples[BENCH_ITERATIONS_MAX]; /* ns per unit */
+};
+
+/* the arguments */
+static struct {
+    const char * corpus;
+    const char * json;
+    size_t keys;
+    size_t attacks;
+    size_t iterations;
+    size_t warmup;
+    uint64_t seed;
+} args = {
+    .keys = 100000,
+    .attacks = 1000000,
+    .iterations = 20,
+    .warmup = 3,
+    .seed = 1
+};
+
+static struct result results[16];
+static size_t n_results = 0;
+
+static uint64_t now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* xorshift64*, so that keys don't depend on the libc's rand() */
+static uint64_t random_next(uint64_t * state) [[gnu::nonnull(1)]]
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1d;
+}
+
+/* a set of random keys */
+struct keys {
+    char ** keys;
+    size_t * lengths;
+    size_t n_keys;
+};
+
+/* generate n distinct-enough random lowercase keys from this seed */
+static bool keys_create(
+        struct keys * keys, size_t n, uint64_t seed) [[gnu::nonnull(1)]]
+{
+    uint64_t state = seed ? seed : 1;
+    *keys = (struct keys) {
+        .keys = calloc(n, sizeof(*keys->keys)),
+        .lengths = calloc(n, sizeof(*keys->lengths)),
+        .n_keys = n
+    };
+    if (!keys->keys || !keys->lengths) {
+        return false;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        size_t length = BENCH_KEY_LENGTH_MIN + random_next(&state) %
+            (BENCH_KEY_LENGTH_MAX - BENCH_KEY_LENGTH_MIN + 1);
+        keys->keys[i] = malloc(length + 1);
+        if (!keys->keys[i]) {
+            return false;
+        }
+        for (size_t j = 0; j < length; j++) {
+            keys->keys[i][j] = 'a' + random_next(&state) % 26;
+        }
+        keys->keys[i][length] = '\0';
+        keys->lengths[i] = length;
+    }
+    return true;
+}
+
+static void keys_destroy(struct keys * keys) [[gnu::nonnull(1)]]
+{
+    for (size_t i = 0; keys->keys && i < keys->n_keys; i++) {
+        free(keys->keys[i]);
+    }
+    free(keys->keys);
+    free(keys->lengths);
+}
+
+/* start a new result */
+static struct result * result_create(
+        const char * name, size_t units) [[gnu::nonnull(1)]]
+{
+    struct result * result = &results[n_results++];
+    *result = (struct result) {
+        .name = name,
+        .units = units
+    };
+    return result;
+}
+
+/* record an iteration that took ns, unless it's a warmup iteration */
+static void result_add(
+        struct result * result,
+        size_t iteration,
+        uint64_t ns
+    ) [[gnu::nonnull(1)]]
+{
+    if (iteration < args.warmup || result->units == 0) {
+        return;
+    }
+    result->samples[result->n_samples++] = (double)ns / result->units;
+}
+
+static double result_mean(const struct result * result) [[gnu::nonnull(1)]]
+{
+    double sum = 0;
+    for (size_t i = 0; i < result->n_samples; i++) {
+        sum += result->samples[i];
+    }
+    return result->n_samples ? sum / result->n_samples : 0;
+}
+
+static double result_stddev(
+        const struct result * result) [[gnu::nonnull(1)]]
+{
+    if (result->n_samples < 2) {
+        return 0;
+    }
+    double mean = result_mean(result);
+    double sum = 0;
+    for (size_t i = 0; i < result->n_samples; i++) {
+        sum += (result->samples[i] - mean) * (result->samples[i] - mean);
+    }
+    return sqrt(sum / (result->n_samples - 1));
+}
+
+static double result_min(const struct result * result) [[gnu::nonnull(1)]]
+{
+    double min = result->n_samples ? result->samples[0] : 0;
+    for (size_t i = 1; i < result->n_samples; i++) {
+        if (result->samples[i] < min) {
+            min = result->samples[i];
+        }
+    }
+    return min;
+}
+
+/* lex the whole corpus, per byte and per token */
+static bool bench_lex()
+{
+    FILE * file = fopen(args.corpus, "rb");
+    if (!file) {
+        fprintf(stderr, "could not open corpus %s\n", args.corpus);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t * input = malloc(size > 0 ? size : 1);
+    if (!input || fread(input, 1, size, file) != (size_t)size) {
+        fprintf(stderr, "could not read corpus %s\n", args.corpus);
+        free(input);
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+
+    struct name_set * name_set = name_set_create();
+    struct particle_buffer * buffer = particle_buffer_create();
+    if (!name_set || !buffer) {
+        return false;
+    }
+
+    struct result * bytes = NULL;
+    struct result * tokens = NULL;
+    for (size_t i = 0; i < args.warmup + args.iterations; i++) {
+        bool oom = false;
+        uint64_t start = now();
+        size_t consumed = lex(
+                &(struct lexer_input) { .input = input, .length = size },
+                1,
+                name_set,
+                buffer,
+                &oom
+            );
+        uint64_t elapsed = now() - start;
+
+        if (!bytes) {
+            bytes = result_create("lex/byte", consumed);
+            tokens = result_create("lex/token", buffer->n_particles);
+        }
+        result_add(bytes, i, elapsed);
+        result_add(tokens, i, elapsed);
+        particle_buffer_free_all(buffer);
+    }
+
+    particle_buffer_destroy(buffer);
+    name_set_destroy(name_set);
+    free(input);
+    return true;
+}
+
+/* name_set_lookup() of every key (hits) and of as many other keys (misses)
+ * in a compiled name_set, name_set_lookup_types() of every key for the wrong
+ * type, and name_set_suggest() of some of the keys with a typo
+ */
+static bool bench_name_set(
+        const struct keys * keys,
+        const struct keys * misses
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct name_set * name_set = name_set_create();
+    if (!name_set) {
+        return false;
+    }
+    /* players, since they have no data for name_set_destroy() to free */
+    for (size_t i = 0; i < keys->n_keys; i++) {
+        bool oom = false;
+        name_set_add(
+                name_set,
+                (const uint8_t *)keys->keys[i],
+                keys->lengths[i],
+                NULL,
+                NAME_TYPE_PLAYER,
+                &oom
+            );
+    }
+    name_set_compile(name_set);
+
+    struct result * hits = result_create("name_set/hit", keys->n_keys);
+    struct result * miss = result_create("name_set/miss", misses->n_keys);
+    struct result * wrong_type =
+        result_create("name_set/wrong_type", keys->n_keys);
+    size_t found = 0;
+    for (size_t i = 0; i < args.warmup + args.iterations; i++) {
+        bool oom = false;
+        uint64_t start = now();
+        for (size_t j = 0; j < keys->n_keys; j++) {
+            found += !!name_set_lookup(
+                    name_set,
+                    (const uint8_t *)keys->keys[j],
+                    keys->lengths[j],
+                    &oom
+                );
+        }
+        uint64_t middle = now();
+        for (size_t j = 0; j < misses->n_keys; j++) {
+            found += !!name_set_lookup(
+                    name_set,
+                    (const uint8_t *)misses->keys[j],
+                    misses->lengths[j],
+                    &oom
+                );
+        }
+        uint64_t end = now();
+        for (size_t j = 0; j < keys->n_keys; j++) {
+            found += !name_set_lookup_types(
+                    name_set,
+                    (const uint8_t *)keys->keys[j],
+                    keys->lengths[j],
+                    NAME_TYPE_BIT(NAME_TYPE_ABILITY),
+                    &oom
+                );
+        }
+        result_add(hits, i, middle - start);
+        result_add(miss, i, end - middle);
+        result_add(wrong_type, i, now() - end);
+    }
+
+    /* the first few keys, each with one letter changed */
+    size_t n_typos = keys->n_keys < BENCH_SUGGESTIONS_MAX ?
+        keys->n_keys : BENCH_SUGGESTIONS_MAX;
+    char (* typos)[BENCH_KEY_LENGTH_MAX] = malloc(sizeof(*typos) * n_typos);
+    if (!typos) {
+        name_set_destroy(name_set);
+        return false;
+    }
+    for (size_t i = 0; i < n_typos; i++) {
+        memcpy(typos[i], keys->keys[i], keys->lengths[i]);
+        size_t j = i % keys->lengths[i];
+        typos[i][j] = 'a' + (typos[i][j] - 'a' + 1) % 26;
+    }
+
+    struct result * suggest = result_create("name_set/suggest", n_typos);
+    size_t suggested = 0;
+    for (size_t i = 0; i < args.warmup + args.iterations; i++) {
+        bool oom = false;
+        struct name * name;
+        uint64_t start = now();
+        for (size_t j = 0; j < n_typos; j++) {
+            suggested += name_set_suggest(
+                    name_set,
+                    (const uint8_t *)typos[j],
+                    keys->lengths[j],
+                    1,
+                    &name,
+                    1,
+                    &oom
+                );
+        }
+        result_add(suggest, i, now() - start);
+    }
+
+    free(typos);
+    name_set_destroy(name_set);
+    return found > 0 && (n_typos == 0 || suggested > 0);
+}
+
+/* copy these keys, since the sorted_set and hash take ownership of them */
+static char ** keys_copy(const struct keys * keys) [[gnu::nonnull(1)]]
+{
+    char ** copy = malloc(sizeof(*copy) * keys->n_keys);
+    if (!copy) {
+        return NULL;
+    }
+    for (size_t i = 0; i < keys->n_keys; i++) {
+        copy[i] = malloc(keys->lengths[i] + 1);
+        if (!copy[i]) {
+            return NULL;
+        }
+        memcpy(copy[i], keys->keys[i], keys->lengths[i] + 1);
+    }
+    return copy;
+}
+
+/* sorted_set_add_key() every key into an empty set and then
+ * sorted_set_lookup() every key
+ */
+static bool bench_sorted_set(const struct keys * keys) [[gnu::nonnull(1)]]
+{
+    struct result * insert = result_create("sorted_set/add", keys->n_keys);
+    struct result * lookup = result_create("sorted_set/lookup", keys->n_keys);
+    size_t found = 0;
+
+    for (size_t i = 0; i < args.warmup + args.iterations; i++) {
+        struct sorted_set * sorted_set = sorted_set_create();
+        char ** copy = keys_copy(keys);
+        if (!sorted_set || !copy) {
+            return false;
+        }
+
+        uint64_t start = now();
+        for (size_t j = 0; j < keys->n_keys; j++) {
+            if (sorted_set_add_key(
+                        sorted_set, copy[j], keys->lengths[j], NULL) !=
+                    SORTED_SET_ADD_KEY_UNIQUE) {
+                free(copy[j]);
+            }
+        }
+        uint64_t middle = now();
+        for (size_t j = 0; j < keys->n_keys; j++) {
+            found += !!sorted_set_lookup(
+                    sorted_set, keys->keys[j], keys->lengths[j]);
+        }
+        uint64_t end = now();
+
+        result_add(insert, i, middle - start);
+        result_add(lookup, i, end - middle);
+        free(copy);
+        sorted_set_destroy(sorted_set);
+    }
+
+    return found > 0;
+}
+
+/* hash_create() from every key and then hash_lookup() every key */
+static bool bench_hash(const struct keys * keys) [[gnu::nonnull(1)]]
+{
+    struct result * create = result_create("hash/create", keys->n_keys);
+    struct result * lookup = result_create("hash/lookup", keys->n_keys);
+    size_t found = 0;
+
+    for (size_t i = 0; i < args.warmup + args.iterations; i++) {
+        struct hash_inputs * hash_inputs = hash_inputs_create();
+        if (!hash_inputs) {
+            return false;
+        }
+        hash_inputs_at_least(hash_inputs, keys->n_keys);
+        for (size_t j = 0; j < keys->n_keys; j++) {
+            hash_inputs_add_safe(
+                    hash_inputs, keys->keys[j], keys->lengths[j], NULL);
+        }
+
+        uint64_t start = now();
+        struct hash * hash = hash_create(hash_inputs);
+        uint64_t middle = now();
+        hash_inputs_destroy(hash_inputs);
+        if (!hash) {
+            fprintf(stderr, "hash_create() failed\n");
+            return false;
+        }
+
+        uint64_t lookup_start = now();
+        for (size_t j = 0; j < keys->n_keys; j++) {
+            found += !!hash_lookup(hash, keys->keys[j], keys->lengths[j]);
+        }
+        uint64_t end = now();
+
+        result_add(create, i, middle - start);
+        result_add(lookup, i, end - lookup_start);
+        hash_destroy(hash);
+    }
+
+    return found > 0;
+}
+
+/* the character zone the bench_game_state() character with this id is in,
+ * so that each player's zones have 16 characters
+ */
+static uint16_t bench_zone(uint32_t id)
+{
+    return 1 + id / 2 % (BENCH_BOARD_DEFAULT / 16);
+}
+
+/* game_state_attack() between random characters of two players (each of
+ * which, when destroyed, is put straight back on the field so the board
+ * stays full), game_state_damage_all() of every character, and
+ * game_state_count() of the face down characters in each zone
+ */
+static bool bench_game_state()
+{
+    struct game_state * state = game_state_create();
+    uint32_t * attackers = malloc(sizeof(*attackers) * args.attacks);
+    uint32_t * defenders = malloc(sizeof(*defenders) * args.attacks);
+    if (!state || !attackers || !defenders) {
+        return false;
+    }
+
+    /* the players' characters alternate, with every other pair in defense
+     * mode, and one in four of the pairs in attack mode equipped
+     */
+    uint64_t random = args.seed ? args.seed : 1;
+    for (size_t i = 0; i < 2 * BENCH_BOARD_DEFAULT; i++) {
+        struct game_stats stats = {
+            .attack = 1 + random_next(&random) % 9,
+            .attack_defense = 1 + random_next(&random) % 9,
+            .defense_defense = 1 + random_next(&random) % 9,
+            .hp = 2 + random_next(&random) % 19,
+            .range = random_next(&random) % 3
+        };
+        uint32_t id = game_state_add(
+                state, NULL, GAME_CARD_CHARACTER, &stats, i % 2,
+                GAME_ZONE_FIELD, bench_zone(i));
+        if (id == GAME_STATE_NO_INSTANCE) {
+            return false;
+        }
+        game_state_set_flags(state, id, GAME_INSTANCE_FACE_UP, true);
+        game_state_set_flags(
+                state, id, GAME_INSTANCE_DEFENSE_MODE, i / 2 % 2);
+    }
+    for (size_t i = 0; i < 2 * BENCH_BOARD_DEFAULT; i += 8) {
+        for (uint32_t character = i; character < i + 2; character++) {
+            struct game_stats stats = { .attack = 1, .defense_defense = 1 };
+            uint32_t id = game_state_add(
+                    state, NULL, GAME_CARD_EQUIPMENT, &stats, character % 2,
+                    GAME_ZONE_SPECIAL, 0);
+            if (id == GAME_STATE_NO_INSTANCE ||
+                    !game_state_attach(state, id, character)) {
+                return false;
+            }
+        }
+    }
+
+    /* each player attacks in turn, with a character in attack mode */
+    for (size_t i = 0; i < args.attacks; i++) {
+        uint32_t player = i % 2;
+        attackers[i] = 4 * (random_next(&random) % (BENCH_BOARD_DEFAULT / 2))
+            + player;
+        defenders[i] = 2 * (random_next(&random) % BENCH_BOARD_DEFAULT)
+            + !player;
+    }
+
+    struct result * attack = result_create("game_state/attack", args.attacks);
+    struct result * sweep = result_create(
+            "game_state/damage_all", 2 * 2 * BENCH_BOARD_DEFAULT);
+    struct result * count = result_create(
+            "game_state/count", 2 * (BENCH_BOARD_DEFAULT / 16));
+    size_t destroyed = 0;
+    size_t counted = 0;
+    for (size_t i = 0; i < args.warmup + args.iterations; i++) {
+        uint64_t start = now();
+        for (size_t j = 0; j < args.attacks; j++) {
+            uint32_t loser;
+            switch (game_state_attack(state, attackers[j], defenders[j])) {
+                case GAME_ATTACK_DEFENDER_DESTROYED:
+                    loser = defenders[j];
+                    break;
+                case GAME_ATTACK_ATTACKER_DESTROYED:
+                    loser = attackers[j];
+                    break;
+                default:
+                    continue;
+            }
+            destroyed++;
+            game_state_move(
+                    state, loser, GAME_ZONE_FIELD, bench_zone(loser));
+        }
+        uint64_t middle = now();
+        for (uint8_t owner = 0; owner < 2; owner++) {
+            destroyed += game_state_damage_all(state, owner, 1);
+            destroyed += game_state_damage_all(state, owner, -1);
+        }
+        uint64_t end = now();
+        for (uint8_t owner = 0; owner < 2; owner++) {
+            for (uint16_t zone = 1; zone <= BENCH_BOARD_DEFAULT / 16;
+                    zone++) {
+                counted += game_state_count(state, &(struct game_query) {
+                            .owner = owner,
+                            .zone = GAME_ZONE_FIELD,
+                            .zone_number = zone,
+                            .characters = true,
+                            .flags_mask = GAME_INSTANCE_FACE_UP
+                        });
+            }
+        }
+
+        result_add(attack, i, middle - start);
+        result_add(sweep, i, end - middle);
+        result_add(count, i, now() - end);
+    }
+
+    free(attackers);
+    free(defenders);
+    game_state_destroy(state);
+    return destroyed > 0 && counted <= 2 * BENCH_BOARD_DEFAULT;
+}
+
+static void print_results()
+{
+    printf("%-20s %12s %12s %12s %12s\n",
+            "benchmark", "units", "mean ns", "stddev", "min ns");
+    for (size_t i = 0; i < n_results; i++) {
+        const struct result * result = &results[i];
+        printf("%-20s %12zu %12.2f %12.2f %12.2f\n",
+                result->name,
+                result->units,
+                result_mean(result),
+                result_stddev(result),
+                result_min(result)
+            );
+    }
+}
+
+static bool write_json(const char * path) [[gnu::nonnull(1)]]
+{
+    FILE * file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "could not open %s\n", path);
+        return false;
+    }
+
+    fprintf(file,
+            "{\n"
+            "  \"seed\": %llu,\n"
+            "  \"keys\": %zu,\n"
+            "  \"attacks\": %zu,\n"
+            "  \"iterations\": %zu,\n"
+            "  \"warmup\": %zu,\n"
+            "  \"results\": {",
+            (unsigned long long)args.seed,
+            args.keys,
+            args.attacks,
+            args.iterations,
+            args.warmup
+        );
+    for (size_t i = 0; i < n_results; i++) {
+        const struct result * result = &results[i];
+        fprintf(file,
+                "%s\n    \"%s\": { \"units\": %zu, \"mean_ns\": %.4f, "
+                "\"stddev_ns\": %.4f, \"min_ns\": %.4f }",
+                i == 0 ? "" : ",",
+                result->name,
+                result->units,
+                result_mean(result),
+                result_stddev(result),
+                result_min(result)
+            );
+    }
+    fprintf(file, "\n  }\n}\n");
+
+    return fclose(file) == 0;
+}
+
+static void usage(const char * name) [[gnu::nonnull(1)]]
+{
+    fprintf(
+            stderr,
+            "usage: %s [--corpus FILE] [--json FILE] [--keys N] "
+            "[--attacks N] [--iterations N] [--warmup N] [--seed N]\n",
+            name
+        );
+}
+
+int main(int argc, char ** argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (!strcmp(argv[i], "--corpus")) {
+            args.corpus = argv[++i];
+        } else if (!strcmp(argv[i], "--json")) {
+            args.json = argv[++i];
+        } else if (!strcmp(argv[i], "--keys")) {
+            args.keys = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--attacks")) {
+            args.attacks = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--iterations")) {
+            args.iterations = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--warmup")) {
+            args.warmup = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--seed")) {
+            args.seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (args.iterations > BENCH_ITERATIONS_MAX) {
+        args.iterations = BENCH_ITERATIONS_MAX;
+    }
+
+    /* the misses come from a different seed, so (almost) none of them are
+     * also keys
+     */
+    struct keys keys;
+    struct keys misses;
+    if (!keys_create(&keys, args.keys, args.seed) ||
+            !keys_create(&misses, args.keys, ~args.seed)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    bool okay = true;
+    if (args.corpus) {
+        okay = bench_lex() && okay;
+    }
+    okay = bench_name_set(&keys, &misses) && okay;
+    okay = bench_sorted_set(&keys) && okay;
+    okay = bench_hash(&keys) && okay;
+    okay = bench_game_state() && okay;
+
+    print_results();
+
+    if (args.json) {
+        okay = write_json(args.json) && okay;
+    }
+
+    keys_destroy(&keys);
+    keys_destroy(&misses);
+
+    return okay ? 0 : 1;
+}
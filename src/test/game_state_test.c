@@ -0,0 +1,555 @@
+/* File: src/test/game_state_test.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "game_state.h"
+
+static size_t errors = 0;
+
+/* print a check of this long and count an error if it isn't as expected */
+static void check(const char * name, long expected, long result)
+{
+    printf("Testing %s\n", name);
+    printf("Expected: %ld\n", expected);
+    printf("Result: %ld\n", result);
+
+    if (result != expected) {
+        errors++;
+    }
+}
+
+/* add a character with this A/AD/DD to the field of this owner, face up and
+ * in attack or defense mode
+ */
+static uint32_t add_character(
+        struct game_state * state,
+        int16_t attack,
+        int16_t attack_defense,
+        int16_t defense_defense,
+        uint8_t owner,
+        bool defense_mode
+    )
+{
+    struct game_stats stats = {
+        .attack = attack,
+        .attack_defense = attack_defense,
+        .defense_defense = defense_defense,
+        .hp = 5,
+        .range = 1
+    };
+    uint32_t id = game_state_add(
+            state, NULL, GAME_CARD_CHARACTER, &stats, owner,
+            GAME_ZONE_FIELD, 1);
+    game_state_set_flags(state, id, GAME_INSTANCE_FACE_UP, true);
+    game_state_set_flags(
+            state, id, GAME_INSTANCE_DEFENSE_MODE, defense_mode);
+    return id;
+}
+
+/* xorshift64*, so that the operations don't depend on the libc's rand() */
+static uint64_t random_next(uint64_t * state) [[gnu::nonnull(1)]]
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dull;
+}
+
+/* the random part: how many instances, players, character zones, and
+ * operations
+ */
+#define RANDOM_INSTANCES 300
+#define RANDOM_PLAYERS 3
+#define RANDOM_FIELD 4
+#define RANDOM_OPERATIONS 3000
+
+/* every ordered stack: the zones (with GAME_ZONE_FIELD standing in for
+ * nothing) and then the character zones
+ */
+#define RANDOM_STACKS (GAME_ZONES + RANDOM_FIELD)
+
+/* return this player's ordered stack i (see RANDOM_STACKS), or NULL */
+static const struct game_stack * ordered_stack(
+        const struct game_state * state, uint8_t owner, size_t i
+    ) [[gnu::nonnull(1)]]
+{
+    const struct game_player * player = &state->players[owner];
+    if (i == GAME_ZONE_FIELD) {
+        return NULL;
+    }
+    if (i < GAME_ZONES) {
+        return &player->stacks[i];
+    }
+    if (i - GAME_ZONES >= player->n_field) {
+        return NULL;
+    }
+    return &player->field[i - GAME_ZONES];
+}
+
+static bool has_bit(const uint64_t * bits, uint32_t id)
+{
+    return bits[id / 64] & ((uint64_t)1 << (id % 64));
+}
+
+/* return whether this instance matches this query, by the per-instance
+ * arrays rather than the bitsets
+ */
+static bool query_matches(
+        const struct game_state * state,
+        const struct game_query * query,
+        uint32_t id
+    ) [[gnu::nonnull(1, 2)]]
+{
+    return state->owner[id] == query->owner &&
+        state->zone[id] == query->zone &&
+        (query->zone != GAME_ZONE_FIELD || query->zone_number == 0 ||
+            state->zone_number[id] == query->zone_number) &&
+        (!query->characters || state->kind[id] == GAME_CARD_CHARACTER) &&
+        (state->flags[id] & query->flags_mask) == query->flags;
+}
+
+/* return the number of ways the stacks disagree with the per-instance
+ * arrays: each instance must be in exactly one ordered stack (the one its
+ * owner, zone, and zone_number say), each stack's order must hold its
+ * members, the GAME_ZONE_FIELD stack must be the character zones together,
+ * and game_state_at() must agree with the order
+ */
+static size_t stack_mismatches(const struct game_state * state)
+{
+    size_t mismatches = 0;
+
+    for (uint32_t id = 0; id < state->n_instances; id++) {
+        size_t found = 0;
+        for (uint8_t owner = 0; owner < RANDOM_PLAYERS; owner++) {
+            for (size_t i = 0; i < RANDOM_STACKS; i++) {
+                const struct game_stack * stack =
+                    ordered_stack(state, owner, i);
+                if (!stack || !has_bit(stack->members, id)) {
+                    continue;
+                }
+                found++;
+                size_t zone = i < GAME_ZONES ? i : GAME_ZONE_FIELD;
+                size_t zone_number = i < GAME_ZONES ? 0 : i - GAME_ZONES + 1;
+                if (owner != state->owner[id] || zone != state->zone[id] ||
+                        (zone == GAME_ZONE_FIELD &&
+                            zone_number != state->zone_number[id])) {
+                    mismatches++;
+                }
+            }
+        }
+        if (found != 1) {
+            mismatches++;
+        }
+    }
+
+    for (uint8_t owner = 0; owner < RANDOM_PLAYERS; owner++) {
+        const struct game_player * player = &state->players[owner];
+        for (size_t word = 0; word < state->n_words; word++) {
+            uint64_t field = 0;
+            for (size_t n = 0; n < player->n_field; n++) {
+                field |= player->field[n].members[word];
+            }
+            if (field != player->stacks[GAME_ZONE_FIELD].members[word]) {
+                mismatches++;
+            }
+        }
+
+        for (size_t i = 0; i < RANDOM_STACKS; i++) {
+            const struct game_stack * stack = ordered_stack(state, owner, i);
+            if (!stack) {
+                continue;
+            }
+            size_t members = 0;
+            for (size_t word = 0; word < state->n_words; word++) {
+                members += __builtin_popcountll(stack->members[word]);
+            }
+            if (members != stack->n_order) {
+                mismatches++;
+            }
+            size_t zone = i < GAME_ZONES ? i : GAME_ZONE_FIELD;
+            size_t zone_number = i < GAME_ZONES ? 0 : i - GAME_ZONES + 1;
+            for (size_t j = 0; j < stack->n_order; j++) {
+                if (!has_bit(stack->members, stack->order[j]) ||
+                        game_state_at(state, owner, zone, zone_number, j + 1)
+                            != stack->order[j]) {
+                    mismatches++;
+                }
+            }
+            if (game_state_at(state, owner, zone, zone_number,
+                        stack->n_order + 1) != GAME_STATE_NO_INSTANCE) {
+                mismatches++;
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+/* return the number of ways game_state_count() and game_state_select()
+ * disagree with a scan of the per-instance arrays for this query
+ */
+static size_t query_mismatches(
+        const struct game_state * state,
+        const struct game_query * query
+    ) [[gnu::nonnull(1, 2)]]
+{
+    static uint32_t ids[RANDOM_INSTANCES];
+    size_t mismatches = 0;
+
+    size_t n = game_state_select(state, query, ids, RANDOM_INSTANCES);
+    if (n != game_state_count(state, query)) {
+        mismatches++;
+    }
+
+    size_t expected = 0;
+    for (uint32_t id = 0; id < state->n_instances; id++) {
+        if (!query_matches(state, query, id)) {
+            continue;
+        }
+        if (expected >= n || ids[expected] != id) {
+            mismatches++;
+        }
+        expected++;
+    }
+    if (expected != n) {
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+int main(int argc, char ** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    printf("Sanity check game_state..\n");
+
+    struct game_state * state = game_state_create();
+    if (!state) {
+        printf("game_state_create() failed\n");
+        return 1;
+    }
+
+    /* the scenarios in planning/rules.md */
+    uint32_t a = add_character(state, 2, 1, 1, 0, false);
+    uint32_t b = add_character(state, 1, 1, 1, 1, false);
+    check("2/1/1 attacking 1/1/1 in attack mode destroys the defender",
+            GAME_ATTACK_DEFENDER_DESTROYED, game_state_attack(state, a, b));
+    check("the defender is in the grave", GAME_ZONE_GRAVE, state->zone[b]);
+    check("the attacker is still on the field",
+            GAME_ZONE_FIELD, state->zone[a]);
+
+    b = add_character(state, 1, 2, 1, 1, false);
+    check("2/1/1 attacking 1/2/1 in attack mode destroys the attacker",
+            GAME_ATTACK_ATTACKER_DESTROYED, game_state_attack(state, a, b));
+    check("the attacker is in the grave", GAME_ZONE_GRAVE, state->zone[a]);
+
+    a = add_character(state, 2, 1, 1, 0, false);
+    b = add_character(state, 1, 1, 3, 1, true);
+    check("2/1/1 attacking 1/1/3 in defense mode destroys the attacker",
+            GAME_ATTACK_ATTACKER_DESTROYED, game_state_attack(state, a, b));
+
+    a = add_character(state, 2, 1, 1, 0, false);
+    b = add_character(state, 1, 1, 3, 1, false);
+    check("2/1/1 attacking 1/1/3 in attack mode destroys the defender",
+            GAME_ATTACK_DEFENDER_DESTROYED, game_state_attack(state, a, b));
+
+    /* ties go to the defender, in either mode */
+    b = add_character(state, 1, 2, 9, 1, false);
+    check("2/1/1 attacking 1/2/9 in attack mode (a tie on AD) destroys the "
+            "attacker",
+            GAME_ATTACK_ATTACKER_DESTROYED, game_state_attack(state, a, b));
+    a = add_character(state, 2, 1, 1, 0, false);
+    b = add_character(state, 1, 9, 2, 1, true);
+    check("2/1/1 attacking 1/9/2 in defense mode (a tie on DD) destroys the "
+            "attacker",
+            GAME_ATTACK_ATTACKER_DESTROYED, game_state_attack(state, a, b));
+
+    /* face down defenders are turned face up, even when they win */
+    a = add_character(state, 2, 1, 1, 0, false);
+    b = add_character(state, 1, 1, 3, 1, true);
+    game_state_set_flags(state, b, GAME_INSTANCE_FACE_UP, false);
+    game_state_attack(state, a, b);
+    check("a face down defender that survives is face up",
+            GAME_INSTANCE_FACE_UP,
+            state->flags[b] & GAME_INSTANCE_FACE_UP);
+
+    /* attacks that aren't allowed change nothing */
+    a = add_character(state, 9, 1, 1, 0, false);
+    uint32_t c = add_character(state, 1, 1, 1, 0, false);
+    check("attacking a character of the same player is invalid",
+            GAME_ATTACK_INVALID, game_state_attack(state, a, c));
+    game_state_set_flags(state, a, GAME_INSTANCE_DEFENSE_MODE, true);
+    check("attacking in defense mode is invalid",
+            GAME_ATTACK_INVALID, game_state_attack(state, a, b));
+    game_state_set_flags(state, a, GAME_INSTANCE_DEFENSE_MODE, false);
+    game_state_set_flags(state, a, GAME_INSTANCE_FACE_UP, false);
+    check("attacking face down is invalid",
+            GAME_ATTACK_INVALID, game_state_attack(state, a, b));
+    check("the defender of an invalid attack is still on the field",
+            GAME_ZONE_FIELD, state->zone[b]);
+    game_state_set_flags(state, a, GAME_INSTANCE_FACE_UP, true);
+
+    /* equipment adds its stats on attach and takes them back on detach */
+    struct game_stats bonus = {
+        .attack = 3,
+        .attack_defense = 2,
+        .defense_defense = 1,
+        .hp = 4,
+        .range = 1
+    };
+    uint32_t sword = game_state_add(
+            state, NULL, GAME_CARD_EQUIPMENT, &bonus, 0,
+            GAME_ZONE_SPECIAL, 0);
+    uint32_t shield = game_state_add(
+            state, NULL, GAME_CARD_EQUIPMENT, &bonus, 0,
+            GAME_ZONE_SPECIAL, 0);
+    check("attaching equipment to a character",
+            true, game_state_attach(state, sword, c));
+    check("attaching more equipment to the same character",
+            true, game_state_attach(state, shield, c));
+    check("attaching equipment to equipment",
+            false, game_state_attach(state, sword, shield));
+    check("attaching equipment to another player's character",
+            false, game_state_attach(state, sword, b));
+    check("A with two pieces of equipment", 1 + 3 + 3, state->attack[c]);
+    check("AD with two pieces of equipment",
+            1 + 2 + 2, state->attack_defense[c]);
+    check("DD with two pieces of equipment",
+            1 + 1 + 1, state->defense_defense[c]);
+    check("HP with two pieces of equipment", 5 + 4 + 4, state->hp[c]);
+    check("range with two pieces of equipment", 1 + 1 + 1, state->range[c]);
+    check("attached equipment is face up",
+            GAME_INSTANCE_FACE_UP,
+            state->flags[sword] & GAME_INSTANCE_FACE_UP);
+    check("attached equipment is with its character",
+            GAME_ZONE_FIELD, state->zone[sword]);
+
+    game_state_detach(state, shield);
+    check("A after detaching one", 1 + 3, state->attack[c]);
+    check("HP after detaching one", 5 + 4, state->hp[c]);
+    check("detached equipment goes to the special zone",
+            GAME_ZONE_SPECIAL, state->zone[shield]);
+    check("detached equipment isn't attached",
+            GAME_STATE_NO_INSTANCE, state->equipped_to[shield]);
+
+    check("moving attached equipment to another character",
+            true, game_state_attach(state, sword, a));
+    check("A of the character it left", 1, state->attack[c]);
+    check("A of the character it went to", 9 + 3, state->attack[a]);
+
+    /* equipment is buried with its character */
+    game_state_attach(state, shield, a);
+    game_state_bury(state, a);
+    check("equipment of a buried character is in the grave",
+            GAME_ZONE_GRAVE, state->zone[sword]);
+    check("and so is the rest of it", GAME_ZONE_GRAVE, state->zone[shield]);
+    check("a buried character has no equipment",
+            GAME_STATE_NO_INSTANCE, state->equipment[a]);
+    check("and is back to its own A", 9, state->attack[a]);
+
+    /* damage_all destroys the characters it leaves with no HP */
+    struct game_state * sweep = game_state_create();
+    uint32_t weak = add_character(sweep, 1, 1, 1, 0, false);
+    uint32_t strong = add_character(sweep, 1, 1, 1, 0, false);
+    uint32_t other = add_character(sweep, 1, 1, 1, 1, false);
+    uint32_t armor = game_state_add(
+            sweep, NULL, GAME_CARD_EQUIPMENT, &bonus, 0,
+            GAME_ZONE_SPECIAL, 0);
+    game_state_attach(sweep, armor, strong);
+    check("game_state_damage_all() of 5 destroys one character",
+            1, game_state_damage_all(sweep, 0, 5));
+    check("the one without the extra HP", GAME_ZONE_GRAVE, sweep->zone[weak]);
+    check("the one with it has 4 HP left", 4, sweep->hp[strong]);
+    check("the other player's character wasn't damaged",
+            5, sweep->hp[other]);
+    game_state_destroy(sweep);
+
+
+    /* positions count from 1, and a move leaves the rest in order */
+    struct game_state * hand = game_state_create();
+    uint32_t cards[4];
+    for (size_t i = 0; i < 4; i++) {
+        cards[i] = game_state_add(
+                hand, NULL, GAME_CARD_EFFECT, &bonus, 0, GAME_ZONE_HAND, 0);
+    }
+    game_state_move(hand, cards[1], GAME_ZONE_DECK, 0);
+    check("the first card in the hand after moving the second",
+            cards[0], game_state_at(hand, 0, GAME_ZONE_HAND, 0, 1));
+    check("the second card in the hand after moving the second",
+            cards[2], game_state_at(hand, 0, GAME_ZONE_HAND, 0, 2));
+    check("the third card in the hand after moving the second",
+            cards[3], game_state_at(hand, 0, GAME_ZONE_HAND, 0, 3));
+    check("there is no fourth", GAME_STATE_NO_INSTANCE,
+            game_state_at(hand, 0, GAME_ZONE_HAND, 0, 4));
+    check("the first card in the deck", cards[1],
+            game_state_at(hand, 0, GAME_ZONE_DECK, 0, 1));
+    game_state_move(hand, cards[0], GAME_ZONE_HAND, 0);
+    check("a card moved to its own zone goes to the end",
+            cards[0], game_state_at(hand, 0, GAME_ZONE_HAND, 0, 3));
+    check("and the rest move up",
+            cards[2], game_state_at(hand, 0, GAME_ZONE_HAND, 0, 1));
+    check("the character zones together have no positions",
+            GAME_STATE_NO_INSTANCE,
+            game_state_at(hand, 0, GAME_ZONE_FIELD, 0, 1));
+    game_state_destroy(hand);
+
+    /* random operations, checked against the per-instance arrays after
+     * each one
+     */
+    struct game_state * random = game_state_create();
+    uint64_t seed = 1;
+    for (size_t i = 0; i < RANDOM_INSTANCES; i++) {
+        uint8_t zone = random_next(&seed) % GAME_ZONES;
+        game_state_add(
+                random, NULL, random_next(&seed) % 4, &bonus,
+                random_next(&seed) % RANDOM_PLAYERS, zone,
+                zone == GAME_ZONE_FIELD ?
+                    1 + random_next(&seed) % RANDOM_FIELD : 0);
+    }
+
+    size_t stack_errors = 0;
+    size_t query_errors = 0;
+    size_t position_errors = 0;
+    static uint32_t before[RANDOM_PLAYERS][RANDOM_STACKS][RANDOM_INSTANCES];
+    static size_t n_before[RANDOM_PLAYERS][RANDOM_STACKS];
+    static bool moved[RANDOM_INSTANCES];
+    for (size_t operation = 0; operation < RANDOM_OPERATIONS; operation++) {
+        for (uint8_t owner = 0; owner < RANDOM_PLAYERS; owner++) {
+            for (size_t i = 0; i < RANDOM_STACKS; i++) {
+                const struct game_stack * stack =
+                    ordered_stack(random, owner, i);
+                n_before[owner][i] = stack ? stack->n_order : 0;
+                for (size_t j = 0; j < n_before[owner][i]; j++) {
+                    before[owner][i][j] = stack->order[j];
+                }
+            }
+        }
+
+        /* the instances the operation may append to a stack: it, and
+         * whatever equipment it has (which moves or is buried with it)
+         */
+        uint32_t id = random_next(&seed) % RANDOM_INSTANCES;
+        for (size_t i = 0; i < RANDOM_INSTANCES; i++) {
+            moved[i] = false;
+        }
+        moved[id] = true;
+        for (uint32_t equipment = random->equipment[id];
+                equipment != GAME_STATE_NO_INSTANCE;
+                equipment = random->next_equipment[equipment]) {
+            moved[equipment] = true;
+        }
+
+        uint8_t zone = random_next(&seed) % GAME_ZONES;
+        switch (random_next(&seed) % 6) {
+            case 0:
+            case 1:
+                game_state_move(random, id, zone,
+                        zone == GAME_ZONE_FIELD ?
+                            1 + random_next(&seed) % RANDOM_FIELD : 0);
+                break;
+            case 2:
+                game_state_set_flags(random, id,
+                        1 + random_next(&seed) % 3, random_next(&seed) % 2);
+                break;
+            case 3:
+                game_state_attach(random, id,
+                        random_next(&seed) % RANDOM_INSTANCES);
+                break;
+            case 4:
+                game_state_detach(random, id);
+                break;
+            case 5:
+                game_state_bury(random, id);
+                break;
+        }
+
+        stack_errors += stack_mismatches(random);
+
+        for (size_t i = 0; i < 4; i++) {
+            uint8_t zone = random_next(&seed) % GAME_ZONES;
+            uint8_t mask = random_next(&seed) % 4;
+            struct game_query query = {
+                .owner = random_next(&seed) % RANDOM_PLAYERS,
+                .zone = zone,
+                .zone_number = zone == GAME_ZONE_FIELD ?
+                    random_next(&seed) % (RANDOM_FIELD + 2) : 0,
+                .characters = random_next(&seed) % 2,
+                .flags_mask = mask,
+                .flags = random_next(&seed) % 4 & mask
+            };
+            query_errors += query_mismatches(random, &query);
+        }
+
+        /* what was in each stack, and didn't leave or move, is still in the
+         * same order, and anything new in it was moved there
+         */
+        for (uint8_t owner = 0; owner < RANDOM_PLAYERS; owner++) {
+            for (size_t i = 0; i < RANDOM_STACKS; i++) {
+                const struct game_stack * stack =
+                    ordered_stack(random, owner, i);
+                size_t n_order = stack ? stack->n_order : 0;
+                size_t k = 0;
+                for (size_t j = 0; j < n_order; j++) {
+                    uint32_t id = stack->order[j];
+                    if (moved[id]) {
+                        continue;
+                    }
+                    while (k < n_before[owner][i] &&
+                            (moved[before[owner][i][k]] ||
+                                !has_bit(stack->members,
+                                    before[owner][i][k]))) {
+                        k++;
+                    }
+                    if (k >= n_before[owner][i] ||
+                            before[owner][i][k] != id) {
+                        position_errors++;
+                    } else {
+                        k++;
+                    }
+                }
+            }
+        }
+    }
+    game_state_destroy(random);
+
+    check("each instance in exactly one stack after random operations "
+            "(mismatches)", 0, stack_errors);
+    check("game_state_count() and game_state_select() against a scan after "
+            "random operations (mismatches)", 0, query_errors);
+    check("positions after random operations (mismatches)",
+            0, position_errors);
+
+    game_state_destroy(state);
+
+    /* done */
+    printf("Done.\n");
+
+    if (errors) {
+        printf("%zu errors occurred\n", errors);
+    } else {
+        printf("No errors occurred\n");
+    }
+
+    return errors;
+}
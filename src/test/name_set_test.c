@@ -0,0 +1,494 @@
+/* File: src/test/name_set_test.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "name_set.h"
+#include "util/metrics.h"
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* the same as in name_set.c, so that a -D for it applies to both */
+#ifndef NAME_SET_MERGE_THRESHOLD_DEFAULT
+#define NAME_SET_MERGE_THRESHOLD_DEFAULT 64
+#endif /* NAME_SET_MERGE_THRESHOLD_DEFAULT */
+
+/* how many names are compiled into the first hash */
+#define COMPILED 100
+
+/* how many names are added after compiling, which is enough to start a merge
+ * and then leave some in the overflow tier
+ */
+#define ADDED (NAME_SET_MERGE_THRESHOLD_DEFAULT + 10)
+
+/* how long to wait for a merge to finish before giving up on it */
+#define MERGE_TIMEOUT_MS 10000
+
+/* how many values enum name_type has */
+#define NAME_TYPES (NAME_TYPE_PLAYER + 1)
+
+static const char * type_names[NAME_TYPES] = {
+    [NAME_TYPE_CARD] = "Card",
+    [NAME_TYPE_ABILITY] = "Ability",
+    [NAME_TYPE_SUBTYPE] = "Subtype",
+    [NAME_TYPE_PLAYER] = "Player"
+};
+
+/* something distinct for the names of each type to point their data at */
+static char type_data[NAME_TYPES];
+
+static size_t errors = 0;
+
+/* print a check of this value and count an error if it isn't as expected */
+static void check(const char * name, long expected, long result)
+{
+    printf("Testing %s\n", name);
+    printf("Expected: %ld\n", expected);
+    printf("Result: %ld\n", result);
+
+    if (result != expected) {
+        errors++;
+    }
+}
+
+/* write the nth name (which is added with a capital letter, so that it is
+ * only found if lookups ignore case) to buffer, returning its length
+ */
+static size_t name_n(char * buffer, size_t n) [[gnu::nonnull(1)]]
+{
+    return sprintf(buffer, "Name %04zu", n);
+}
+
+/* add the names from first up to (but not including) last, returning how
+ * many of them weren't added
+ */
+static size_t add_names(
+        struct name_set * name_set, size_t first, size_t last
+    ) [[gnu::nonnull(1)]]
+{
+    size_t failed = 0;
+    for (size_t i = first; i < last; i++) {
+        char buffer[32];
+        size_t length = name_n(buffer, i);
+        bool oom = false;
+        if (!name_set_add(name_set, (uint8_t *)buffer, length, NULL,
+                    NAME_TYPE_PLAYER, &oom) || oom) {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/* look up the names from first up to (but not including) last, in lowercase,
+ * returning how many of them weren't found (or were found as something else)
+ */
+static size_t lookup_names(
+        const struct name_set * name_set, size_t first, size_t last
+    ) [[gnu::nonnull(1)]]
+{
+    size_t misses = 0;
+    for (size_t i = first; i < last; i++) {
+        char buffer[32];
+        size_t length = name_n(buffer, i);
+        buffer[0] = 'n';
+        bool oom = false;
+        struct name * name =
+            name_set_lookup(name_set, (uint8_t *)buffer, length, &oom);
+        if (!name || oom || name->type != NAME_TYPE_PLAYER ||
+                name->display_name_length != length ||
+                memcmp(name->display_name, buffer, length)) {
+            misses++;
+        }
+    }
+    return misses;
+}
+
+/* add a name of each type for this tier (e.g. "Hash Card"), returning how
+ * many of them weren't added
+ */
+static size_t add_typed_names(
+        struct name_set * name_set, const char * tier) [[gnu::nonnull(1, 2)]]
+{
+    size_t failed = 0;
+    for (enum name_type type = 0; type < NAME_TYPES; type++) {
+        char buffer[32];
+        int length = sprintf(buffer, "%s %s", tier, type_names[type]);
+        bool oom = false;
+        if (!name_set_add(name_set, (uint8_t *)buffer, length,
+                    &type_data[type], type, &oom) || oom) {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/* look up each of this tier's typed names (in lowercase) with each type's
+ * bit, the other types' bits, and every bit, returning how many lookups
+ * didn't find the name when they should have, found it when they shouldn't
+ * have, or returned it tagged or with the wrong type, data or display name
+ */
+static size_t lookup_typed_names(
+        const struct name_set * name_set, const char * tier)
+    [[gnu::nonnull(1, 2)]]
+{
+    size_t failed = 0;
+    for (enum name_type type = 0; type < NAME_TYPES; type++) {
+        char buffer[32];
+        int length = sprintf(buffer, "%s %s", tier, type_names[type]);
+        /* which is also what the display name is */
+        for (int i = 0; i < length; i++) {
+            buffer[i] = tolower(buffer[i]);
+        }
+
+        unsigned int masks[NAME_TYPES + 2];
+        size_t n_masks = 0;
+        for (enum name_type other = 0; other < NAME_TYPES; other++) {
+            masks[n_masks++] = NAME_TYPE_BIT(other);
+        }
+        masks[n_masks++] = NAME_TYPE_BITS_ALL & ~NAME_TYPE_BIT(type);
+        masks[n_masks++] = NAME_TYPE_BITS_ALL;
+
+        for (size_t i = 0; i < n_masks; i++) {
+            bool oom = false;
+            struct name * name = name_set_lookup_types(
+                    name_set, (uint8_t *)buffer, length, masks[i], &oom);
+            bool expected = masks[i] & NAME_TYPE_BIT(type);
+            if (oom || !name != !expected) {
+                failed++;
+                continue;
+            }
+            if (!name) {
+                continue;
+            }
+            /* check the pointer before using it, in case it's tagged */
+            if ((uintptr_t)name % alignof(struct name)) {
+                failed++;
+                continue;
+            }
+            if (name->type != type || name->data != &type_data[type] ||
+                    name->display_name_length != (size_t)length ||
+                    memcmp(name->display_name, buffer, length)) {
+                failed++;
+            }
+        }
+    }
+    return failed;
+}
+
+/* name_set_apply() callback that makes every name a player, so that
+ * name_set_destroy() doesn't try to destroy the stand-in data of the others
+ * as cards, abilities or subtypes
+ */
+static void make_player(struct name * name, void * ptr)
+{
+    (void)ptr;
+    name->type = NAME_TYPE_PLAYER;
+}
+
+/* add each of these names as players, returning how many weren't added */
+static size_t add_players(
+        struct name_set * name_set, const char ** names, size_t n_names)
+    [[gnu::nonnull(1, 2)]]
+{
+    size_t failed = 0;
+    for (size_t i = 0; i < n_names; i++) {
+        bool oom = false;
+        if (!name_set_add(name_set, (uint8_t *)names[i], strlen(names[i]),
+                    NULL, NAME_TYPE_PLAYER, &oom) || oom) {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/* complete this prefix with up to max names and check that the display
+ * names returned are these (separated by spaces)
+ */
+static void check_completions(
+        const struct name_set * name_set,
+        const char * prefix,
+        size_t max,
+        const char * expected
+    ) [[gnu::nonnull(1, 2, 4)]]
+{
+    struct name * names[16];
+    bool oom = false;
+    size_t n_names = name_set_complete(name_set, (uint8_t *)prefix,
+            strlen(prefix), names, max < 16 ? max : 16, &oom);
+
+    char result[256] = "";
+    size_t length = 0;
+    for (size_t i = 0; i < n_names; i++) {
+        length += snprintf(result + length, sizeof(result) - length,
+                "%s%.*s", i > 0 ? " " : "",
+                (int)names[i]->display_name_length, names[i]->display_name);
+    }
+    if (oom) {
+        snprintf(result, sizeof(result), "out of memory");
+    }
+
+    printf("Testing completing \"%s\" (up to %zu)\n", prefix, max);
+    printf("Expected: %s\n", expected);
+    printf("Result: %s\n", result);
+
+    if (strcmp(result, expected)) {
+        errors++;
+    }
+}
+
+/* metrics_report() callback that picks out the number of merges */
+static void merges_line(const char * line, void * ptr)
+{
+    sscanf(line, "name_set_merges %" SCNu64, (uint64_t *)ptr);
+}
+
+/* return how many merges have been swapped in so far */
+static uint64_t merges()
+{
+    uint64_t n = 0;
+    metrics_report(&merges_line, &n);
+    return n;
+}
+
+/* call name_set_maintain() until more than since merges have been swapped in
+ * (or it has taken too long), returning whether they were
+ */
+static bool maintain_until_merged(struct name_set * name_set, uint64_t since)
+    [[gnu::nonnull(1)]]
+{
+    for (size_t i = 0; i < MERGE_TIMEOUT_MS; i++) {
+        name_set_maintain(name_set);
+        if (merges() > since) {
+            return true;
+        }
+        nanosleep(&(struct timespec) { .tv_nsec = 1000000 }, NULL);
+    }
+    return false;
+}
+
+int main(int argc, char ** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    printf("Sanity check name_set..\n");
+
+    struct name_set * name_set = name_set_create();
+    if (!name_set) {
+        printf("name_set_create() failed\n");
+        return 1;
+    }
+
+    /* before compiling, everything is in the overflow tier */
+    check("adding names before compiling (failures)",
+            0, add_names(name_set, 0, COMPILED));
+    check("looking them up before compiling (misses)",
+            0, lookup_names(name_set, 0, COMPILED));
+
+    name_set_compile(name_set);
+    check("looking them up in the hash (misses)",
+            0, lookup_names(name_set, 0, COMPILED));
+
+    /* enough names after compiling to start merging them in the
+     * background, which moves them to the merging tier. nothing swaps the
+     * merge in until name_set_maintain() or name_set_add() is next called,
+     * so until then they are looked up there whether or not the thread is
+     * done.
+     */
+    uint64_t merged = merges();
+    check("adding names up to the merge threshold (failures)", 0,
+            add_names(name_set, COMPILED,
+                COMPILED + NAME_SET_MERGE_THRESHOLD_DEFAULT - 1));
+    check("looking up the compiled names before the merge (misses)",
+            0, lookup_names(name_set, 0, COMPILED));
+    check("looking up the added names before the merge (misses)", 0,
+            lookup_names(name_set, COMPILED,
+                COMPILED + NAME_SET_MERGE_THRESHOLD_DEFAULT - 1));
+    check("adding the name that starts the merge (failures)", 0,
+            add_names(name_set,
+                COMPILED + NAME_SET_MERGE_THRESHOLD_DEFAULT - 1,
+                COMPILED + NAME_SET_MERGE_THRESHOLD_DEFAULT));
+    check("looking up the compiled names during the merge (misses)",
+            0, lookup_names(name_set, 0, COMPILED));
+    check("looking up the merging names during the merge (misses)", 0,
+            lookup_names(name_set, COMPILED,
+                COMPILED + NAME_SET_MERGE_THRESHOLD_DEFAULT));
+
+    /* re-adding a name fails, as a duplicate rather than from memory */
+    bool oom = false;
+    char buffer[32];
+    size_t length = name_n(buffer, 0);
+    check("re-adding a name in the hash",
+            false, name_set_add(name_set, (uint8_t *)buffer, length, NULL,
+                NAME_TYPE_PLAYER, &oom));
+    check("re-adding a name in the hash sets oom", false, oom);
+    length = name_n(buffer, COMPILED);
+    check("re-adding a name being merged",
+            false, name_set_add(name_set, (uint8_t *)buffer, length, NULL,
+                NAME_TYPE_PLAYER, &oom));
+    check("re-adding a name being merged sets oom", false, oom);
+
+    /* the rest go in the overflow tier (adding them may swap the merge in,
+     * if it's done by then, but won't start another)
+     */
+    check("adding names to the overflow tier (failures)", 0,
+            add_names(name_set,
+                COMPILED + NAME_SET_MERGE_THRESHOLD_DEFAULT,
+                COMPILED + ADDED));
+    check("looking them up (misses)", 0,
+            lookup_names(name_set,
+                COMPILED + NAME_SET_MERGE_THRESHOLD_DEFAULT,
+                COMPILED + ADDED));
+
+    check("the merge finishing",
+            true, maintain_until_merged(name_set, merged));
+    check("the merges swapped in", 1, merges() - merged);
+    check("looking up every name after the merge (misses)",
+            0, lookup_names(name_set, 0, COMPILED + ADDED));
+    length = name_n(buffer, COMPILED + 1);
+    check("re-adding a name that was merged",
+            false, name_set_add(name_set, (uint8_t *)buffer, length, NULL,
+                NAME_TYPE_PLAYER, &oom));
+    length = name_n(buffer, COMPILED + ADDED - 1);
+    check("re-adding a name in the overflow tier",
+            false, name_set_add(name_set, (uint8_t *)buffer, length, NULL,
+                NAME_TYPE_PLAYER, &oom));
+    check("re-adding them sets oom", false, oom);
+
+    /* compiling again merges the overflow tier (which isn't empty) in right
+     * away
+     */
+    name_set_compile(name_set);
+    check("looking up every name after compiling again (misses)",
+            0, lookup_names(name_set, 0, COMPILED + ADDED));
+    check("adding names after compiling again (failures)", 0,
+            add_names(name_set, COMPILED + ADDED, COMPILED + ADDED + 5));
+    check("looking them up (misses)",
+            0, lookup_names(name_set, 0, COMPILED + ADDED + 5));
+
+    name_set_destroy(name_set);
+
+    /* a name of each type in each tier is only found with its own type's
+     * bit, and comes back untagged. the names in the merging tier are
+     * checked before anything else is added, so that nothing can swap the
+     * merge in first.
+     */
+    name_set = name_set_create();
+    if (!name_set) {
+        printf("name_set_create() failed\n");
+        return 1;
+    }
+    check("adding typed names to the overflow tier before compiling "
+            "(failures)", 0, add_typed_names(name_set, "Uncompiled"));
+    check("looking them up by type (failures)",
+            0, lookup_typed_names(name_set, "Uncompiled"));
+    name_set_compile(name_set);
+    check("looking them up by type in the hash (failures)",
+            0, lookup_typed_names(name_set, "Uncompiled"));
+    check("adding typed names to be merged (failures)",
+            0, add_typed_names(name_set, "Merging"));
+    check("adding names to start merging them (failures)", 0,
+            add_names(name_set, 0,
+                NAME_SET_MERGE_THRESHOLD_DEFAULT - NAME_TYPES));
+    check("looking them up by type during the merge (failures)",
+            0, lookup_typed_names(name_set, "Merging"));
+    check("adding typed names to the overflow tier (failures)",
+            0, add_typed_names(name_set, "Overflow"));
+    check("looking them up by type (failures)",
+            0, lookup_typed_names(name_set, "Overflow"));
+    name_set_compile(name_set);
+    check("looking every typed name up by type after compiling again "
+            "(failures)", 0,
+            lookup_typed_names(name_set, "Uncompiled") +
+            lookup_typed_names(name_set, "Merging") +
+            lookup_typed_names(name_set, "Overflow"));
+    name_set_apply(name_set, &make_player, NULL);
+    name_set_destroy(name_set);
+
+    /* completions ignore the case of the prefix, are in order of the
+     * (lowercased) display names, stop at max, and include names added
+     * after compiling, whichever tier they are in
+     */
+    name_set = name_set_create();
+    if (!name_set) {
+        printf("name_set_create() failed\n");
+        return 1;
+    }
+    check("adding names to complete (failures)", 0,
+            add_players(name_set, (const char *[]) {
+                "Alpha", "alpine", "ALPACA", "Beta", "Al"
+            }, 5));
+    check_completions(name_set, "AL", 10, "al alpaca alpha alpine");
+    check_completions(name_set, "aLp", 10, "alpaca alpha alpine");
+    check_completions(name_set, "al", 2, "al alpaca");
+    check_completions(name_set, "b", 10, "beta");
+    check_completions(name_set, "alps", 10, "");
+    name_set_compile(name_set);
+    check_completions(name_set, "AL", 10, "al alpaca alpha alpine");
+    check("adding a name to complete after compiling (failures)", 0,
+            add_players(name_set, (const char *[]) { "Alps" }, 1));
+    check_completions(name_set, "alp", 10, "alpaca alpha alpine alps");
+    check_completions(name_set, "alp", 3, "alpaca alpha alpine");
+    merged = merges();
+    check("adding names to start merging them (failures)", 0,
+            add_names(name_set, 0, NAME_SET_MERGE_THRESHOLD_DEFAULT - 1));
+    check("adding a name to complete to the overflow tier (failures)", 0,
+            add_players(name_set, (const char *[]) { "Alpenhorn" }, 1));
+    check_completions(name_set, "ALP", 10,
+            "alpaca alpenhorn alpha alpine alps");
+    check("the merge finishing",
+            true, maintain_until_merged(name_set, merged));
+    check_completions(name_set, "ALP", 10,
+            "alpaca alpenhorn alpha alpine alps");
+    check_completions(name_set, "name 000", 3,
+            "name 0000 name 0001 name 0002");
+    name_set_destroy(name_set);
+
+    /* destroying a set while it is merging waits for the merge (and, under
+     * ASan, doesn't leak or use the tiers after they're freed)
+     */
+    name_set = name_set_create();
+    if (!name_set) {
+        printf("name_set_create() failed\n");
+        return 1;
+    }
+    add_names(name_set, 0, COMPILED);
+    name_set_compile(name_set);
+    check("adding names to start another merge (failures)", 0,
+            add_names(name_set, COMPILED,
+                COMPILED + NAME_SET_MERGE_THRESHOLD_DEFAULT));
+    name_set_destroy(name_set);
+
+    /* done */
+    printf("Done.\n");
+
+    if (errors) {
+        printf("%zu errors occurred\n", errors);
+    } else {
+        printf("No errors occurred\n");
+    }
+
+    return errors;
+}
@@ -0,0 +1,337 @@
+/* File: src/test/ngram_index_test.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "util/ngram_index.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* a test of the n-gram index
+ *
+ * a few fixed searches check the order of the results and where they are cut
+ * off. then a seeded set of keys over a small alphabet (so that there are
+ * lots of close keys, short keys, and keys with repeated trigrams) is
+ * searched for seeded strings at distances 0 to 2, and the results are
+ * compared against a plain scan of every key with a full edit distance
+ */
+
+/* the random part: how many keys and searches, how long they are, and the
+ * letters they are made of
+ */
+#define RANDOM_KEYS 1500
+#define RANDOM_SEARCHES 200
+#define RANDOM_LENGTH 8
+#define RANDOM_LETTERS "abc"
+
+/* the most results a search of the random keys is limited to when checking
+ * where the results are cut off
+ */
+#define RANDOM_MAX 3
+
+static size_t errors = 0;
+
+/* xorshift64*, so that the keys don't depend on the libc's rand() */
+static uint64_t random_next(uint64_t * state) [[gnu::nonnull(1)]]
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dull;
+}
+
+/* write a random string of up to RANDOM_LENGTH letters to buffer, returning
+ * its length
+ */
+static size_t random_string(uint64_t * state, char * buffer)
+    [[gnu::nonnull(1, 2)]]
+{
+    size_t length = random_next(state) % (RANDOM_LENGTH + 1);
+    for (size_t i = 0; i < length; i++) {
+        buffer[i] = RANDOM_LETTERS[
+            random_next(state) % (sizeof(RANDOM_LETTERS) - 1)];
+    }
+    return length;
+}
+
+/* the edit distance between a and b, computed in full */
+static size_t distance(
+        const char * a, size_t a_length, const char * b, size_t b_length)
+    [[gnu::nonnull(1, 3)]]
+{
+    size_t table[RANDOM_LENGTH + 2][RANDOM_LENGTH + 2];
+    for (size_t i = 0; i <= a_length; i++) {
+        table[i][0] = i;
+    }
+    for (size_t j = 0; j <= b_length; j++) {
+        table[0][j] = j;
+    }
+    for (size_t i = 1; i <= a_length; i++) {
+        for (size_t j = 1; j <= b_length; j++) {
+            size_t best = table[i - 1][j - 1] + (a[i - 1] != b[j - 1]);
+            if (table[i - 1][j] + 1 < best) {
+                best = table[i - 1][j] + 1;
+            }
+            if (table[i][j - 1] + 1 < best) {
+                best = table[i][j - 1] + 1;
+            }
+            table[i][j] = best;
+        }
+    }
+    return table[a_length][b_length];
+}
+
+/* returns true if a and b have a trigram in common, with each padded by two
+ * zero bytes at both ends (see ngram_index.h)
+ */
+static bool share_trigram(
+        const char * a, size_t a_length, const char * b, size_t b_length)
+    [[gnu::nonnull(1, 3)]]
+{
+    char x[RANDOM_LENGTH + 5] = { };
+    char y[RANDOM_LENGTH + 5] = { };
+    memcpy(&x[2], a, a_length);
+    memcpy(&y[2], b, b_length);
+    for (size_t i = 0; i < a_length + 2; i++) {
+        for (size_t j = 0; j < b_length + 2; j++) {
+            if (!memcmp(&x[i], &y[j], 3)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* the order ngram_index_search() promises: closest first, then bytewise,
+ * with a key before the longer keys it is a prefix of
+ */
+static int compare_results(const void * a, const void * b)
+{
+    const struct ngram_index_result * x = a;
+    const struct ngram_index_result * y = b;
+    if (x->distance != y->distance) {
+        return x->distance < y->distance ? -1 : 1;
+    }
+    size_t length = x->length < y->length ? x->length : y->length;
+    int result = memcmp(x->key, y->key, length);
+    if (result) {
+        return result;
+    }
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+/* search for this key and check that the keys found (as "key:distance",
+ * separated by spaces) are these
+ */
+static void check_search(
+        struct ngram_index * index,
+        const char * key,
+        size_t max_distance,
+        size_t max,
+        const char * expected
+    ) [[gnu::nonnull(1, 2, 5)]]
+{
+    struct ngram_index_result results[16];
+    bool oom = false;
+    size_t n_results = ngram_index_search(index, key, strlen(key),
+            max_distance, results, max < 16 ? max : 16, &oom);
+
+    char result[256] = "";
+    size_t length = 0;
+    for (size_t i = 0; i < n_results; i++) {
+        length += snprintf(result + length, sizeof(result) - length,
+                "%s%.*s:%zu", i > 0 ? " " : "", (int)results[i].length,
+                results[i].key, results[i].distance);
+    }
+    if (oom) {
+        snprintf(result, sizeof(result), "out of memory");
+    }
+
+    printf("Testing searching for \"%s\" within %zu (up to %zu)\n",
+            key, max_distance, max);
+    printf("Expected: %s\n", expected);
+    printf("Result: %s\n", result);
+
+    if (strcmp(result, expected)) {
+        errors++;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    printf("Sanity check ngram_index..\n");
+
+    /* the fixed searches */
+    static const char * keys[] = {
+        "abd", "abc", "ab", "abcd", "b", "xy", "aaaa", "aaaaaa"
+    };
+    struct ngram_index * index = ngram_index_create();
+    if (!index) {
+        printf("ngram_index_create() failed\n");
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(keys) / sizeof(*keys); i++) {
+        if (!ngram_index_add(index, keys[i], strlen(keys[i]), NULL)) {
+            printf("ngram_index_add() failed\n");
+            return 1;
+        }
+    }
+
+    /* equally close keys are in bytewise order, a prefix before the keys it
+     * begins, and the results are cut off at max
+     */
+    check_search(index, "abc", 0, 10, "abc:0");
+    check_search(index, "abc", 1, 10, "abc:0 ab:1 abcd:1 abd:1");
+    check_search(index, "abc", 1, 3, "abc:0 ab:1 abcd:1");
+    check_search(index, "abc", 1, 1, "abc:0");
+    check_search(index, "abc", 1, 0, "");
+    check_search(index, "abc", 2, 10, "abc:0 ab:1 abcd:1 abd:1");
+
+    /* keys shorter than a trigram are found through the padded trigrams
+     * they share, but not if they share none, however close they are ("b"
+     * is one edit from "a", and "xy" two from "yx")
+     */
+    check_search(index, "ab", 1, 10, "ab:0 abc:1 abd:1 b:1");
+    check_search(index, "a", 1, 10, "ab:1");
+    check_search(index, "yx", 2, 10, "");
+
+    /* repeated trigrams are only counted once */
+    check_search(index, "aaa", 1, 10, "aaaa:1");
+    check_search(index, "aaaaa", 1, 10, "aaaa:1 aaaaaa:1");
+
+    ngram_index_destroy(index);
+
+    /* the random keys, without duplicates (which would be found once each,
+     * in no particular order)
+     */
+    static char random_keys[RANDOM_KEYS][RANDOM_LENGTH];
+    static size_t random_lengths[RANDOM_KEYS];
+    size_t n_keys = 0;
+    uint64_t seed = 1;
+    while (n_keys < RANDOM_KEYS) {
+        random_lengths[n_keys] = random_string(&seed, random_keys[n_keys]);
+        bool duplicate = false;
+        for (size_t i = 0; i < n_keys && !duplicate; i++) {
+            duplicate = random_lengths[i] == random_lengths[n_keys] &&
+                !memcmp(random_keys[i], random_keys[n_keys],
+                        random_lengths[i]);
+        }
+        if (!duplicate) {
+            n_keys++;
+        }
+    }
+
+    index = ngram_index_create();
+    if (!index) {
+        printf("ngram_index_create() failed\n");
+        return 1;
+    }
+    for (size_t i = 0; i < n_keys; i++) {
+        if (!ngram_index_add(index, random_keys[i], random_lengths[i],
+                    &random_keys[i])) {
+            printf("ngram_index_add() failed\n");
+            return 1;
+        }
+    }
+
+    static struct ngram_index_result expected[RANDOM_KEYS];
+    static struct ngram_index_result results[RANDOM_KEYS];
+    size_t mismatches[3][2] = { };
+    size_t n_found[3] = { };
+    for (size_t search = 0; search < RANDOM_SEARCHES; search++) {
+        char key[RANDOM_LENGTH];
+        size_t length = random_string(&seed, key);
+
+        for (size_t max_distance = 0; max_distance < 3; max_distance++) {
+            /* every key close enough, sharing a trigram, in order */
+            size_t n_expected = 0;
+            for (size_t i = 0; i < n_keys; i++) {
+                size_t d = distance(key, length,
+                        random_keys[i], random_lengths[i]);
+                if (d <= max_distance && share_trigram(key, length,
+                            random_keys[i], random_lengths[i])) {
+                    expected[n_expected++] = (struct ngram_index_result) {
+                        .key = random_keys[i],
+                        .length = random_lengths[i],
+                        .data = &random_keys[i],
+                        .distance = d
+                    };
+                }
+            }
+            qsort(expected, n_expected, sizeof(*expected), &compare_results);
+            n_found[max_distance] += n_expected;
+
+            /* with room for all of them, and with less room */
+            size_t maxes[2] = { RANDOM_KEYS, RANDOM_MAX };
+            for (size_t m = 0; m < 2; m++) {
+                bool oom = false;
+                size_t n_results = ngram_index_search(index, key, length,
+                        max_distance, results, maxes[m], &oom);
+                size_t n_wanted = n_expected < maxes[m] ?
+                    n_expected : maxes[m];
+                bool match = !oom && n_results == n_wanted;
+                for (size_t i = 0; match && i < n_results; i++) {
+                    match = results[i].key == expected[i].key &&
+                        results[i].length == expected[i].length &&
+                        results[i].data == expected[i].data &&
+                        results[i].distance == expected[i].distance;
+                }
+                if (!match) {
+                    printf("Mismatch searching for \"%.*s\" within %zu "
+                            "(up to %zu): %zu results, %zu expected\n",
+                            (int)length, key, max_distance, maxes[m],
+                            n_results, n_wanted);
+                    mismatches[max_distance][m]++;
+                }
+            }
+        }
+    }
+
+    for (size_t max_distance = 0; max_distance < 3; max_distance++) {
+        char name[128];
+        snprintf(name, sizeof(name), "searching the random keys within %zu "
+                "(mismatches)", max_distance);
+        printf("Testing %s\n", name);
+        printf("Expected: 0 and 0 cut off at %d (of %zu keys found)\n",
+                RANDOM_MAX, n_found[max_distance]);
+        printf("Result: %zu and %zu cut off at %d\n",
+                mismatches[max_distance][0], mismatches[max_distance][1],
+                RANDOM_MAX);
+        if (mismatches[max_distance][0] || mismatches[max_distance][1]) {
+            errors++;
+        }
+    }
+
+    ngram_index_destroy(index);
+
+    /* done */
+    printf("Done.\n");
+
+    if (errors) {
+        printf("%zu errors occurred\n", errors);
+    } else {
+        printf("No errors occurred\n");
+    }
+
+    return errors;
+}
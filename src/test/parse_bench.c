@@ -0,0 +1,154 @@
+/* File: src/test/parse_bench.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "command/lex.h"
+#include "command/parse.h"
+#include "name_set.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* a throughput benchmark for the parser
+ *
+ * stdin is lexed up front (so only the parser is timed) and then parsed in
+ * batches of --batch commands, the way the networker hands it commands, as
+ * many times over as --iterations says
+ */
+
+static constexpr size_t input_max = 256 * 1024 * 1024;
+
+static uint64_t now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char ** argv)
+{
+    size_t iterations = 10;
+    size_t batch = 64;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            iterations = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--batch") && i + 1 < argc) {
+            batch = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(
+                    stderr,
+                    "usage: %s [--iterations N] [--batch N] < input\n",
+                    argv[0]
+                );
+            return 1;
+        }
+    }
+
+    if (batch == 0) {
+        batch = 1;
+    }
+
+    uint8_t * input = malloc(input_max);
+    struct particle_buffer * buffer = particle_buffer_create();
+    struct name_set * name_set = name_set_create();
+    struct parser * parser = parser_create(NULL);
+    if (!input || !buffer || !name_set || !parser) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    size_t length = fread(input, 1, input_max, stdin);
+
+    bool oom = false;
+    size_t index = lex(
+            &(struct lexer_input) { .input = input, .length = length },
+            1,
+            name_set,
+            buffer,
+            &oom
+        );
+    if (oom) {
+        fprintf(stderr, "lex() signaled a memory failure\n");
+        return 1;
+    }
+
+    /* where each batch starts and ends */
+    size_t n_batches = 0;
+    size_t * ends = malloc(sizeof(*ends) * (buffer->n_particles + 1));
+    if (!ends) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    ends[n_batches++] = 0;
+    size_t in_batch = 0;
+    for (size_t i = 0; i < buffer->n_particles; i++) {
+        if (buffer->particles[i]->type == PARTICLE_END &&
+                ++in_batch == batch) {
+            ends[n_batches++] = i + 1;
+            in_batch = 0;
+        }
+    }
+    if (ends[n_batches - 1] != buffer->n_particles) {
+        ends[n_batches++] = buffer->n_particles;
+    }
+
+    size_t n_commands = 0;
+    size_t n_errors = 0;
+    uint64_t start = now();
+    for (size_t i = 0; i < iterations; i++) {
+        for (size_t j = 0; j + 1 < n_batches; j++) {
+            struct particle_buffer view = {
+                .particles = &buffer->particles[ends[j]],
+                .n_particles = ends[j + 1] - ends[j]
+            };
+            struct parse_result result;
+            parser_parse(parser, &view, &result);
+            n_commands += result.n_commands;
+            n_errors += result.n_errors;
+        }
+    }
+    uint64_t elapsed = now() - start;
+
+    printf(
+            "%zu bytes lexed (of %zu), %zu particles\n"
+            "%zu commands parsed in %zu iterations, %zu errors\n"
+            "%.3f s, %.1f ns/command, %.0f commands/s\n",
+            index,
+            length,
+            buffer->n_particles,
+            n_commands,
+            iterations,
+            n_errors,
+            elapsed / 1e9,
+            n_commands ? (double)elapsed / n_commands : 0.0,
+            elapsed ? n_commands / (elapsed / 1e9) : 0.0
+        );
+
+    free(ends);
+    particle_buffer_free_all(buffer);
+    particle_buffer_destroy(buffer);
+    parser_destroy(parser);
+    name_set_destroy(name_set);
+    free(input);
+
+    return 0;
+}
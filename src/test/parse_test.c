@@ -0,0 +1,769 @@
+/* File: src/test/parse_test.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "command/lex.h"
+#include "command/parse.h"
+#include "game.h"
+#include "config.h"
+#include "name_set.h"
+#include "util/refstring.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* a test of the parser
+ *
+ * fixed inputs are lexed and parsed, and the commands are dumped (as
+ * "TYPE (ARGUMENT KEYWORD value children...) ..." with subcommands in []s)
+ * and compared against what is expected. then the same inputs are parsed
+ * again, together and after a batch deep enough to grow the parser, to check
+ * that its stacks and arena are reused rather than reallocated. last, some
+ * COMPLETE commands are parsed and run against a game, and the responses are
+ * compared against what is expected.
+ */
+
+/* the same as in game.c, so that a -D for it applies to both */
+#ifndef GAME_COMPLETIONS_MAX_DEFAULT
+#define GAME_COMPLETIONS_MAX_DEFAULT 100
+#endif /* GAME_COMPLETIONS_MAX_DEFAULT */
+
+/* a command and what it should parse to (with this many errors) */
+struct parse_case {
+    const char * input;
+    const char * expected;
+    size_t n_errors;
+};
+
+static const struct parse_case cases[] = {
+    /* every command */
+    { "SAY hello \"world\" (3)\n", "SAY (TEXT <hello \"world\" ( 3 )>)", 0 },
+    { "EXIT\n", "EXIT", 0 },
+    { "SHUTDOWN\n", "SHUTDOWN", 0 },
+    { "VERSION\n", "VERSION", 0 },
+    { "RULES\n", "RULES", 0 },
+    { "READY\n", "READY", 0 },
+    {
+        "LOOK MY HAND 3\n",
+        "LOOK (LOCATION (PLAYER MY) (STACK HAND) (POSITION 3))",
+        0
+    },
+    { "LOOK PLAYER 2 LIFE\n", "LOOK (LIFE (PLAYER PLAYER 2))", 0 },
+    {
+        "LOOK MY ENERGY SOURCES\n",
+        "LOOK (ENERGY SOURCES (PLAYER MY))",
+        0
+    },
+    { "LOOK ENERGY\n", "LOOK (ENERGY)", 0 },
+    {
+        "LOOK ZONE 2 POSITION 1\n",
+        "LOOK (LOCATION (STACK ZONE 2) (POSITION 1))",
+        0
+    },
+    { "LOOK ZONE SPECIAL\n", "LOOK (LOCATION (STACK SPECIAL))", 0 },
+    { "LOOK ZONE ID 4\n", "LOOK (LOCATION (STACK ZONE 4))", 0 },
+    {
+        "LOOK CARD \"Ox\" IN MY GRAVE\n",
+        "LOOK (CARD \"Ox\" (LOCATION (PLAYER MY) (STACK GRAVE)))",
+        0
+    },
+    {
+        "ACTIVATE CARD 5 ABILITY \"strike\"\n",
+        "ACTIVATE (MOVE \"strike\" (CARD 5))",
+        0
+    },
+    { "LIST PLAYERS\n", "LIST (LIST PLAYERS)", 0 },
+    { "LIST MY ZONES\n", "LIST (LIST ZONES (PLAYER MY))", 0 },
+    { "FIND CARD ID 3\n", "FIND (CARD 3)", 0 },
+    {
+        "FIND CARD DISCARD 2\n",
+        "FIND (CARD (LOCATION (STACK DISCARD) (POSITION 2)))",
+        0
+    },
+    { "LOOKUP CARD \"Ox\"\n", "LOOKUP (CARD \"Ox\")", 0 },
+    {
+        "LOOKUP CARD \"Ox\" ABILITY 2\n",
+        "LOOKUP (MOVE 2 (CARD \"Ox\"))",
+        0
+    },
+    {
+        "MOVE MY HAND 1 TO ZONE 2 FACE DOWN DEFENSE MODE\n",
+        "MOVE (LOCATION (PLAYER MY) (STACK HAND) (POSITION 1)) "
+            "(LOCATION (STACK ZONE 2)) (FACE DOWN) (MODE DEFENSE)",
+        0
+    },
+    {
+        "MOVE DECK GRAVE\n",
+        "MOVE (LOCATION (STACK DECK)) (LOCATION (STACK GRAVE))",
+        0
+    },
+    {
+        "PLAY 2 ON ZONE 1 UP ATTACK\n",
+        "PLAY (POSITION 2) (LOCATION (STACK ZONE 1)) (FACE UP) (MODE ATTACK)",
+        0
+    },
+    { "PLAY MY HAND 1\n", "PLAY (LOCATION (PLAYER MY) (STACK HAND) "
+        "(POSITION 1))", 0 },
+    { "COMPLETE \"O\" 5\n", "COMPLETE (PREFIX \"O\") (COUNT 5)", 0 },
+    { "COMPLETE \"O\"\n", "COMPLETE (PREFIX \"O\")", 0 },
+
+    /* subcommands */
+    {
+        "FIND CARD (LOOKUP CARD \"Ox\")\n",
+        "FIND (CARD [LOOKUP (CARD \"Ox\")])",
+        0
+    },
+    {
+        "LOOK DECK (FIND CARD (LOOKUP CARD (VERSION)))\n",
+        "LOOK (LOCATION (STACK DECK) (POSITION "
+            "[FIND (CARD [LOOKUP (CARD [VERSION])])]))",
+        0
+    },
+    {
+        "MOVE MY HAND (SAY a (b) c) TO GRAVE\n",
+        "MOVE (LOCATION (PLAYER MY) (STACK HAND) "
+            "(POSITION [SAY (TEXT <a ( b ) c>)])) (LOCATION (STACK GRAVE))",
+        0
+    },
+    {
+        "ACTIVATE CARD (EXIT) ABILITY (COMPLETE \"a\" 1)\n",
+        "ACTIVATE (MOVE [COMPLETE (PREFIX \"a\") (COUNT 1)] (CARD [EXIT]))",
+        0
+    },
+
+    /* errors */
+    { "FOO\n", "ERROR \"expected a command\" at 0", 1 },
+    { "LOOK\n", "ERROR \"expected something to look at\" at 1", 1 },
+    { "MOVE MY HAND 1 TO\n", "ERROR \"expected a location\" at 5", 1 },
+    {
+        "EXIT now\n",
+        "ERROR \"unexpected input after the end of the command\" at 1",
+        1
+    },
+    { "LOOK DECK (FIND CARD 3\n", "ERROR \"expected )\" at 6", 1 },
+    { "FIND CARD ()\n", "ERROR \"expected a command\" at 3", 1 },
+    {
+        "LOOK DECK 99999999999999999999999\n",
+        "ERROR \"number out of range\" at 2",
+        1
+    },
+    { "LOOK DECK #\n", "ERROR \"invalid input\" at 2", 1 },
+    {
+        "COMPLETE 5\n",
+        "ERROR \"expected a name\" at 1",
+        1
+    },
+    {
+        "PLAY 1 FACE SIDEWAYS\n",
+        "ERROR \"expected UP or DOWN\" at 3",
+        1
+    },
+
+    /* recovery: an error only spoils its own command, and blank lines and
+     * incomplete commands are left out
+     */
+    {
+        "FOO\nVERSION\n\nLOOK\n\nEXIT\n",
+        "ERROR \"expected a command\" at 0; VERSION; "
+            "ERROR \"expected something to look at\" at 1; EXIT",
+        2
+    },
+    {
+        "LOOK DECK (FIND\nLOOK DECK (VERSION)\nEXIT",
+        "ERROR \"expected CARD\" at 4; "
+            "LOOK (LOCATION (STACK DECK) (POSITION [VERSION]))",
+        1
+    }
+};
+
+static constexpr size_t n_cases = sizeof(cases) / sizeof(*cases);
+
+/* how deep the subcommands of the batch that grows the parser go, which is
+ * deeper than PARSER_STACK_SIZE_DEFAULT
+ */
+static constexpr size_t deep = 16;
+
+/* how many copies of the cases are in the batch that spans several blocks of
+ * the arena
+ */
+static constexpr size_t copies = 200;
+
+/* a COMPLETE command and the response it should get from a game with the
+ * names below in it
+ */
+struct complete_case {
+    const char * input;
+    const char * expected;
+};
+
+static const struct complete_case complete_cases[] = {
+    /* the prefix's case is ignored, but it's echoed as given */
+    {
+        "COMPLETE \"AL\"\n",
+        "[server] \"AL\" completes to \"alpaca\" \"alpha\" \"alpine\" "
+            "\"alps\"\n"
+    },
+    {
+        "COMPLETE \"al\" 2\n",
+        "[server] \"al\" completes to \"alpaca\" \"alpha\"\n"
+    },
+    /* the count is at least 1 */
+    {
+        "COMPLETE \"al\" 0\n",
+        "[server] \"al\" completes to \"alpaca\"\n"
+    },
+    { "COMPLETE \"B\" 1000\n", "[server] \"B\" completes to \"beta\"\n" },
+    { "COMPLETE \"z\"\n", "[server] nothing begins with \"z\"\n" }
+};
+
+static constexpr size_t n_complete_cases =
+    sizeof(complete_cases) / sizeof(*complete_cases);
+
+/* the names added to the game, compiled, and then one more after that */
+static const char * complete_names[] = {
+    "Alpha", "alpine", "ALPACA", "Beta"
+};
+
+static constexpr size_t n_complete_names =
+    sizeof(complete_names) / sizeof(*complete_names);
+
+static const char * complete_name_after = "Alps";
+
+/* how many "Player N" names are added too, which is enough for the count
+ * to be cut down to GAME_COMPLETIONS_MAX_DEFAULT
+ */
+static constexpr size_t complete_players = GAME_COMPLETIONS_MAX_DEFAULT + 20;
+
+/* the names of the commands, from keywords.txt */
+#define COMMAND_NAME(name, handler) [COMMAND_##name] = #name,
+static const char * command_names[COMMAND_COUNT] = {
+    COMMAND_HANDLERS(COMMAND_NAME)
+};
+#undef COMMAND_NAME
+
+static const char * argument_names[] = {
+    [ARGUMENT_PLAYER] = "PLAYER",
+    [ARGUMENT_STACK] = "STACK",
+    [ARGUMENT_POSITION] = "POSITION",
+    [ARGUMENT_LOCATION] = "LOCATION",
+    [ARGUMENT_CARD] = "CARD",
+    [ARGUMENT_MOVE] = "MOVE",
+    [ARGUMENT_LIFE] = "LIFE",
+    [ARGUMENT_ENERGY] = "ENERGY",
+    [ARGUMENT_FACE] = "FACE",
+    [ARGUMENT_MODE] = "MODE",
+    [ARGUMENT_LIST] = "LIST",
+    [ARGUMENT_PREFIX] = "PREFIX",
+    [ARGUMENT_COUNT] = "COUNT",
+    [ARGUMENT_TEXT] = "TEXT"
+};
+
+/* the string of each keyword that has been lexed (the arguments only keep
+ * the enum keyword), which is the lexer's (i.e. keyword_string()'s) and so
+ * outlives the particle it came from
+ */
+static const uint8_t * keyword_strings[KEYWORD_COUNT];
+static size_t keyword_lengths[KEYWORD_COUNT];
+
+/* what the commands are dumped into */
+struct dump {
+    char * string;
+    size_t length;
+    size_t capacity;
+};
+
+/* append to this dump, printf-style */
+static void dump_printf(struct dump * dump, const char * format, ...)
+    [[gnu::nonnull(1, 2)]]
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (dump->length + n + 1 > dump->capacity) {
+        dump->capacity = (dump->length + n + 1) * 2;
+        dump->string = realloc(dump->string, dump->capacity);
+        if (!dump->string) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+
+    va_start(args, format);
+    vsnprintf(&dump->string[dump->length], n + 1, format, args);
+    va_end(args);
+    dump->length += n;
+}
+
+static void dump_command(struct dump * dump, const struct command * command)
+    [[gnu::nonnull(1, 2)]];
+
+static void dump_particle(
+        struct dump * dump, const struct particle * particle)
+    [[gnu::nonnull(1, 2)]]
+{
+    switch (particle->type) {
+        case PARTICLE_BEGIN_NEST:
+            dump_printf(dump, "(");
+            break;
+        case PARTICLE_END_NEST:
+            dump_printf(dump, ")");
+            break;
+        case PARTICLE_NAME:
+            dump_printf(dump, "\"%.*s\"",
+                    (int)particle->length, (char *)particle->value);
+            break;
+        default:
+            dump_printf(dump, "%.*s",
+                    (int)particle->length, (char *)particle->value);
+            break;
+    }
+}
+
+static void dump_value(struct dump * dump, const struct value * value)
+    [[gnu::nonnull(1, 2)]]
+{
+    switch (value->type) {
+        case VALUE_NONE:
+            break;
+        case VALUE_NUMBER:
+            dump_printf(dump, " %ld", value->number);
+            break;
+        case VALUE_NAME:
+            dump_printf(dump, " ");
+            dump_particle(dump, value->particle);
+            break;
+        case VALUE_SUBCOMMAND:
+            dump_printf(dump, " [");
+            dump_command(dump, value->subcommand);
+            dump_printf(dump, "]");
+            break;
+        case VALUE_PARTICLES:
+            dump_printf(dump, " <");
+            for (size_t i = 0; i < value->n_particles; i++) {
+                if (i > 0) {
+                    dump_printf(dump, " ");
+                }
+                dump_particle(dump, value->particles[i]);
+            }
+            dump_printf(dump, ">");
+            break;
+    }
+}
+
+static void dump_argument(
+        struct dump * dump, const struct argument * argument)
+    [[gnu::nonnull(1, 2)]]
+{
+    dump_printf(dump, "(%s", argument_names[argument->type]);
+    if (argument->keyword != KEYWORD_NO_MATCH) {
+        dump_printf(dump, " %.*s",
+                (int)keyword_lengths[argument->keyword],
+                (const char *)keyword_strings[argument->keyword]);
+    }
+    dump_value(dump, &argument->value);
+    for (const struct argument * child = argument->children; child;
+            child = child->next) {
+        dump_printf(dump, " ");
+        dump_argument(dump, child);
+    }
+    dump_printf(dump, ")");
+}
+
+static void dump_command(struct dump * dump, const struct command * command)
+{
+    if (command->type == COMMAND_ERROR) {
+        dump_printf(dump, "ERROR \"%s\" at %zu",
+                command->error, command->error_index);
+        return;
+    }
+
+    dump_printf(dump, "%s", command_names[command->type]);
+    for (const struct argument * argument = command->arguments; argument;
+            argument = argument->next) {
+        dump_printf(dump, " ");
+        dump_argument(dump, argument);
+    }
+}
+
+/* dump every command of this result, separated by "; " */
+static void dump_result(struct dump * dump, const struct parse_result * result)
+    [[gnu::nonnull(1, 2)]]
+{
+    dump->length = 0;
+    dump_printf(dump, "%s", "");
+    for (const struct command * command = result->commands; command;
+            command = command->next) {
+        if (command != result->commands) {
+            dump_printf(dump, "; ");
+        }
+        dump_command(dump, command);
+    }
+}
+
+/* mark the type of this command, and of its subcommands, as seen */
+static void see_command(bool * seen, const struct command * command)
+    [[gnu::nonnull(1, 2)]];
+
+static void see_argument(bool * seen, const struct argument * argument)
+    [[gnu::nonnull(1, 2)]]
+{
+    if (argument->value.type == VALUE_SUBCOMMAND) {
+        see_command(seen, argument->value.subcommand);
+    }
+    for (const struct argument * child = argument->children; child;
+            child = child->next) {
+        see_argument(seen, child);
+    }
+}
+
+static void see_command(bool * seen, const struct command * command)
+{
+    seen[command->type] = true;
+    for (const struct argument * argument = command->arguments; argument;
+            argument = argument->next) {
+        see_argument(seen, argument);
+    }
+}
+
+/* lex this input into buffer (which is emptied first) */
+static void lex_string(
+        struct particle_buffer * buffer,
+        struct name_set * name_set,
+        const char * input
+    ) [[gnu::nonnull(1, 2, 3)]]
+{
+    particle_buffer_free_all(buffer);
+
+    bool oom = false;
+    lex(
+            &(struct lexer_input) {
+                .input = (const uint8_t *)input,
+                .length = strlen(input)
+            },
+            1,
+            name_set,
+            buffer,
+            &oom
+        );
+    if (oom) {
+        fprintf(stderr, "lex() signaled a memory failure\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < buffer->n_particles; i++) {
+        const struct particle * particle = buffer->particles[i];
+        if (particle->type == PARTICLE_KEYWORD &&
+                particle->keyword != KEYWORD_NO_MATCH) {
+            keyword_strings[particle->keyword] = particle->value;
+            keyword_lengths[particle->keyword] = particle->length;
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    printf("Sanity check parser..\n");
+
+    size_t errors = 0;
+
+    struct particle_buffer * buffer = particle_buffer_create();
+    struct name_set * name_set = name_set_create();
+    struct parser * parser = parser_create(NULL);
+    if (!buffer || !name_set || !parser) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    struct dump dump = { };
+    struct parse_result result;
+
+    /* each case on its own */
+    bool seen[COMMAND_COUNT] = { };
+    for (size_t i = 0; i < n_cases; i++) {
+        lex_string(buffer, name_set, cases[i].input);
+        parser_parse(parser, buffer, &result);
+        dump_result(&dump, &result);
+
+        printf("Testing %s", cases[i].input);
+        if (cases[i].input[strlen(cases[i].input) - 1] != '\n') {
+            printf("\n");
+        }
+        printf("Expected: %s (%zu errors)\n",
+                cases[i].expected, cases[i].n_errors);
+        printf("Result: %s (%zu errors)\n", dump.string, result.n_errors);
+
+        if (strcmp(dump.string, cases[i].expected) ||
+                result.n_errors != cases[i].n_errors ||
+                (result.type == PARSE_ERROR) != (result.n_errors > 0)) {
+            errors++;
+        }
+
+        for (const struct command * command = result.commands; command;
+                command = command->next) {
+            see_command(seen, command);
+        }
+    }
+
+    size_t unseen = 0;
+    for (size_t i = 1; i < COMMAND_COUNT; i++) {
+        if (!seen[i]) {
+            printf("no case parses to %s\n", command_names[i]);
+            unseen++;
+        }
+    }
+    printf("Testing that every command in keywords.txt has a case\n");
+    printf("Expected: 0 without one\n");
+    printf("Result: %zu without one\n", unseen);
+    if (unseen) {
+        errors++;
+    }
+
+    /* a batch of subcommands nested deep enough to grow the stacks */
+    struct dump input = { };
+    struct dump expected = { };
+    for (size_t i = 0; i < deep; i++) {
+        dump_printf(&input, "LOOK DECK (");
+        dump_printf(&expected, "LOOK (LOCATION (STACK DECK) (POSITION [");
+    }
+    dump_printf(&input, "VERSION");
+    dump_printf(&expected, "VERSION");
+    for (size_t i = 0; i < deep; i++) {
+        dump_printf(&input, ")");
+        dump_printf(&expected, "]))");
+    }
+    dump_printf(&input, "\n");
+
+    size_t stack_capacity = parser->stack_capacity;
+    size_t frames_capacity = parser->frames_capacity;
+
+    lex_string(buffer, name_set, input.string);
+    parser_parse(parser, buffer, &result);
+    dump_result(&dump, &result);
+    printf("Testing subcommands nested %zu deep\n", deep);
+    printf("Expected: %s\n", expected.string);
+    printf("Result: %s\n", dump.string);
+    if (strcmp(dump.string, expected.string)) {
+        errors++;
+    }
+
+    printf("Testing that they grew the stacks\n");
+    printf("Expected: more than %zu and %zu deep\n",
+            stack_capacity, frames_capacity);
+    printf("Result: %zu and %zu deep\n",
+            parser->stack_capacity, parser->frames_capacity);
+    if (parser->stack_capacity <= stack_capacity ||
+            parser->frames_capacity <= frames_capacity) {
+        errors++;
+    }
+
+    const struct parser_symbol ** stack = parser->stack;
+    struct parser_frame * frames = parser->frames;
+    stack_capacity = parser->stack_capacity;
+    frames_capacity = parser->frames_capacity;
+
+    /* every case (that ends in a newline) in one batch, many times over, so
+     * that it spans several blocks of the arena
+     */
+    input.length = 0;
+    expected.length = 0;
+    size_t n_errors = 0;
+    dump_printf(&input, "%s", "");
+    dump_printf(&expected, "%s", "");
+    for (size_t copy = 0; copy < copies; copy++) {
+        for (size_t i = 0; i < n_cases; i++) {
+            const char * case_input = cases[i].input;
+            if (case_input[strlen(case_input) - 1] != '\n') {
+                continue;
+            }
+            dump_printf(&input, "%s", case_input);
+            dump_printf(&expected, "%s%s",
+                    expected.length ? "; " : "", cases[i].expected);
+            n_errors += cases[i].n_errors;
+        }
+    }
+
+    lex_string(buffer, name_set, input.string);
+    parser_parse(parser, buffer, &result);
+    dump_result(&dump, &result);
+    printf("Testing every case %zu times in one batch\n", copies);
+    printf("Expected: %zu errors, the same dump\n", n_errors);
+    printf("Result: %zu errors, %s dump\n", result.n_errors,
+            strcmp(dump.string, expected.string) ? "a different" : "the same");
+    if (strcmp(dump.string, expected.string) || result.n_errors != n_errors) {
+        errors++;
+    }
+
+    const struct command ** addresses =
+        malloc(sizeof(*addresses) * result.n_commands);
+    if (!addresses) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    size_t n_addresses = 0;
+    for (const struct command * command = result.commands; command;
+            command = command->next) {
+        addresses[n_addresses++] = command;
+    }
+
+    /* the same batch again, which should land in the same places in the
+     * arena, without the stacks moving
+     */
+    parser_parse(parser, buffer, &result);
+    size_t moved = 0;
+    size_t n = 0;
+    for (const struct command * command = result.commands; command;
+            command = command->next) {
+        if (n >= n_addresses || addresses[n] != command) {
+            moved++;
+        }
+        n++;
+    }
+    if (n != n_addresses) {
+        moved++;
+    }
+    dump_result(&dump, &result);
+    printf("Testing the same batch again\n");
+    printf("Expected: 0 commands at new addresses, the same dump\n");
+    printf("Result: %zu commands at new addresses, %s dump\n", moved,
+            strcmp(dump.string, expected.string) ? "a different" : "the same");
+    if (moved || strcmp(dump.string, expected.string)) {
+        errors++;
+    }
+
+    /* and a small batch after it, which should start where the big one did
+     * (and not see anything left over from it)
+     */
+    lex_string(buffer, name_set, cases[0].input);
+    parser_parse(parser, buffer, &result);
+    dump_result(&dump, &result);
+    printf("Testing a small batch after the big one\n");
+    printf("Expected: %s at the start of the arena\n", cases[0].expected);
+    printf("Result: %s at %s\n", dump.string,
+            result.commands == addresses[0] ?
+                "the start of the arena" : "somewhere else");
+    if (strcmp(dump.string, cases[0].expected) ||
+            result.commands != addresses[0]) {
+        errors++;
+    }
+
+    printf("Testing that the stacks were reused\n");
+    printf("Expected: %zu and %zu deep, not moved\n",
+            stack_capacity, frames_capacity);
+    printf("Result: %zu and %zu deep, %s\n",
+            parser->stack_capacity, parser->frames_capacity,
+            parser->stack == stack && parser->frames == frames ?
+                "not moved" : "moved");
+    if (parser->stack != stack || parser->frames != frames ||
+            parser->stack_capacity != stack_capacity ||
+            parser->frames_capacity != frames_capacity) {
+        errors++;
+    }
+
+    /* COMPLETE against a game */
+    struct game * game = game_create(&(struct config) { });
+    if (!game) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bool oom = false;
+    for (size_t i = 0; i < n_complete_names; i++) {
+        name_set_add(game->name_set, (const uint8_t *)complete_names[i],
+                strlen(complete_names[i]), NULL, NAME_TYPE_PLAYER, &oom);
+    }
+    for (size_t i = 0; i < complete_players; i++) {
+        char name[32];
+        size_t length = snprintf(name, sizeof(name), "Player %03zu", i);
+        name_set_add(game->name_set, (const uint8_t *)name, length, NULL,
+                NAME_TYPE_PLAYER, &oom);
+    }
+    name_set_compile(game->name_set);
+    name_set_add(game->name_set, (const uint8_t *)complete_name_after,
+            strlen(complete_name_after), NULL, NAME_TYPE_PLAYER, &oom);
+    if (oom) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    /* the fixed cases, and a count over the maximum, which returns the
+     * first GAME_COMPLETIONS_MAX_DEFAULT players
+     */
+    dump.length = 0;
+    dump_printf(&dump, "[server] \"player\" completes to");
+    for (size_t i = 0; i < GAME_COMPLETIONS_MAX_DEFAULT; i++) {
+        dump_printf(&dump, " \"player %03zu\"", i);
+    }
+    dump_printf(&dump, "\n");
+    char * clamped = dump.string;
+    dump = (struct dump) { };
+
+    for (size_t i = 0; i <= n_complete_cases; i++) {
+        const char * complete_input = i < n_complete_cases ?
+            complete_cases[i].input : "COMPLETE \"player\" 1000\n";
+        const char * complete_expected = i < n_complete_cases ?
+            complete_cases[i].expected : clamped;
+
+        lex_string(buffer, game->name_set, complete_input);
+        parser_parse(parser, buffer, &result);
+        struct refstring * response = NULL;
+        if (result.type != PARSE_ERROR && result.n_commands == 1) {
+            response = game_complete(game, &result.commands[0]);
+        }
+
+        printf("Testing %s", complete_input);
+        printf("Expected: %s", complete_expected);
+        printf("Result: %s", response ?
+                (const char *)refstring_string(response) : "no command\n");
+        if (!response || strcmp(
+                    (const char *)refstring_string(response),
+                    complete_expected)) {
+            errors++;
+        }
+        if (response) {
+            refstring_destroy(response);
+        }
+    }
+
+    free(clamped);
+    game_destroy(game);
+    free(addresses);
+    free(input.string);
+    free(expected.string);
+    free(dump.string);
+    particle_buffer_free_all(buffer);
+    particle_buffer_destroy(buffer);
+    parser_destroy(parser);
+    name_set_destroy(name_set);
+
+    /* done */
+    printf("Done.\n");
+
+    if (errors) {
+        printf("%zu errors occurred\n", errors);
+    } else {
+        printf("No errors occurred\n");
+    }
+
+    return errors;
+}
@@ -0,0 +1,346 @@
+/* File: src/test/server_bench.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "networker.h"
+#include "config.h"
+#include "util/safe_realloc.h"
+#include "util/strdup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+
+/* an end-to-end benchmark of the server
+ *
+ * a networker (and its game) is created as usual, but instead of connecting
+ * over sockets, --clients in-process clients are connected to it with
+ * networker_connect_pair(), all on the networker's own event loop. each
+ * sends --commands commands, keeping up to --pipeline of them in flight, and
+ * times how long each takes to be answered. everything goes through the same
+ * path as it would from a socket: input callback, lex(), parser_parse(), the
+ * command handlers, and the output buffer.
+ *
+ * the commands come from --script (one per line) or, by default, a built-in
+ * mix. every command must get exactly one line in response, which rules out
+ * SAY (which is broadcast to everyone) and EXIT.
+ */
+
+/* the default mix of commands */
+static const char * default_script[] = {
+    "look card \"fireball\"\n",
+    "look my hand\n",
+    "look player 2 life\n",
+    "version\n",
+    "find card id 3\n",
+    "move my hand 1 to zone 2 face down\n",
+    "move hand to\n",
+    "activate card 7 ability \"strike\"\n",
+    "complete \"fi\" 5\n"
+};
+
+/* the arguments */
+static struct {
+    size_t clients;
+    size_t commands;
+    size_t pipeline;
+    const char * script;
+} args = {
+    .clients = 16,
+    .commands = 10000,
+    .pipeline = 1
+};
+
+/* the script, as an array of lines (including their newlines) */
+static char ** lines;
+static size_t * line_lengths;
+static size_t n_lines;
+
+/* a client */
+struct client {
+    struct bufferevent * bev;
+    bool welcomed;
+    size_t sent;
+    size_t received;
+    uint64_t * sent_at; /* a ring of args.pipeline send times */
+};
+
+static struct client * clients;
+static size_t clients_done;
+static uint64_t * latencies;
+static size_t n_latencies;
+
+static uint64_t now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* send this client's next command */
+static void client_send(struct client * client) [[gnu::nonnull(1)]]
+{
+    size_t index = (client - clients + client->sent) % n_lines;
+    client->sent_at[client->sent % args.pipeline] = now();
+    bufferevent_write(client->bev, lines[index], line_lengths[index]);
+    client->sent++;
+}
+
+/* handle every complete line of response this client has received */
+static void client_read_cb(struct bufferevent * bev, void * ptr)
+{
+    struct client * client = ptr;
+    struct evbuffer * input = bufferevent_get_input(bev);
+
+    while (true) {
+        size_t eol_length;
+        struct evbuffer_ptr eol = evbuffer_search_eol(
+                input, NULL, &eol_length, EVBUFFER_EOL_LF);
+        if (eol.pos < 0) {
+            break;
+        }
+        evbuffer_drain(input, eol.pos + eol_length);
+
+        if (!client->welcomed) {
+            client->welcomed = true;
+            while (client->sent < args.commands &&
+                    client->sent < args.pipeline) {
+                client_send(client);
+            }
+            continue;
+        }
+
+        latencies[n_latencies++] =
+            now() - client->sent_at[client->received % args.pipeline];
+        client->received++;
+
+        if (client->sent < args.commands) {
+            client_send(client);
+        } else if (client->received == args.commands) {
+            if (++clients_done == args.clients) {
+                event_base_loopbreak(bufferevent_get_base(bev));
+            }
+            break;
+        }
+    }
+}
+
+static void client_event_cb(struct bufferevent * bev, short events, void * ptr)
+{
+    (void)ptr;
+    if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        fprintf(stderr, "a client was disconnected\n");
+        event_base_loopbreak(bufferevent_get_base(bev));
+    }
+}
+
+/* read the script from args.script, or use the default one */
+static bool load_script()
+{
+    if (!args.script) {
+        n_lines = sizeof(default_script) / sizeof(*default_script);
+        lines = malloc(sizeof(*lines) * n_lines);
+        line_lengths = malloc(sizeof(*line_lengths) * n_lines);
+        if (!lines || !line_lengths) {
+            return false;
+        }
+        for (size_t i = 0; i < n_lines; i++) {
+            lines[i] = util_strdup(default_script[i]);
+            line_lengths[i] = strlen(default_script[i]);
+            if (!lines[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    FILE * file = fopen(args.script, "r");
+    if (!file) {
+        fprintf(stderr, "could not open script %s\n", args.script);
+        return false;
+    }
+
+    char * line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, file)) > 0) {
+        if (line[length - 1] != '\n') {
+            continue;
+        }
+        lines = safe_realloc(lines, sizeof(*lines) * (n_lines + 1));
+        line_lengths = safe_realloc(
+                line_lengths, sizeof(*line_lengths) * (n_lines + 1));
+        if (!lines || !line_lengths) {
+            return false;
+        }
+        lines[n_lines] = util_strdup(line);
+        line_lengths[n_lines] = length;
+        if (!lines[n_lines]) {
+            return false;
+        }
+        n_lines++;
+    }
+    free(line);
+    fclose(file);
+
+    if (n_lines == 0) {
+        fprintf(stderr, "script %s has no commands\n", args.script);
+        return false;
+    }
+    return true;
+}
+
+static int compare_latencies(const void * a, const void * b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* the pth percentile latency, in microseconds */
+static double percentile(double p)
+{
+    if (n_latencies == 0) {
+        return 0;
+    }
+    size_t index = (size_t)(p / 100 * (n_latencies - 1));
+    return latencies[index] / 1e3;
+}
+
+static void usage(const char * name) [[gnu::nonnull(1)]]
+{
+    fprintf(
+            stderr,
+            "usage: %s [--clients N] [--commands N] [--pipeline N] "
+            "[--script FILE]\n",
+            name
+        );
+}
+
+int main(int argc, char ** argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (!strcmp(argv[i], "--clients")) {
+            args.clients = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--commands")) {
+            args.commands = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--pipeline")) {
+            args.pipeline = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--script")) {
+            args.script = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (args.clients == 0 || args.commands == 0 || args.pipeline == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!load_script()) {
+        fprintf(stderr, "could not load the script\n");
+        return 1;
+    }
+
+    /* no limits, timeouts, or admin socket, and an ephemeral port that
+     * nothing connects to
+     */
+    struct config config = (struct config) {
+        .admin_socket = ""
+    };
+
+    struct networker * networker = networker_create(&config);
+    if (!networker) {
+        fprintf(stderr, "networker_create() failed\n");
+        return 1;
+    }
+
+    clients = calloc(args.clients, sizeof(*clients));
+    latencies = malloc(sizeof(*latencies) * args.clients * args.commands);
+    if (!clients || !latencies) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < args.clients; i++) {
+        struct client * client = &clients[i];
+        client->sent_at = malloc(sizeof(*client->sent_at) * args.pipeline);
+        client->bev = networker_connect_pair(networker);
+        if (!client->sent_at || !client->bev) {
+            fprintf(stderr, "could not connect client %zu\n", i);
+            return 1;
+        }
+        bufferevent_setcb(
+                client->bev, &client_read_cb, NULL, &client_event_cb, client);
+        bufferevent_enable(client->bev, EV_READ | EV_WRITE);
+    }
+
+    uint64_t start = now();
+    event_base_dispatch(networker_base(networker));
+    uint64_t elapsed = now() - start;
+
+    qsort(latencies, n_latencies, sizeof(*latencies), &compare_latencies);
+
+    printf(
+            "%zu clients, %zu commands each, pipeline %zu\n"
+            "%zu commands in %.3f s, %.0f commands/s\n"
+            "latency (us): p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f\n",
+            args.clients,
+            args.commands,
+            args.pipeline,
+            n_latencies,
+            elapsed / 1e9,
+            elapsed ? n_latencies / (elapsed / 1e9) : 0.0,
+            percentile(50),
+            percentile(90),
+            percentile(99),
+            percentile(99.9),
+            percentile(100)
+        );
+
+    bool okay = clients_done == args.clients;
+
+    for (size_t i = 0; i < args.clients; i++) {
+        bufferevent_free(clients[i].bev);
+        free(clients[i].sent_at);
+    }
+    free(clients);
+    /* let the server side of each pair see its EOF and close */
+    event_base_loop(networker_base(networker), EVLOOP_NONBLOCK);
+    free(latencies);
+    networker_destroy(networker);
+    for (size_t i = 0; i < n_lines; i++) {
+        free(lines[i]);
+    }
+    free(lines);
+    free(line_lengths);
+
+    return okay ? 0 : 1;
+}
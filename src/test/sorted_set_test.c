@@ -259,6 +259,99 @@ int main(int argc, char ** argv)
     }
     free(keys.keys);
 
+    /* test the cursors */
+    struct sorted_set * set3 = sorted_set_create();
+    const char * cursor_keys[] = {
+        "card", "cardboard", "cards", "carp", "cat", "dog", "dot"
+    };
+    size_t n_cursor_keys = sizeof(cursor_keys) / sizeof(*cursor_keys);
+    for (size_t i = n_cursor_keys; i > 0; i--) {
+        const char * key = cursor_keys[i - 1];
+        sorted_set_add_key(set3, strdup(key), strlen(key), NULL);
+    }
+
+    struct {
+        const char * name;
+        struct sorted_set_cursor cursor;
+        const char * expected;
+    } cursor_tests[] = {
+        {
+            "sorted_set_first",
+            sorted_set_first(set3),
+            "card cardboard cards carp cat dog dot"
+        },
+        {
+            "sorted_set_lower_bound(\"cards\")",
+            sorted_set_lower_bound(set3, "cards", 5),
+            "cards carp cat dog dot"
+        },
+        {
+            "sorted_set_lower_bound(\"cart\")",
+            sorted_set_lower_bound(set3, "cart", 4),
+            "cat dog dot"
+        },
+        {
+            "sorted_set_upper_bound(\"cards\")",
+            sorted_set_upper_bound(set3, "cards", 5),
+            "carp cat dog dot"
+        },
+        {
+            "sorted_set_upper_bound(\"dot\")",
+            sorted_set_upper_bound(set3, "dot", 3),
+            ""
+        },
+        {
+            "sorted_set_prefix(\"card\")",
+            sorted_set_prefix(set3, "card", 4),
+            "card cardboard cards"
+        },
+        {
+            "sorted_set_prefix(\"do\")",
+            sorted_set_prefix(set3, "do", 2),
+            "dog dot"
+        },
+        {
+            "sorted_set_prefix(\"cow\")",
+            sorted_set_prefix(set3, "cow", 3),
+            ""
+        }
+    };
+
+    for (size_t i = 0; i < sizeof(cursor_tests) / sizeof(*cursor_tests); i++) {
+        char buffer[128] = { };
+        size_t used = 0;
+        const struct sorted_set_lookup_result * result;
+        while ((result = sorted_set_cursor_next(&cursor_tests[i].cursor))) {
+            used += snprintf(
+                    &buffer[used], sizeof(buffer) - used, "%s%.*s",
+                    used ? " " : "", (int)result->length, result->key);
+        }
+
+        printf("Testing %s\n", cursor_tests[i].name);
+        printf("Expected: %s\n", cursor_tests[i].expected);
+        printf("Result: %s\n", buffer);
+
+        if (strcmp(buffer, cursor_tests[i].expected)) {
+            errors++;
+        }
+    }
+
+    /* stopping early just means not calling sorted_set_cursor_next() again */
+    struct sorted_set_cursor cursor = sorted_set_lower_bound(set3, "c", 1);
+    const struct sorted_set_lookup_result * first =
+        sorted_set_cursor_next(&cursor);
+
+    printf("Testing the first key of sorted_set_lower_bound(\"c\")\n");
+    printf("Expected: card\n");
+    printf("Result: %.*s\n", first ? (int)first->length : 0,
+            first ? first->key : "");
+
+    if (!first || first->length != 4 || memcmp(first->key, "card", 4)) {
+        errors++;
+    }
+
+    sorted_set_destroy(set3);
+
     /* done */
     printf("Done.\n");
 
@@ -0,0 +1,249 @@
+/* File: src/test/string_pool_test.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "util/string_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the same as in string_pool.c, so that a -D for it applies to both */
+#ifndef STRING_POOL_BLOCK_DEFAULT
+#define STRING_POOL_BLOCK_DEFAULT 16384
+#endif /* STRING_POOL_BLOCK_DEFAULT */
+
+/* how many small strings are interned, which is enough to grow the table
+ * and the entries many times over, and to fill several blocks
+ */
+#define SMALL_STRINGS 5000
+
+/* the lengths of the big strings, around where they stop being packed into
+ * blocks and get an allocation of their own
+ */
+static const size_t big_lengths[] = {
+    STRING_POOL_BLOCK_DEFAULT / 4 - 1,
+    STRING_POOL_BLOCK_DEFAULT / 4,
+    STRING_POOL_BLOCK_DEFAULT / 4 + 1,
+    STRING_POOL_BLOCK_DEFAULT * 2
+};
+
+#define BIG_STRINGS (sizeof(big_lengths) / sizeof(*big_lengths))
+
+static size_t errors = 0;
+
+/* print a check of this value and count an error if it isn't as expected */
+static void check(const char * name, long expected, long result)
+{
+    printf("Testing %s\n", name);
+    printf("Expected: %ld\n", expected);
+    printf("Result: %ld\n", result);
+
+    if (result != expected) {
+        errors++;
+    }
+}
+
+/* write the nth small string to buffer, returning its length
+ *
+ * every seventh one has a zero byte in the middle, and the 0th is empty
+ */
+static size_t small_string(uint8_t * buffer, size_t n) [[gnu::nonnull(1)]]
+{
+    if (n == 0) {
+        return 0;
+    }
+    size_t length = sprintf((char *)buffer, "string %zu", n);
+    if (n % 7 == 0) {
+        buffer[3] = 0;
+    }
+    return length;
+}
+
+/* the nth big string, which is all one letter except for its last byte, so
+ * that big strings of the same length only differ there
+ */
+static uint8_t * big_string(size_t n, char last) [[gnu::returns_nonnull]]
+{
+    uint8_t * string = malloc(big_lengths[n]);
+    if (!string) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    memset(string, 'a' + n, big_lengths[n]);
+    string[big_lengths[n] - 1] = last;
+    return string;
+}
+
+/* returns true if this view is of this string (with a null terminator) */
+static bool view_is(
+        struct string_view view, const uint8_t * string, size_t length)
+    [[gnu::nonnull(2)]]
+{
+    return view.string && view.length == length &&
+        !memcmp(view.string, string, length) && view.string[length] == 0;
+}
+
+int main(int argc, char ** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    printf("Sanity check string_pool..\n");
+
+    struct string_pool * pool = string_pool_create();
+    if (!pool) {
+        printf("string_pool_create() failed\n");
+        return 1;
+    }
+
+    uint8_t buffer[32];
+    check("finding the empty string in an empty pool",
+            STRING_POOL_NO_ID, string_pool_find(pool, buffer, 0));
+
+    /* the small strings get ids in the order they're interned, and their
+     * views are remembered to check that they don't move later
+     */
+    static const uint8_t * small_views[SMALL_STRINGS];
+    size_t wrong_ids = 0;
+    size_t wrong_views = 0;
+    for (size_t i = 0; i < SMALL_STRINGS; i++) {
+        size_t length = small_string(buffer, i);
+        uint32_t id = string_pool_intern(pool, buffer, length);
+        if (id != i) {
+            wrong_ids++;
+            continue;
+        }
+        struct string_view view = string_pool_view(pool, id);
+        if (!view_is(view, buffer, length)) {
+            wrong_views++;
+        }
+        small_views[i] = view.string;
+    }
+    check("interning distinct strings (wrong ids)", 0, wrong_ids);
+    check("their views (wrong)", 0, wrong_views);
+    check("the size", SMALL_STRINGS, string_pool_size(pool));
+
+    /* the big ones, each next to one that only differs in its last byte */
+    uint32_t big_ids[BIG_STRINGS][2];
+    const uint8_t * big_views[BIG_STRINGS][2];
+    wrong_ids = 0;
+    wrong_views = 0;
+    for (size_t i = 0; i < BIG_STRINGS; i++) {
+        for (size_t j = 0; j < 2; j++) {
+            uint8_t * string = big_string(i, j ? 'y' : 'x');
+            big_ids[i][j] = string_pool_intern(pool, string, big_lengths[i]);
+            if (big_ids[i][j] != SMALL_STRINGS + 2 * i + j) {
+                wrong_ids++;
+            } else {
+                struct string_view view =
+                    string_pool_view(pool, big_ids[i][j]);
+                if (!view_is(view, string, big_lengths[i])) {
+                    wrong_views++;
+                }
+                big_views[i][j] = view.string;
+            }
+            free(string);
+        }
+    }
+    check("interning big strings (wrong ids)", 0, wrong_ids);
+    check("their views (wrong)", 0, wrong_views);
+    check("the size", SMALL_STRINGS + 2 * BIG_STRINGS,
+            string_pool_size(pool));
+
+    /* interning or finding any of them again gives the same id and doesn't
+     * add anything, and their views haven't moved despite everything that
+     * grew since
+     */
+    wrong_ids = 0;
+    wrong_views = 0;
+    for (size_t i = 0; i < SMALL_STRINGS; i++) {
+        size_t length = small_string(buffer, i);
+        if (string_pool_intern(pool, buffer, length) != i ||
+                string_pool_find(pool, buffer, length) != i) {
+            wrong_ids++;
+        }
+        struct string_view view = string_pool_view(pool, i);
+        if (!view_is(view, buffer, length) || view.string != small_views[i]) {
+            wrong_views++;
+        }
+    }
+    for (size_t i = 0; i < BIG_STRINGS; i++) {
+        for (size_t j = 0; j < 2; j++) {
+            uint8_t * string = big_string(i, j ? 'y' : 'x');
+            if (string_pool_intern(pool, string, big_lengths[i]) !=
+                    big_ids[i][j] ||
+                    string_pool_find(pool, string, big_lengths[i]) !=
+                    big_ids[i][j]) {
+                wrong_ids++;
+            }
+            struct string_view view = string_pool_view(pool, big_ids[i][j]);
+            if (!view_is(view, string, big_lengths[i]) ||
+                    view.string != big_views[i][j]) {
+                wrong_views++;
+            }
+            free(string);
+        }
+    }
+    check("interning and finding every string again (wrong ids)",
+            0, wrong_ids);
+    check("their views (wrong or moved)", 0, wrong_views);
+    check("the size", SMALL_STRINGS + 2 * BIG_STRINGS,
+            string_pool_size(pool));
+
+    /* strings that were never interned, including ones that are a prefix of
+     * one that was, or begin with one, or only differ after a zero byte
+     */
+    size_t found = 0;
+    static const char * never[] = {
+        "string", "string 1 ", "string 0", "strinG 1", "str"
+    };
+    for (size_t i = 0; i < sizeof(never) / sizeof(*never); i++) {
+        found += string_pool_find(pool, (const uint8_t *)never[i],
+                strlen(never[i])) != STRING_POOL_NO_ID;
+    }
+    size_t length = small_string(buffer, 7);
+    buffer[4] = 'X';
+    found += string_pool_find(pool, buffer, length) != STRING_POOL_NO_ID;
+    length = small_string(buffer, SMALL_STRINGS);
+    found += string_pool_find(pool, buffer, length) != STRING_POOL_NO_ID;
+    for (size_t i = 0; i < BIG_STRINGS; i++) {
+        uint8_t * string = big_string(i, 'z');
+        found += string_pool_find(pool, string, big_lengths[i]) !=
+            STRING_POOL_NO_ID;
+        found += string_pool_find(pool, string, big_lengths[i] - 1) !=
+            STRING_POOL_NO_ID;
+        free(string);
+    }
+    check("finding strings that were never interned (found)", 0, found);
+    check("the size", SMALL_STRINGS + 2 * BIG_STRINGS,
+            string_pool_size(pool));
+
+    string_pool_destroy(pool);
+
+    /* done */
+    printf("Done.\n");
+
+    if (errors) {
+        printf("%zu errors occurred\n", errors);
+    } else {
+        printf("No errors occurred\n");
+    }
+
+    return errors;
+}
@@ -22,6 +22,7 @@
 #include "util/strdup.h"
 
 #include <stdlib.h>
+#include <errno.h>
 #include <argp.h>
 
 const char * argp_program_version =
@@ -39,6 +40,13 @@ static char args_doc[] =
 static struct argp_option options[] = {
     { "validate", 'v', NULL, 0,
         "Validate the each Lua script" },
+    { "prefix", 'p', "PREFIX", 0,
+        "Only list cards whose filenames begin with PREFIX" },
+    { "after", 'a', "NAME", 0,
+        "Only list cards whose filenames sort after NAME (e.g. the last "
+        "one on the previous page)" },
+    { "limit", 'n', "N", 0,
+        "List at most N cards" },
     { }
 };
 
@@ -51,6 +59,26 @@ static error_t parse_opt(int key, char * argv, struct argp_state * state)
             args->validate = true;
             break;
 
+        case 'p':
+            free(args->prefix);
+            args->prefix = util_strdup(argv);
+            break;
+
+        case 'a':
+            free(args->after);
+            args->after = util_strdup(argv);
+            break;
+
+        case 'n': {
+            char * end;
+            args->limit = strtoull(argv, &end, 10);
+            if (!*argv || *end) {
+                argp_error(state, "invalid limit '%s'", argv);
+                return EINVAL;
+            }
+            break;
+        }
+
         case ARGP_KEY_ARG:
             if (args->database_name) {
                 return ARGP_ERR_UNKNOWN;
@@ -66,7 +94,13 @@ static error_t parse_opt(int key, char * argv, struct argp_state * state)
             break;
 
         case ARGP_KEY_ERROR:
+            /* NULL these too, main() frees them again */
             free(args->database_name);
+            free(args->prefix);
+            free(args->after);
+            args->database_name = NULL;
+            args->prefix = NULL;
+            args->after = NULL;
             break;
 
         default:
@@ -27,11 +27,17 @@
 
 static void usage()
 {
-    fprintf(stderr, "Usage: cards_compile [--help] [-v|--validate] DATABASE\n");
+    fprintf(stderr,
+            "Usage: cards_inspect [--help] [-v|--validate] "
+            "[-p|--prefix PREFIX]\n"
+            "                     [-a|--after NAME] [-n|--limit N] DATABASE\n");
 }
 
 static struct option options[] = {
     { "validate", 0, 0, 'v' },
+    { "prefix", 1, 0, 'p' },
+    { "after", 1, 0, 'a' },
+    { "limit", 1, 0, 'n' },
     { "help", 0, 0, 1000 },
     { }
 };
@@ -41,7 +47,7 @@ int parse_args(
 {
     while (1) {
         int index = 0;
-        int c = getopt_long(argc, argv, "v", options, &index);
+        int c = getopt_long(argc, argv, "vp:a:n:", options, &index);
 
         if (c == -1) {
             break;
@@ -52,6 +58,27 @@ int parse_args(
                 args->validate = true;
                 break;
 
+            case 'p':
+                free(args->prefix);
+                args->prefix = util_strdup(optarg);
+                break;
+
+            case 'a':
+                free(args->after);
+                args->after = util_strdup(optarg);
+                break;
+
+            case 'n': {
+                char * end;
+                args->limit = strtoull(optarg, &end, 10);
+                if (!*optarg || *end) {
+                    fprintf(stderr, "invalid limit '%s'\n", optarg);
+                    usage();
+                    return 2;
+                }
+                break;
+            }
+
             case 1000:
             case '?':
                 usage();
@@ -19,16 +19,55 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sqlite3.h>
 
 #include "lua.h"
 #include "constants.h"
+#include "util/sorted_set.h"
+#include "util/strdup.h"
 
 #include "tools/cards_inspect/args.h"
 
 static void free_args(struct arguments * args)
 {
     free(args->database_name);
+    free(args->prefix);
+    free(args->after);
+}
+
+/* print the filenames in this set in order, starting after args->after and
+ * limited to args->prefix and args->limit
+ */
+static void list_page(
+        struct sorted_set * filenames,
+        const struct arguments * args
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct sorted_set_cursor cursor;
+
+    /* start after whichever of the prefix and the last page is later */
+    size_t prefix_length = args->prefix ? strlen(args->prefix) : 0;
+    if (args->after &&
+            (!args->prefix || strcmp(args->after, args->prefix) >= 0)) {
+        cursor = sorted_set_upper_bound(
+                filenames, args->after, strlen(args->after));
+    } else if (args->prefix) {
+        cursor = sorted_set_lower_bound(
+                filenames, args->prefix, prefix_length);
+    } else {
+        cursor = sorted_set_first(filenames);
+    }
+
+    if (args->prefix) {
+        sorted_set_cursor_limit_prefix(&cursor, args->prefix, prefix_length);
+    }
+
+    const struct sorted_set_lookup_result * result;
+    for (size_t n = 0; (!args->limit || n < args->limit) &&
+            (result = sorted_set_cursor_next(&cursor)); n++) {
+        printf("%.*s\n", (int)result->length, result->key);
+    }
 }
 
 int main(int argc, char ** argv)
@@ -66,6 +105,21 @@ int main(int argc, char ** argv)
 
     size_t errors = 0;
 
+    /* when listing, the filenames are collected here so they can be printed
+     * in order (and paged through)
+     */
+    struct sorted_set * filenames = NULL;
+    if (!args.validate) {
+        filenames = sorted_set_create();
+        if (!filenames) {
+            fprintf(stderr, "out of memory\n");
+            sqlite3_finalize(stmt);
+            sqlite3_close(db);
+            free_args(&args);
+            return 1;
+        }
+    }
+
     int result;
     while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
         const unsigned char * filename = sqlite3_column_text(stmt, 0);
@@ -99,7 +153,17 @@ int main(int argc, char ** argv)
 
             lua_close(L);
         } else {
-            printf("%s\n", filename);
+            char * key = util_strdup((const char *)filename);
+            enum sorted_set_add_key_result add_result = key ?
+                sorted_set_add_key(filenames, key, strlen(key), NULL) :
+                SORTED_SET_ADD_KEY_ERROR;
+            if (add_result != SORTED_SET_ADD_KEY_UNIQUE) {
+                free(key);
+            }
+            if (add_result == SORTED_SET_ADD_KEY_ERROR) {
+                fprintf(stderr, "out of memory\n");
+                errors++;
+            }
         }
     }
 
@@ -109,6 +173,9 @@ int main(int argc, char ** argv)
                 "error stepping statement: %s\n",
                 sqlite3_errmsg(db)
            );
+        if (filenames) {
+            sorted_set_destroy(filenames);
+        }
         sqlite3_finalize(stmt);
         sqlite3_close(db);
         free_args(&args);
@@ -117,6 +184,9 @@ int main(int argc, char ** argv)
 
     if (args.validate) {
         printf("%zu errors ocurred\n", errors);
+    } else {
+        list_page(filenames, &args);
+        sorted_set_destroy(filenames);
     }
 
     sqlite3_finalize(stmt);
@@ -0,0 +1,613 @@
+/* File: src/tools/log_decode/log_decode.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <unistdio.h>
+#include <jansson.h>
+
+#include "tools/log_decode/args.h"
+#include "util/log_format.h"
+#include "util/safe_realloc.h"
+
+/* a site definition read from the log */
+struct site {
+    enum log_level level;
+    uint32_t line;
+    char * file;
+    char * format;
+};
+
+/* the state of the decoder */
+struct decoder {
+    FILE * file;
+    struct arguments * args;
+    struct site * sites;
+    size_t n_sites;
+};
+
+/* the arguments of an event, being read from the front */
+struct cursor {
+    const uint8_t * data;
+    size_t length;
+    size_t used;
+};
+
+/* a growing string */
+struct text {
+    char * string;
+    size_t length;
+    size_t capacity;
+};
+
+static void free_args(struct arguments * args)
+{
+    free(args->log_name);
+}
+
+/* forget every site (at the start of a new run of the logger) */
+static void decoder_clear_sites(struct decoder * decoder)
+{
+    for (size_t i = 0; i < decoder->n_sites; i++) {
+        free(decoder->sites[i].file);
+        free(decoder->sites[i].format);
+    }
+    free(decoder->sites);
+    decoder->sites = NULL;
+    decoder->n_sites = 0;
+}
+
+/* read exactly size bytes, returning false if the log ends first */
+static bool read_exactly(struct decoder * decoder, void * out, size_t size)
+{
+    return fread(out, 1, size, decoder->file) == size;
+}
+
+/* read a u32 length and that many bytes into a new NUL-terminated string */
+static char * read_string(struct decoder * decoder, uint32_t * length_out)
+{
+    uint32_t length;
+    if (!read_exactly(decoder, &length, sizeof(length))) {
+        return NULL;
+    }
+
+    char * string = malloc((size_t)length + 1);
+    if (!string) {
+        return NULL;
+    }
+
+    if (!read_exactly(decoder, string, length)) {
+        free(string);
+        return NULL;
+    }
+    string[length] = '\0';
+
+    if (length_out) {
+        *length_out = length;
+    }
+
+    return string;
+}
+
+/* take size bytes from the front of the cursor */
+static bool cursor_take(struct cursor * cursor, void * out, size_t size)
+{
+    if (cursor->length - cursor->used < size) {
+        return false;
+    }
+    memcpy(out, &cursor->data[cursor->used], size);
+    cursor->used += size;
+    return true;
+}
+
+/* take a string argument from the front of the cursor, as a new
+ * NUL-terminated string (or NULL with *is_null set)
+ */
+static bool cursor_take_string(
+        struct cursor * cursor, char ** out, bool * is_null)
+{
+    uint32_t length;
+    if (!cursor_take(cursor, &length, sizeof(length))) {
+        return false;
+    }
+
+    *is_null = length == UINT32_MAX;
+    if (*is_null) {
+        *out = NULL;
+        return true;
+    }
+
+    char * string = malloc((size_t)length + 1);
+    if (!string || !cursor_take(cursor, string, length)) {
+        free(string);
+        return false;
+    }
+    string[length] = '\0';
+    *out = string;
+    return true;
+}
+
+/* append length bytes of string to text */
+static bool text_append(struct text * text, const char * string, size_t length)
+{
+    if (text->length + length + 1 > text->capacity) {
+        size_t capacity = text->capacity ? text->capacity : 128;
+        while (text->length + length + 1 > capacity) {
+            capacity *= 2;
+        }
+        text->string = safe_realloc(text->string, capacity);
+        if (!text->string) {
+            return false;
+        }
+        text->capacity = capacity;
+    }
+    memcpy(&text->string[text->length], string, length);
+    text->length += length;
+    text->string[text->length] = '\0';
+    return true;
+}
+
+/* rewrite this conversion specification with its * width and precision
+ * replaced by their values (a negative precision is as if it was omitted)
+ */
+static void make_spec(
+        char * out,
+        const char * spec,
+        size_t length,
+        const struct log_conversion * conversion,
+        int32_t width,
+        int32_t precision
+    )
+{
+    size_t n = 0;
+    bool seen_width = !conversion->star_width;
+    for (size_t i = 0; i < length; i++) {
+        if (spec[i] == '*' && !seen_width) {
+            n += sprintf(&out[n], "%d", width);
+            seen_width = true;
+        } else if (spec[i] == '.' && i + 1 < length && spec[i + 1] == '*' &&
+                conversion->star_precision) {
+            if (precision >= 0) {
+                n += sprintf(&out[n], ".%d", precision);
+            }
+            i++;
+        } else {
+            out[n++] = spec[i];
+        }
+    }
+    out[n] = '\0';
+}
+
+/* format the arguments of an event with the format of its site, appending
+ * the result to text
+ */
+static bool format_event(
+        const char * format,
+        struct cursor * cursor,
+        struct text * text
+    )
+{
+    size_t offset = 0;
+    size_t literal = 0;
+    struct log_conversion conversion;
+
+    while (log_format_next(format, &offset, &conversion)) {
+        if (!text_append(
+                    text, &format[literal], conversion.start - literal)) {
+            return false;
+        }
+        literal = offset;
+
+        int32_t width = 0;
+        int32_t precision = -1;
+        if (conversion.star_width &&
+                !cursor_take(cursor, &width, sizeof(width))) {
+            return false;
+        }
+        if (conversion.star_precision &&
+                !cursor_take(cursor, &precision, sizeof(precision))) {
+            return false;
+        }
+
+        /* each * is at most 11 characters longer once replaced */
+        char spec[64];
+        if (conversion.length + 24 > sizeof(spec)) {
+            return false;
+        }
+        make_spec(
+                spec,
+                &format[conversion.start],
+                conversion.length,
+                &conversion,
+                width,
+                precision
+            );
+
+        char * piece = NULL;
+        int result = -1;
+
+        switch (conversion.type) {
+            case LOG_ARG_NONE:
+                result = ulc_asprintf(&piece, "%%");
+                break;
+            case LOG_ARG_INT: {
+                int32_t value;
+                if (cursor_take(cursor, &value, sizeof(value))) {
+                    result = ulc_asprintf(&piece, spec, (int)value);
+                }
+                break;
+            }
+            case LOG_ARG_LONG: {
+                int64_t value;
+                if (cursor_take(cursor, &value, sizeof(value))) {
+                    result = ulc_asprintf(&piece, spec, (long)value);
+                }
+                break;
+            }
+            case LOG_ARG_LONG_LONG: {
+                int64_t value;
+                if (cursor_take(cursor, &value, sizeof(value))) {
+                    result = ulc_asprintf(&piece, spec, (long long)value);
+                }
+                break;
+            }
+            case LOG_ARG_SIZE: {
+                uint64_t value;
+                if (cursor_take(cursor, &value, sizeof(value))) {
+                    result = ulc_asprintf(&piece, spec, (size_t)value);
+                }
+                break;
+            }
+            case LOG_ARG_INTMAX: {
+                int64_t value;
+                if (cursor_take(cursor, &value, sizeof(value))) {
+                    result = ulc_asprintf(&piece, spec, (intmax_t)value);
+                }
+                break;
+            }
+            case LOG_ARG_PTRDIFF: {
+                int64_t value;
+                if (cursor_take(cursor, &value, sizeof(value))) {
+                    result = ulc_asprintf(&piece, spec, (ptrdiff_t)value);
+                }
+                break;
+            }
+            case LOG_ARG_DOUBLE: {
+                double value;
+                if (cursor_take(cursor, &value, sizeof(value))) {
+                    result = ulc_asprintf(&piece, spec, value);
+                }
+                break;
+            }
+            case LOG_ARG_LONG_DOUBLE: {
+                long double value;
+                if (cursor_take(cursor, &value, sizeof(value))) {
+                    result = ulc_asprintf(&piece, spec, value);
+                }
+                break;
+            }
+            case LOG_ARG_POINTER: {
+                uint64_t value;
+                if (cursor_take(cursor, &value, sizeof(value))) {
+                    result = ulc_asprintf(
+                            &piece, spec, (void *)(uintptr_t)value);
+                }
+                break;
+            }
+            case LOG_ARG_STRING:
+            case LOG_ARG_U8_STRING: {
+                char * value;
+                bool is_null;
+                if (cursor_take_string(cursor, &value, &is_null)) {
+                    result = ulc_asprintf(&piece, spec, value);
+                    free(value);
+                }
+                break;
+            }
+            case LOG_ARG_UNSUPPORTED:
+                /* the logger never encodes these */
+                break;
+        }
+
+        if (result < 0) {
+            free(piece);
+            return false;
+        }
+
+        bool appended = text_append(text, piece, result);
+        free(piece);
+        if (!appended) {
+            return false;
+        }
+    }
+
+    return text_append(text, &format[literal], offset - literal);
+}
+
+/* print one message */
+static void print_message(
+        struct decoder * decoder,
+        uint64_t timestamp,
+        enum log_level level,
+        const struct site * site,
+        const char * message,
+        size_t length
+    )
+{
+    if (decoder->args->json) {
+        json_t * object = json_object();
+        json_t * string = json_stringn(message, length);
+        json_object_set_new(object, "time", json_integer(timestamp));
+        json_object_set_new(
+                object, "level", json_string(log_level_name(level)));
+        if (site) {
+            json_object_set_new(object, "file", json_string(site->file));
+            json_object_set_new(object, "line", json_integer(site->line));
+            json_object_set_new(object, "format", json_string(site->format));
+        }
+        json_object_set_new(
+                object,
+                "message",
+                string ? string : json_string("<invalid utf-8>")
+            );
+        char * dump = json_dumps(object, JSON_COMPACT);
+        if (dump) {
+            printf("%s\n", dump);
+            free(dump);
+        }
+        json_decref(object);
+        return;
+    }
+
+    time_t seconds = timestamp / 1000000000;
+    struct tm tm;
+    char date[32] = "?";
+    if (gmtime_r(&seconds, &tm)) {
+        strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+    }
+
+    printf(
+            "%s.%09lu %s ",
+            date,
+            (unsigned long)(timestamp % 1000000000),
+            log_level_name(level)
+        );
+    if (site) {
+        printf("%s:%lu: ", site->file, (unsigned long)site->line);
+    }
+    fwrite(message, 1, length, stdout);
+    if (length == 0 || message[length - 1] != '\n') {
+        putchar('\n');
+    }
+}
+
+/* read a site definition */
+static bool decode_site(struct decoder * decoder)
+{
+    uint32_t id;
+    uint8_t level;
+    uint32_t line;
+    if (!read_exactly(decoder, &id, sizeof(id)) ||
+            !read_exactly(decoder, &level, sizeof(level)) ||
+            !read_exactly(decoder, &line, sizeof(line))) {
+        return false;
+    }
+
+    if (id != decoder->n_sites) {
+        fprintf(stderr, "site %lu defined out of order\n", (unsigned long)id);
+        return false;
+    }
+
+    struct site site = {
+        .level = level,
+        .line = line,
+        .file = read_string(decoder, NULL)
+    };
+    site.format = site.file ? read_string(decoder, NULL) : NULL;
+
+    if (!site.format) {
+        free(site.file);
+        return false;
+    }
+
+    decoder->sites = safe_realloc(
+            decoder->sites, sizeof(*decoder->sites) * (decoder->n_sites + 1));
+    if (!decoder->sites) {
+        decoder->n_sites = 0;
+        free(site.file);
+        free(site.format);
+        return false;
+    }
+    decoder->sites[decoder->n_sites++] = site;
+
+    return true;
+}
+
+/* read and print an event */
+static bool decode_event(struct decoder * decoder)
+{
+    uint32_t id;
+    uint64_t timestamp;
+    uint32_t length;
+    if (!read_exactly(decoder, &id, sizeof(id)) ||
+            !read_exactly(decoder, &timestamp, sizeof(timestamp))) {
+        return false;
+    }
+
+    if (id >= decoder->n_sites) {
+        fprintf(stderr, "event refers to undefined site %lu\n",
+                (unsigned long)id);
+        return false;
+    }
+
+    char * payload = read_string(decoder, &length);
+    if (!payload) {
+        return false;
+    }
+
+    struct site * site = &decoder->sites[id];
+    struct cursor cursor = {
+        .data = (const uint8_t *)payload,
+        .length = length
+    };
+    struct text text = { };
+
+    bool ok = format_event(site->format, &cursor, &text);
+    if (ok) {
+        print_message(
+                decoder,
+                timestamp,
+                site->level,
+                site,
+                text.string ? text.string : "",
+                text.length
+            );
+    } else {
+        fprintf(stderr, "could not decode event for site %lu (%s:%lu)\n",
+                (unsigned long)id, site->file, (unsigned long)site->line);
+    }
+
+    free(text.string);
+    free(payload);
+    return ok;
+}
+
+/* read and print a preformatted message */
+static bool decode_text(struct decoder * decoder)
+{
+    uint8_t level;
+    uint64_t timestamp;
+    uint32_t length;
+    if (!read_exactly(decoder, &level, sizeof(level)) ||
+            !read_exactly(decoder, &timestamp, sizeof(timestamp))) {
+        return false;
+    }
+
+    char * message = read_string(decoder, &length);
+    if (!message) {
+        return false;
+    }
+
+    print_message(decoder, timestamp, level, NULL, message, length);
+    free(message);
+    return true;
+}
+
+/* read a header, which starts a new run of the logger */
+static bool decode_header(struct decoder * decoder)
+{
+    char magic[sizeof(LOG_MAGIC) - 1];
+    uint32_t version;
+    uint32_t mark;
+    if (!read_exactly(decoder, magic, sizeof(magic)) ||
+            !read_exactly(decoder, &version, sizeof(version)) ||
+            !read_exactly(decoder, &mark, sizeof(mark))) {
+        return false;
+    }
+
+    if (memcmp(magic, LOG_MAGIC, sizeof(magic))) {
+        fprintf(stderr, "not a binary log\n");
+        return false;
+    }
+
+    if (mark != LOG_BYTE_ORDER_MARK) {
+        fprintf(stderr, "log was written with a different byte order\n");
+        return false;
+    }
+
+    if (version != LOG_VERSION) {
+        fprintf(stderr, "unsupported log version %lu\n",
+                (unsigned long)version);
+        return false;
+    }
+
+    decoder_clear_sites(decoder);
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    struct arguments args = { };
+
+    int parse_result;
+    if ((parse_result = parse_args(&args, argc, argv))) {
+        free_args(&args);
+        return parse_result;
+    }
+
+    struct decoder decoder = {
+        .file = fopen(args.log_name, "rb"),
+        .args = &args
+    };
+
+    if (!decoder.file) {
+        fprintf(stderr, "error opening log %s\n", args.log_name);
+        free_args(&args);
+        return 1;
+    }
+
+    bool ok = true;
+    bool seen_header = false;
+    int kind;
+    while (ok && (kind = fgetc(decoder.file)) != EOF) {
+        if (!seen_header && kind != LOG_RECORD_HEADER) {
+            fprintf(stderr, "not a binary log\n");
+            ok = false;
+            break;
+        }
+
+        switch (kind) {
+            case LOG_RECORD_HEADER:
+                ok = decode_header(&decoder);
+                seen_header = true;
+                break;
+            case LOG_RECORD_SITE:
+                ok = decode_site(&decoder);
+                break;
+            case LOG_RECORD_EVENT:
+                ok = decode_event(&decoder);
+                break;
+            case LOG_RECORD_TEXT:
+                ok = decode_text(&decoder);
+                break;
+            default:
+                fprintf(stderr, "unknown record kind %d\n", kind);
+                ok = false;
+                break;
+        }
+    }
+
+    if (!ok) {
+        fprintf(
+                stderr,
+                "error decoding %s at offset %ld\n",
+                args.log_name,
+                ftell(decoder.file)
+            );
+    }
+
+    decoder_clear_sites(&decoder);
+    fclose(decoder.file);
+    free_args(&args);
+    return ok ? 0 : 1;
+}
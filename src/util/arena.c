@@ -0,0 +1,142 @@
+/* File: src/util/arena.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "util/arena.h"
+
+#include <stdlib.h>
+#include <stdalign.h>
+#include <stdint.h>
+
+/* one block of an arena */
+struct arena_block {
+    struct arena_block * next;
+    size_t size;
+    size_t used;
+    alignas(max_align_t) unsigned char data[];
+};
+
+/* an arena, which is a list of blocks of which current is the one being
+ * allocated from (the ones before it are full, the ones after it are empty)
+ */
+struct arena {
+    size_t block_size;
+    struct arena_block * first;
+    struct arena_block * current;
+};
+
+/* create a block that can hold at least size bytes */
+[[nodiscard]] static struct arena_block * arena_block_create(size_t size)
+{
+    if (size > SIZE_MAX - sizeof(struct arena_block)) {
+        return NULL;
+    }
+
+    struct arena_block * block = malloc(sizeof(*block) + size);
+    if (!block) {
+        return NULL;
+    }
+
+    *block = (struct arena_block) {
+        .size = size
+    };
+    return block;
+}
+
+/* create an arena that allocates blocks of block_size bytes */
+[[nodiscard]] struct arena * arena_create(size_t block_size)
+{
+    struct arena * arena = malloc(sizeof(*arena));
+    if (!arena) {
+        return NULL;
+    }
+
+    *arena = (struct arena) {
+        .block_size = block_size,
+        .first = arena_block_create(block_size)
+    };
+
+    if (!arena->first) {
+        free(arena);
+        return NULL;
+    }
+
+    arena->current = arena->first;
+    return arena;
+}
+
+/* destroy this arena */
+void arena_destroy(struct arena * arena) [[gnu::nonnull(1)]]
+{
+    struct arena_block * block = arena->first;
+    while (block) {
+        struct arena_block * next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+/* allocate size bytes from this arena */
+[[nodiscard]] void * arena_alloc(
+        struct arena * arena, size_t size) [[gnu::nonnull(1)]]
+{
+    /* round up so that the next allocation is aligned too */
+    size_t padded = (size + alignof(max_align_t) - 1) &
+        ~(alignof(max_align_t) - 1);
+    if (padded < size) {
+        return NULL;
+    }
+
+    struct arena_block * block = arena->current;
+    while (block->size - block->used < padded) {
+        if (block->next && block->next->size >= padded) {
+            /* an empty block left over from before the last reset */
+            block = block->next;
+            continue;
+        }
+
+        struct arena_block * new_block = arena_block_create(
+                padded > arena->block_size ? padded : arena->block_size);
+        if (!new_block) {
+            return NULL;
+        }
+        new_block->next = block->next;
+        block->next = new_block;
+        block = new_block;
+    }
+
+    arena->current = block;
+    void * ptr = &block->data[block->used];
+    block->used += padded;
+    return ptr;
+}
+
+/* release everything allocated from this arena */
+void arena_reset(struct arena * arena) [[gnu::nonnull(1)]]
+{
+    for (struct arena_block * block = arena->first; block;
+            block = block->next) {
+        if (block->used == 0 && block != arena->first) {
+            /* the blocks after the first empty one are empty too */
+            break;
+        }
+        block->used = 0;
+    }
+    arena->current = arena->first;
+}
@@ -18,51 +18,876 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "util/log.h"
+#include "util/log_format.h"
 
 #include <unistdio.h>
+#include <unistr.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 
 #include "config.h"
 
+/* the size of the text (or encoded arguments) of a log record, longer
+ * messages are truncated
+ */
+#ifndef LOGGER_RECORD_TEXT_SIZE_DEFAULT
+#define LOGGER_RECORD_TEXT_SIZE_DEFAULT 512
+#endif /* LOGGER_RECORD_TEXT_SIZE_DEFAULT */
+
+/* how long the writer thread sleeps before looking at an empty ring again
+ * when nobody wakes it up, in milliseconds
+ */
+#ifndef LOGGER_WRITER_SLEEP_MS_DEFAULT
+#define LOGGER_WRITER_SLEEP_MS_DEFAULT 100
+#endif /* LOGGER_WRITER_SLEEP_MS_DEFAULT */
+
+/* a log message in the ring
+ *
+ * sequence is the slot's place in the ring: a producer may claim the slot
+ * when it equals the position being claimed, and the writer may consume it
+ * once the producer has set it to that position + 1
+ *
+ * if site is NULL, text is the formatted message. otherwise, it is the
+ * encoded arguments of a call at that site (see util/log_format.h.)
+ */
+struct log_record {
+    _Atomic size_t sequence;
+    enum log_level level;
+    const struct log_site * site;
+    uint64_t timestamp;
+    size_t length;
+    char text[LOGGER_RECORD_TEXT_SIZE_DEFAULT];
+};
+
+/* what logger_logf() does when the ring is full */
+enum log_overflow {
+    LOG_OVERFLOW_DROP, /* drop the message and count it */
+    LOG_OVERFLOW_BLOCK /* wait for the writer thread to make room */
+};
+
+/* where the writer thread writes records */
+enum log_backend {
+    LOG_BACKEND_TEXT, /* formatted, to stdout and stderr */
+    LOG_BACKEND_BINARY /* encoded, to a file (see util/log_format.h) */
+};
+
+/* the id a binary log has given a site */
+struct log_site_id {
+    const struct log_site * site;
+    uint32_t id;
+};
+
 /* a logger
  *
- * at the moment, loggers hold no state, have no configuration, and do nothing
- * meaningful. we pass them around in case they start doing something.
+ * logger_logf() formats messages on the calling thread into the records of a
+ * bounded lock-free ring (any number of threads may log at once), and a
+ * writer thread drains the ring to stdout (LOG_VERBOSE, LOG_INFO) or stderr
+ * (LOG_ERROR), so that the caller never waits on terminal or pipe I/O.
  *
- * the logger_logf() command and associated macros just call fprintf with
- * stdout (if LOG_VERBOSE or LOG_INFO) or stderr (if LOG_ERROR)
+ * with the binary backend, calls through the LOGF_* macros aren't formatted
+ * at all: their arguments are copied into the record, and the writer thread
+ * writes them to the log file along with the id of their call site.
+ *
+ * when the writer is idle it sleeps on a condition variable, and only then
+ * does logging take a lock (to wake it up.)
  */
 struct logger {
-    // empty
+    struct log_record * records;
+    size_t mask; /* the number of records - 1 */
+    enum log_overflow overflow;
+    enum log_level min_level;
+    enum log_backend backend;
+
+    _Atomic size_t head; /* the next position producers claim */
+    size_t tail; /* the next position the writer consumes */
+
+    _Atomic size_t dropped;
+    size_t dropped_reported;
+
+    /* the binary backend's file and the ids it has given sites so far, in
+     * an open-addressed table (these are only used by the writer thread)
+     */
+    FILE * file;
+    struct log_site_id * site_ids;
+    size_t site_ids_capacity;
+    uint32_t n_sites;
+
+    _Atomic bool stopping;
+    _Atomic bool sleeping;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t writer;
 };
 
+/* returns the FILE * messages at this level are written to */
+static FILE * log_level_file(enum log_level level)
+{
+    switch (level) {
+        case LOG_VERBOSE:
+        case LOG_INFO:
+            return stdout;
+
+        case LOG_ERROR:
+            return stderr;
+    }
+
+    ulc_fprintf(
+            stderr,
+            "logger_logf() warning: treating log_level %d as LOG_ERROR\n",
+            level
+        );
+    return stderr;
+}
+
+/* returns the current time in nanoseconds since the epoch */
+static uint64_t log_timestamp()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+/* append size bytes of data to the size bytes of out already *used
+ *
+ * returns false if they don't fit in capacity
+ */
+static bool log_put(
+        char * out,
+        size_t capacity,
+        size_t * used,
+        const void * data,
+        size_t size
+    ) [[gnu::nonnull(1, 3)]]
+{
+    if (capacity - *used < size) {
+        return false;
+    }
+    if (size > 0) {
+        memcpy(&out[*used], data, size);
+    }
+    *used += size;
+    return true;
+}
+
+/* append a string argument, whose precision is precision (or -1) */
+static bool log_put_string(
+        char * out,
+        size_t capacity,
+        size_t * used,
+        const char * string,
+        long precision,
+        bool is_u8
+    ) [[gnu::nonnull(1, 3)]]
+{
+    if (!string) {
+        uint32_t length = UINT32_MAX;
+        return log_put(out, capacity, used, &length, sizeof(length));
+    }
+
+    size_t length;
+    if (precision < 0) {
+        length = strlen(string);
+    } else if (!is_u8) {
+        length = strnlen(string, precision);
+    } else {
+        /* the precision of %U counts characters, not bytes */
+        const uint8_t * s = (const uint8_t *)string;
+        length = 0;
+        for (long i = 0; i < precision && s[length]; i++) {
+            int n = u8_strmblen(&s[length]);
+            length += n > 0 ? (size_t)n : 1;
+        }
+    }
+
+    if (length >= UINT32_MAX) {
+        return false;
+    }
+
+    uint32_t length32 = length;
+    return log_put(out, capacity, used, &length32, sizeof(length32)) &&
+        log_put(out, capacity, used, string, length);
+}
+
+/* encode the arguments of format into out (see log_format_next()), storing
+ * how many bytes were used in *length
+ *
+ * returns false if the format has a conversion that can't be encoded, or if
+ * the arguments don't fit
+ */
+static bool log_encode(
+        char * out,
+        size_t capacity,
+        size_t * length,
+        const char * format,
+        va_list args
+    ) [[gnu::nonnull(1, 3, 4)]]
+{
+    size_t used = 0;
+    size_t offset = 0;
+    struct log_conversion conversion;
+
+    while (log_format_next(format, &offset, &conversion)) {
+        long precision = conversion.precision;
+
+        if (conversion.type == LOG_ARG_NONE) {
+            continue;
+        }
+
+        if (conversion.type == LOG_ARG_UNSUPPORTED) {
+            return false;
+        }
+
+        if (conversion.star_width) {
+            int32_t width = va_arg(args, int);
+            if (!log_put(out, capacity, &used, &width, sizeof(width))) {
+                return false;
+            }
+        }
+
+        if (conversion.star_precision) {
+            int32_t star = va_arg(args, int);
+            precision = star;
+            if (!log_put(out, capacity, &used, &star, sizeof(star))) {
+                return false;
+            }
+        }
+
+        bool fits;
+        switch (conversion.type) {
+            case LOG_ARG_INT: {
+                int32_t value = va_arg(args, int);
+                fits = log_put(out, capacity, &used, &value, sizeof(value));
+                break;
+            }
+            case LOG_ARG_LONG: {
+                int64_t value = va_arg(args, long);
+                fits = log_put(out, capacity, &used, &value, sizeof(value));
+                break;
+            }
+            case LOG_ARG_LONG_LONG: {
+                int64_t value = va_arg(args, long long);
+                fits = log_put(out, capacity, &used, &value, sizeof(value));
+                break;
+            }
+            case LOG_ARG_SIZE: {
+                uint64_t value = va_arg(args, size_t);
+                fits = log_put(out, capacity, &used, &value, sizeof(value));
+                break;
+            }
+            case LOG_ARG_INTMAX: {
+                int64_t value = va_arg(args, intmax_t);
+                fits = log_put(out, capacity, &used, &value, sizeof(value));
+                break;
+            }
+            case LOG_ARG_PTRDIFF: {
+                int64_t value = va_arg(args, ptrdiff_t);
+                fits = log_put(out, capacity, &used, &value, sizeof(value));
+                break;
+            }
+            case LOG_ARG_DOUBLE: {
+                double value = va_arg(args, double);
+                fits = log_put(out, capacity, &used, &value, sizeof(value));
+                break;
+            }
+            case LOG_ARG_LONG_DOUBLE: {
+                long double value = va_arg(args, long double);
+                fits = log_put(out, capacity, &used, &value, sizeof(value));
+                break;
+            }
+            case LOG_ARG_POINTER: {
+                uint64_t value = (uintptr_t)va_arg(args, void *);
+                fits = log_put(out, capacity, &used, &value, sizeof(value));
+                break;
+            }
+            case LOG_ARG_STRING:
+                fits = log_put_string(
+                        out,
+                        capacity,
+                        &used,
+                        va_arg(args, const char *),
+                        precision,
+                        false
+                    );
+                break;
+            case LOG_ARG_U8_STRING:
+                fits = log_put_string(
+                        out,
+                        capacity,
+                        &used,
+                        (const char *)va_arg(args, const uint8_t *),
+                        precision,
+                        true
+                    );
+                break;
+            default:
+                fits = false;
+                break;
+        }
+
+        if (!fits) {
+            return false;
+        }
+    }
+
+    *length = used;
+    return true;
+}
+
+/* write a record of the binary format (see util/log_format.h) */
+static void log_write_header(FILE * file) [[gnu::nonnull(1)]]
+{
+    uint8_t kind = LOG_RECORD_HEADER;
+    uint32_t version = LOG_VERSION;
+    uint32_t mark = LOG_BYTE_ORDER_MARK;
+    fwrite(&kind, sizeof(kind), 1, file);
+    fwrite(LOG_MAGIC, 1, sizeof(LOG_MAGIC) - 1, file);
+    fwrite(&version, sizeof(version), 1, file);
+    fwrite(&mark, sizeof(mark), 1, file);
+}
+
+/* write a string as a u32 length and its bytes */
+static void log_write_string(
+        FILE * file, const char * string) [[gnu::nonnull(1, 2)]]
+{
+    uint32_t length = strlen(string);
+    fwrite(&length, sizeof(length), 1, file);
+    fwrite(string, 1, length, file);
+}
+
+/* returns the id of this site in the logger's binary log, writing its
+ * definition first if it doesn't have one yet
+ *
+ * returns UINT32_MAX on failure
+ */
+static uint32_t logger_site_id(
+        struct logger * logger,
+        const struct log_site * site
+    ) [[gnu::nonnull(1, 2)]]
+{
+    if (logger->n_sites * 2 >= logger->site_ids_capacity) {
+        size_t capacity = logger->site_ids_capacity ?
+            logger->site_ids_capacity * 2 : 64;
+        struct log_site_id * site_ids = calloc(capacity, sizeof(*site_ids));
+        if (!site_ids) {
+            return UINT32_MAX;
+        }
+        for (size_t i = 0; i < logger->site_ids_capacity; i++) {
+            if (!logger->site_ids[i].site) {
+                continue;
+            }
+            size_t j = ((uintptr_t)logger->site_ids[i].site >> 4) &
+                (capacity - 1);
+            while (site_ids[j].site) {
+                j = (j + 1) & (capacity - 1);
+            }
+            site_ids[j] = logger->site_ids[i];
+        }
+        free(logger->site_ids);
+        logger->site_ids = site_ids;
+        logger->site_ids_capacity = capacity;
+    }
+
+    size_t mask = logger->site_ids_capacity - 1;
+    size_t i = ((uintptr_t)site >> 4) & mask;
+    while (logger->site_ids[i].site) {
+        if (logger->site_ids[i].site == site) {
+            return logger->site_ids[i].id;
+        }
+        i = (i + 1) & mask;
+    }
+
+    uint32_t id = logger->n_sites++;
+    logger->site_ids[i] = (struct log_site_id) {
+        .site = site,
+        .id = id
+    };
+
+    uint8_t kind = LOG_RECORD_SITE;
+    uint8_t level = site->level;
+    uint32_t line = site->line;
+    fwrite(&kind, sizeof(kind), 1, logger->file);
+    fwrite(&id, sizeof(id), 1, logger->file);
+    fwrite(&level, sizeof(level), 1, logger->file);
+    fwrite(&line, sizeof(line), 1, logger->file);
+    log_write_string(logger->file, site->file);
+    log_write_string(logger->file, site->format);
+
+    return id;
+}
+
+/* write this record to the logger's binary log */
+static void logger_write_binary(
+        struct logger * logger,
+        const struct log_record * record
+    ) [[gnu::nonnull(1, 2)]]
+{
+    uint32_t length = record->length;
+
+    if (record->site) {
+        uint32_t id = logger_site_id(logger, record->site);
+        if (id != UINT32_MAX) {
+            uint8_t kind = LOG_RECORD_EVENT;
+            fwrite(&kind, sizeof(kind), 1, logger->file);
+            fwrite(&id, sizeof(id), 1, logger->file);
+            fwrite(&record->timestamp, sizeof(record->timestamp), 1,
+                   logger->file);
+            fwrite(&length, sizeof(length), 1, logger->file);
+            fwrite(record->text, 1, length, logger->file);
+            return;
+        }
+        /* out of memory, count the message as dropped */
+        atomic_fetch_add_explicit(&logger->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint8_t kind = LOG_RECORD_TEXT;
+    uint8_t level = record->level;
+    fwrite(&kind, sizeof(kind), 1, logger->file);
+    fwrite(&level, sizeof(level), 1, logger->file);
+    fwrite(&record->timestamp, sizeof(record->timestamp), 1, logger->file);
+    fwrite(&length, sizeof(length), 1, logger->file);
+    fwrite(record->text, 1, length, logger->file);
+}
+
+/* write every published record, returning how many were written
+ *
+ * this is only called by the writer thread
+ */
+static size_t logger_drain(struct logger * logger) [[gnu::nonnull(1)]]
+{
+    size_t n = 0;
+
+    for (;;) {
+        struct log_record * record = &logger->records[
+            logger->tail & logger->mask];
+        size_t sequence = atomic_load_explicit(
+                &record->sequence, memory_order_acquire);
+
+        if (sequence != logger->tail + 1) {
+            break;
+        }
+
+        if (logger->backend == LOG_BACKEND_BINARY) {
+            logger_write_binary(logger, record);
+        } else {
+            fwrite(
+                    record->text,
+                    1,
+                    record->length,
+                    log_level_file(record->level)
+                );
+        }
+
+        atomic_store_explicit(
+                &record->sequence,
+                logger->tail + logger->mask + 1,
+                memory_order_release
+            );
+        logger->tail++;
+        n++;
+    }
+
+    size_t dropped = atomic_load_explicit(
+            &logger->dropped, memory_order_relaxed);
+    if (dropped != logger->dropped_reported) {
+        struct log_record record = {
+            .level = LOG_ERROR,
+            .timestamp = log_timestamp()
+        };
+        int length = snprintf(
+                record.text,
+                sizeof(record.text),
+                "[logger] dropped %zu messages because the ring was full\n",
+                dropped - logger->dropped_reported
+            );
+        record.length = length > 0 ? (size_t)length : 0;
+
+        if (logger->backend == LOG_BACKEND_BINARY) {
+            logger_write_binary(logger, &record);
+        } else {
+            fwrite(record.text, 1, record.length, stderr);
+        }
+
+        logger->dropped_reported = dropped;
+        n++;
+    }
+
+    if (n > 0) {
+        if (logger->backend == LOG_BACKEND_BINARY) {
+            fflush(logger->file);
+        } else {
+            fflush(stdout);
+            fflush(stderr);
+        }
+    }
+
+    return n;
+}
+
+/* the writer thread */
+static void * logger_writer(void * ptr)
+{
+    struct logger * logger = ptr;
+
+    for (;;) {
+        if (logger_drain(logger) > 0) {
+            continue;
+        }
+
+        if (atomic_load(&logger->stopping)) {
+            /* everything published before stopping was set has been
+             * drained
+             */
+            break;
+        }
+
+        pthread_mutex_lock(&logger->mutex);
+        atomic_store(&logger->sleeping, true);
+
+        struct log_record * record = &logger->records[
+            logger->tail & logger->mask];
+        if (atomic_load(&record->sequence) != logger->tail + 1 &&
+                !atomic_load(&logger->stopping)) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += LOGGER_WRITER_SLEEP_MS_DEFAULT * 1000000L;
+            if (until.tv_nsec >= 1000000000L) {
+                until.tv_sec += until.tv_nsec / 1000000000L;
+                until.tv_nsec %= 1000000000L;
+            }
+            pthread_cond_timedwait(&logger->cond, &logger->mutex, &until);
+        }
+
+        atomic_store(&logger->sleeping, false);
+        pthread_mutex_unlock(&logger->mutex);
+    }
+
+    return NULL;
+}
+
+/* wake the writer thread if it is sleeping */
+static void logger_wake(struct logger * logger) [[gnu::nonnull(1)]]
+{
+    if (atomic_load(&logger->sleeping)) {
+        pthread_mutex_lock(&logger->mutex);
+        pthread_cond_signal(&logger->cond);
+        pthread_mutex_unlock(&logger->mutex);
+    }
+}
+
+/* claim the next record in the ring, storing its position in *position, or
+ * return NULL if the ring is full
+ */
+static struct log_record * logger_claim(
+        struct logger * logger, size_t * position) [[gnu::nonnull(1, 2)]]
+{
+    size_t head = atomic_load_explicit(&logger->head, memory_order_relaxed);
+
+    for (;;) {
+        struct log_record * record = &logger->records[head & logger->mask];
+        size_t sequence = atomic_load_explicit(
+                &record->sequence, memory_order_acquire);
+
+        if (sequence == head) {
+            if (atomic_compare_exchange_weak_explicit(
+                        &logger->head,
+                        &head,
+                        head + 1,
+                        memory_order_relaxed,
+                        memory_order_relaxed
+                    )) {
+                *position = head;
+                return record;
+            }
+            /* head was reloaded by the failed exchange */
+        } else if ((intptr_t)(sequence - head) < 0) {
+            return NULL;
+        } else {
+            head = atomic_load_explicit(&logger->head, memory_order_relaxed);
+        }
+    }
+}
+
 /* create a logger for/with this config
  *
  * normally this is then put into the config->logger property,
  * but this function cannot assume one of those already exists,
  * so it must not rely on that logger instance for logging
- * (which is fine, it doesn't log anything.)
+ * (which is fine, it only logs its own configuration errors to stderr.)
  */
 [[nodiscard]] struct logger * logger_create(
         struct config * config) [[gnu::nonnull(1)]]
 {
-    /* TODO */
-    (void)config;
+    enum log_overflow overflow = LOG_OVERFLOW_DROP;
+    if (config->log_overflow) {
+        if (!strcmp(config->log_overflow, "drop")) {
+            overflow = LOG_OVERFLOW_DROP;
+        } else if (!strcmp(config->log_overflow, "block")) {
+            overflow = LOG_OVERFLOW_BLOCK;
+        } else {
+            ulc_fprintf(
+                    stderr,
+                    "logger_create() error: config.log_overflow must be "
+                    "\"drop\" or \"block\", not \"%s\"\n",
+                    config->log_overflow
+                );
+            return NULL;
+        }
+    }
+
+    enum log_level min_level = LOG_VERBOSE;
+    if (config->log_level) {
+        if (!strcmp(config->log_level, "verbose")) {
+            min_level = LOG_VERBOSE;
+        } else if (!strcmp(config->log_level, "info")) {
+            min_level = LOG_INFO;
+        } else if (!strcmp(config->log_level, "error")) {
+            min_level = LOG_ERROR;
+        } else {
+            ulc_fprintf(
+                    stderr,
+                    "logger_create() error: config.log_level must be "
+                    "\"verbose\", \"info\", or \"error\", not \"%s\"\n",
+                    config->log_level
+                );
+            return NULL;
+        }
+    }
+
+    enum log_backend backend = LOG_BACKEND_TEXT;
+    if (config->log_format) {
+        if (!strcmp(config->log_format, "text")) {
+            backend = LOG_BACKEND_TEXT;
+        } else if (!strcmp(config->log_format, "binary")) {
+            backend = LOG_BACKEND_BINARY;
+        } else {
+            ulc_fprintf(
+                    stderr,
+                    "logger_create() error: config.log_format must be "
+                    "\"text\" or \"binary\", not \"%s\"\n",
+                    config->log_format
+                );
+            return NULL;
+        }
+    }
+
+    if (backend == LOG_BACKEND_BINARY && !config->log_file) {
+        ulc_fprintf(
+                stderr,
+                "logger_create() error: config.log_format is \"binary\" "
+                "but config.log_file is not set\n"
+            );
+        return NULL;
+    }
+
+    if (config->log_ring_size < 1) {
+        ulc_fprintf(
+                stderr,
+                "logger_create() error: config.log_ring_size must be at "
+                "least 1\n"
+            );
+        return NULL;
+    }
+
+    /* round up to a power of two so positions can be masked */
+    size_t n_records = 1;
+    while (n_records < (size_t)config->log_ring_size) {
+        n_records <<= 1;
+    }
 
     struct logger * logger = malloc(sizeof(*logger));
     if (!logger) return NULL;
-    *logger = (struct logger) { };
+
+    *logger = (struct logger) {
+        .records = malloc(sizeof(*logger->records) * n_records),
+        .mask = n_records - 1,
+        .overflow = overflow,
+        .min_level = min_level,
+        .backend = backend
+    };
+
+    if (!logger->records) {
+        free(logger);
+        return NULL;
+    }
+
+    if (backend == LOG_BACKEND_BINARY) {
+        logger->file = fopen(config->log_file, "ab");
+        if (!logger->file) {
+            ulc_fprintf(
+                    stderr,
+                    "logger_create() error: could not open %s\n",
+                    config->log_file
+                );
+            free(logger->records);
+            free(logger);
+            return NULL;
+        }
+        log_write_header(logger->file);
+    }
+
+    for (size_t i = 0; i < n_records; i++) {
+        atomic_init(&logger->records[i].sequence, i);
+    }
+    atomic_init(&logger->head, 0);
+    atomic_init(&logger->dropped, 0);
+    atomic_init(&logger->stopping, false);
+    atomic_init(&logger->sleeping, false);
+
+    if (pthread_mutex_init(&logger->mutex, NULL)) {
+        if (logger->file) {
+            fclose(logger->file);
+        }
+        free(logger->records);
+        free(logger);
+        return NULL;
+    }
+
+    if (pthread_cond_init(&logger->cond, NULL)) {
+        pthread_mutex_destroy(&logger->mutex);
+        if (logger->file) {
+            fclose(logger->file);
+        }
+        free(logger->records);
+        free(logger);
+        return NULL;
+    }
+
+    if (pthread_create(&logger->writer, NULL, &logger_writer, logger)) {
+        pthread_cond_destroy(&logger->cond);
+        pthread_mutex_destroy(&logger->mutex);
+        if (logger->file) {
+            fclose(logger->file);
+        }
+        free(logger->records);
+        free(logger);
+        return NULL;
+    }
+
     return logger;
 }
 
-/* destroy this logger */
+/* destroy this logger, after writing every message logged before this call
+ */
 void logger_destroy(struct logger * logger) [[gnu::nonnull(1)]]
 {
+    pthread_mutex_lock(&logger->mutex);
+    atomic_store(&logger->stopping, true);
+    pthread_cond_signal(&logger->cond);
+    pthread_mutex_unlock(&logger->mutex);
+
+    pthread_join(logger->writer, NULL);
+
+    pthread_cond_destroy(&logger->cond);
+    pthread_mutex_destroy(&logger->mutex);
+    if (logger->file) {
+        fclose(logger->file);
+    }
+    free(logger->site_ids);
+    free(logger->records);
     free(logger);
 }
 
-/* log using this logger at this level with this format and args */
+/* returns true if this logger writes messages at this level */
+bool logger_wants(const struct logger * logger, enum log_level level)
+{
+    return !logger || level >= logger->min_level;
+}
+
+/* log using this logger at this level with this format and args, on
+ * behalf of site (if it isn't NULL)
+ */
+static void logger_vlogf(
+        struct logger * logger,
+        enum log_level level,
+        const struct log_site * site,
+        const char * format,
+        va_list args
+    ) [[gnu::nonnull(4)]]
+{
+    if (!logger) {
+        ulc_vfprintf(log_level_file(level), format, args);
+        return;
+    }
+
+    size_t position;
+    struct log_record * record;
+    while (!(record = logger_claim(logger, &position))) {
+        if (logger->overflow == LOG_OVERFLOW_DROP) {
+            atomic_fetch_add_explicit(
+                    &logger->dropped, 1, memory_order_relaxed);
+            logger_wake(logger);
+            return;
+        }
+        logger_wake(logger);
+        sched_yield();
+    }
+
+    record->level = level;
+    record->site = NULL;
+    record->timestamp = 0;
+
+    if (logger->backend == LOG_BACKEND_BINARY) {
+        record->timestamp = log_timestamp();
+
+        if (site) {
+            va_list copy;
+            va_copy(copy, args);
+            bool encoded = log_encode(
+                    record->text,
+                    sizeof(record->text),
+                    &record->length,
+                    format,
+                    copy
+                );
+            va_end(copy);
+
+            if (encoded) {
+                record->site = site;
+                atomic_store(&record->sequence, position + 1);
+                logger_wake(logger);
+                return;
+            }
+        }
+    }
+
+    int length = ulc_vsnprintf(
+            record->text, sizeof(record->text), format, args);
+
+    if (length < 0) {
+        length = snprintf(
+                record->text,
+                sizeof(record->text),
+                "[logger] failed to format message \"%s\"\n",
+                format
+            );
+        if (length < 0) {
+            length = 0;
+        }
+    }
+
+    if ((size_t)length >= sizeof(record->text)) {
+        /* truncated, mark it as such */
+        length = sizeof(record->text) - 1;
+        memcpy(&record->text[length - 4], "...\n", 4);
+    }
+
+    record->length = (size_t)length;
+
+    atomic_store(&record->sequence, position + 1);
+    logger_wake(logger);
+}
+
+/* log using this logger at this level with this format and args
+ *
+ * if logger is NULL, the message is written synchronously
+ */
 void logger_logf(
         struct logger * logger,
         enum log_level level,
@@ -70,31 +895,31 @@ void logger_logf(
         ...
     ) [[gnu::nonnull(3)]]
 {
-    /* TODO: use the logger */
-    (void)logger;
+    if (!logger_wants(logger, level)) {
+        return;
+    }
 
     va_list args;
     va_start(args, format);
+    logger_vlogf(logger, level, NULL, format, args);
+    va_end(args);
+}
 
-    FILE * f = stderr;
-
-    switch (level) {
-        case LOG_VERBOSE:
-        case LOG_INFO:
-            f = stdout;
-            break;
-
-        case LOG_ERROR:
-            f = stderr;
-            break;
-
-        default:
-            ulc_fprintf(f, "logger_logf() warning: treating log_level %d as LOG_ERROR\n", level);
-            f = stderr;
-            break;
+/* log using this logger at the level of this site with its format and these
+ * args
+ */
+void logger_logf_site(
+        struct logger * logger,
+        const struct log_site * site,
+        ...
+    ) [[gnu::nonnull(2)]]
+{
+    if (!logger_wants(logger, site->level)) {
+        return;
     }
 
-    ulc_vfprintf(f, format, args);
-
+    va_list args;
+    va_start(args, site);
+    logger_vlogf(logger, site->level, site, site->format, args);
     va_end(args);
 }
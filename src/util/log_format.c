@@ -0,0 +1,217 @@
+/* File: src/util/log_format.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "util/log_format.h"
+
+#include <string.h>
+
+/* find the next conversion in format at or after *offset */
+bool log_format_next(
+        const char * format,
+        size_t * offset,
+        struct log_conversion * conversion
+    ) [[gnu::nonnull(1, 2, 3)]]
+{
+    const char * start = strchr(format + *offset, '%');
+    if (!start) {
+        *offset += strlen(format + *offset);
+        return false;
+    }
+
+    const char * c = start + 1;
+
+    *conversion = (struct log_conversion) {
+        .start = start - format,
+        .precision = -1
+    };
+
+    /* flags */
+    while (*c && strchr("-+ #0'I", *c)) {
+        c++;
+    }
+
+    /* width */
+    if (*c == '*') {
+        conversion->star_width = true;
+        c++;
+    } else {
+        while (*c >= '0' && *c <= '9') {
+            c++;
+        }
+    }
+
+    /* precision */
+    if (*c == '.') {
+        c++;
+        if (*c == '*') {
+            conversion->star_precision = true;
+            c++;
+        } else {
+            conversion->precision = 0;
+            while (*c >= '0' && *c <= '9') {
+                conversion->precision =
+                    conversion->precision * 10 + (*c - '0');
+                c++;
+            }
+        }
+    }
+
+    /* length modifier */
+    enum {
+        LENGTH_NONE,
+        LENGTH_LONG,
+        LENGTH_LONG_LONG,
+        LENGTH_SIZE,
+        LENGTH_INTMAX,
+        LENGTH_PTRDIFF,
+        LENGTH_LONG_DOUBLE
+    } length = LENGTH_NONE;
+
+    switch (*c) {
+        case 'h':
+            c++;
+            if (*c == 'h') {
+                c++;
+            }
+            break;
+        case 'l':
+            c++;
+            length = LENGTH_LONG;
+            if (*c == 'l') {
+                c++;
+                length = LENGTH_LONG_LONG;
+            }
+            break;
+        case 'q':
+            c++;
+            length = LENGTH_LONG_LONG;
+            break;
+        case 'z':
+            c++;
+            length = LENGTH_SIZE;
+            break;
+        case 'j':
+            c++;
+            length = LENGTH_INTMAX;
+            break;
+        case 't':
+            c++;
+            length = LENGTH_PTRDIFF;
+            break;
+        case 'L':
+            c++;
+            length = LENGTH_LONG_DOUBLE;
+            break;
+    }
+
+    switch (*c) {
+        case '%':
+            conversion->type = LOG_ARG_NONE;
+            break;
+
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            switch (length) {
+                case LENGTH_NONE:
+                    conversion->type = LOG_ARG_INT;
+                    break;
+                case LENGTH_LONG:
+                    conversion->type = LOG_ARG_LONG;
+                    break;
+                case LENGTH_LONG_LONG:
+                    conversion->type = LOG_ARG_LONG_LONG;
+                    break;
+                case LENGTH_SIZE:
+                    conversion->type = LOG_ARG_SIZE;
+                    break;
+                case LENGTH_INTMAX:
+                    conversion->type = LOG_ARG_INTMAX;
+                    break;
+                case LENGTH_PTRDIFF:
+                    conversion->type = LOG_ARG_PTRDIFF;
+                    break;
+                case LENGTH_LONG_DOUBLE:
+                    conversion->type = LOG_ARG_UNSUPPORTED;
+                    break;
+            }
+            break;
+
+        case 'c':
+            conversion->type = length == LENGTH_NONE ?
+                LOG_ARG_INT : LOG_ARG_UNSUPPORTED;
+            break;
+
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            conversion->type = length == LENGTH_LONG_DOUBLE ?
+                LOG_ARG_LONG_DOUBLE : LOG_ARG_DOUBLE;
+            break;
+
+        case 'p':
+            conversion->type = LOG_ARG_POINTER;
+            break;
+
+        case 's':
+            conversion->type = length == LENGTH_NONE ?
+                LOG_ARG_STRING : LOG_ARG_UNSUPPORTED;
+            break;
+
+        case 'U':
+            conversion->type = length == LENGTH_NONE ?
+                LOG_ARG_U8_STRING : LOG_ARG_UNSUPPORTED;
+            break;
+
+        default:
+            conversion->type = LOG_ARG_UNSUPPORTED;
+            break;
+    }
+
+    if (*c) {
+        c++;
+    }
+
+    conversion->length = c - start;
+    *offset = c - format;
+
+    return true;
+}
+
+/* returns the name of this log level */
+const char * log_level_name(enum log_level level)
+{
+    switch (level) {
+        case LOG_VERBOSE:
+            return "verbose";
+        case LOG_INFO:
+            return "info";
+        case LOG_ERROR:
+            return "error";
+    }
+    return "unknown";
+}
@@ -0,0 +1,375 @@
+/* File: src/util/metrics.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "util/metrics.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+
+/* histograms split each power of two into 2^METRICS_SUB_BUCKET_BITS linear
+ * sub-buckets (see metrics_record())
+ */
+#ifndef METRICS_SUB_BUCKET_BITS
+#define METRICS_SUB_BUCKET_BITS 4
+#endif /* METRICS_SUB_BUCKET_BITS */
+
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BUCKET_BITS)
+
+/* values below METRICS_SUB_BUCKETS get a bucket each, and every highest set
+ * bit from METRICS_SUB_BUCKET_BITS to 63 gets METRICS_SUB_BUCKETS more
+ */
+#define METRICS_BUCKETS \
+    ((64 - METRICS_SUB_BUCKET_BITS + 1) * METRICS_SUB_BUCKETS)
+
+/* the names metrics are reported with */
+static const char * counter_names[METRIC_COUNTERS] = {
+    [METRIC_ACCEPTS] = "accepts",
+    [METRIC_DISCONNECTS] = "disconnects",
+    [METRIC_BYTES_IN] = "bytes_in",
+    [METRIC_BYTES_OUT] = "bytes_out",
+    [METRIC_COMMANDS_LEXED] = "commands_lexed",
+    [METRIC_COMMANDS_PARSED] = "commands_parsed",
+    [METRIC_LEX_ERRORS] = "lex_errors",
+    [METRIC_NAME_LOOKUPS] = "name_lookups",
+    [METRIC_NAME_LOOKUP_MISSES] = "name_lookup_misses",
+    [METRIC_NAME_COMPLETIONS] = "name_completions",
+    [METRIC_NAME_SUGGESTIONS] = "name_suggestions",
+    [METRIC_NAME_SET_MERGES] = "name_set_merges",
+    [METRIC_LOOK_CACHE_HITS] = "look_cache_hits",
+    [METRIC_LOOK_CACHE_MISSES] = "look_cache_misses"
+};
+
+static const char * gauge_names[METRIC_GAUGES] = {
+    [METRIC_CONNECTIONS] = "connections"
+};
+
+static const char * histogram_names[METRIC_HISTOGRAMS] = {
+    [METRIC_BUNDLE_LOAD_TIME] = "bundle_load_ns",
+    [METRIC_NAME_SET_MERGE_TIME] = "name_set_merge_ns",
+    [METRIC_COMMAND_LATENCY] = "command_latency_ns",
+    [METRIC_TURN_LATENCY] = "turn_latency_ns"
+};
+
+/* a histogram (see metrics_record()) */
+struct metrics_histogram {
+    _Atomic uint64_t sum;
+    _Atomic uint64_t max;
+    _Atomic uint64_t buckets[METRICS_BUCKETS];
+};
+
+/* the metrics recorded by one thread
+ *
+ * only the owning thread writes to a shard (so it doesn't need atomic
+ * read-modify-writes), but metrics_report() reads them from whatever thread
+ * it is called on, so the fields are still atomic
+ */
+struct metrics_shard {
+    struct metrics_shard * next;
+    _Atomic uint64_t counters[METRIC_COUNTERS];
+    struct metrics_histogram histograms[METRIC_HISTOGRAMS];
+};
+
+/* the registry: every live thread's shard, plus everything recorded by
+ * threads that have since exited, all protected by metrics_mutex
+ */
+static pthread_mutex_t metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct metrics_shard * metrics_shards = NULL;
+static struct metrics_shard metrics_retired;
+
+static pthread_once_t metrics_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t metrics_key;
+static bool metrics_key_created = false;
+static _Thread_local struct metrics_shard * metrics_local_shard = NULL;
+
+static _Atomic int64_t metrics_gauges[METRIC_GAUGES];
+
+/* add n to x, which only this thread writes to */
+static inline void shard_add(_Atomic uint64_t * x, uint64_t n)
+{
+    atomic_store_explicit(
+            x,
+            atomic_load_explicit(x, memory_order_relaxed) + n,
+            memory_order_relaxed
+        );
+}
+
+/* raise x to n if it is smaller, where only this thread writes to x */
+static inline void shard_max(_Atomic uint64_t * x, uint64_t n)
+{
+    if (n > atomic_load_explicit(x, memory_order_relaxed)) {
+        atomic_store_explicit(x, n, memory_order_relaxed);
+    }
+}
+
+/* add everything in shard to into (which must be exclusively held) */
+static void shard_fold(
+        struct metrics_shard * into,
+        struct metrics_shard * shard
+    ) [[gnu::nonnull(1, 2)]]
+{
+    for (size_t i = 0; i < METRIC_COUNTERS; i++) {
+        shard_add(&into->counters[i], shard->counters[i]);
+    }
+
+    for (size_t i = 0; i < METRIC_HISTOGRAMS; i++) {
+        struct metrics_histogram * a = &into->histograms[i];
+        struct metrics_histogram * b = &shard->histograms[i];
+        shard_add(&a->sum, b->sum);
+        shard_max(&a->max, b->max);
+        for (size_t j = 0; j < METRICS_BUCKETS; j++) {
+            shard_add(&a->buckets[j], b->buckets[j]);
+        }
+    }
+}
+
+/* thread exit callback that moves the exiting thread's metrics into
+ * metrics_retired and frees its shard
+ */
+static void metrics_shard_retire(void * ptr)
+{
+    struct metrics_shard * shard = ptr;
+
+    pthread_mutex_lock(&metrics_mutex);
+    shard_fold(&metrics_retired, shard);
+    struct metrics_shard ** next = &metrics_shards;
+    while (*next != shard) {
+        next = &(*next)->next;
+    }
+    *next = shard->next;
+    pthread_mutex_unlock(&metrics_mutex);
+
+    metrics_local_shard = NULL;
+    free(shard);
+}
+
+/* pthread_once() callback that creates metrics_key */
+static void metrics_key_create()
+{
+    /* if this fails, the shards of exited threads stay registered (and
+     * allocated) rather than being retired
+     */
+    metrics_key_created =
+        pthread_key_create(&metrics_key, &metrics_shard_retire) == 0;
+}
+
+/* create and register the calling thread's shard, returning NULL on failure
+ * (in which case whatever was being recorded is dropped)
+ */
+static struct metrics_shard * metrics_shard_register()
+{
+    pthread_once(&metrics_key_once, &metrics_key_create);
+
+    struct metrics_shard * shard = calloc(1, sizeof(*shard));
+    if (!shard) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&metrics_mutex);
+    shard->next = metrics_shards;
+    metrics_shards = shard;
+    pthread_mutex_unlock(&metrics_mutex);
+
+    if (metrics_key_created) {
+        pthread_setspecific(metrics_key, shard);
+    }
+    metrics_local_shard = shard;
+    return shard;
+}
+
+/* returns the calling thread's shard, or NULL */
+static inline struct metrics_shard * metrics_shard()
+{
+    struct metrics_shard * shard = metrics_local_shard;
+    if (shard) {
+        return shard;
+    }
+    return metrics_shard_register();
+}
+
+/* add n to this counter */
+void metrics_count(enum metric_counter counter, uint64_t n)
+{
+    struct metrics_shard * shard = metrics_shard();
+    if (shard) {
+        shard_add(&shard->counters[counter], n);
+    }
+}
+
+/* add delta (which may be negative) to this gauge */
+void metrics_gauge_add(enum metric_gauge gauge, int64_t delta)
+{
+    atomic_fetch_add_explicit(
+            &metrics_gauges[gauge], delta, memory_order_relaxed);
+}
+
+/* returns the bucket of a histogram that value goes in */
+static size_t bucket_index(uint64_t value)
+{
+    if (value < METRICS_SUB_BUCKETS) {
+        return value;
+    }
+
+    size_t high_bit = 63 - __builtin_clzll(value);
+    size_t shift = high_bit - METRICS_SUB_BUCKET_BITS;
+    return (shift + 1) * METRICS_SUB_BUCKETS +
+        ((value >> shift) & (METRICS_SUB_BUCKETS - 1));
+}
+
+/* returns the largest value that goes in this bucket */
+static uint64_t bucket_upper_bound(size_t index)
+{
+    if (index < METRICS_SUB_BUCKETS) {
+        return index;
+    }
+
+    size_t shift = index / METRICS_SUB_BUCKETS - 1;
+    uint64_t sub_bucket = index % METRICS_SUB_BUCKETS;
+    uint64_t lower = (METRICS_SUB_BUCKETS + sub_bucket) << shift;
+    return lower + (((uint64_t)1 << shift) - 1);
+}
+
+/* record this value in this histogram */
+void metrics_record(enum metric_histogram histogram, uint64_t value)
+{
+    struct metrics_shard * shard = metrics_shard();
+    if (!shard) {
+        return;
+    }
+
+    struct metrics_histogram * h = &shard->histograms[histogram];
+    shard_add(&h->buckets[bucket_index(value)], 1);
+    shard_add(&h->sum, value);
+    shard_max(&h->max, value);
+}
+
+/* returns a monotonic timestamp in nanoseconds */
+uint64_t metrics_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* returns the value at this quantile of histogram h (which has count values
+ * in it), which is the upper bound of the bucket it falls in
+ */
+static uint64_t histogram_quantile(
+        const struct metrics_histogram * h,
+        uint64_t count,
+        double quantile
+    ) [[gnu::nonnull(1)]]
+{
+    /* the rank of the value, rounded up */
+    double exact = quantile * (double)count;
+    uint64_t rank = (uint64_t)exact;
+    if ((double)rank < exact || rank == 0) {
+        rank++;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < METRICS_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint64_t value = bucket_upper_bound(i);
+            return value < h->max ? value : h->max;
+        }
+    }
+
+    return h->max;
+}
+
+/* call fn once per line of a report of every metric */
+void metrics_report(
+        void (*fn)(const char * line, void * ptr),
+        void * ptr
+    ) [[gnu::nonnull(1)]]
+{
+    /* sum the shards into a snapshot, so that fn is called without holding
+     * metrics_mutex (it may well record metrics itself)
+     */
+    struct metrics_shard * snapshot = calloc(1, sizeof(*snapshot));
+    if (!snapshot) {
+        fn("metrics unavailable (out of memory)\n", ptr);
+        return;
+    }
+
+    pthread_mutex_lock(&metrics_mutex);
+    shard_fold(snapshot, &metrics_retired);
+    for (struct metrics_shard * shard = metrics_shards; shard;
+            shard = shard->next) {
+        shard_fold(snapshot, shard);
+    }
+    pthread_mutex_unlock(&metrics_mutex);
+
+    char line[256];
+
+    for (size_t i = 0; i < METRIC_COUNTERS; i++) {
+        snprintf(
+                line,
+                sizeof(line),
+                "%s %" PRIu64 "\n",
+                counter_names[i],
+                (uint64_t)snapshot->counters[i]
+            );
+        fn(line, ptr);
+    }
+
+    for (size_t i = 0; i < METRIC_GAUGES; i++) {
+        snprintf(
+                line,
+                sizeof(line),
+                "%s %" PRId64 "\n",
+                gauge_names[i],
+                (int64_t)metrics_gauges[i]
+            );
+        fn(line, ptr);
+    }
+
+    for (size_t i = 0; i < METRIC_HISTOGRAMS; i++) {
+        const struct metrics_histogram * h = &snapshot->histograms[i];
+        uint64_t count = 0;
+        for (size_t j = 0; j < METRICS_BUCKETS; j++) {
+            count += h->buckets[j];
+        }
+
+        snprintf(
+                line,
+                sizeof(line),
+                "%s count=%" PRIu64 " mean=%" PRIu64 " p50=%" PRIu64
+                " p90=%" PRIu64 " p99=%" PRIu64 " p999=%" PRIu64
+                " max=%" PRIu64 "\n",
+                histogram_names[i],
+                count,
+                count ? (uint64_t)h->sum / count : 0,
+                count ? histogram_quantile(h, count, 0.5) : 0,
+                count ? histogram_quantile(h, count, 0.9) : 0,
+                count ? histogram_quantile(h, count, 0.99) : 0,
+                count ? histogram_quantile(h, count, 0.999) : 0,
+                (uint64_t)h->max
+            );
+        fn(line, ptr);
+    }
+
+    free(snapshot);
+}
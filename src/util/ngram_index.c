@@ -0,0 +1,450 @@
+/* File: src/util/ngram_index.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "util/ngram_index.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the number of slots in a new index's table of posting lists, which must be
+ * a power of two
+ */
+#ifndef NGRAM_INDEX_LISTS_DEFAULT
+#define NGRAM_INDEX_LISTS_DEFAULT 1024
+#endif /* NGRAM_INDEX_LISTS_DEFAULT */
+
+/* the number of keys a new index has room for before it first grows */
+#ifndef NGRAM_INDEX_ENTRIES_DEFAULT
+#define NGRAM_INDEX_ENTRIES_DEFAULT 64
+#endif /* NGRAM_INDEX_ENTRIES_DEFAULT */
+
+/* a key in the index, whose id is its position in entries */
+struct entry {
+    const char * key;
+    size_t length;
+    void * data;
+};
+
+/* the ids of the keys that contain a trigram, in increasing order and each
+ * only once
+ *
+ * a gram of 0 is an unused slot (see trigram())
+ */
+struct posting_list {
+    uint32_t gram;
+    uint32_t n_ids;
+    uint32_t capacity;
+    uint32_t * ids;
+};
+
+/* an n-gram index */
+struct ngram_index {
+    struct entry * entries;
+    size_t n_entries;
+    size_t entries_capacity;
+
+    /* open addressed (with linear probing) and never more than half full */
+    struct posting_list * lists;
+    size_t n_lists;
+    size_t lists_capacity;
+
+    /* scratch space for ngram_index_search()
+     *
+     * counts and touched have room for every entry, and counts is all zeroes
+     * between searches
+     */
+    uint32_t * counts;
+    uint32_t * touched;
+    uint32_t * grams;
+    size_t grams_capacity;
+    size_t * rows;
+    size_t rows_capacity;
+};
+
+/* create an empty n-gram index */
+[[nodiscard]] struct ngram_index * ngram_index_create()
+{
+    struct ngram_index * index = malloc(sizeof(*index));
+    if (!index) {
+        return NULL;
+    }
+    *index = (struct ngram_index) {
+        .lists = calloc(NGRAM_INDEX_LISTS_DEFAULT, sizeof(*index->lists)),
+        .lists_capacity = NGRAM_INDEX_LISTS_DEFAULT
+    };
+    if (!index->lists) {
+        free(index);
+        return NULL;
+    }
+    return index;
+}
+
+/* destroy this n-gram index */
+void ngram_index_destroy(struct ngram_index * index) [[gnu::nonnull(1)]]
+{
+    for (size_t i = 0; i < index->lists_capacity; i++) {
+        free(index->lists[i].ids);
+    }
+    free(index->lists);
+    free(index->entries);
+    free(index->counts);
+    free(index->touched);
+    free(index->grams);
+    free(index->rows);
+    free(index);
+}
+
+/* return the number of keys added to this index */
+size_t ngram_index_size(
+        const struct ngram_index * index) [[gnu::nonnull(1)]]
+{
+    return index->n_entries;
+}
+
+/* the ith of the length + 2 trigrams of this key, as if it had two zero bytes
+ * before and after it
+ *
+ * this is the three bytes plus one, so that no trigram is 0
+ */
+static uint32_t trigram(
+        const char * key, size_t length, size_t i) [[gnu::nonnull(1)]]
+{
+    uint32_t gram = 0;
+    for (size_t j = i; j < i + 3; j++) {
+        uint8_t byte = j >= 2 && j - 2 < length ? (uint8_t)key[j - 2] : 0;
+        gram = gram << 8 | byte;
+    }
+    return gram + 1;
+}
+
+/* return the posting list for this gram, or the unused slot where it would
+ * go if there isn't one
+ */
+static struct posting_list * list_find(
+        const struct ngram_index * index, uint32_t gram) [[gnu::nonnull(1)]]
+{
+    size_t mask = index->lists_capacity - 1;
+    size_t slot = ((uint64_t)gram * 0x9e3779b97f4a7c15) >> 32 & mask;
+    while (index->lists[slot].gram != gram && index->lists[slot].gram != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return &index->lists[slot];
+}
+
+/* make sure there is room for one more posting list without the table
+ * becoming more than half full
+ */
+static bool lists_reserve(struct ngram_index * index) [[gnu::nonnull(1)]]
+{
+    if ((index->n_lists + 1) * 2 <= index->lists_capacity) {
+        return true;
+    }
+
+    struct ngram_index grown = {
+        .lists = calloc(index->lists_capacity * 2, sizeof(*grown.lists)),
+        .lists_capacity = index->lists_capacity * 2
+    };
+    if (!grown.lists) {
+        return false;
+    }
+    for (size_t i = 0; i < index->lists_capacity; i++) {
+        if (index->lists[i].gram) {
+            *list_find(&grown, index->lists[i].gram) = index->lists[i];
+        }
+    }
+    free(index->lists);
+    index->lists = grown.lists;
+    index->lists_capacity = grown.lists_capacity;
+    return true;
+}
+
+/* make room for more entries (and the search scratch space that goes with
+ * them), keeping everything as it was on failure
+ */
+static bool entries_grow(struct ngram_index * index) [[gnu::nonnull(1)]]
+{
+    size_t capacity = index->entries_capacity ?
+        index->entries_capacity * 2 : NGRAM_INDEX_ENTRIES_DEFAULT;
+
+    struct entry * entries = realloc(
+            index->entries, sizeof(*entries) * capacity);
+    if (!entries) {
+        return false;
+    }
+    index->entries = entries;
+
+    uint32_t * counts = realloc(index->counts, sizeof(*counts) * capacity);
+    if (!counts) {
+        return false;
+    }
+    memset(&counts[index->entries_capacity], 0,
+            sizeof(*counts) * (capacity - index->entries_capacity));
+    index->counts = counts;
+
+    uint32_t * touched = realloc(index->touched, sizeof(*touched) * capacity);
+    if (!touched) {
+        return false;
+    }
+    index->touched = touched;
+
+    index->entries_capacity = capacity;
+    return true;
+}
+
+/* add this key of length to the index, associating it with data */
+bool ngram_index_add(
+        struct ngram_index * index,
+        const char * key,
+        size_t length,
+        void * data
+    ) [[gnu::nonnull(1, 2)]]
+{
+    if (index->n_entries == UINT32_MAX) {
+        return false;
+    }
+    if (index->n_entries == index->entries_capacity &&
+            !entries_grow(index)) {
+        return false;
+    }
+
+    uint32_t id = index->n_entries++;
+    index->entries[id] = (struct entry) {
+        .key = key,
+        .length = length,
+        .data = data
+    };
+
+    for (size_t i = 0; i < length + 2; i++) {
+        if (!lists_reserve(index)) {
+            return false;
+        }
+
+        struct posting_list * list = list_find(index, trigram(key, length, i));
+        if (!list->gram) {
+            list->gram = trigram(key, length, i);
+            index->n_lists++;
+        }
+
+        /* a trigram that appears more than once in the key */
+        if (list->n_ids > 0 && list->ids[list->n_ids - 1] == id) {
+            continue;
+        }
+
+        if (list->n_ids == list->capacity) {
+            uint32_t capacity = list->capacity ? list->capacity * 2 : 4;
+            uint32_t * ids = realloc(list->ids, sizeof(*ids) * capacity);
+            if (!ids) {
+                return false;
+            }
+            list->ids = ids;
+            list->capacity = capacity;
+        }
+        list->ids[list->n_ids++] = id;
+    }
+
+    return true;
+}
+
+/* the edit distance between a and b, or max_distance + 1 if it is more than
+ * max_distance
+ *
+ * rows must have room for 2 * (a_length + 1) distances
+ */
+static size_t edit_distance(
+        size_t * rows,
+        const char * a,
+        size_t a_length,
+        const char * b,
+        size_t b_length,
+        size_t max_distance
+    ) [[gnu::nonnull(1, 2, 4)]]
+{
+    size_t * previous = rows;
+    size_t * current = rows + a_length + 1;
+
+    for (size_t i = 0; i <= a_length; i++) {
+        previous[i] = i;
+    }
+
+    for (size_t j = 1; j <= b_length; j++) {
+        current[0] = j;
+        size_t row_min = j;
+        for (size_t i = 1; i <= a_length; i++) {
+            size_t best = previous[i - 1] + (a[i - 1] != b[j - 1]);
+            if (previous[i] + 1 < best) {
+                best = previous[i] + 1;
+            }
+            if (current[i - 1] + 1 < best) {
+                best = current[i - 1] + 1;
+            }
+            current[i] = best;
+            if (best < row_min) {
+                row_min = best;
+            }
+        }
+
+        /* every later row is at least this row's smallest distance */
+        if (row_min > max_distance) {
+            return max_distance + 1;
+        }
+
+        size_t * swap = previous;
+        previous = current;
+        current = swap;
+    }
+
+    return previous[a_length] > max_distance ?
+        max_distance + 1 : previous[a_length];
+}
+
+/* returns true if result x should come before result y */
+static bool result_before(
+        const struct ngram_index_result * x,
+        const struct ngram_index_result * y
+    ) [[gnu::nonnull(1, 2)]]
+{
+    if (x->distance != y->distance) {
+        return x->distance < y->distance;
+    }
+    size_t length = x->length < y->length ? x->length : y->length;
+    int result = memcmp(x->key, y->key, length);
+    return result < 0 || (result == 0 && x->length < y->length);
+}
+
+static int compare_grams(const void * a, const void * b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* find the keys within max_distance edits of this key of length */
+size_t ngram_index_search(
+        struct ngram_index * index,
+        const char * key,
+        size_t length,
+        size_t max_distance,
+        struct ngram_index_result * results,
+        size_t max,
+        bool * oom
+    ) [[gnu::nonnull(1, 2, 7)]]
+{
+    if (max == 0 || index->n_entries == 0) {
+        return 0;
+    }
+
+    size_t n_grams = length + 2;
+    if (n_grams > index->grams_capacity) {
+        uint32_t * grams = realloc(index->grams, sizeof(*grams) * n_grams);
+        if (!grams) {
+            *oom = true;
+            return 0;
+        }
+        index->grams = grams;
+        index->grams_capacity = n_grams;
+    }
+
+    size_t n_rows = 2 * (length + 1);
+    if (n_rows > index->rows_capacity) {
+        size_t * rows = realloc(index->rows, sizeof(*rows) * n_rows);
+        if (!rows) {
+            *oom = true;
+            return 0;
+        }
+        index->rows = rows;
+        index->rows_capacity = n_rows;
+    }
+
+    /* the distinct trigrams of key */
+    for (size_t i = 0; i < n_grams; i++) {
+        index->grams[i] = trigram(key, length, i);
+    }
+    qsort(index->grams, n_grams, sizeof(*index->grams), &compare_grams);
+    size_t n_distinct = 1;
+    for (size_t i = 1; i < n_grams; i++) {
+        if (index->grams[i] != index->grams[n_distinct - 1]) {
+            index->grams[n_distinct++] = index->grams[i];
+        }
+    }
+
+    /* count how many of them each key shares */
+    size_t n_touched = 0;
+    for (size_t i = 0; i < n_distinct; i++) {
+        const struct posting_list * list = list_find(index, index->grams[i]);
+        for (uint32_t j = 0; j < list->n_ids; j++) {
+            uint32_t id = list->ids[j];
+            if (index->counts[id]++ == 0) {
+                index->touched[n_touched++] = id;
+            }
+        }
+    }
+
+    /* a key within max_distance edits shares at least this many */
+    size_t threshold = n_distinct > 3 * max_distance ?
+        n_distinct - 3 * max_distance : 1;
+
+    size_t n_results = 0;
+    for (size_t i = 0; i < n_touched; i++) {
+        uint32_t id = index->touched[i];
+        uint32_t count = index->counts[id];
+        index->counts[id] = 0;
+
+        const struct entry * entry = &index->entries[id];
+        size_t difference = entry->length > length ?
+            entry->length - length : length - entry->length;
+        if (count < threshold || difference > max_distance) {
+            continue;
+        }
+
+        struct ngram_index_result result = {
+            .key = entry->key,
+            .length = entry->length,
+            .data = entry->data,
+            .distance = edit_distance(
+                    index->rows,
+                    key,
+                    length,
+                    entry->key,
+                    entry->length,
+                    max_distance
+                )
+        };
+        if (result.distance > max_distance) {
+            continue;
+        }
+
+        /* insert it in order, dropping the last result if there's no room */
+        size_t position = n_results;
+        while (position > 0 && result_before(&result, &results[position - 1])) {
+            position--;
+        }
+        if (position == max) {
+            continue;
+        }
+        if (n_results < max) {
+            n_results++;
+        }
+        memmove(&results[position + 1], &results[position],
+                sizeof(*results) * (n_results - 1 - position));
+        results[position] = result;
+    }
+
+    return n_results;
+}
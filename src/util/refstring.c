@@ -30,19 +30,21 @@
 
 #include "util/strdup.h"
 
-/* TODO: if this API doesn't end up used in more places (i.e. outside of the
- *       single use for displaying debug data for lexer results) we should get
- *       rid of it
+/* refstrings are used for displaying debug data for lexer results and for
+ * messages the networker broadcasts to many connections at once (where each
+ * connection's output holds a reference until the data has been written)
  */
 
 /* a refstring */
 struct refstring {
     uint8_t * string;
+    size_t length;
     long references;
 };
 
 struct refstring null_refstring = {
     .string = u8"<null refstring>",
+    .length = sizeof("<null refstring>") - 1,
     .references = 0
 };
 
@@ -67,6 +69,8 @@ struct refstring null_refstring = {
         return &null_refstring;
     }
 
+    refstring->length = u8_strlen(refstring->string);
+
     return refstring;
 }
 
@@ -74,19 +78,36 @@ struct refstring null_refstring = {
 [[nodiscard]] struct refstring * refstring_createf(
         const char * format, ...)
 {
+    va_list args;
+    va_start(args, format);
+    struct refstring * refstring = refstring_createv(format, args);
+    va_end(args);
+    return refstring;
+}
+
+/* like refstring_createf() but with a va_list */
+[[nodiscard]] struct refstring * refstring_createv(
+        const char * format, va_list args)
+{
+    va_list args_copy;
+    va_copy(args_copy, args);
 
-    va_list args1, args2;
-    va_start(args1, format);
-    va_copy(args2, args1);
+    int n = u8_vsnprintf(NULL, 0, format, args_copy);
+    va_end(args_copy);
 
-    int n = u8_vsnprintf(NULL, 0, format, args1) + 1;
-    uint8_t * s = malloc(sizeof(*s) * n);
+    if (n < 0) {
+        null_refstring.references++;
+        return &null_refstring;
+    }
+
+    uint8_t * s = malloc(sizeof(*s) * (n + 1));
 
     if (!s) {
+        null_refstring.references++;
         return &null_refstring;
     }
 
-    u8_vsnprintf(s, n, format, args2);
+    u8_vsnprintf(s, n + 1, format, args);
 
     struct refstring * refstring = malloc(sizeof(*refstring));
 
@@ -98,11 +119,10 @@ struct refstring null_refstring = {
 
     *refstring = (struct refstring) {
         .string = s,
+        .length = n,
         .references = 1
     };
 
-    va_end(args1);
-    va_end(args2);
     return refstring;
 }
 
@@ -115,15 +135,20 @@ struct refstring null_refstring = {
 {
     struct refstring * refstring = malloc(sizeof(*refstring));
 
-    if (!refstring) return &null_refstring;
+    if (!refstring) {
+        null_refstring.references++;
+        return &null_refstring;
+    }
 
     *refstring = (struct refstring) {
         .string = malloc(n + 1),
+        .length = n,
         .references = 1
     };
 
     if (!refstring->string) {
         free(refstring);
+        null_refstring.references++;
         return &null_refstring;
     }
 
@@ -153,6 +178,15 @@ const uint8_t * refstring_string(
     return refstring->string;
 }
 
+/* get the length of the string in this refstring, not including the null
+ * terminator
+ */
+size_t refstring_length(struct refstring * refstring) [[gnu::nonnull(1)]]
+{
+    assert(refstring->references > 0);
+    return refstring->length;
+}
+
 /* duplicate this refstring */
 [[nodiscard]] struct refstring * refstring_dup(
         struct refstring * refstring) [[gnu::nonnull(1)]]
@@ -18,39 +18,137 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "util/sorted_set.h"
-#include "util/safe_realloc.h"
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
-/* a sorted set */
-struct sorted_set {
-    struct node ** next;
-    size_t layers;
-    size_t size;
-    size_t padding;
-};
+#ifndef SORTED_SET_SLAB_SIZE_DEFAULT
+#define SORTED_SET_SLAB_SIZE_DEFAULT 4096
+#endif /* SORTED_SET_SLAB_SIZE_DEFAULT */
 
-/* a node in the skip list */
-struct node {
-    struct node ** next; /* this property must line up with sorted_set because
-                          * we cast sorted_set into node in the add function
-                          *
-                          * only next is used from this, though.
-                          */
+#ifndef SORTED_SET_SLAB_SIZE_MAX_DEFAULT
+#define SORTED_SET_SLAB_SIZE_MAX_DEFAULT (1 << 20)
+#endif /* SORTED_SET_SLAB_SIZE_MAX_DEFAULT */
+
+/* the most layers a set can have. random_level() caps levels at this, and the
+ * sorted_set_maker never needs more than log2(n_keys) of them
+ */
+#define SORTED_SET_LAYERS_MAX 64
 
+/* a node in the skip list
+ *
+ * nodes are allocated as one block, with next[] sized to the node's level,
+ * out of the slabs of the set they belong to
+ */
+struct node {
     /* these three properties must stay in this order because we cast a pointer
-     * to the display_key field to a struct sorted_set_lookup_result pointer
+     * to the key field to a struct sorted_set_lookup_result pointer
      */
     char * key;
     size_t length;
     void * data;
+
+    struct node * next[];
 };
 
-/* waste sizeof(size_t) bytes to make -fanalyzer happy */
-/* TODO: is there a better way? */
-static_assert(sizeof(struct sorted_set) == sizeof(struct node));
+/* a block of memory that nodes are allocated out of
+ *
+ * slabs are never freed individually, only all together when the set is
+ * destroyed
+ */
+struct slab {
+    struct slab * next;
+    size_t size;
+    size_t used;
+    unsigned char bytes[];
+};
+
+/* a sorted set */
+struct sorted_set {
+    struct node * next[SORTED_SET_LAYERS_MAX]; /* the head of each layer */
+    size_t layers;
+    size_t size;
+    struct slab * slabs; /* the most recent slab, which nodes come from */
+};
+
+/* the size of a node of this level */
+static size_t node_size(size_t level)
+{
+    return sizeof(struct node) + sizeof(struct node *) * level;
+}
+
+/* add a slab big enough for at least this many bytes to this set
+ *
+ * slabs double in size from SORTED_SET_SLAB_SIZE_DEFAULT up to
+ * SORTED_SET_SLAB_SIZE_MAX_DEFAULT
+ *
+ * returns false if it could not be allocated
+ */
+static bool sorted_set_add_slab(
+        struct sorted_set * sorted_set, size_t min_size) [[gnu::nonnull(1)]]
+{
+    size_t size = SORTED_SET_SLAB_SIZE_DEFAULT;
+    if (sorted_set->slabs) {
+        size = sorted_set->slabs->size * 2;
+        if (size > SORTED_SET_SLAB_SIZE_MAX_DEFAULT) {
+            size = SORTED_SET_SLAB_SIZE_MAX_DEFAULT;
+        }
+    }
+    if (size < min_size) {
+        size = min_size;
+    }
+
+    struct slab * slab = malloc(sizeof(*slab) + size);
+    if (!slab) {
+        return false;
+    }
+
+    *slab = (struct slab) {
+        .next = sorted_set->slabs,
+        .size = size
+    };
+    sorted_set->slabs = slab;
+    return true;
+}
+
+/* allocate a node of this level out of this set's slabs
+ *
+ * returns NULL if a new slab was needed and could not be allocated
+ */
+static struct node * node_create(
+        struct sorted_set * sorted_set, size_t level) [[gnu::nonnull(1)]]
+{
+    size_t size = node_size(level);
+    struct slab * slab = sorted_set->slabs;
+    if (!slab || slab->size - slab->used < size) {
+        if (!sorted_set_add_slab(sorted_set, size)) {
+            return NULL;
+        }
+        slab = sorted_set->slabs;
+    }
+
+    /* every node is a multiple of sizeof(struct node *) in size, so this
+     * keeps them all aligned
+     */
+    struct node * node = (struct node *)&slab->bytes[slab->used];
+    slab->used += size;
+    return node;
+}
+
+/* free every slab of this set (and so every node in it) */
+static void sorted_set_free_slabs(
+        struct sorted_set * sorted_set) [[gnu::nonnull(1)]]
+{
+    struct slab * slab = sorted_set->slabs;
+    while (slab) {
+        struct slab * next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    sorted_set->slabs = NULL;
+}
 
 /* create an empty sorted set */
 [[nodiscard]] struct sorted_set * sorted_set_create()
@@ -59,33 +157,19 @@ static_assert(sizeof(struct sorted_set) == sizeof(struct node));
     if (!sorted_set) return NULL;
 
     *sorted_set = (struct sorted_set) {
-        .next = malloc(sizeof(*sorted_set->next)),
         .layers = 1
     };
 
-    if (!sorted_set->next) {
-        free(sorted_set);
-        return NULL;
-    }
-
-    sorted_set->next[0] = NULL;
     return sorted_set;
 }
 
 /* destroy this sorted set */
 void sorted_set_destroy(struct sorted_set * sorted_set) [[gnu::nonnull(1)]]
 {
-    if (sorted_set->layers > 0) {
-        struct node * node = sorted_set->next[0];
-        while (node) {
-            struct node * next = node->next[0];
-            free(node->key);
-            free(node->next);
-            free(node);
-            node = next;
-        }
-        free(sorted_set->next);
+    for (struct node * node = sorted_set->next[0]; node; node = node->next[0]) {
+        free(node->key);
     }
+    sorted_set_free_slabs(sorted_set);
     free(sorted_set);
 }
 
@@ -93,16 +177,7 @@ void sorted_set_destroy(struct sorted_set * sorted_set) [[gnu::nonnull(1)]]
 void sorted_set_destroy_except_keys(
         struct sorted_set * sorted_set) [[gnu::nonnull(1)]]
 {
-    if (sorted_set->layers > 0) {
-        struct node * node = sorted_set->next[0];
-        while (node) {
-            struct node * next = node->next[0];
-            free(node->next);
-            free(node);
-            node = next;
-        }
-        free(sorted_set->next);
-    }
+    sorted_set_free_slabs(sorted_set);
     free(sorted_set);
 }
 
@@ -112,19 +187,26 @@ size_t sorted_set_size(struct sorted_set * sorted_set) [[gnu::nonnull(1)]]
     return sorted_set->size;
 }
 
-/* returns 0 when equal, negative when a < b, positive when a > b */
-static int key_compare(const struct node * a, const struct node * b)
+/* returns 0 when equal, negative when key < node's key, positive when
+ * key > node's key
+ *
+ * keys compare bytewise, as unsigned chars, and then by length
+ */
+static int key_compare(
+        const char * key, size_t length, const struct node * node)
 {
-    size_t length = a->length > b->length ? a->length : b->length;
-    for (size_t i = 0; i < length; i++) {
-        if (a->key[i] != b->key[i]) {
-            return (int)a->key[i] - (int)b->key[i];
-        }
+    size_t min = length < node->length ? length : node->length;
+    int compare = memcmp(key, node->key, min);
+    if (compare != 0) {
+        return compare;
     }
-    return 0;
+    return (length > node->length) - (length < node->length);
 }
 
-/* start at 1. do forever { if 50% chance: increase it, otherwise stop } */
+/* start at 1. do forever { if 50% chance: increase it, otherwise stop }
+ *
+ * (but never past SORTED_SET_LAYERS_MAX)
+ */
 static size_t random_level()
 {
     size_t level = 1;
@@ -132,16 +214,13 @@ static size_t random_level()
         uint32_t x = rand();
         /* RAND_MAX is at least (1<<15)-1 */
         for (size_t i = 0; i < 15; i++) {
-            if (x & 1) {
+            if (x & 1 || level == SORTED_SET_LAYERS_MAX) {
                 return level;
             }
             x >>= 1;
             level++;
         }
     }
-    /* you know, if you win the lottery, this could overflow the size_t.
-     * it would take a long time, though.
-     */
 }
 
 /* add this key of length to the sorted set, associating it with data
@@ -167,105 +246,57 @@ enum sorted_set_add_key_result sorted_set_add_key(
         void * data
     ) [[gnu::nonnull(1, 2)]]
 {
-    /* pick a random height for the new nodde */
-    size_t new_level = random_level();
-
-    /* trailing nodes */
-    struct node ** update = malloc(sizeof(*update) * sorted_set->layers);
-    if (!update) {
-        return SORTED_SET_ADD_KEY_ERROR;
-    }
-
-    for (size_t i = new_level; i < sorted_set->layers; i++) {
-        update[i] = NULL;
-    }
+    /* the next[] array (of the head or of a node) that precedes the new node
+     * on each layer
+     */
+    struct node ** update[SORTED_SET_LAYERS_MAX];
 
     /* locate where new node should go */
-    size_t layer = sorted_set->layers - 1;
-    struct node * node = (struct node *)sorted_set;
-
-    for (;;) {
-        while (node->next[layer]) {
-            int compare = key_compare(
-                    &(struct node) { .key = key, .length = length },
-                    node->next[layer]
-                );
+    struct node ** next = sorted_set->next;
+    for (size_t layer = sorted_set->layers; layer-- > 0; ) {
+        while (next[layer]) {
+            int compare = key_compare(key, length, next[layer]);
             if (compare == 0) {
                 /* key is a duplicate */
-                free(update);
                 return SORTED_SET_ADD_KEY_DUPLICATE;
             }
 
-            if (compare > 0) {
-                node = node->next[layer];
-            }
-
             if (compare < 0) {
                 break;
             }
-        }
-
-        update[layer] = node;
 
-        if (layer == 0) {
-            break;
+            next = next[layer]->next;
         }
-        layer--;
+        update[layer] = next;
     }
 
-    /* at this point we know the key isn't a duplicate */
-    sorted_set->size++;
+    /* pick a random height for the new node */
+    size_t new_level = random_level();
 
-    struct node * new_node = malloc(sizeof(*new_node));
+    struct node * new_node = node_create(sorted_set, new_level);
     if (!new_node) {
-        free(update);
-        return SORTED_SET_ADD_KEY_ERROR;
-    }
-
-    *new_node = (struct node) {
-        .key = key,
-        .length = length,
-        .data = data,
-        .next = malloc(sizeof(*new_node->next) * new_level)
-    };
-
-    if (!new_node->next) {
-        free(update);
-        free(new_node);
         return SORTED_SET_ADD_KEY_ERROR;
     }
 
-    /* update the nexts of update[] and set new_node's nexts */
-    if (new_level <= sorted_set->layers) {
-        for (size_t i = 0; i < new_level; i++) {
-            new_node->next[i] = update[i]->next[i];
-            update[i]->next[i] = new_node;
-        }
-    } else {
-        for (size_t i = 0; i < sorted_set->layers; i++) {
-            new_node->next[i] = update[i]->next[i];
-            update[i]->next[i] = new_node;
-        }
-
-        sorted_set->next = safe_realloc(
-                sorted_set->next,
-                sizeof(*sorted_set->next) * new_level
-            );
-        if (!sorted_set->next) {
-            free(update);
-            free(new_node);
-            return SORTED_SET_ADD_KEY_ERROR;
-        }
+    /* at this point we know the key isn't a duplicate */
+    sorted_set->size++;
 
-        for (size_t i = sorted_set->layers; i < new_level; i++) {
-            sorted_set->next[i] = new_node;
-            new_node->next[i] = NULL;
-        }
+    new_node->key = key;
+    new_node->length = length;
+    new_node->data = data;
 
+    for (size_t i = sorted_set->layers; i < new_level; i++) {
+        update[i] = sorted_set->next;
+    }
+    if (new_level > sorted_set->layers) {
         sorted_set->layers = new_level;
     }
 
-    free(update);
+    /* update the nexts of update[] and set new_node's nexts */
+    for (size_t i = 0; i < new_level; i++) {
+        new_node->next[i] = update[i][i];
+        update[i][i] = new_node;
+    }
 
     return SORTED_SET_ADD_KEY_UNIQUE;
 }
@@ -291,14 +322,8 @@ void sorted_set_apply(
         void * ptr
     ) [[gnu::nonnull(1, 2)]]
 {
-    if (sorted_set->layers == 0) {
-        return;
-    }
-
-    struct node * node = sorted_set->next[0];
-    while (node) {
+    for (struct node * node = sorted_set->next[0]; node; node = node->next[0]) {
         fn(node->key, node->length, node->data, ptr);
-        node = node->next[0];
     }
 }
 
@@ -324,22 +349,11 @@ void sorted_set_apply_and_destroy(
         void * ptr
     ) [[gnu::nonnull(1, 2)]]
 {
-    if (sorted_set->layers == 0) {
-        return;
-    }
-
-    struct node * node = sorted_set->next[0];
-    while (node) {
+    for (struct node * node = sorted_set->next[0]; node; node = node->next[0]) {
         fn(node->key, node->length, node->data, ptr);
-
-        struct node * next = node->next[0];
-        free(node->next);
-        free(node);
-
-        node = next;
     }
 
-    free(sorted_set->next);
+    sorted_set_free_slabs(sorted_set);
     free(sorted_set);
 }
 
@@ -356,43 +370,143 @@ const struct sorted_set_lookup_result * sorted_set_lookup(
         size_t length
     ) [[gnu::nonnull(1, 2)]]
 {
-    size_t layer = sorted_set->layers - 1;
-    struct node * node = (struct node *)sorted_set;
-
-    for (;;) {
-        while (node->next[layer]) {
-            int compare = key_compare(
-                    /* casting away the const is fine, key_compare doesn't
-                     * modify the node
-                     */
-                    &(struct node) { .key = (char *)key, .length = length },
-                    node->next[layer]
-                );
+    struct node ** next = sorted_set->next;
+    for (size_t layer = sorted_set->layers; layer-- > 0; ) {
+        while (next[layer]) {
+            int compare = key_compare(key, length, next[layer]);
             if (compare == 0) {
                 return (const struct sorted_set_lookup_result *)
-                    &node->next[layer]->key;
-            }
-
-            if (compare > 0) {
-                node = node->next[layer];
+                    &next[layer]->key;
             }
 
             if (compare < 0) {
                 break;
             }
-        }
 
-        if (layer == 0) {
-            break;
+            next = next[layer]->next;
         }
-        layer--;
     }
 
     return NULL;
 }
 
+/* returns the first node whose key is not less than this key (or, if after is
+ * true, greater than it), or NULL if there isn't one
+ */
+static struct node * find_bound(
+        struct sorted_set * sorted_set,
+        const char * key,
+        size_t length,
+        bool after
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct node ** next = sorted_set->next;
+    for (size_t layer = sorted_set->layers; layer-- > 0; ) {
+        while (next[layer]) {
+            int compare = key_compare(key, length, next[layer]);
+            if (compare < 0 || (compare == 0 && !after)) {
+                break;
+            }
+            next = next[layer]->next;
+        }
+    }
+    return next[0];
+}
+
+/* returns a cursor at the first key in the set */
+struct sorted_set_cursor sorted_set_first(
+        struct sorted_set * sorted_set) [[gnu::nonnull(1)]]
+{
+    return (struct sorted_set_cursor) { .node = sorted_set->next[0] };
+}
+
+/* returns a cursor at the first key in the set that is not less than this
+ * key of length
+ *
+ * this function does not take ownership of key
+ */
+struct sorted_set_cursor sorted_set_lower_bound(
+        struct sorted_set * sorted_set,
+        const char * key,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    return (struct sorted_set_cursor) {
+        .node = find_bound(sorted_set, key, length, false)
+    };
+}
+
+/* returns a cursor at the first key in the set that is greater than this
+ * key of length
+ *
+ * this function does not take ownership of key
+ */
+struct sorted_set_cursor sorted_set_upper_bound(
+        struct sorted_set * sorted_set,
+        const char * key,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    return (struct sorted_set_cursor) {
+        .node = find_bound(sorted_set, key, length, true)
+    };
+}
+
+/* returns a cursor over just the keys that begin with this prefix of length
+ *
+ * this is sorted_set_lower_bound() followed by
+ * sorted_set_cursor_limit_prefix(), so prefix must outlive the cursor
+ */
+struct sorted_set_cursor sorted_set_prefix(
+        struct sorted_set * sorted_set,
+        const char * prefix,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct sorted_set_cursor cursor =
+        sorted_set_lower_bound(sorted_set, prefix, length);
+    sorted_set_cursor_limit_prefix(&cursor, prefix, length);
+    return cursor;
+}
+
+/* make this cursor stop at the first key that doesn't begin with this prefix
+ * of length, which is not copied and must outlive the cursor
+ */
+void sorted_set_cursor_limit_prefix(
+        struct sorted_set_cursor * cursor,
+        const char * prefix,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    cursor->prefix = prefix;
+    cursor->prefix_length = length;
+}
+
+/* return the key this cursor is at and advance it to the next one, or return
+ * NULL if there are no more keys
+ */
+const struct sorted_set_lookup_result * sorted_set_cursor_next(
+        struct sorted_set_cursor * cursor) [[gnu::nonnull(1)]]
+{
+    struct node * node = cursor->node;
+    if (!node) {
+        return NULL;
+    }
+
+    if (cursor->prefix && (node->length < cursor->prefix_length ||
+                memcmp(node->key, cursor->prefix, cursor->prefix_length))) {
+        cursor->node = NULL;
+        return NULL;
+    }
+
+    cursor->node = node->next[0];
+    return (const struct sorted_set_lookup_result *)&node->key;
+}
+
 /* remove this key of length from the sorted set, returning the keys data
  * field, or NULL if the key is not in the set
+ *
+ * (the node's memory stays in its slab until the set is destroyed)
  */
 /*
 void * sorted_set_remove_key(
@@ -401,47 +515,34 @@ void * sorted_set_remove_key(
         size_t length
     ) [[gnu::nonnull(1, 2)]]
 {
-    size_t layer = sorted_set->layers - 1;
-    struct node * node = (struct node *)sorted_set;
-
-    struct node ** update = malloc(sizeof(*update) * sorted_set->layers);
+    struct node ** update[SORTED_SET_LAYERS_MAX];
+    struct node * found = NULL;
 
-    for (;;) {
-        while (node->next[layer]) {
-            int compare = key_compare(
-                    &(struct node) { .key = (char *)key, .length = length },
-                    node->next[layer]
-                );
+    struct node ** next = sorted_set->next;
+    for (size_t layer = sorted_set->layers; layer-- > 0; ) {
+        while (next[layer]) {
+            int compare = key_compare((const char *)key, length, next[layer]);
             if (compare == 0) {
-                for (size_t i = 0; i < layer; i++) {
-                    update[i]->next[i] = node->next[layer]->next[i];
-                }
-                free(update);
-                void * data = node->next[layer]->data;
-                free(node->next);
-                free(node->key);
-                free(node);
-                return data;
-            }
-
-            if (compare > 0) {
-                node = node->next[layer];
+                found = next[layer];
             }
-
-            if (compare < 0) {
+            if (compare <= 0) {
                 break;
             }
+            next = next[layer]->next;
         }
+        update[layer] = next;
+    }
 
-        update[layer] = node;
-
-        if (layer == 0) {
-            break;
-        }
-        layer--;
+    if (!found) {
+        return NULL;
     }
 
-    return NULL;
+    for (size_t i = 0; i < sorted_set->layers && update[i][i] == found; i++) {
+        update[i][i] = found->next[i];
+    }
+    sorted_set->size--;
+    free(found->key);
+    return found->data;
 }
 */
 
@@ -455,6 +556,19 @@ struct sorted_set_maker {
     struct node * next; /* where will the next added key go? */
 };
 
+/* the level of the i'th node made by a sorted_set_maker: the highest layer
+ * whose landmark it falls on
+ */
+static size_t maker_level(size_t i, const size_t * landmarks, size_t layers)
+{
+    for (size_t j = layers - 1; j > 0; j--) {
+        if (i % landmarks[j] == 0) {
+            return j + 1;
+        }
+    }
+    return 1;
+}
+
 /* create a sorted_set_maker that will make a sorted sorted with this number
  * of keys
  *
@@ -466,6 +580,8 @@ struct sorted_set_maker {
  * points, unlike the propabilistic distribution of creating a set and then
  * adding them one by one without using a maker
  *
+ * all of the nodes are allocated up front, out of a single slab
+ *
  * if n_keys == 0, there's no clear reason to call this function, but it
  * handles this case just fine anyways.
  */
@@ -480,7 +596,7 @@ struct sorted_set_maker {
     }
 
     *sorted_set_maker = (struct sorted_set_maker) {
-        .sorted_set = malloc(sizeof(*sorted_set_maker->sorted_set))
+        .sorted_set = sorted_set_create()
     };
     if (!sorted_set_maker->sorted_set) {
         free(sorted_set_maker);
@@ -502,107 +618,54 @@ struct sorted_set_maker {
 
     struct sorted_set * sorted_set = sorted_set_maker->sorted_set;
 
-    size_t layers = 0;
-    for (size_t n = n_keys; n > 1; n /= 2) {
+    size_t layers = 1;
+    for (size_t n = n_keys; n > 3; n /= 2) {
         layers++;
     }
 
-    size_t * landmarks = malloc(sizeof(*landmarks) * layers);
-    if (!landmarks) {
-        free(sorted_set_maker->sorted_set);
-        free(sorted_set_maker);
-        return NULL;
+    /* landmarks[j] is the spacing of the nodes that reach layer j */
+    size_t landmarks[SORTED_SET_LAYERS_MAX];
+    for (size_t j = 1, n = n_keys / 2; j < layers; j++, n /= 2) {
+        landmarks[layers - j] = n;
     }
 
-    size_t i = layers - 1;
-    for (size_t n = n_keys / 2; n > 1; n /= 2) {
-        landmarks[i] = n;
-        i--;
+    /* size the slab for exactly the nodes we're about to make */
+    size_t slab_size = 0;
+    for (size_t i = 0; i < n_keys; i++) {
+        slab_size += node_size(maker_level(i, landmarks, layers));
     }
 
-    sorted_set->layers = layers;
-    sorted_set->next = calloc(layers, sizeof(*sorted_set->next));
-    sorted_set->size = 0;
-
-    if (!sorted_set->next) {
-        free(landmarks);
-        free(sorted_set_maker->sorted_set);
+    if (!sorted_set_add_slab(sorted_set, slab_size)) {
+        sorted_set_destroy_except_keys(sorted_set);
         free(sorted_set_maker);
         return NULL;
     }
 
-    struct node ** update = malloc(sizeof(*update) * layers);
-    if (!update) {
-        free(landmarks);
-        free(sorted_set->next);
-        free(sorted_set_maker->sorted_set);
-        free(sorted_set_maker);
-        return NULL;
-    }
-    for (size_t i = 0; i < layers; i++) {
-        update[i] = (struct node *)sorted_set;
+    sorted_set->layers = layers;
+
+    struct node ** update[SORTED_SET_LAYERS_MAX];
+    for (size_t j = 0; j < layers; j++) {
+        update[j] = sorted_set->next;
     }
 
     for (size_t i = 0; i < n_keys; i++) {
-        size_t layer = 0;
-        for (size_t j = layers - 1; j > 0; j--) {
-            if (i % landmarks[j] == 0) {
-                layer = j;
-                break;
-            }
-        }
-        layer++;
-
-        struct node * node = malloc(sizeof(*node));
-        if (!node) {
-            struct node * node = sorted_set->next[layers - 1];
-            while (node) {
-                struct node * next = node->next[layers - 1];
-                free(node->next);
-                free(node);
-                node = next;
-            }
-            free(update);
-            free(landmarks);
-            free(sorted_set->next);
-            free(sorted_set_maker->sorted_set);
-            free(sorted_set_maker);
-            return NULL;
-        }
+        size_t level = maker_level(i, landmarks, layers);
 
-        *node = (struct node) {
-            .next = malloc(sizeof(*node->next) * (layer))
-        };
-
-        if (!node->next) {
-            struct node * node = sorted_set->next[layers - 1];
-            while (node) {
-                struct node * next = node->next[layers - 1];
-                free(node->next);
-                free(node);
-                node = next;
-            }
-            free(update);
-            free(landmarks);
-            free(sorted_set->next);
-            free(sorted_set_maker->sorted_set);
-            free(sorted_set_maker);
-            return NULL;
-        }
+        /* can't fail, the slab has room for every node */
+        struct node * node = node_create(sorted_set, level);
+        *node = (struct node) { };
 
-        for (size_t j = 0; j < layer; j++) {
-            update[j]->next[j] = node;
-            update[j] = node;
+        for (size_t j = 0; j < level; j++) {
+            update[j][j] = node;
+            update[j] = node->next;
         }
     }
 
-    for (size_t i = 0; i < layers; i++) {
-        update[i]->next[i] = NULL;
+    for (size_t j = 0; j < layers; j++) {
+        update[j][j] = NULL;
     }
 
     sorted_set_maker->next = sorted_set->next[0];
-    free(update);
-    free(landmarks);
     return sorted_set_maker;
 }
 
@@ -636,22 +699,13 @@ struct sorted_set * sorted_set_maker_finalize(
 void sorted_set_maker_destroy(
         struct sorted_set_maker * sorted_set_maker) [[gnu::nonnull(1)]]
 {
-    struct node * node = sorted_set_maker->sorted_set->next[0];
-    while (node != sorted_set_maker->next) {
-        struct node * next = node->next[0];
-        free(node->next);
+    struct sorted_set * sorted_set = sorted_set_maker->sorted_set;
+    for (struct node * node = sorted_set->next[0];
+            node != sorted_set_maker->next;
+            node = node->next[0]) {
         free(node->key);
-        free(node);
-        node = next;
-    }
-    while (node) {
-        struct node * next = node->next[0];
-        free(node->next);
-        free(node);
-        node = next;
     }
-    free(sorted_set_maker->sorted_set->next);
-    free(sorted_set_maker->sorted_set);
+    sorted_set_destroy_except_keys(sorted_set);
     free(sorted_set_maker);
 }
 
@@ -661,15 +715,7 @@ void sorted_set_maker_destroy(
 void sorted_set_maker_destroy_except_keys(
         struct sorted_set_maker * sorted_set_maker) [[gnu::nonnull(1)]]
 {
-    struct node * node = sorted_set_maker->sorted_set->next[0];
-    while (node) {
-        struct node * next = node->next[0];
-        free(node->next);
-        free(node);
-        node = next;
-    }
-    free(sorted_set_maker->sorted_set->next);
-    free(sorted_set_maker->sorted_set);
+    sorted_set_destroy_except_keys(sorted_set_maker->sorted_set);
     free(sorted_set_maker);
 }
 
@@ -695,6 +741,7 @@ bool sorted_set_maker_add_key(
     sorted_set_maker->next->key = key;
     sorted_set_maker->next->length = length;
     sorted_set_maker->next->data = data;
+    sorted_set_maker->sorted_set->size++;
     sorted_set_maker->next = sorted_set_maker->next->next[0];
     return !sorted_set_maker->next;
 }
@@ -0,0 +1,1009 @@
+/* File: src/util/sorted_set_btree.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "util/sorted_set.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/* a sorted set, as a B+tree
+ *
+ * this is an alternative to the skip list in sorted_set.c, chosen with
+ * configure.py --sorted-set-backend=btree. the nodes are a few cache lines
+ * each and keep the first eight bytes of each of their keys inline (as a
+ * big-endian integer, so they order the same way the keys do), so most of a
+ * search is a scan over one array without following any pointers.
+ *
+ * the keys, lengths, and data live in entries that never move, so that the
+ * results of sorted_set_lookup() stay valid as more keys are added (like
+ * they do with the skip list.)
+ */
+
+/* the most keys in a leaf, and the most children of an inner node */
+#ifndef SORTED_SET_BTREE_ORDER_DEFAULT
+#define SORTED_SET_BTREE_ORDER_DEFAULT 16
+#endif /* SORTED_SET_BTREE_ORDER_DEFAULT */
+
+#define ORDER SORTED_SET_BTREE_ORDER_DEFAULT
+static_assert(ORDER >= 4);
+
+/* the number of entries in the first entry block, which doubles up to
+ * SORTED_SET_BTREE_ENTRY_BLOCK_MAX_DEFAULT
+ */
+#ifndef SORTED_SET_BTREE_ENTRY_BLOCK_DEFAULT
+#define SORTED_SET_BTREE_ENTRY_BLOCK_DEFAULT 64
+#endif /* SORTED_SET_BTREE_ENTRY_BLOCK_DEFAULT */
+
+#ifndef SORTED_SET_BTREE_ENTRY_BLOCK_MAX_DEFAULT
+#define SORTED_SET_BTREE_ENTRY_BLOCK_MAX_DEFAULT 16384
+#endif /* SORTED_SET_BTREE_ENTRY_BLOCK_MAX_DEFAULT */
+
+/* nodes are at least half full, so this is far more than will ever be
+ * needed
+ */
+#define HEIGHT_MAX 64
+
+/* a key in the set
+ *
+ * this must line up with struct sorted_set_lookup_result, because lookups
+ * return a pointer to one
+ */
+struct entry {
+    char * key;
+    size_t length;
+    void * data;
+};
+
+static_assert(sizeof(struct entry) == sizeof(struct sorted_set_lookup_result));
+
+/* a block of entries */
+struct entry_block {
+    struct entry_block * next;
+    size_t used;
+    size_t size;
+    struct entry entries[];
+};
+
+/* a leaf, holding up to ORDER keys in order */
+struct leaf {
+    size_t count;
+    struct leaf * next; /* the leaf after this one, for in-order walks */
+    uint64_t prefixes[ORDER];
+    struct entry * entries[ORDER];
+};
+
+/* an inner node, with up to ORDER children
+ *
+ * keys[i] is the first key under children[i + 1]
+ */
+struct inner {
+    size_t count; /* of children */
+    uint64_t prefixes[ORDER - 1];
+    struct entry * keys[ORDER - 1];
+    void * children[ORDER];
+};
+
+/* a sorted set */
+struct sorted_set {
+    void * root; /* a leaf if height is 0, otherwise an inner */
+    size_t height;
+    size_t size;
+    struct leaf * first; /* the leftmost leaf */
+    struct entry_block * blocks; /* the most recent block */
+};
+
+/* the first eight bytes of this key as a big-endian integer, padded with
+ * zeroes, which orders the same way key_compare() does as far as it goes
+ */
+static uint64_t key_prefix(const char * key, size_t length)
+{
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; i++) {
+        prefix = prefix << 8 | (i < length ? (uint8_t)key[i] : 0);
+    }
+    return prefix;
+}
+
+/* returns 0 when equal, negative when key < entry's key, positive when
+ * key > entry's key
+ *
+ * keys compare bytewise, as unsigned chars, and then by length (the same as
+ * the skip list)
+ */
+static int key_compare(
+        const char * key,
+        size_t length,
+        uint64_t prefix,
+        uint64_t entry_prefix,
+        const struct entry * entry
+    )
+{
+    if (prefix != entry_prefix) {
+        return prefix < entry_prefix ? -1 : 1;
+    }
+
+    size_t min = length < entry->length ? length : entry->length;
+    int compare = memcmp(key, entry->key, min);
+    if (compare != 0) {
+        return compare;
+    }
+    return (length > entry->length) - (length < entry->length);
+}
+
+/* returns the index of the first of these n keys that key is not greater
+ * than (or n if there isn't one), and sets *equal if it is equal to it
+ */
+static size_t node_search(
+        const char * key,
+        size_t length,
+        uint64_t prefix,
+        const uint64_t * prefixes,
+        struct entry * const * entries,
+        size_t n,
+        bool * equal
+    ) [[gnu::nonnull(1, 4, 5, 7)]]
+{
+    size_t i = 0;
+
+    /* these are smaller from their prefix alone */
+    while (i < n && prefixes[i] < prefix) {
+        i++;
+    }
+
+    for (; i < n; i++) {
+        int compare = key_compare(key, length, prefix, prefixes[i], entries[i]);
+        if (compare <= 0) {
+            *equal = compare == 0;
+            return i;
+        }
+    }
+
+    *equal = false;
+    return n;
+}
+
+/* allocate an entry in this set
+ *
+ * returns NULL on memory error
+ */
+static struct entry * entry_create(
+        struct sorted_set * sorted_set) [[gnu::nonnull(1)]]
+{
+    struct entry_block * block = sorted_set->blocks;
+    if (!block || block->used == block->size) {
+        size_t size = SORTED_SET_BTREE_ENTRY_BLOCK_DEFAULT;
+        if (block) {
+            size = block->size * 2;
+            if (size > SORTED_SET_BTREE_ENTRY_BLOCK_MAX_DEFAULT) {
+                size = SORTED_SET_BTREE_ENTRY_BLOCK_MAX_DEFAULT;
+            }
+        }
+
+        struct entry_block * new_block = malloc(
+                sizeof(*new_block) + sizeof(*new_block->entries) * size);
+        if (!new_block) {
+            return NULL;
+        }
+
+        *new_block = (struct entry_block) {
+            .next = block,
+            .size = size
+        };
+        sorted_set->blocks = block = new_block;
+    }
+
+    return &block->entries[block->used++];
+}
+
+/* create an empty sorted set */
+[[nodiscard]] struct sorted_set * sorted_set_create()
+{
+    struct sorted_set * sorted_set = malloc(sizeof(*sorted_set));
+    if (!sorted_set) return NULL;
+
+    struct leaf * leaf = malloc(sizeof(*leaf));
+    if (!leaf) {
+        free(sorted_set);
+        return NULL;
+    }
+    *leaf = (struct leaf) { };
+
+    *sorted_set = (struct sorted_set) {
+        .root = leaf,
+        .first = leaf
+    };
+
+    return sorted_set;
+}
+
+/* free the inner nodes of this subtree (but not the leaves) */
+static void inner_free(struct inner * inner, size_t height)
+{
+    if (height > 1) {
+        for (size_t i = 0; i < inner->count; i++) {
+            inner_free(inner->children[i], height - 1);
+        }
+    }
+    free(inner);
+}
+
+/* destroy this sorted set without free'ing the keys */
+void sorted_set_destroy_except_keys(
+        struct sorted_set * sorted_set) [[gnu::nonnull(1)]]
+{
+    if (sorted_set->height > 0) {
+        inner_free(sorted_set->root, sorted_set->height);
+    }
+
+    struct leaf * leaf = sorted_set->first;
+    while (leaf) {
+        struct leaf * next = leaf->next;
+        free(leaf);
+        leaf = next;
+    }
+
+    struct entry_block * block = sorted_set->blocks;
+    while (block) {
+        struct entry_block * next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(sorted_set);
+}
+
+/* destroy this sorted set */
+void sorted_set_destroy(struct sorted_set * sorted_set) [[gnu::nonnull(1)]]
+{
+    for (struct leaf * leaf = sorted_set->first; leaf; leaf = leaf->next) {
+        for (size_t i = 0; i < leaf->count; i++) {
+            free(leaf->entries[i]->key);
+        }
+    }
+    sorted_set_destroy_except_keys(sorted_set);
+}
+
+/* return the number of keys added to this set */
+size_t sorted_set_size(struct sorted_set * sorted_set) [[gnu::nonnull(1)]]
+{
+    return sorted_set->size;
+}
+
+/* add this key of length to the sorted set, associating it with data
+ *
+ * if the key is added (i.e. if it is not a duplicate of a key currently in the
+ * set), the sorted_set takes ownership of this memory. do not free it after
+ * calling this function, unless the memory is extracted via an
+ * apply_and_destroy or transformation into a hash (and then from the hash.)
+ *
+ * note that this function operates on a char * because it is designed to be
+ * called on the result of u8_normxfrm() being called on a uint8_t *. as far
+ * as this function (and the sorted set) is concerned, key is just a block of
+ * bytes of a given length where we can compare the contents of individual
+ * bytes with <, ==, and > and get consistent results.
+ *
+ * returns SORTED_SET_ADD_KEY_UNIQUE if the key was not already in the set,
+ * or SORTED_SET_ADD_KEY_DUPLICATE otherwise
+ */
+enum sorted_set_add_key_result sorted_set_add_key(
+        struct sorted_set * sorted_set,
+        char * key,
+        size_t length,
+        void * data
+    ) [[gnu::nonnull(1, 2)]]
+{
+    uint64_t prefix = key_prefix(key, length);
+    bool equal;
+
+    /* path[level] is the inner node at that height above the leaves that we
+     * passed through, and indices[level] the child we took
+     */
+    struct inner * path[HEIGHT_MAX + 1];
+    size_t indices[HEIGHT_MAX + 1];
+
+    void * node = sorted_set->root;
+    for (size_t level = sorted_set->height; level > 0; level--) {
+        struct inner * inner = node;
+        size_t i = node_search(
+                key, length, prefix, inner->prefixes, inner->keys,
+                inner->count - 1, &equal);
+        if (equal) {
+            return SORTED_SET_ADD_KEY_DUPLICATE;
+        }
+        path[level] = inner;
+        indices[level] = i;
+        node = inner->children[i];
+    }
+
+    struct leaf * leaf = node;
+    size_t position = node_search(
+            key, length, prefix, leaf->prefixes, leaf->entries, leaf->count,
+            &equal);
+    if (equal) {
+        return SORTED_SET_ADD_KEY_DUPLICATE;
+    }
+
+    /* allocate everything up front, so that a memory error can't leave the
+     * tree half split: a leaf if this one is full, an inner node for each
+     * full one above it, and a new root if they're all full
+     */
+    size_t splits = 0;
+    if (leaf->count == ORDER) {
+        splits = 1;
+        while (splits <= sorted_set->height && path[splits]->count == ORDER) {
+            splits++;
+        }
+    }
+    bool new_root = splits > sorted_set->height;
+    assert(sorted_set->height + new_root <= HEIGHT_MAX);
+
+    struct leaf * new_leaf = NULL;
+    struct inner * new_inners[HEIGHT_MAX + 1] = { };
+    bool okay = true;
+    if (splits > 0) {
+        okay = (new_leaf = malloc(sizeof(*new_leaf)));
+    }
+    for (size_t level = 1; okay && level < splits + new_root; level++) {
+        okay = (new_inners[level] = malloc(sizeof(*new_inners[level])));
+    }
+    struct entry * entry = okay ? entry_create(sorted_set) : NULL;
+    if (!entry) {
+        free(new_leaf);
+        for (size_t level = 1; level < splits + new_root; level++) {
+            free(new_inners[level]);
+        }
+        return SORTED_SET_ADD_KEY_ERROR;
+    }
+
+    *entry = (struct entry) {
+        .key = key,
+        .length = length,
+        .data = data
+    };
+    sorted_set->size++;
+
+    if (!new_leaf) {
+        memmove(&leaf->prefixes[position + 1], &leaf->prefixes[position],
+                sizeof(*leaf->prefixes) * (leaf->count - position));
+        memmove(&leaf->entries[position + 1], &leaf->entries[position],
+                sizeof(*leaf->entries) * (leaf->count - position));
+        leaf->prefixes[position] = prefix;
+        leaf->entries[position] = entry;
+        leaf->count++;
+        return SORTED_SET_ADD_KEY_UNIQUE;
+    }
+
+    /* split the leaf: lay out all ORDER + 1 keys in order, then give the
+     * first half to the old leaf and the rest to the new one
+     */
+    uint64_t prefixes[ORDER + 1];
+    struct entry * entries[ORDER + 1];
+    memcpy(prefixes, leaf->prefixes, sizeof(*prefixes) * position);
+    memcpy(entries, leaf->entries, sizeof(*entries) * position);
+    prefixes[position] = prefix;
+    entries[position] = entry;
+    memcpy(&prefixes[position + 1], &leaf->prefixes[position],
+           sizeof(*prefixes) * (ORDER - position));
+    memcpy(&entries[position + 1], &leaf->entries[position],
+           sizeof(*entries) * (ORDER - position));
+
+    constexpr size_t leaf_left = (ORDER + 1) / 2;
+    leaf->count = leaf_left;
+    memcpy(leaf->prefixes, prefixes, sizeof(*prefixes) * leaf_left);
+    memcpy(leaf->entries, entries, sizeof(*entries) * leaf_left);
+
+    new_leaf->count = ORDER + 1 - leaf_left;
+    memcpy(new_leaf->prefixes, &prefixes[leaf_left],
+           sizeof(*prefixes) * new_leaf->count);
+    memcpy(new_leaf->entries, &entries[leaf_left],
+           sizeof(*entries) * new_leaf->count);
+    new_leaf->next = leaf->next;
+    leaf->next = new_leaf;
+
+    /* then carry the new node and its first key up the path */
+    void * right = new_leaf;
+    uint64_t separator_prefix = new_leaf->prefixes[0];
+    struct entry * separator = new_leaf->entries[0];
+
+    for (size_t level = 1; ; level++) {
+        if (level > sorted_set->height) {
+            struct inner * root = new_inners[level];
+            *root = (struct inner) {
+                .count = 2,
+                .prefixes = { separator_prefix },
+                .keys = { separator },
+                .children = { sorted_set->root, right }
+            };
+            sorted_set->root = root;
+            sorted_set->height++;
+            break;
+        }
+
+        struct inner * inner = path[level];
+        size_t i = indices[level];
+
+        if (inner->count < ORDER) {
+            size_t n_keys = inner->count - 1;
+            memmove(&inner->prefixes[i + 1], &inner->prefixes[i],
+                    sizeof(*inner->prefixes) * (n_keys - i));
+            memmove(&inner->keys[i + 1], &inner->keys[i],
+                    sizeof(*inner->keys) * (n_keys - i));
+            memmove(&inner->children[i + 2], &inner->children[i + 1],
+                    sizeof(*inner->children) * (inner->count - i - 1));
+            inner->prefixes[i] = separator_prefix;
+            inner->keys[i] = separator;
+            inner->children[i + 1] = right;
+            inner->count++;
+            break;
+        }
+
+        /* split this inner node the same way, except that the key between
+         * the halves moves up rather than being copied
+         */
+        uint64_t key_prefixes[ORDER];
+        struct entry * keys[ORDER];
+        void * children[ORDER + 1];
+
+        memcpy(key_prefixes, inner->prefixes, sizeof(*key_prefixes) * i);
+        memcpy(keys, inner->keys, sizeof(*keys) * i);
+        key_prefixes[i] = separator_prefix;
+        keys[i] = separator;
+        memcpy(&key_prefixes[i + 1], &inner->prefixes[i],
+               sizeof(*key_prefixes) * (ORDER - 1 - i));
+        memcpy(&keys[i + 1], &inner->keys[i],
+               sizeof(*keys) * (ORDER - 1 - i));
+
+        memcpy(children, inner->children, sizeof(*children) * (i + 1));
+        children[i + 1] = right;
+        memcpy(&children[i + 2], &inner->children[i + 1],
+               sizeof(*children) * (ORDER - 1 - i));
+
+        constexpr size_t inner_left = (ORDER + 1) / 2;
+        struct inner * new_inner = new_inners[level];
+
+        inner->count = inner_left;
+        memcpy(inner->prefixes, key_prefixes,
+               sizeof(*key_prefixes) * (inner_left - 1));
+        memcpy(inner->keys, keys, sizeof(*keys) * (inner_left - 1));
+        memcpy(inner->children, children, sizeof(*children) * inner_left);
+
+        new_inner->count = ORDER + 1 - inner_left;
+        memcpy(new_inner->prefixes, &key_prefixes[inner_left],
+               sizeof(*key_prefixes) * (new_inner->count - 1));
+        memcpy(new_inner->keys, &keys[inner_left],
+               sizeof(*keys) * (new_inner->count - 1));
+        memcpy(new_inner->children, &children[inner_left],
+               sizeof(*children) * new_inner->count);
+
+        right = new_inner;
+        separator_prefix = key_prefixes[inner_left - 1];
+        separator = keys[inner_left - 1];
+    }
+
+    return SORTED_SET_ADD_KEY_UNIQUE;
+}
+
+/* apply this function to every key in sorted order
+ *
+ * the ptr passed to sorted_set_apply is passed to the callback as well
+ */
+void sorted_set_apply(
+        struct sorted_set * sorted_set,
+        void (*fn)(
+            const char * key,
+            size_t length,
+            void * data,
+            void * ptr
+        ),
+        void * ptr
+    ) [[gnu::nonnull(1, 2)]]
+{
+    for (struct leaf * leaf = sorted_set->first; leaf; leaf = leaf->next) {
+        for (size_t i = 0; i < leaf->count; i++) {
+            struct entry * entry = leaf->entries[i];
+            fn(entry->key, entry->length, entry->data, ptr);
+        }
+    }
+}
+
+/* apply this function to every key in sorted order while destroying the
+ * sorted set.
+ *
+ * the value of the key is passed as a non-const to the callback and must
+ * either be retained or free'd as (unlike sorted_set_destroy) this function
+ * does not free it when destroying the sorted_set.
+ *
+ * the ptr passed to sorted_set_apply is passed to the callback as well.
+ */
+void sorted_set_apply_and_destroy(
+        struct sorted_set * sorted_set,
+        void (*fn)(
+            char * key,
+            size_t length,
+            void * data,
+            void * ptr
+        ),
+        void * ptr
+    ) [[gnu::nonnull(1, 2)]]
+{
+    for (struct leaf * leaf = sorted_set->first; leaf; leaf = leaf->next) {
+        for (size_t i = 0; i < leaf->count; i++) {
+            struct entry * entry = leaf->entries[i];
+            fn(entry->key, entry->length, entry->data, ptr);
+        }
+    }
+    sorted_set_destroy_except_keys(sorted_set);
+}
+
+/* find this key in the sorted set and return a const pointer to it, or NULL
+ * if it's not in the set
+ *
+ * this function does not take ownership of key
+ *
+ * see sorted_set_add for why this is a char * and not a uint8_t *
+ */
+const struct sorted_set_lookup_result * sorted_set_lookup(
+        struct sorted_set * sorted_set,
+        const char * key,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    uint64_t prefix = key_prefix(key, length);
+    bool equal;
+
+    void * node = sorted_set->root;
+    for (size_t level = sorted_set->height; level > 0; level--) {
+        struct inner * inner = node;
+        size_t i = node_search(
+                key, length, prefix, inner->prefixes, inner->keys,
+                inner->count - 1, &equal);
+        /* keys equal to a separator are under the child to its right */
+        node = inner->children[i + equal];
+    }
+
+    struct leaf * leaf = node;
+    size_t i = node_search(
+            key, length, prefix, leaf->prefixes, leaf->entries, leaf->count,
+            &equal);
+    if (!equal) {
+        return NULL;
+    }
+
+    return (const struct sorted_set_lookup_result *)leaf->entries[i];
+}
+
+/* returns a cursor at the first key that is not less than this key (or, if
+ * after is true, greater than it)
+ */
+static struct sorted_set_cursor find_bound(
+        struct sorted_set * sorted_set,
+        const char * key,
+        size_t length,
+        bool after
+    ) [[gnu::nonnull(1, 2)]]
+{
+    uint64_t prefix = key_prefix(key, length);
+    bool equal;
+
+    void * node = sorted_set->root;
+    for (size_t level = sorted_set->height; level > 0; level--) {
+        struct inner * inner = node;
+        size_t i = node_search(
+                key, length, prefix, inner->prefixes, inner->keys,
+                inner->count - 1, &equal);
+        node = inner->children[i + equal];
+    }
+
+    struct leaf * leaf = node;
+    size_t i = node_search(
+            key, length, prefix, leaf->prefixes, leaf->entries, leaf->count,
+            &equal);
+    if (equal && after) {
+        i++;
+    }
+
+    /* the bound might be the first key of the next leaf */
+    if (i == leaf->count) {
+        leaf = leaf->next;
+        i = 0;
+    }
+
+    return (struct sorted_set_cursor) { .node = leaf, .index = i };
+}
+
+/* returns a cursor at the first key in the set */
+struct sorted_set_cursor sorted_set_first(
+        struct sorted_set * sorted_set) [[gnu::nonnull(1)]]
+{
+    /* only an empty set has an empty leaf */
+    return (struct sorted_set_cursor) {
+        .node = sorted_set->first->count ? sorted_set->first : NULL
+    };
+}
+
+/* returns a cursor at the first key in the set that is not less than this
+ * key of length
+ *
+ * this function does not take ownership of key
+ */
+struct sorted_set_cursor sorted_set_lower_bound(
+        struct sorted_set * sorted_set,
+        const char * key,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    return find_bound(sorted_set, key, length, false);
+}
+
+/* returns a cursor at the first key in the set that is greater than this
+ * key of length
+ *
+ * this function does not take ownership of key
+ */
+struct sorted_set_cursor sorted_set_upper_bound(
+        struct sorted_set * sorted_set,
+        const char * key,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    return find_bound(sorted_set, key, length, true);
+}
+
+/* returns a cursor over just the keys that begin with this prefix of length
+ *
+ * this is sorted_set_lower_bound() followed by
+ * sorted_set_cursor_limit_prefix(), so prefix must outlive the cursor
+ */
+struct sorted_set_cursor sorted_set_prefix(
+        struct sorted_set * sorted_set,
+        const char * prefix,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    struct sorted_set_cursor cursor =
+        sorted_set_lower_bound(sorted_set, prefix, length);
+    sorted_set_cursor_limit_prefix(&cursor, prefix, length);
+    return cursor;
+}
+
+/* make this cursor stop at the first key that doesn't begin with this prefix
+ * of length, which is not copied and must outlive the cursor
+ */
+void sorted_set_cursor_limit_prefix(
+        struct sorted_set_cursor * cursor,
+        const char * prefix,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    cursor->prefix = prefix;
+    cursor->prefix_length = length;
+}
+
+/* return the key this cursor is at and advance it to the next one, or return
+ * NULL if there are no more keys
+ */
+const struct sorted_set_lookup_result * sorted_set_cursor_next(
+        struct sorted_set_cursor * cursor) [[gnu::nonnull(1)]]
+{
+    struct leaf * leaf = cursor->node;
+    if (!leaf) {
+        return NULL;
+    }
+
+    struct entry * entry = leaf->entries[cursor->index];
+    if (cursor->prefix && (entry->length < cursor->prefix_length ||
+                memcmp(entry->key, cursor->prefix, cursor->prefix_length))) {
+        cursor->node = NULL;
+        return NULL;
+    }
+
+    cursor->index++;
+    if (cursor->index == leaf->count) {
+        cursor->node = leaf->next;
+        cursor->index = 0;
+    }
+
+    return (const struct sorted_set_lookup_result *)entry;
+}
+
+/* a sorted_set_maker
+ *
+ * this allows insertion of pre-sorted keys into a sorted_set in O(1) time
+ * when the number of keys is known ahead of time
+ *
+ * all of the leaves and inner nodes are allocated on creation, the leaves
+ * are filled as keys are added, and the inner nodes are built over them on
+ * finalization
+ */
+struct sorted_set_maker {
+    struct sorted_set * sorted_set; /* the embedded sorted_set */
+    struct leaf * leaf; /* where will the next added key go? */
+    size_t n_keys;
+    size_t n_added;
+    size_t n_leaves;
+    size_t leaf_index; /* of leaf */
+
+    struct inner ** inners; /* preallocated for finalization */
+    size_t n_inners;
+    void ** level; /* scratch space for finalization, n_leaves long */
+    struct entry ** firsts; /* likewise */
+};
+
+/* when spreading n_items evenly over n_nodes nodes, the index of the first
+ * item that goes in the node at this index (or n_items, for index n_nodes)
+ */
+static size_t spread(size_t index, size_t n_items, size_t n_nodes)
+{
+    return index * (n_items / n_nodes) + index * (n_items % n_nodes) / n_nodes;
+}
+
+/* destroy this sorted_set_maker and any partially-constructed set inside it,
+ * but do not free any keys
+ */
+void sorted_set_maker_destroy_except_keys(
+        struct sorted_set_maker * sorted_set_maker) [[gnu::nonnull(1)]]
+{
+    sorted_set_destroy_except_keys(sorted_set_maker->sorted_set);
+    if (sorted_set_maker->inners) {
+        for (size_t i = 0; i < sorted_set_maker->n_inners; i++) {
+            free(sorted_set_maker->inners[i]);
+        }
+    }
+    free(sorted_set_maker->inners);
+    free(sorted_set_maker->level);
+    free(sorted_set_maker->firsts);
+    free(sorted_set_maker);
+}
+
+/* destroy this sorted_set_maker and any partially-constructed set inside it,
+ * and free any keys
+ */
+void sorted_set_maker_destroy(
+        struct sorted_set_maker * sorted_set_maker) [[gnu::nonnull(1)]]
+{
+    struct sorted_set * sorted_set = sorted_set_maker->sorted_set;
+    for (struct leaf * leaf = sorted_set->first; leaf; leaf = leaf->next) {
+        for (size_t i = 0; i < leaf->count; i++) {
+            free(leaf->entries[i]->key);
+        }
+    }
+    sorted_set_maker_destroy_except_keys(sorted_set_maker);
+}
+
+/* create a sorted_set_maker that will make a sorted sorted with this number
+ * of keys
+ *
+ * the expected usage is to then call sorted_set_maker_add_key n_keys times
+ * and then finally sorted_set_maker_finalize() to transform the maker into
+ * a sorted_set
+ *
+ * sets created using this method have nodes that are as full as they can be
+ * while being evenly filled
+ *
+ * if n_keys == 0, there's no clear reason to call this function, but it
+ * handles this case just fine anyways.
+ */
+[[nodiscard]] struct sorted_set_maker * sorted_set_maker_create(
+        size_t n_keys)
+{
+    struct sorted_set_maker * sorted_set_maker =
+        malloc(sizeof(*sorted_set_maker));
+
+    if (!sorted_set_maker) {
+        return NULL;
+    }
+
+    *sorted_set_maker = (struct sorted_set_maker) {
+        .sorted_set = sorted_set_create(),
+        .n_keys = n_keys,
+        .n_leaves = 1
+    };
+    if (!sorted_set_maker->sorted_set) {
+        free(sorted_set_maker);
+        return NULL;
+    }
+
+    if (n_keys == 0) {
+        /* sorted_set_maker->leaf is NULL, so sorted_set_maker_complete()
+         * returns true and the (empty) set is ready as is
+         */
+        return sorted_set_maker;
+    }
+
+    struct sorted_set * sorted_set = sorted_set_maker->sorted_set;
+
+    /* the leaves, chained after the one sorted_set_create() made */
+    size_t n_leaves = (n_keys + ORDER - 1) / ORDER;
+    struct leaf * last = sorted_set->first;
+    for (size_t i = 1; i < n_leaves; i++) {
+        struct leaf * leaf = malloc(sizeof(*leaf));
+        if (!leaf) {
+            sorted_set_maker_destroy_except_keys(sorted_set_maker);
+            return NULL;
+        }
+        *leaf = (struct leaf) { };
+        last->next = leaf;
+        last = leaf;
+    }
+    sorted_set_maker->n_leaves = n_leaves;
+
+    /* the inner nodes */
+    size_t n_inners = 0;
+    for (size_t n = n_leaves; n > 1; ) {
+        n = (n + ORDER - 1) / ORDER;
+        n_inners += n;
+    }
+
+    sorted_set_maker->inners = calloc(
+            n_inners, sizeof(*sorted_set_maker->inners));
+    sorted_set_maker->n_inners = n_inners;
+    sorted_set_maker->level = malloc(
+            sizeof(*sorted_set_maker->level) * n_leaves);
+    sorted_set_maker->firsts = malloc(
+            sizeof(*sorted_set_maker->firsts) * n_leaves);
+    if ((n_inners && !sorted_set_maker->inners) ||
+            !sorted_set_maker->level || !sorted_set_maker->firsts) {
+        sorted_set_maker_destroy_except_keys(sorted_set_maker);
+        return NULL;
+    }
+    for (size_t i = 0; i < n_inners; i++) {
+        sorted_set_maker->inners[i] = malloc(
+                sizeof(*sorted_set_maker->inners[i]));
+        if (!sorted_set_maker->inners[i]) {
+            sorted_set_maker_destroy_except_keys(sorted_set_maker);
+            return NULL;
+        }
+    }
+
+    /* and the entries, all in one block */
+    struct entry_block * block = malloc(
+            sizeof(*block) + sizeof(*block->entries) * n_keys);
+    if (!block) {
+        sorted_set_maker_destroy_except_keys(sorted_set_maker);
+        return NULL;
+    }
+    *block = (struct entry_block) {
+        .size = n_keys
+    };
+    sorted_set->blocks = block;
+
+    sorted_set_maker->leaf = sorted_set->first;
+    return sorted_set_maker;
+}
+
+/* returns true if the number of keys added to this sorted_set_maker is equal
+ * to the number of keys preallocated on its creation
+ */
+bool sorted_set_maker_complete(
+        const struct sorted_set_maker * sorted_set_maker) [[gnu::nonnull(1)]]
+{
+    return !sorted_set_maker->leaf;
+}
+
+/* finalize this sorted_set_maker, destroying it and returning the sorted_set
+ * that was made
+ *
+ * this must be called after a number of keys have been added to the maker
+ * equal to the number that were preallocated.
+ */
+struct sorted_set * sorted_set_maker_finalize(
+        struct sorted_set_maker * sorted_set_maker) [[gnu::nonnull(1)]]
+{
+    assert(sorted_set_maker_complete(sorted_set_maker));
+    struct sorted_set * sorted_set = sorted_set_maker->sorted_set;
+
+    /* build each level over the one below it, spreading the children evenly
+     * and reusing level[] and firsts[] in place
+     */
+    size_t n = 0;
+    for (struct leaf * leaf = sorted_set->first;
+            leaf && sorted_set_maker->n_keys;
+            leaf = leaf->next) {
+        sorted_set_maker->level[n] = leaf;
+        sorted_set_maker->firsts[n] = leaf->entries[0];
+        n++;
+    }
+
+    size_t next_inner = 0;
+    while (n > 1) {
+        size_t n_parents = (n + ORDER - 1) / ORDER;
+        for (size_t p = 0; p < n_parents; p++) {
+            size_t start = spread(p, n, n_parents);
+            size_t end = spread(p + 1, n, n_parents);
+
+            struct inner * inner = sorted_set_maker->inners[next_inner++];
+            inner->count = end - start;
+            for (size_t c = start; c < end; c++) {
+                inner->children[c - start] = sorted_set_maker->level[c];
+                if (c > start) {
+                    struct entry * first = sorted_set_maker->firsts[c];
+                    inner->keys[c - start - 1] = first;
+                    inner->prefixes[c - start - 1] =
+                        key_prefix(first->key, first->length);
+                }
+            }
+
+            sorted_set_maker->firsts[p] = sorted_set_maker->firsts[start];
+            sorted_set_maker->level[p] = inner;
+        }
+        n = n_parents;
+        sorted_set->height++;
+    }
+
+    if (n == 1) {
+        sorted_set->root = sorted_set_maker->level[0];
+    }
+    assert(next_inner == sorted_set_maker->n_inners);
+
+    free(sorted_set_maker->inners);
+    free(sorted_set_maker->level);
+    free(sorted_set_maker->firsts);
+    free(sorted_set_maker);
+    return sorted_set;
+}
+
+/* add this key to this sorted_set_maker
+ *
+ * this takes ownership of key
+ *
+ * see sorted_set_add_key for why key is a char * and not a uint8_t *
+ *
+ * returns true if the sorted_set_maker is now complete
+ *
+ * it is an error to call this on a complete sorted_set_maker (this includes
+ * a sorted_set_maker created with n_keys == 0)
+ */
+bool sorted_set_maker_add_key(
+        struct sorted_set_maker * sorted_set_maker,
+        char * key,
+        size_t length,
+        void * data
+    ) [[gnu::nonnull(1, 2)]]
+{
+    assert(sorted_set_maker->leaf);
+    struct sorted_set * sorted_set = sorted_set_maker->sorted_set;
+
+    struct entry * entry = &sorted_set->blocks->entries[
+        sorted_set->blocks->used++];
+    *entry = (struct entry) {
+        .key = key,
+        .length = length,
+        .data = data
+    };
+
+    struct leaf * leaf = sorted_set_maker->leaf;
+    leaf->prefixes[leaf->count] = key_prefix(key, length);
+    leaf->entries[leaf->count] = entry;
+    leaf->count++;
+
+    sorted_set->size++;
+    sorted_set_maker->n_added++;
+
+    if (sorted_set_maker->n_added == spread(
+                sorted_set_maker->leaf_index + 1,
+                sorted_set_maker->n_keys,
+                sorted_set_maker->n_leaves)) {
+        sorted_set_maker->leaf = leaf->next;
+        sorted_set_maker->leaf_index++;
+    }
+
+    return !sorted_set_maker->leaf;
+}
@@ -0,0 +1,270 @@
+/* File: src/util/string_pool.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "util/string_pool.h"
+#include "util/arena.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the size of the blocks strings are packed into
+ *
+ * a string too big to fit in a quarter of one gets an allocation of its own
+ * instead, so that starting a new block never wastes more than that
+ */
+#ifndef STRING_POOL_BLOCK_DEFAULT
+#define STRING_POOL_BLOCK_DEFAULT 16384
+#endif /* STRING_POOL_BLOCK_DEFAULT */
+
+/* the number of slots in a new pool's table, which must be a power of two */
+#ifndef STRING_POOL_SLOTS_DEFAULT
+#define STRING_POOL_SLOTS_DEFAULT 256
+#endif /* STRING_POOL_SLOTS_DEFAULT */
+
+/* an interned string, whose id is its position in entries */
+struct entry {
+    const uint8_t * string;
+    size_t length;
+    uint32_t hash;
+};
+
+/* a string pool */
+struct string_pool {
+    struct arena * arena;
+    uint8_t * block; /* the block being packed, from the arena */
+    size_t block_used;
+
+    struct entry * entries;
+    size_t n_entries;
+    size_t entries_capacity;
+
+    /* ids, open addressed (with linear probing) and never more than half
+     * full, where STRING_POOL_NO_ID is an unused slot
+     */
+    uint32_t * slots;
+    size_t slots_capacity;
+};
+
+/* FNV-1a */
+static uint32_t hash_string(
+        const uint8_t * string, size_t length) [[gnu::nonnull(1)]]
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= string[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* create an empty string pool */
+[[nodiscard]] struct string_pool * string_pool_create()
+{
+    struct string_pool * pool = malloc(sizeof(*pool));
+    if (!pool) {
+        return NULL;
+    }
+    *pool = (struct string_pool) {
+        .arena = arena_create(STRING_POOL_BLOCK_DEFAULT),
+        .block_used = STRING_POOL_BLOCK_DEFAULT,
+        .slots = malloc(sizeof(*pool->slots) * STRING_POOL_SLOTS_DEFAULT),
+        .slots_capacity = STRING_POOL_SLOTS_DEFAULT
+    };
+    if (!pool->arena || !pool->slots) {
+        if (pool->arena) {
+            arena_destroy(pool->arena);
+        }
+        free(pool->slots);
+        free(pool);
+        return NULL;
+    }
+    memset(pool->slots, 0xff, sizeof(*pool->slots) * pool->slots_capacity);
+    return pool;
+}
+
+/* destroy this string pool */
+void string_pool_destroy(struct string_pool * pool) [[gnu::nonnull(1)]]
+{
+    arena_destroy(pool->arena);
+    free(pool->entries);
+    free(pool->slots);
+    free(pool);
+}
+
+/* return the number of distinct strings in this pool */
+size_t string_pool_size(
+        const struct string_pool * pool) [[gnu::nonnull(1)]]
+{
+    return pool->n_entries;
+}
+
+/* return the slot holding this string, or the unused one where it would go */
+static uint32_t * slot_find(
+        const struct string_pool * pool,
+        const uint8_t * string,
+        size_t length,
+        uint32_t hash
+    ) [[gnu::nonnull(1, 2)]]
+{
+    size_t mask = pool->slots_capacity - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        uint32_t id = pool->slots[i];
+        if (id == STRING_POOL_NO_ID) {
+            return &pool->slots[i];
+        }
+        const struct entry * entry = &pool->entries[id];
+        if (entry->hash == hash && entry->length == length &&
+                !memcmp(entry->string, string, length)) {
+            return &pool->slots[i];
+        }
+    }
+}
+
+/* double the size of this pool's table, returning false on memory error */
+static bool slots_grow(struct string_pool * pool) [[gnu::nonnull(1)]]
+{
+    size_t capacity = pool->slots_capacity * 2;
+    uint32_t * slots = malloc(sizeof(*slots) * capacity);
+    if (!slots) {
+        return false;
+    }
+    memset(slots, 0xff, sizeof(*slots) * capacity);
+
+    size_t mask = capacity - 1;
+    for (size_t id = 0; id < pool->n_entries; id++) {
+        size_t i = pool->entries[id].hash & mask;
+        while (slots[i] != STRING_POOL_NO_ID) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id;
+    }
+
+    free(pool->slots);
+    pool->slots = slots;
+    pool->slots_capacity = capacity;
+    return true;
+}
+
+/* copy this string of length (and a null terminator) into the pool */
+static const uint8_t * copy_string(
+        struct string_pool * pool,
+        const uint8_t * string,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    if (length >= STRING_POOL_BLOCK_DEFAULT / 4) {
+        if (length == SIZE_MAX) {
+            return NULL;
+        }
+        uint8_t * copy = arena_alloc(pool->arena, length + 1);
+        if (!copy) {
+            return NULL;
+        }
+        memcpy(copy, string, length);
+        copy[length] = 0;
+        return copy;
+    }
+
+    if (STRING_POOL_BLOCK_DEFAULT - pool->block_used < length + 1) {
+        uint8_t * block = arena_alloc(pool->arena, STRING_POOL_BLOCK_DEFAULT);
+        if (!block) {
+            return NULL;
+        }
+        pool->block = block;
+        pool->block_used = 0;
+    }
+
+    uint8_t * copy = &pool->block[pool->block_used];
+    memcpy(copy, string, length);
+    copy[length] = 0;
+    pool->block_used += length + 1;
+    return copy;
+}
+
+/* intern this string of length and return its id */
+uint32_t string_pool_intern(
+        struct string_pool * pool,
+        const uint8_t * string,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    uint32_t hash = hash_string(string, length);
+    uint32_t * slot = slot_find(pool, string, length, hash);
+    if (*slot != STRING_POOL_NO_ID) {
+        return *slot;
+    }
+
+    if (pool->n_entries == STRING_POOL_NO_ID) {
+        return STRING_POOL_NO_ID;
+    }
+
+    if ((pool->n_entries + 1) * 2 > pool->slots_capacity) {
+        if (!slots_grow(pool)) {
+            return STRING_POOL_NO_ID;
+        }
+        slot = slot_find(pool, string, length, hash);
+    }
+
+    if (pool->n_entries == pool->entries_capacity) {
+        size_t capacity = pool->entries_capacity ?
+            pool->entries_capacity * 2 : STRING_POOL_SLOTS_DEFAULT / 2;
+        struct entry * entries = realloc(
+                pool->entries, sizeof(*entries) * capacity);
+        if (!entries) {
+            return STRING_POOL_NO_ID;
+        }
+        pool->entries = entries;
+        pool->entries_capacity = capacity;
+    }
+
+    const uint8_t * copy = copy_string(pool, string, length);
+    if (!copy) {
+        return STRING_POOL_NO_ID;
+    }
+
+    uint32_t id = pool->n_entries++;
+    pool->entries[id] = (struct entry) {
+        .string = copy,
+        .length = length,
+        .hash = hash
+    };
+    *slot = id;
+    return id;
+}
+
+/* return the id of this string if it has been interned */
+uint32_t string_pool_find(
+        const struct string_pool * pool,
+        const uint8_t * string,
+        size_t length
+    ) [[gnu::nonnull(1, 2)]]
+{
+    return *slot_find(pool, string, length, hash_string(string, length));
+}
+
+/* return a view of the string with this id */
+struct string_view string_pool_view(
+        const struct string_pool * pool, uint32_t id) [[gnu::nonnull(1)]]
+{
+    return (struct string_view) {
+        .string = pool->entries[id].string,
+        .length = pool->entries[id].length
+    };
+}
@@ -0,0 +1,176 @@
+/* File: src/util/timer_wheel.c
+ * Part of cards <github.com/rmkrupp/cards>
+ *
+ * Copyright (C) 2024 Noah Santer <n.ed.santer@gmail.com>
+ * Copyright (C) 2024 Rebecca Krupp <beka.krupp@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "util/timer_wheel.h"
+
+#include <stdlib.h>
+
+/* a timer wheel */
+struct timer_wheel {
+    uint64_t now;
+    size_t n_slots;
+
+    /* each slot is the sentinel of a circular list of timers */
+    struct timer_wheel_timer slots[];
+};
+
+/* link timer into the circular list before sentinel */
+static void timer_link(
+        struct timer_wheel_timer * sentinel,
+        struct timer_wheel_timer * timer
+    ) [[gnu::nonnull(1, 2)]]
+{
+    timer->prev = sentinel->prev;
+    timer->next = sentinel;
+    sentinel->prev->next = timer;
+    sentinel->prev = timer;
+}
+
+/* unlink timer from whatever list it is in */
+static void timer_unlink(struct timer_wheel_timer * timer) [[gnu::nonnull(1)]]
+{
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev = NULL;
+    timer->next = NULL;
+}
+
+/* create a timer wheel with this many slots */
+[[nodiscard]] struct timer_wheel * timer_wheel_create(size_t n_slots)
+{
+    if (n_slots == 0) {
+        return NULL;
+    }
+
+    struct timer_wheel * wheel = malloc(
+            sizeof(*wheel) + sizeof(*wheel->slots) * n_slots);
+    if (!wheel) {
+        return NULL;
+    }
+
+    wheel->now = 0;
+    wheel->n_slots = n_slots;
+    for (size_t i = 0; i < n_slots; i++) {
+        wheel->slots[i].prev = &wheel->slots[i];
+        wheel->slots[i].next = &wheel->slots[i];
+    }
+
+    return wheel;
+}
+
+/* destroy this timer wheel */
+void timer_wheel_destroy(struct timer_wheel * wheel) [[gnu::nonnull(1)]]
+{
+    for (size_t i = 0; i < wheel->n_slots; i++) {
+        struct timer_wheel_timer * sentinel = &wheel->slots[i];
+        while (sentinel->next != sentinel) {
+            timer_unlink(sentinel->next);
+        }
+    }
+    free(wheel);
+}
+
+/* returns the number of times this wheel has ticked */
+uint64_t timer_wheel_now(const struct timer_wheel * wheel) [[gnu::nonnull(1)]]
+{
+    return wheel->now;
+}
+
+/* initialize this timer */
+void timer_wheel_timer_init(
+        struct timer_wheel_timer * timer) [[gnu::nonnull(1)]]
+{
+    *timer = (struct timer_wheel_timer) { };
+}
+
+/* returns true if this timer is scheduled on a wheel */
+bool timer_wheel_timer_pending(
+        const struct timer_wheel_timer * timer) [[gnu::nonnull(1)]]
+{
+    return timer->next != NULL;
+}
+
+/* schedule this timer to call fn(timer, ptr) after this many ticks */
+void timer_wheel_schedule(
+        struct timer_wheel * wheel,
+        struct timer_wheel_timer * timer,
+        uint64_t ticks,
+        void (*fn)(struct timer_wheel_timer * timer, void * ptr),
+        void * ptr
+    ) [[gnu::nonnull(1, 2, 4)]]
+{
+    if (timer_wheel_timer_pending(timer)) {
+        timer_unlink(timer);
+    }
+
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    timer->expires = wheel->now + ticks;
+    timer->fn = fn;
+    timer->ptr = ptr;
+
+    timer_link(&wheel->slots[timer->expires % wheel->n_slots], timer);
+}
+
+/* unschedule this timer, if it is scheduled */
+void timer_wheel_cancel(struct timer_wheel_timer * timer) [[gnu::nonnull(1)]]
+{
+    if (timer_wheel_timer_pending(timer)) {
+        timer_unlink(timer);
+    }
+}
+
+/* advance this wheel by one tick, firing the timers that expire on it */
+void timer_wheel_tick(struct timer_wheel * wheel) [[gnu::nonnull(1)]]
+{
+    wheel->now++;
+
+    struct timer_wheel_timer * sentinel =
+        &wheel->slots[wheel->now % wheel->n_slots];
+
+    /* move the slot onto a local list first, so that timers the callbacks
+     * schedule into this same slot aren't looked at again this tick, while
+     * timers they cancel are still simply unlinked from wherever they are
+     */
+    struct timer_wheel_timer pending;
+    if (sentinel->next == sentinel) {
+        return;
+    }
+    pending.next = sentinel->next;
+    pending.prev = sentinel->prev;
+    pending.next->prev = &pending;
+    pending.prev->next = &pending;
+    sentinel->next = sentinel;
+    sentinel->prev = sentinel;
+
+    while (pending.next != &pending) {
+        struct timer_wheel_timer * timer = pending.next;
+        timer_unlink(timer);
+
+        if (timer->expires > wheel->now) {
+            /* expires on a later lap of the wheel */
+            timer_link(sentinel, timer);
+            continue;
+        }
+
+        timer->fn(timer, timer->ptr);
+    }
+}